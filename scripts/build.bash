@@ -1,3 +1,3 @@
 #!/bin/bash
 
-g++ src/*.cpp src/**/*.cpp -L/usr/lib -lssl -lcrypto -lsqlite3 -o build/ddupes.o
+g++ src/*.cpp src/**/*.cpp -L/usr/lib -lssl -lcrypto -lsqlite3 -pthread -o build/ddupes.o
@@ -1,4 +1,4 @@
 #!/bin/bash
 
-g++ -g src/*.cpp src/**/*.cpp -L/usr/lib -lssl -lcrypto -lsqlite3 -o build/ddupes_debug.o
+g++ -g src/*.cpp src/**/*.cpp -L/usr/lib -lssl -lcrypto -lsqlite3 -pthread -o build/ddupes_debug.o
 gdb build/ddupes_debug.o
\ No newline at end of file
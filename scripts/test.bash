@@ -1,3 +1,3 @@
 #!/bin/bash
 
-g++ tests/$1 -L/usr/lib -lssl -lcrypto -lsqlite3 -o build/test.o && build/test.o && echo "Success"
+g++ tests/$1 -L/usr/lib -lssl -lcrypto -lsqlite3 -pthread -o build/test.o && build/test.o && echo "Success"
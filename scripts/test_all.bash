@@ -4,6 +4,6 @@ echo "Running all tests!"
 for TEST_FILE in tests/**/test_*.cpp tests/test_*.cpp
 do  
   echo "Running $TEST_FILE";
-  g++ $TEST_FILE -L/usr/lib -lssl -lcrypto -lsqlite3 -o build/test.o && build/test.o && echo "Success"
+  g++ $TEST_FILE -L/usr/lib -lssl -lcrypto -lsqlite3 -pthread -o build/test.o && build/test.o && echo "Success"
 done
 echo "Done!"
\ No newline at end of file
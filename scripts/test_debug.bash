@@ -1,4 +1,4 @@
 #!/bin/bash
 
-g++ -g tests/$1 -L/usr/lib -lssl -lcrypto -lsqlite3 -o build/test_debug.o 
+g++ -g tests/$1 -L/usr/lib -lssl -lcrypto -lsqlite3 -pthread -o build/test_debug.o 
 gdb "build/test_debug.o"
\ No newline at end of file
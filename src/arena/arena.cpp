@@ -0,0 +1,84 @@
+#include "./arena.h"
+
+#include <cstring>
+
+bool arena_stats::operator==(arena_stats const &rhs) const {
+  return rhs.allocations == allocations &&
+         rhs.bytes_allocated == bytes_allocated &&
+         rhs.bytes_reserved == bytes_reserved && rhs.blocks == blocks;
+}
+
+arena *initArena(std::size_t block_size) {
+  return new arena{.head = nullptr, .block_size = block_size, .stats = {}};
+}
+
+arena_block *createArenaBlock(arena *arena, std::size_t size) {
+  arena_block *block = new arena_block{
+      .next = nullptr, .data = new char[size], .size = size, .used = 0};
+  arena->stats.bytes_reserved += size;
+  ++arena->stats.blocks;
+  return block;
+}
+
+void *arenaAlloc(arena *arena, std::size_t size, std::size_t alignment) {
+  ++arena->stats.allocations;
+  arena->stats.bytes_allocated += size;
+
+  if (size > arena->block_size) {
+    // Oversized requests get a block of their own. It is linked behind the
+    // current block so the current block keeps being bumped.
+    arena_block *block = createArenaBlock(arena, size);
+    block->used = size;
+    if (arena->head == nullptr) {
+      arena->head = block;
+    } else {
+      block->next = arena->head->next;
+      arena->head->next = block;
+    }
+    return block->data;
+  }
+
+  // Blocks come from new[] so they start aligned for any fundamental type.
+  arena_block *block = arena->head;
+  std::size_t offset = 0;
+  if (block != nullptr) {
+    offset = (block->used + alignment - 1) & ~(alignment - 1);
+  }
+
+  if (block == nullptr || offset + size > block->size) {
+    block = createArenaBlock(arena, arena->block_size);
+    block->next = arena->head;
+    arena->head = block;
+    offset = 0;
+  }
+
+  block->used = offset + size;
+  return block->data + offset;
+}
+
+char *arenaStringDup(arena *arena, str_const string) {
+  std::size_t length = stringLength(string);
+  char *string_copy = static_cast<char *>(arenaAlloc(arena, length));
+  std::memcpy(string_copy, string, length);
+  return string_copy;
+}
+
+hash arenaHashDup(arena *arena, hash_const hash_one) {
+  hash hash_copy = static_cast<hash>(arenaAlloc(arena, MD5_DIGEST_LENGTH));
+  std::memcpy(hash_copy, hash_one, MD5_DIGEST_LENGTH);
+  return hash_copy;
+}
+
+arena_stats arenaStats(arena const *arena) { return arena->stats; }
+
+void freeArena(arena *arena) {
+  arena_block *block = arena->head;
+  while (block != nullptr) {
+    arena_block *next = block->next;
+    delete[] block->data;
+    delete block;
+    block = next;
+  }
+
+  delete arena;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+#include "../lib.h"
+
+/**
+ * Bump pointer allocator. Memory is handed out from large blocks and is only
+ * ever released all at once by freeArena. Used for the names and hashes that
+ * live for the whole run of a command.
+ */
+constexpr std::size_t ARENA_BLOCK_SIZE = 4194304; // 4 MiB
+
+struct arena_block {
+  arena_block *next;
+  char *data;
+  std::size_t size;
+  std::size_t used;
+};
+
+struct arena_stats {
+  std::size_t allocations;
+  std::size_t bytes_allocated;
+  std::size_t bytes_reserved;
+  std::size_t blocks;
+
+  bool operator==(arena_stats const &rhs) const;
+};
+
+struct arena {
+  arena_block *head;
+  std::size_t block_size;
+  arena_stats stats;
+};
+
+arena *initArena(std::size_t block_size = ARENA_BLOCK_SIZE);
+void *arenaAlloc(arena *arena, std::size_t size, std::size_t alignment = 1);
+char *arenaStringDup(arena *arena, str_const string);
+hash arenaHashDup(arena *arena, hash_const hash);
+arena_stats arenaStats(arena const *arena);
+void freeArena(arena *arena);
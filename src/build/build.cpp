@@ -1,5 +1,8 @@
 #include "./build.h"
 
+#include "./lockstep.h"
+#include "./manifest.h"
+
 /**
  * TODO:
  * - Test to make sure we don't pass in the same path.
@@ -24,12 +27,28 @@ struct root_calc_result {
   bool operator==(const root_calc_result &rhs) const;
 };
 
+/**
+ * A file found while scanning whose hash is written once every file has been
+ * found.
+ */
+struct pending_hash {
+  row_id directory_id;
+  std::string name;
+  int64_t modified_ns;
+};
+
 struct file_visitor_services {
   sqlite3 *db;
   std::ostream *console;
   std::string relative_argument_path;
-  std::vector<int> directory_stack;
-  int depth;
+  std::vector<row_id> directory_stack;
+  std::size_t depth;
+  build_options const *options;
+  std::vector<pending_hash> *pending_hashes;
+  std::vector<lockstep_file> *pending_files;
+  digest_store *store;
+  manifest_index *manifests;
+  std::string absolute_argument_path;
 };
 
 bool argument_path::operator==(const argument_path &rhs) const {
@@ -53,7 +72,7 @@ void copyFromSecondVector(std::vector<std::string> &vector_one,
 std::string removeBeginningSlash(std::string &path) {
   if (path.at(0) == '/') {
     std::string relative_path;
-    for (int i = 1; i < path.size(); ++i) {
+    for (std::size_t i = 1; i < path.size(); ++i) {
       relative_path += path[i];
     }
     return relative_path;
@@ -102,13 +121,13 @@ std::vector<std::string> tokenizeRootPath(std::string &path) {
   return tokens;
 }
 
-int countShortestTokenizePath(
+std::size_t countShortestTokenizePath(
     std::vector<std::vector<std::string>> &argument_paths) {
   if (argument_paths.size() == 0) {
     return 0;
   }
 
-  int shortest_path = argument_paths[0].size();
+  std::size_t shortest_path = argument_paths[0].size();
 
   for (const std::vector<std::string> argument_path : argument_paths) {
     if (argument_path.size() < shortest_path) {
@@ -132,7 +151,7 @@ calcRootPath(std::vector<std::string> &relative_argument_paths) {
   }
 
   std::vector<argument_path> argument_paths{};
-  for (int i = 0; i < tokenized_paths.size(); ++i) {
+  for (std::size_t i = 0; i < tokenized_paths.size(); ++i) {
     argument_paths.push_back({relative_argument_paths[i], {}});
   }
 
@@ -146,19 +165,19 @@ calcRootPath(std::vector<std::string> &relative_argument_paths) {
             .argument_paths = argument_paths};
   }
 
-  int shortest_path = countShortestTokenizePath(tokenized_paths);
+  std::size_t shortest_path = countShortestTokenizePath(tokenized_paths);
 
   // This will determine when the paths split off into seperate sub trees.
   // TODO Write a test to see what happens if shortest_path would be 0 which
   // would only happen if qualifyRelativeURL returns a path of length zero.
   std::vector<std::string> root_path{};
   std::string *common_path_ancestor = nullptr;
-  int unequal_index = 0;
+  std::size_t unequal_index = 0;
 
   for (; unequal_index < shortest_path; ++unequal_index) {
     bool same_token = false;
     std::string *tmp_path_segment = &tokenized_paths[0][unequal_index];
-    for (int j = 1; j < tokenized_paths.size(); ++j) {
+    for (std::size_t j = 1; j < tokenized_paths.size(); ++j) {
       same_token = *tmp_path_segment == tokenized_paths[j][unequal_index];
       if (!same_token) {
         break;
@@ -176,8 +195,8 @@ calcRootPath(std::vector<std::string> &relative_argument_paths) {
   root_path.pop_back();
 
   // Copy the rest of the paths that are not duplicates.
-  for (int i = 0; i < tokenized_paths.size(); ++i) {
-    for (int j = unequal_index; j < tokenized_paths[i].size(); ++j) {
+  for (std::size_t i = 0; i < tokenized_paths.size(); ++i) {
+    for (std::size_t j = unequal_index; j < tokenized_paths[i].size(); ++j) {
       argument_paths[i].canonicalized_path_tokens.push_back(
           tokenized_paths[i][j]);
     }
@@ -193,7 +212,7 @@ std::string removeLeadingRelativePath(const std::string &leading_relative_path,
                                       const std::string &path) {
   std::string path_without_leading = "";
 
-  int i = 0;
+  std::size_t i = 0;
   for (; i < path.size(); ++i) {
     if (i == leading_relative_path.size() ||
         leading_relative_path[i] != path[i]) {
@@ -208,6 +227,44 @@ std::string removeLeadingRelativePath(const std::string &leading_relative_path,
   return path_without_leading;
 }
 
+/**
+ * A manifest which can not be read is skipped, its files are read instead.
+ */
+void loadManifestFile(manifest_index &manifests,
+                      std::string const &manifest_path,
+                      std::string const &absolute_directory,
+                      std::ostream &console) {
+  try {
+    std::size_t entries =
+        loadManifest(manifests, manifest_path, absolute_directory);
+    console << "Loaded " << entries << " digests from the manifest "
+            << manifest_path << '\n';
+  } catch (file_open_error &error) {
+    console << "Error opening manifest: " << manifest_path << '\n';
+  }
+}
+
+void loadDirectoryManifest(manifest_index &manifests,
+                           std::string const &directory_path,
+                           std::string const &absolute_directory,
+                           std::ostream &console) {
+  // Argument paths may end in a slash, the directories found under them do not.
+  std::string manifest_path =
+      directory_path.back() == DELIMITER
+          ? directory_path + MANIFEST_FILE_NAME
+          : joinPath({directory_path, MANIFEST_FILE_NAME});
+  if (fileExists(manifest_path)) {
+    loadManifestFile(manifests, manifest_path, absolute_directory, console);
+  }
+}
+
+std::string absoluteVisitedPath(file_visitor_services const *file_services,
+                                std::vector<std::string> const &tokens) {
+  std::vector<std::string> segments{file_services->absolute_argument_path};
+  segments.insert(segments.end(), tokens.begin(), tokens.end());
+  return joinPath(segments);
+}
+
 void fileVisitorCallback(const std::string path, const enum file_type type,
                          void *services) {
   file_visitor_services *file_services =
@@ -219,63 +276,194 @@ void fileVisitorCallback(const std::string path, const enum file_type type,
       tokenizeRelativePath(path_without_relative);
   std::string file_node_name = tokenize_path[tokenize_path.size() - 1];
 
-  if (file_services->depth != tokenize_path.size() - 1) {
-    int ascend_depth = (file_services->depth + 1) - tokenize_path.size();
-    for (int i = 0; i < ascend_depth; ++i) {
+  if (file_services->depth + 1 > tokenize_path.size()) {
+    std::size_t ascend_depth =
+        (file_services->depth + 1) - tokenize_path.size();
+    for (std::size_t i = 0; i < ascend_depth; ++i) {
       --file_services->depth;
       file_services->directory_stack.pop_back();
     }
   }
 
+  // The times let update rescan only what changed since.
+  file_stamp stamp{};
+  bool stamped = stampFile(path, stamp);
+
+  if (type == FILE_TYPE_FILE && file_services->options->lockstep) {
+    file_services->pending_hashes->push_back(
+        {.directory_id = file_services->directory_stack.back(),
+         .name = file_node_name,
+         .modified_ns = stamp.modified_ns});
+    file_services->pending_files->push_back({.path = path, .size = stamp.size});
+    return;
+  }
+
   if (type == FILE_TYPE_FILE) {
     uint8_t file_hash[MD5_DIGEST_LENGTH];
+    bool read_file = false;
     *(file_services->console) << "Hashing File: " << path << '\n';
     try {
-
-      extractHash(file_hash, path);
+      // A file which could not be stat'ed has no key to store it under.
+      if (file_services->manifests == nullptr ||
+          !trustManifestDigest(*file_services->manifests,
+                               absoluteVisitedPath(file_services,
+                                                   tokenize_path),
+                               path, file_hash)) {
+        read_file =
+            extractStoredHash(stamped ? file_services->store : nullptr,
+                              file_hash, path, stamp);
+      }
     } catch (file_open_error &error) {
       *(file_services->console) << "Error opening file: " << path << '\n';
     }
+    digest extents{};
+    bool mapped = read_file && fingerprintExtents(path, extents.bytes);
     createHash(file_services->db,
                {.directory_id = file_services->directory_stack.back(),
                 .name = file_node_name.c_str(),
-                .hash = file_hash});
+                .hash = file_hash,
+                .size = stamp.size,
+                .modified_ns = stamp.modified_ns,
+                .extents = mapped ? extents.bytes : nullptr});
     return;
   }
 
   ++file_services->depth;
   *(file_services->console) << "Discovered Directory: " << path << '\n';
-  int directory_id = createDirectory(
+  row_id directory_id = createDirectory(
       file_services->db, {.parent_id = file_services->directory_stack.back(),
-                          .name = file_node_name.c_str()});
+                          .name = file_node_name.c_str(),
+                          .modified_ns = stamp.modified_ns});
   file_services->directory_stack.push_back(directory_id);
+  if (file_services->manifests != nullptr) {
+    loadDirectoryManifest(*file_services->manifests, path,
+                          absoluteVisitedPath(file_services, tokenize_path),
+                          *file_services->console);
+  }
+}
+
+void hashPendingFiles(sqlite3 *db,
+                      std::vector<pending_hash> const &pending_hashes,
+                      std::vector<lockstep_file> const &pending_files,
+                      std::ostream &console) {
+  console << "Comparing " << pending_files.size()
+          << " files of the same size in lockstep.\n";
+  std::vector<digest> digests{};
+  lockstep_stats stats = hashInLockstep(pending_files, digests);
+
+  for (std::size_t i = 0; i < pending_hashes.size(); ++i) {
+    digest extents{};
+    bool mapped = fingerprintExtents(pending_files[i].path, extents.bytes);
+    createHash(db, {.directory_id = pending_hashes[i].directory_id,
+                    .name = pending_hashes[i].name.c_str(),
+                    .hash = digests[i].bytes,
+                    .size = pending_files[i].size,
+                    .modified_ns = pending_hashes[i].modified_ns,
+                    .extents = mapped ? extents.bytes : nullptr});
+  }
+
+  console << "Hashed " << stats.files_hashed << " files in full, "
+          << stats.files_unique << " files were unique before the end ("
+          << stats.bytes_skipped << " bytes skipped) and "
+          << stats.files_unreadable << " files could not be read.\n";
+}
+
+/**
+ * The time of a directory whose entries are all scanned. The directories
+ * above the scanned paths only have the one entry on the way down.
+ */
+int64_t scannedModifiedNs(std::string const &path, bool scanned) {
+  file_stamp stamp{.size = 0,
+                   .modified_ns = NOT_SCANNED_MODIFIED_NS,
+                   .device = 0,
+                   .inode = 0};
+  if (scanned) {
+    stampFile(path, stamp);
+  }
+  return stamp.modified_ns;
 }
 
 void build(std::vector<std::string> paths, std::string cache_path,
-           std::ostream &console) {
+           build_options const &options, std::ostream &console) {
   sqlite3 *db = initDB(cache_path.c_str());
   resetDB(db);
 
   root_calc_result root_calc_result = calcRootPath(paths);
 
   createScanMetaData(db, {.root_dir = root_calc_result.root_path.c_str()});
-  int root_id = createDirectory(
-      db,
-      {.parent_id = -1, .name = root_calc_result.common_path_ancestor.c_str()});
-
-  std::vector<int> directory_stack{root_id};
+  createCacheOption(db, {.name = DIGEST_NAMES_OPTION,
+                         .value = options.digest_names ? "1" : "0"});
+  createCacheOption(db, {.name = LOCKSTEP_PLACEHOLDERS_OPTION,
+                         .value = options.lockstep ? "1" : "0"});
+  row_id root_id = createDirectory(
+      db, {.parent_id = -1,
+           .name = root_calc_result.common_path_ancestor.c_str(),
+           .modified_ns = scannedModifiedNs(paths[0], paths.size() == 1)});
+
+  std::vector<pending_hash> pending_hashes{};
+  std::vector<lockstep_file> pending_files{};
+  std::vector<row_id> directory_stack{root_id};
+  digest_store *store =
+      options.lockstep
+          ? nullptr
+          : initDigestStore(options.store_path, options.attributes,
+                            options.store_max_entries);
+  manifest_index manifests{.entries = {},
+                           .trusted = {},
+                           .spot_check_every = options.spot_check_every,
+                           .stats = {0, 0, 0, 0}};
+  for (std::string manifest_path : options.manifest_paths) {
+    std::string absolute_path = qualifyRelativeURL(manifest_path);
+    loadManifestFile(manifests, manifest_path,
+                     absolute_path.substr(0, absolute_path.rfind(DELIMITER)),
+                     console);
+  }
   for (const argument_path path : root_calc_result.argument_paths) {
-    for (const std::string token : path.canonicalized_path_tokens) {
+    std::vector<std::string> const &tokens = path.canonicalized_path_tokens;
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
       directory_stack.push_back(createDirectory(
-          db, {.parent_id = directory_stack.back(), .name = token.c_str()}));
+          db, {.parent_id = directory_stack.back(),
+               .name = tokens[i].c_str(),
+               .modified_ns = scannedModifiedNs(path.relative_path,
+                                                i == tokens.size() - 1)}));
+    }
+
+    std::string relative_path = path.relative_path;
+    std::string absolute_argument_path =
+        options.trust_manifests ? qualifyRelativeURL(relative_path) : "";
+    if (options.trust_manifests) {
+      loadDirectoryManifest(manifests, relative_path, absolute_argument_path,
+                            console);
     }
 
     file_visitor_services file_visitor_services{
-        db, &console, path.relative_path, directory_stack, 0};
+        db,
+        &console,
+        path.relative_path,
+        directory_stack,
+        0,
+        &options,
+        &pending_hashes,
+        &pending_files,
+        store,
+        options.trust_manifests ? &manifests : nullptr,
+        absolute_argument_path};
     visitFiles(path.relative_path, fileVisitorCallback, &file_visitor_services);
 
     directory_stack = {root_id};
   }
+
+  if (options.lockstep) {
+    hashPendingFiles(db, pending_hashes, pending_files, console);
+  }
+  printDigestStoreStats(store, console);
+  if (options.trust_manifests) {
+    console << "Took " << manifests.stats.files_trusted << " digests from "
+            << manifests.stats.manifests_loaded << " manifests, spot checked "
+            << manifests.stats.files_checked << " files and "
+            << manifests.stats.checks_failed << " did not match.\n";
+  }
+  freeDigestStore(store);
   console << "Done scanning all files!\n";
   freeDB(db);
 }
\ No newline at end of file
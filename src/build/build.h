@@ -1,7 +1,44 @@
+#pragma once
 
 #include "../fs/file_system.h"
 #include "../sqlite/sqlite.h"
+#include "../store/store.h"
 #include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * With lockstep files are not hashed while they are discovered. They are
+ * hashed once the scan is done by comparing the files of the same size
+ * against each other, see lockstep.h.
+ *
+ * With a store path files are looked up in the shared store before they are
+ * read, and with attributes in their extended attributes, see store.h. Store
+ * max entries bounds the shared store, zero keeps its default.
+ * Lockstep builds use neither since the digests they give files of a unique
+ * size are not digests of their contents.
+ *
+ * With trust manifests files take their digests from md5sum manifests, the
+ * ones in manifest_paths and every MANIFEST_FILE_NAME found while scanning,
+ * see manifest.h. A manifest is loaded as soon as its directory is found, so
+ * before any of the files it lists. Lockstep can not be combined with it for
+ * the same reason as the store.
+ *
+ * Files which are read for their digest, in full or in lockstep, also have
+ * their extents fingerprinted, see fingerprintExtents, so dupes can tell
+ * groups which already share their extents. Digests from the store, an
+ * attribute or a manifest leave the file unread and without a fingerprint.
+ */
+struct build_options {
+  bool digest_names;
+  bool lockstep;
+  std::string store_path;
+  bool attributes;
+  bool trust_manifests;
+  std::vector<std::string> manifest_paths;
+  std::size_t spot_check_every;
+  std::size_t store_max_entries;
+};
 
 void build(std::vector<std::string> paths, std::string cache_path,
-           std::ostream &console);
\ No newline at end of file
+           build_options const &options, std::ostream &console);
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include "./lockstep.h"
+
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+#include "../fs/file_system.h"
+#include "../thread/parallel.h"
+
+/**
+ * Members (indices into the files) which matched each other so far, with the
+ * MD5 of the bytes they share. They are read on from offset, chunk bytes at a
+ * time.
+ */
+struct lockstep_part {
+  std::vector<std::size_t> members;
+  EVP_MD_CTX *md_context;
+  int64_t offset;
+  std::size_t chunk;
+};
+
+struct lockstep_context {
+  std::vector<lockstep_file> const *files;
+  std::vector<std::size_t> const *order;
+  std::vector<std::size_t> const *group_offsets;
+  std::vector<digest> *digests;
+  std::vector<lockstep_stats> *group_stats;
+};
+
+bool lockstep_stats::operator==(lockstep_stats const &rhs) const {
+  return rhs.files_hashed == files_hashed && rhs.files_unique == files_unique &&
+         rhs.files_unreadable == files_unreadable &&
+         rhs.bytes_read == bytes_read && rhs.bytes_skipped == bytes_skipped;
+}
+
+/**
+ * Paths are unique so the digest is too. It ends in the placeholder marker so
+ * the files given one can be found again, see lib.h.
+ */
+digest uniqueFileDigest(std::string const &path, int64_t size) {
+  digest size_digest{};
+  std::memcpy(size_digest.bytes, &size, sizeof(size));
+  std::memset(size_digest.bytes + sizeof(size), 0xff,
+              MD5_DIGEST_LENGTH - sizeof(size));
+
+  digest unique_digest{};
+  computeNamedDigest(unique_digest, path.c_str(), size_digest);
+  std::memcpy(unique_digest.bytes + MD5_DIGEST_LENGTH -
+                  PLACEHOLDER_MARKER_LENGTH,
+              PLACEHOLDER_MARKER, PLACEHOLDER_MARKER_LENGTH);
+  return unique_digest;
+}
+
+void finishPart(lockstep_part &part, std::vector<digest> &digests) {
+  digest content_digest{};
+  unsigned int md5_digest_length = MD5_DIGEST_LENGTH;
+  EVP_DigestFinal_ex(part.md_context, content_digest.bytes,
+                     &md5_digest_length);
+  for (std::size_t member : part.members) {
+    digests[member] = content_digest;
+  }
+}
+
+void markUnique(std::vector<lockstep_file> const &files, std::size_t member,
+                std::vector<digest> &digests) {
+  digests[member] = uniqueFileDigest(files[member].path, files[member].size);
+}
+
+/**
+ * Reads the next chunk of every member of the part and splits the part by
+ * what was read. Chunks are bucketed by a hash of their bytes so each one is
+ * only compared against the splits it may belong to. Members left on their
+ * own, or which could not be read in full, are marked unique and closed. The
+ * parts which still match carry on with a copy of the MD5 context updated
+ * with their chunk. The chunk is shrunk when the part has too many members
+ * for their chunks to fit in LOCKSTEP_MAX_BUFFER.
+ */
+void advancePart(std::vector<lockstep_file> const &files, lockstep_part &part,
+                 open_file_pool &pool, std::vector<char> &buffer,
+                 std::vector<digest> &digests, lockstep_stats &stats,
+                 std::vector<lockstep_part> &next_parts) {
+  int64_t size = files[part.members[0]].size;
+  std::size_t length = std::min<std::size_t>(
+      part.chunk,
+      std::max<std::size_t>(LOCKSTEP_MAX_BUFFER / part.members.size(), 1));
+  length = static_cast<std::size_t>(
+      std::min<int64_t>(length, size - part.offset));
+  buffer.resize(part.members.size() * length);
+  std::vector<std::size_t> read_members{};
+  std::vector<std::vector<std::size_t>> splits{};
+  std::unordered_map<std::size_t, std::vector<std::size_t>> buckets{};
+
+  for (std::size_t member : part.members) {
+    char *chunk = buffer.data() + read_members.size() * length;
+    std::size_t count = 0;
+    try {
+      count = readPooledFileChunk(pool, files[member].path, part.offset, chunk,
+                                  length);
+    } catch (file_open_error &error) {
+      ++stats.files_unreadable;
+    }
+    stats.bytes_read += count;
+
+    if (count != length) {
+      // The file changed size since it was listed or could not be read.
+      closePooledFile(pool, files[member].path);
+      markUnique(files, member, digests);
+      continue;
+    }
+
+    std::size_t read_index = read_members.size();
+    read_members.push_back(member);
+
+    std::vector<std::size_t> &bucket =
+        buckets[std::hash<std::string_view>{}(std::string_view(chunk, length))];
+    bool placed = false;
+    for (std::size_t split : bucket) {
+      if (std::memcmp(buffer.data() + splits[split][0] * length, chunk,
+                      length) == 0) {
+        splits[split].push_back(read_index);
+        placed = true;
+        break;
+      }
+    }
+
+    if (!placed) {
+      bucket.push_back(splits.size());
+      splits.push_back({read_index});
+    }
+  }
+
+  for (std::vector<std::size_t> const &split : splits) {
+    if (split.size() == 1) {
+      std::size_t member = read_members[split[0]];
+      closePooledFile(pool, files[member].path);
+      markUnique(files, member, digests);
+      ++stats.files_unique;
+      stats.bytes_skipped +=
+          size - part.offset - static_cast<int64_t>(length);
+      continue;
+    }
+
+    lockstep_part next_part{.members = {},
+                            .md_context = EVP_MD_CTX_new(),
+                            .offset = part.offset +
+                                      static_cast<int64_t>(length),
+                            .chunk = std::min(part.chunk * 2,
+                                              LOCKSTEP_MAX_CHUNK)};
+    EVP_MD_CTX_copy_ex(next_part.md_context, part.md_context);
+    EVP_DigestUpdate(next_part.md_context, buffer.data() + split[0] * length,
+                     length);
+    for (std::size_t read_index : split) {
+      next_part.members.push_back(read_members[read_index]);
+    }
+    next_parts.push_back(next_part);
+  }
+
+  EVP_MD_CTX_free(part.md_context);
+  part.md_context = nullptr;
+}
+
+/**
+ * The files of the group stay open between chunks, up to the size of the
+ * pool, and are closed as soon as they are done with.
+ */
+void hashSizeGroup(std::vector<lockstep_file> const &files,
+                   std::size_t const *members, std::size_t member_count,
+                   std::vector<digest> &digests, lockstep_stats &stats) {
+  int64_t size = files[members[0]].size;
+  if (size == 0) {
+    // Empty files are left out of the directory digests.
+    for (std::size_t i = 0; i < member_count; ++i) {
+      digests[members[i]] = EMPTY_DIGEST;
+    }
+    return;
+  }
+
+  if (member_count == 1) {
+    markUnique(files, members[0], digests);
+    ++stats.files_unique;
+    stats.bytes_skipped += size;
+    return;
+  }
+
+  std::vector<lockstep_part> parts{
+      {.members = std::vector<std::size_t>(members, members + member_count),
+       .md_context = EVP_MD_CTX_new(),
+       .offset = 0,
+       .chunk = LOCKSTEP_FIRST_CHUNK}};
+  EVP_DigestInit_ex(parts[0].md_context, EVP_md5(), nullptr);
+
+  open_file_pool pool = initOpenFilePool(OPEN_FILE_POOL_SIZE);
+  std::vector<char> buffer{};
+  std::vector<lockstep_part> next_parts{};
+  while (parts.size() != 0) {
+    next_parts.clear();
+    for (lockstep_part &part : parts) {
+      if (part.offset < size) {
+        advancePart(files, part, pool, buffer, digests, stats, next_parts);
+        continue;
+      }
+
+      finishPart(part, digests);
+      stats.files_hashed += part.members.size();
+      EVP_MD_CTX_free(part.md_context);
+      for (std::size_t member : part.members) {
+        closePooledFile(pool, files[member].path);
+      }
+    }
+    parts.swap(next_parts);
+  }
+  closeOpenFilePool(pool);
+}
+
+void hashSizeGroups(std::size_t begin, std::size_t end, void *context) {
+  lockstep_context *lockstep = static_cast<lockstep_context *>(context);
+  for (std::size_t group = begin; group < end; ++group) {
+    std::size_t group_offset = (*lockstep->group_offsets)[group];
+    hashSizeGroup(*lockstep->files, lockstep->order->data() + group_offset,
+                  (*lockstep->group_offsets)[group + 1] - group_offset,
+                  *lockstep->digests, (*lockstep->group_stats)[group]);
+  }
+}
+
+/**
+ * Size groups are independent so they are spread across threads, each group
+ * is read by a single thread.
+ */
+lockstep_stats hashInLockstep(std::vector<lockstep_file> const &files,
+                              std::vector<digest> &digests) {
+  digests.assign(files.size(), EMPTY_DIGEST);
+
+  std::vector<std::size_t> order(files.size());
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&files](std::size_t file_one, std::size_t file_two) {
+                     return files[file_one].size < files[file_two].size;
+                   });
+
+  std::vector<std::size_t> group_offsets{0};
+  for (std::size_t i = 1; i <= order.size(); ++i) {
+    if (i == order.size() ||
+        files[order[i]].size != files[order[i - 1]].size) {
+      group_offsets.push_back(i);
+    }
+  }
+  if (order.size() == 0) {
+    group_offsets.clear();
+  }
+
+  std::size_t group_count =
+      group_offsets.size() == 0 ? 0 : group_offsets.size() - 1;
+  std::vector<lockstep_stats> group_stats(group_count, lockstep_stats{});
+  lockstep_context context{&files, &order, &group_offsets, &digests,
+                           &group_stats};
+  parallelFor(0, group_count, hashSizeGroups, &context, 1);
+
+  lockstep_stats stats{};
+  for (lockstep_stats const &group_stat : group_stats) {
+    stats.files_hashed += group_stat.files_hashed;
+    stats.files_unique += group_stat.files_unique;
+    stats.files_unreadable += group_stat.files_unreadable;
+    stats.bytes_read += group_stat.bytes_read;
+    stats.bytes_skipped += group_stat.bytes_skipped;
+  }
+  return stats;
+}
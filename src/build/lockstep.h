@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../lib.h"
+
+/**
+ * Hashes files by comparing the ones which share a size against each other
+ * instead of reading every file to the end. Members of a size group are read
+ * a chunk at a time and partitioned by what was read. A file stops being read
+ * as soon as no other file matches it and is given a digest derived from its
+ * path, which can not match any other file. Files still matching at the end
+ * of the group get the MD5 of their contents, computed once per partition.
+ * Chunks start small and double so files that differ early cost little.
+ * The chunks of a partition are held at once, so a partition with many
+ * members reads smaller chunks to stay within LOCKSTEP_MAX_BUFFER.
+ */
+constexpr std::size_t LOCKSTEP_FIRST_CHUNK = 1 << 12;
+constexpr std::size_t LOCKSTEP_MAX_CHUNK = 1 << 20;
+constexpr std::size_t LOCKSTEP_MAX_BUFFER = 1 << 26;
+
+struct lockstep_file {
+  std::string path;
+  int64_t size;
+};
+
+struct lockstep_stats {
+  std::size_t files_hashed;
+  std::size_t files_unique;
+  std::size_t files_unreadable;
+  int64_t bytes_read;
+  int64_t bytes_skipped;
+
+  bool operator==(lockstep_stats const &rhs) const;
+};
+
+digest uniqueFileDigest(std::string const &path, int64_t size);
+lockstep_stats hashInLockstep(std::vector<lockstep_file> const &files,
+                              std::vector<digest> &digests);
@@ -0,0 +1,174 @@
+#include "./manifest.h"
+
+#include <algorithm>
+
+#include "../fs/file_system.h"
+
+// The md5 of no bytes, which extractHash gives as zeros instead.
+constexpr uint8_t EMPTY_FILE_MD5[MD5_DIGEST_LENGTH] = {
+    0xd4, 0x1d, 0x8c, 0xd9, 0x8f, 0x00, 0xb2, 0x04,
+    0xe9, 0x80, 0x09, 0x98, 0xec, 0xf8, 0x42, 0x7e};
+
+bool manifest_stats::operator==(manifest_stats const &rhs) const {
+  return rhs.manifests_loaded == manifests_loaded &&
+         rhs.files_trusted == files_trusted &&
+         rhs.files_checked == files_checked &&
+         rhs.checks_failed == checks_failed;
+}
+
+int manifestHexValue(char character) {
+  if (character >= '0' && character <= '9') {
+    return character - '0';
+  }
+  if (character >= 'a' && character <= 'f') {
+    return character - 'a' + 10;
+  }
+  if (character >= 'A' && character <= 'F') {
+    return character - 'A' + 10;
+  }
+  return -1;
+}
+
+/**
+ * md5sum escapes names with a backslash or a newline in them, "\\" and "\n",
+ * and marks the line with a leading backslash.
+ */
+bool unescapeManifestName(std::string const &escaped, std::string &name) {
+  name.clear();
+  for (std::size_t i = 0; i < escaped.size(); ++i) {
+    if (escaped[i] != '\\') {
+      name += escaped[i];
+      continue;
+    }
+
+    if (++i == escaped.size()) {
+      return false;
+    }
+    if (escaped[i] == '\\') {
+      name += '\\';
+    } else if (escaped[i] == 'n') {
+      name += '\n';
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parseManifestLine(std::string const &line, std::string &name,
+                       digest &hash) {
+  bool escaped = line.size() != 0 && line[0] == '\\';
+  std::size_t start = escaped ? 1 : 0;
+  std::size_t name_start = start + MD5_DIGEST_LENGTH * 2 + 2;
+  if (line.size() <= name_start || line[name_start - 2] != ' ' ||
+      (line[name_start - 1] != ' ' && line[name_start - 1] != '*')) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < MD5_DIGEST_LENGTH; ++i) {
+    int high = manifestHexValue(line[start + i * 2]);
+    int low = manifestHexValue(line[start + i * 2 + 1]);
+    if (high == -1 || low == -1) {
+      return false;
+    }
+    hash.bytes[i] = static_cast<uint8_t>(high << 4 | low);
+  }
+  if (std::equal(hash.bytes, hash.bytes + MD5_DIGEST_LENGTH, EMPTY_FILE_MD5)) {
+    std::fill(hash.bytes, hash.bytes + MD5_DIGEST_LENGTH, 0);
+  }
+
+  std::string raw_name = line.substr(name_start);
+  if (escaped) {
+    if (!unescapeManifestName(raw_name, name)) {
+      return false;
+    }
+  } else {
+    name = raw_name;
+  }
+
+  // md5sum run as "md5sum ./*" writes names starting with "./".
+  while (name.compare(0, 2, "./") == 0) {
+    name.erase(0, 2);
+  }
+  return name.size() != 0 && name[0] != '/';
+}
+
+/**
+ * Adds the entries of a manifest to the index and gives back how many it had.
+ * A file in more than one manifest takes its digest from the last one.
+ * Throws file_open_error when the manifest can not be read.
+ */
+std::size_t loadManifest(manifest_index &index,
+                         std::string const &manifest_path,
+                         std::string const &absolute_directory) {
+  std::string contents{};
+  std::vector<char> buffer(MANIFEST_READ_SIZE);
+  std::size_t read = 0;
+  do {
+    read = readFileChunk(manifest_path, static_cast<int64_t>(contents.size()),
+                         buffer.data(), buffer.size());
+    contents.append(buffer.data(), read);
+  } while (read == buffer.size());
+
+  std::size_t manifest = index.trusted.size();
+  index.trusted.push_back(true);
+  ++index.stats.manifests_loaded;
+
+  std::size_t entries = 0;
+  std::string name{};
+  digest hash{};
+  std::size_t line_start = 0;
+  while (line_start < contents.size()) {
+    std::size_t line_end = contents.find('\n', line_start);
+    if (line_end == std::string::npos) {
+      line_end = contents.size();
+    }
+    std::string line = contents.substr(line_start, line_end - line_start);
+    if (line.size() != 0 && line.back() == '\r') {
+      line.pop_back();
+    }
+    line_start = line_end + 1;
+
+    if (!parseManifestLine(line, name, hash)) {
+      continue;
+    }
+    index.entries[joinPath({absolute_directory, name})] = {
+        .manifest = manifest, .hash = hash};
+    ++entries;
+  }
+  return entries;
+}
+
+/**
+ * False when no trusted manifest has the file, it has to be read then. A
+ * spot check reads the file and throws file_open_error when it can not.
+ */
+bool trustManifestDigest(manifest_index &index,
+                         std::string const &absolute_path,
+                         std::string const &path, uint8_t *hash) {
+  std::unordered_map<std::string, manifest_entry>::const_iterator entry =
+      index.entries.find(absolute_path);
+  if (entry == index.entries.end() || !index.trusted[entry->second.manifest]) {
+    return false;
+  }
+
+  manifest_stats &stats = index.stats;
+  if (index.spot_check_every != 0 &&
+      (stats.files_trusted + stats.checks_failed) % index.spot_check_every ==
+          0) {
+    digest actual{};
+    extractHash(actual.bytes, path);
+    ++stats.files_checked;
+    if (actual != entry->second.hash) {
+      ++stats.checks_failed;
+      index.trusted[entry->second.manifest] = false;
+      std::copy(actual.bytes, actual.bytes + MD5_DIGEST_LENGTH, hash);
+      return true;
+    }
+  }
+
+  ++stats.files_trusted;
+  std::copy(entry->second.hash.bytes,
+            entry->second.hash.bytes + MD5_DIGEST_LENGTH, hash);
+  return true;
+}
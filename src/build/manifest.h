@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../lib.h"
+
+/**
+ * Takes the digests of files from md5sum manifests instead of reading the
+ * files. A manifest has a line per file in the format md5sum writes, the hex
+ * digest, a space, a space or a star and the name of the file relative to
+ * the directory of the manifest. Lines md5sum had to escape start with a
+ * backslash, other lines which do not parse are skipped.
+ *
+ * Files are keyed by their absolute path. One in every spot_check_every of
+ * the files a manifest vouches for is read anyway, starting with the first,
+ * and a manifest which got one wrong is not trusted for the rest of the
+ * build. The file it got wrong keeps the digest it really has.
+ */
+constexpr char MANIFEST_FILE_NAME[] = "MD5SUMS";
+constexpr std::size_t MANIFEST_READ_SIZE = 1 << 16;
+
+struct manifest_entry {
+  std::size_t manifest;
+  digest hash;
+};
+
+struct manifest_stats {
+  std::size_t manifests_loaded;
+  std::size_t files_trusted;
+  std::size_t files_checked;
+  std::size_t checks_failed;
+
+  bool operator==(manifest_stats const &rhs) const;
+};
+
+struct manifest_index {
+  std::unordered_map<std::string, manifest_entry> entries;
+  std::vector<bool> trusted;
+  std::size_t spot_check_every;
+  manifest_stats stats;
+};
+
+bool parseManifestLine(std::string const &line, std::string &name,
+                       digest &hash);
+std::size_t loadManifest(manifest_index &index,
+                         std::string const &manifest_path,
+                         std::string const &absolute_directory);
+bool trustManifestDigest(manifest_index &index,
+                         std::string const &absolute_path,
+                         std::string const &path, uint8_t *hash);
@@ -1,16 +1,57 @@
 #include "./cli.h"
 #include "./build/build.h"
+#include "./decode/decode.h"
 #include "./dupes/dupes.h"
 #include "./env/env.h"
 #include "./fs/file_system.h"
 #include "./lib.h"
+#include "./prune/prune.h"
+#include "./reclaim/reclaim.h"
 #include "./update/update.h"
+#include <cstdlib>
 #include <iostream>
+#include <unistd.h>
 
 char const CACHE_OPTION_NAME[] = "--cache";
+char const DIGEST_NAMES_OPTION_NAME[] = "--digest-names";
+char const VERIFY_OPTION_NAME[] = "--verify";
+char const LOCKSTEP_OPTION_NAME[] = "--lockstep";
+char const RESCAN_OPTION_NAME[] = "--rescan";
+char const SHARED_STORE_OPTION_NAME[] = "--shared-store";
+char const STORE_MAX_ENTRIES_OPTION_NAME[] = "--store-max-entries";
+char const XATTRS_OPTION_NAME[] = "--xattrs";
+char const TRUST_MANIFEST_OPTION_NAME[] = "--trust-manifest";
+char const MANIFEST_OPTION_NAME[] = "--manifest";
+char const SPOT_CHECK_OPTION_NAME[] = "--spot-check";
+char const STORE_FILE_NAME[] = "shared.store";
+char const TOP_OPTION_NAME[] = "--top";
+char const WINDOW_OPTION_NAME[] = "--window";
+char const SORT_OPTION_NAME[] = "--sort";
+char const SORT_PATH_VALUE[] = "path";
+char const SORT_BYTES_VALUE[] = "bytes";
+char const FORMAT_OPTION_NAME[] = "--format";
+char const FORMAT_TEXT_VALUE[] = "text";
+char const FORMAT_JSONL_VALUE[] = "jsonl";
+char const FORMAT_NULL_VALUE[] = "null";
+char const FORMAT_CSV_VALUE[] = "csv";
+char const FORMAT_PREFIX_VALUE[] = "prefix";
+char const MODE_OPTION_NAME[] = "--mode";
+char const MODE_REFLINK_VALUE[] = "reflink";
+char const MODE_HARDLINK_VALUE[] = "hardlink";
+char const KEEP_OPTION_NAME[] = "--keep";
+char const KEEP_OLDEST_VALUE[] = "oldest";
+char const KEEP_SHORTEST_PATH_VALUE[] = "shortest-path";
+char const EXEC_OPTION_NAME[] = "--exec";
+char const JOBS_OPTION_NAME[] = "--jobs";
+char const BATCH_OPTION_NAME[] = "--batch";
+char const BATCH_PATHS_VALUE[] = "paths";
+char const BATCH_GROUP_VALUE[] = "group";
 char const DUPES_COMMAND_NAME[] = "dupes";
 char const BUILD_COMMAND_NAME[] = "build";
 char const UPDATE_COMMAND_NAME[] = "update";
+char const DECODE_COMMAND_NAME[] = "decode";
+char const RECLAIM_COMMAND_NAME[] = "reclaim";
+char const PRUNE_COMMAND_NAME[] = "prune";
 
 char const *parseCacheArgument(int argc, char *argv[]) {
   for (int i = 0; i < argc; ++i) {
@@ -30,14 +71,290 @@ char const *parseCacheArgument(int argc, char *argv[]) {
   throw command_error("'--cache' argument must be included.");
 }
 
+/**
+ * Options followed by a value, the value is never a flag or a path.
+ */
+bool isValueOption(char const *argument) {
+  return compareStrings(CACHE_OPTION_NAME, argument) ||
+         compareStrings(TOP_OPTION_NAME, argument) ||
+         compareStrings(WINDOW_OPTION_NAME, argument) ||
+         compareStrings(SORT_OPTION_NAME, argument) ||
+         compareStrings(FORMAT_OPTION_NAME, argument) ||
+         compareStrings(MODE_OPTION_NAME, argument) ||
+         compareStrings(KEEP_OPTION_NAME, argument) ||
+         compareStrings(EXEC_OPTION_NAME, argument) ||
+         compareStrings(JOBS_OPTION_NAME, argument) ||
+         compareStrings(BATCH_OPTION_NAME, argument) ||
+         compareStrings(MANIFEST_OPTION_NAME, argument) ||
+         compareStrings(SPOT_CHECK_OPTION_NAME, argument) ||
+         compareStrings(STORE_MAX_ENTRIES_OPTION_NAME, argument);
+}
+
+/**
+ * Null when the option was not passed.
+ */
+char const *parseValueArgument(int argc, char *argv[], str_const option_name,
+                               char const *missing_value_message) {
+  for (int i = 2; i < argc; ++i) {
+    if (!compareStrings(option_name, argv[i])) {
+      continue;
+    }
+
+    if (i == argc - 1) {
+      throw command_error(missing_value_message);
+    }
+    return argv[i + 1];
+  }
+
+  return nullptr;
+}
+
+/**
+ * Zero when the option was not passed.
+ */
+std::size_t parseCountArgument(int argc, char *argv[], str_const option_name,
+                               char const *invalid_count_message) {
+  char const *count_value =
+      parseValueArgument(argc, argv, option_name, invalid_count_message);
+  if (count_value == nullptr) {
+    return 0;
+  }
+
+  char *end = nullptr;
+  unsigned long long count = std::strtoull(count_value, &end, 10);
+  if (*count_value == '-' || *end != '\0' || end == count_value ||
+      count == 0) {
+    throw command_error(invalid_count_message);
+  }
+  return static_cast<std::size_t>(count);
+}
+
+group_sort parseSortArgument(int argc, char *argv[]) {
+  char const *sort_value =
+      parseValueArgument(argc, argv, SORT_OPTION_NAME,
+                         "'--sort' argument must be 'path' or 'bytes'.");
+  if (sort_value == nullptr || compareStrings(SORT_PATH_VALUE, sort_value)) {
+    return GROUP_SORT_PATH;
+  }
+
+  if (compareStrings(SORT_BYTES_VALUE, sort_value)) {
+    return GROUP_SORT_BYTES;
+  }
+
+  throw command_error("'--sort' argument must be 'path' or 'bytes'.");
+}
+
+output_format parseFormatArgument(int argc, char *argv[]) {
+  char const *invalid_format_message =
+      "'--format' argument must be 'text', 'jsonl', 'null', 'csv' or "
+      "'prefix'.";
+  char const *format_value = parseValueArgument(
+      argc, argv, FORMAT_OPTION_NAME, invalid_format_message);
+  if (format_value == nullptr ||
+      compareStrings(FORMAT_TEXT_VALUE, format_value)) {
+    return OUTPUT_FORMAT_TEXT;
+  }
+
+  if (compareStrings(FORMAT_JSONL_VALUE, format_value)) {
+    return OUTPUT_FORMAT_JSONL;
+  }
+
+  if (compareStrings(FORMAT_NULL_VALUE, format_value)) {
+    return OUTPUT_FORMAT_NULL;
+  }
+
+  if (compareStrings(FORMAT_CSV_VALUE, format_value)) {
+    return OUTPUT_FORMAT_CSV;
+  }
+
+  if (compareStrings(FORMAT_PREFIX_VALUE, format_value)) {
+    return OUTPUT_FORMAT_PREFIX;
+  }
+
+  throw command_error(invalid_format_message);
+}
+
+exec_batch parseBatchArgument(int argc, char *argv[]) {
+  char const *invalid_batch_message =
+      "'--batch' argument must be 'paths' or 'group'.";
+  char const *batch_value = parseValueArgument(argc, argv, BATCH_OPTION_NAME,
+                                               invalid_batch_message);
+  if (batch_value == nullptr ||
+      compareStrings(BATCH_PATHS_VALUE, batch_value)) {
+    return EXEC_BATCH_PATHS;
+  }
+
+  if (compareStrings(BATCH_GROUP_VALUE, batch_value)) {
+    return EXEC_BATCH_GROUP;
+  }
+
+  throw command_error(invalid_batch_message);
+}
+
+/**
+ * The command is null when the groups are written instead of passed to a
+ * command. One job runs the commands one after the other.
+ */
+exec_options parseExecArguments(int argc, char *argv[]) {
+  std::size_t jobs =
+      parseCountArgument(argc, argv, JOBS_OPTION_NAME,
+                         "'--jobs' argument must be a positive number.");
+  return {.command = parseValueArgument(
+              argc, argv, EXEC_OPTION_NAME,
+              "'--exec' argument must have the command to run."),
+          .jobs = jobs == 0 ? 1 : jobs,
+          .batch = parseBatchArgument(argc, argv)};
+}
+
+/**
+ * Reclaiming replaces files so the mode is never assumed.
+ */
+reclaim_mode parseModeArgument(int argc, char *argv[]) {
+  char const *invalid_mode_message =
+      "'--mode' argument must be 'reflink' or 'hardlink'.";
+  char const *mode_value = parseValueArgument(argc, argv, MODE_OPTION_NAME,
+                                              invalid_mode_message);
+  if (mode_value == nullptr) {
+    throw command_error(invalid_mode_message);
+  }
+
+  if (compareStrings(MODE_REFLINK_VALUE, mode_value)) {
+    return RECLAIM_MODE_REFLINK;
+  }
+
+  if (compareStrings(MODE_HARDLINK_VALUE, mode_value)) {
+    return RECLAIM_MODE_HARDLINK;
+  }
+
+  throw command_error(invalid_mode_message);
+}
+
+/**
+ * Pruning deletes files so which one is kept is never assumed.
+ */
+prune_keep parseKeepArgument(int argc, char *argv[]) {
+  char const *invalid_keep_message =
+      "'--keep' argument must be 'oldest' or 'shortest-path'.";
+  char const *keep_value = parseValueArgument(argc, argv, KEEP_OPTION_NAME,
+                                              invalid_keep_message);
+  if (keep_value == nullptr) {
+    throw command_error(invalid_keep_message);
+  }
+
+  if (compareStrings(KEEP_OLDEST_VALUE, keep_value)) {
+    return PRUNE_KEEP_OLDEST;
+  }
+
+  if (compareStrings(KEEP_SHORTEST_PATH_VALUE, keep_value)) {
+    return PRUNE_KEEP_SHORTEST_PATH;
+  }
+
+  throw command_error(invalid_keep_message);
+}
+
+bool parseFlagArgument(int argc, char *argv[], str_const flag_name) {
+  for (int i = 2; i < argc; ++i) {
+    if (isValueOption(argv[i])) {
+      ++i;
+      continue;
+    }
+
+    if (compareStrings(flag_name, argv[i])) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Every '--manifest' passed, in order.
+ */
+std::vector<std::string> parseManifestArguments(int argc, char *argv[]) {
+  std::vector<std::string> manifest_paths{};
+  for (int i = 2; i < argc; ++i) {
+    if (!compareStrings(MANIFEST_OPTION_NAME, argv[i])) {
+      continue;
+    }
+
+    if (i == argc - 1) {
+      throw command_error("'--manifest' argument must have the path of a "
+                          "manifest.");
+    }
+    manifest_paths.push_back(argv[++i]);
+  }
+  return manifest_paths;
+}
+
+/**
+ * Zero keeps the store's default, the bound means nothing without the store.
+ */
+std::size_t parseStoreMaxEntriesArgument(int argc, char *argv[],
+                                         std::string const &store_file) {
+  std::size_t max_entries = parseCountArgument(
+      argc, argv, STORE_MAX_ENTRIES_OPTION_NAME,
+      "'--store-max-entries' argument must be a positive number.");
+  if (max_entries != 0 && store_file.empty()) {
+    throw command_error("'--store-max-entries' can only be used with "
+                        "'--shared-store'.");
+  }
+  return max_entries;
+}
+
+/**
+ * Manifests are only read when they are trusted, and lockstep gives files
+ * digests which can not be compared to the ones manifests give. The shared
+ * store and attributes would keep lockstep's placeholders past the cache.
+ */
+build_options parseBuildArguments(int argc, char *argv[],
+                                  std::string const &store_file) {
+  build_options options{
+      .digest_names = parseFlagArgument(argc, argv, DIGEST_NAMES_OPTION_NAME),
+      .lockstep = parseFlagArgument(argc, argv, LOCKSTEP_OPTION_NAME),
+      .store_path = store_file,
+      .attributes = parseFlagArgument(argc, argv, XATTRS_OPTION_NAME),
+      .trust_manifests =
+          parseFlagArgument(argc, argv, TRUST_MANIFEST_OPTION_NAME),
+      .manifest_paths = parseManifestArguments(argc, argv),
+      .spot_check_every = parseCountArgument(
+          argc, argv, SPOT_CHECK_OPTION_NAME,
+          "'--spot-check' argument must be a positive number."),
+      .store_max_entries =
+          parseStoreMaxEntriesArgument(argc, argv, store_file)};
+
+  if (!options.trust_manifests &&
+      (options.manifest_paths.size() != 0 || options.spot_check_every != 0)) {
+    throw command_error("'--manifest' and '--spot-check' can only be used "
+                        "with '--trust-manifest'.");
+  }
+  if (options.trust_manifests && options.lockstep) {
+    throw command_error("'--trust-manifest' can not be used with "
+                        "'--lockstep'.");
+  }
+  if (options.lockstep && (!store_file.empty() || options.attributes)) {
+    throw command_error("'--shared-store' and '--xattrs' can not be used "
+                        "with '--lockstep'.");
+  }
+  return options;
+}
+
 std::vector<std::string> parsePathsArguments(int argc, char *argv[]) {
   std::vector<std::string> path_args;
   for (int i = 2; i < argc;) {
-    if (compareStrings(CACHE_OPTION_NAME, argv[i])) {
+    if (isValueOption(argv[i])) {
       i += 2;
       continue;
     }
 
+    if (compareStrings(DIGEST_NAMES_OPTION_NAME, argv[i]) ||
+        compareStrings(LOCKSTEP_OPTION_NAME, argv[i]) ||
+        compareStrings(SHARED_STORE_OPTION_NAME, argv[i]) ||
+        compareStrings(XATTRS_OPTION_NAME, argv[i]) ||
+        compareStrings(TRUST_MANIFEST_OPTION_NAME, argv[i])) {
+      ++i;
+      continue;
+    }
+
     path_args.push_back(argv[i]);
     ++i;
   }
@@ -69,32 +386,82 @@ void process(int argc, char *argv[]) {
 
   if (argc < 2) {
     throw command_error("You must pass in the action! The actions include "
-                        "'build', 'dupes', and 'update'.");
+                        "'build', 'dupes', 'update', 'reclaim', 'prune', "
+                        "and 'decode'.");
   }
 
   char *action = argv[1];
 
+  // Decoding reads a report, not a cache.
+  if (compareStrings(DECODE_COMMAND_NAME, action)) {
+    if (argc < 3) {
+      throw command_error("'decode' must have the path of the report to "
+                          "decode.");
+    }
+    decode(argv[2], STDOUT_FILENO);
+    return;
+  }
+
   // Setup DB file.
   char const *cache_path = buildChachePath();
   createDirectory(cache_path);
   char const *cache_arg = parseCacheArgument(argc, argv);
   std::string db_file = postfixDb(cache_path, cache_arg);
+  // The store is shared by every cache so it is not named after one.
+  std::string store_file =
+      parseFlagArgument(argc, argv, SHARED_STORE_OPTION_NAME)
+          ? joinPath({cache_path, STORE_FILE_NAME})
+          : "";
 
   if (compareStrings(DUPES_COMMAND_NAME, action)) {
-    dupes(db_file, std::cout);
+    output_format format = parseFormatArgument(argc, argv);
+    // Progress goes to stderr so machine readable output stays parseable.
+    std::ostream &console =
+        format == OUTPUT_FORMAT_TEXT ? std::cout : std::cerr;
+    dupes(db_file,
+          {.verify = parseFlagArgument(argc, argv, VERIFY_OPTION_NAME),
+           .sort = parseSortArgument(argc, argv),
+           .top = parseCountArgument(
+               argc, argv, TOP_OPTION_NAME,
+               "'--top' argument must be a positive number."),
+           .window = parseCountArgument(
+               argc, argv, WINDOW_OPTION_NAME,
+               "'--window' argument must be a positive number."),
+           .format = format,
+           .output_fd = STDOUT_FILENO,
+           .exec = parseExecArguments(argc, argv)},
+          console);
     return;
   }
 
   if (compareStrings(BUILD_COMMAND_NAME, action)) {
-    build(parsePathsArguments(argc, argv), db_file, std::cout);
+    build(parsePathsArguments(argc, argv), db_file,
+          parseBuildArguments(argc, argv, store_file), std::cout);
     return;
   }
 
   if (compareStrings(UPDATE_COMMAND_NAME, action)) {
-    update(db_file, std::cout);
+    update(db_file,
+           {.rescan = parseFlagArgument(argc, argv, RESCAN_OPTION_NAME),
+            .store_path = store_file,
+            .attributes = parseFlagArgument(argc, argv, XATTRS_OPTION_NAME),
+            .store_max_entries =
+                parseStoreMaxEntriesArgument(argc, argv, store_file)},
+           std::cout);
+    return;
+  }
+
+  if (compareStrings(RECLAIM_COMMAND_NAME, action)) {
+    reclaim(db_file, {.mode = parseModeArgument(argc, argv)}, std::cout);
+    return;
+  }
+
+  if (compareStrings(PRUNE_COMMAND_NAME, action)) {
+    prune(db_file, {.keep = parseKeepArgument(argc, argv)}, std::cout);
     return;
   }
 
   throw command_error("Invalid action. The allowed actions include "
-                      "'build', 'dupes', and 'update'.");
+                      "'build', 'dupes', 'update', 'reclaim', 'prune', and "
+                      "'decode'.");
 }
@@ -0,0 +1,147 @@
+#include "./decode.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+/**
+ * The full path of every directory is kept by id. Directories are written
+ * before anything under them so a directory's parent is always known, and a
+ * member's path is its parent's path and its segment.
+ */
+
+constexpr char PATH_DELIMITER = '/';
+
+/**
+ * The field of the record starting at offset up to the next tab, offset is
+ * moved past the tab. The last field runs to the end of the record.
+ */
+std::string nextField(std::string const &record, std::size_t &offset,
+                      bool last) {
+  if (offset > record.size()) {
+    throw decode_error("The report has a record which is missing fields.");
+  }
+
+  std::size_t end = last ? record.size() : record.find('\t', offset);
+  if (end == std::string::npos) {
+    throw decode_error("The report has a record which is missing fields.");
+  }
+
+  std::string field = record.substr(offset, end - offset);
+  offset = end + 1;
+  return field;
+}
+
+int64_t parseNumberField(std::string const &field) {
+  char *end = nullptr;
+  long long value = std::strtoll(field.c_str(), &end, 10);
+  if (field.size() == 0 || *end != '\0') {
+    throw decode_error("The report has a number which could not be read: " +
+                       field);
+  }
+  return value;
+}
+
+/**
+ * The path of the parent a record refers to, empty for a root.
+ */
+std::string const &
+findParentPath(std::vector<std::string> const &directory_paths,
+               int64_t parent_id) {
+  static std::string const NO_PARENT_PATH{};
+  if (parent_id == -1) {
+    return NO_PARENT_PATH;
+  }
+
+  if (parent_id < 0 ||
+      parent_id >= static_cast<int64_t>(directory_paths.size())) {
+    throw decode_error("The report refers to a directory before writing it.");
+  }
+  return directory_paths[parent_id];
+}
+
+void joinSegment(std::string const &parent_path, std::string const &segment,
+                 std::string &path) {
+  path = parent_path;
+  if (path.size() != 0) {
+    path += PATH_DELIMITER;
+  }
+  path += segment;
+}
+
+void decodeHeader(std::istream &input, output_sink &sink) {
+  std::string header{};
+  std::getline(input, header, '\n');
+
+  std::istringstream header_stream(header);
+  std::string magic{};
+  int version = 0;
+  std::size_t group_count = 0;
+  header_stream >> magic >> version >> group_count;
+  if (!header_stream || magic != PREFIX_FORMAT_MAGIC ||
+      version != PREFIX_FORMAT_VERSION) {
+    throw decode_error("The input is not a report in the prefix format.");
+  }
+
+  writeSinkNumber(sink, group_count);
+  writeSinkString(sink, " Sets of Duplicates Found:\n\n");
+}
+
+void decodeReport(std::istream &input, output_sink &sink) {
+  decodeHeader(input, sink);
+
+  std::vector<std::string> directory_paths{};
+  std::string record{};
+  std::string path{};
+  bool first_group = true;
+  while (std::getline(input, record, '\0')) {
+    if (record.size() == 0) {
+      throw decode_error("The report has an empty record.");
+    }
+
+    std::size_t offset = 1;
+    switch (record[0]) {
+    case PREFIX_DIRECTORY_TAG: {
+      int64_t id = parseNumberField(nextField(record, offset, false));
+      int64_t parent_id = parseNumberField(nextField(record, offset, false));
+      if (id != static_cast<int64_t>(directory_paths.size())) {
+        throw decode_error("The report has directories out of order.");
+      }
+
+      joinSegment(findParentPath(directory_paths, parent_id),
+                  nextField(record, offset, true), path);
+      directory_paths.push_back(path);
+      break;
+    }
+    case PREFIX_GROUP_TAG:
+      if (!first_group) {
+        writeSinkBytes(sink, "\n", 1);
+      }
+      first_group = false;
+      break;
+    case PREFIX_MEMBER_TAG: {
+      int64_t parent_id = parseNumberField(nextField(record, offset, false));
+      joinSegment(findParentPath(directory_paths, parent_id),
+                  nextField(record, offset, true), path);
+      path += '\n';
+      writeSinkString(sink, path);
+      break;
+    }
+    default:
+      throw decode_error("The report has a record with an unknown tag.");
+    }
+  }
+
+  flushSink(sink);
+}
+
+void decode(std::string const &input_path, int output_fd) {
+  std::ifstream input(input_path, std::ios::binary);
+  if (!input) {
+    throw decode_error("Could not open the report: " + input_path);
+  }
+
+  output_sink sink = initOutputSink(flushToFileDescriptor, &output_fd);
+  decodeReport(input, sink);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <istream>
+#include <stdexcept>
+#include <string>
+
+#include "../dupes/format.h"
+#include "../dupes/sink.h"
+
+/**
+ * Expands a report written with the prefix format back into the text block
+ * list dupes prints by default.
+ */
+void decodeReport(std::istream &input, output_sink &sink);
+void decode(std::string const &input_path, int output_fd);
+
+class decode_error : public std::runtime_error {
+public:
+  decode_error(const std::string &message) : std::runtime_error(message) {}
+};
@@ -0,0 +1,110 @@
+#include "./digest_map.h"
+
+#include <cstring>
+
+std::size_t slotCapacity(std::size_t expected_digests) {
+  // Keep the load factor at or below one half.
+  std::size_t capacity = 16;
+  while (capacity < expected_digests * 2) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+digest_map initDigestMap(std::size_t expected_digests) {
+  digest_map map{};
+  map.slots.assign(slotCapacity(expected_digests), NO_GROUP);
+  map.group_digests.reserve(expected_digests);
+  return map;
+}
+
+std::size_t probeSlot(digest_map const &map, digest const &key) {
+  std::size_t mask = map.slots.size() - 1;
+  std::size_t slot = hashDigest(key) & mask;
+
+  while (map.slots[slot] != NO_GROUP &&
+         std::memcmp(map.group_digests[map.slots[slot]].bytes, key.bytes,
+                     MD5_DIGEST_LENGTH) != 0) {
+    slot = (slot + 1) & mask;
+  }
+
+  return slot;
+}
+
+void growDigestMap(digest_map &map) {
+  map.slots.assign(map.slots.size() * 2, NO_GROUP);
+  for (std::size_t group = 0; group < map.group_digests.size(); ++group) {
+    map.slots[probeSlot(map, map.group_digests[group])] = group;
+  }
+}
+
+std::size_t insertDigest(digest_map &map, digest const &key) {
+  std::size_t slot = probeSlot(map, key);
+  if (map.slots[slot] != NO_GROUP) {
+    return map.slots[slot];
+  }
+
+  std::size_t group = map.group_digests.size();
+  map.group_digests.push_back(key);
+  map.slots[slot] = group;
+
+  if (map.group_digests.size() * 2 > map.slots.size()) {
+    growDigestMap(map);
+  }
+
+  return group;
+}
+
+std::size_t findDigest(digest_map const &map, digest const &key) {
+  return map.slots[probeSlot(map, key)];
+}
+
+std::size_t digest_groups::size() const {
+  return group_offsets.size() == 0 ? 0 : group_offsets.size() - 1;
+}
+
+std::size_t digest_groups::groupSize(std::size_t group) const {
+  return group_offsets[group + 1] - group_offsets[group];
+}
+
+std::size_t const *digest_groups::groupMembers(std::size_t group) const {
+  return members.data() + group_offsets[group];
+}
+
+/**
+ * Counting sort of the nodes by group id. One pass assigns the group ids and
+ * counts members, a prefix sum turns the counts into offsets and a final pass
+ * places each node.
+ */
+digest_groups groupDigests(std::vector<digest> const &digests,
+                           std::vector<std::size_t> const &order) {
+  digest_groups groups{};
+  digest_map map = initDigestMap(order.size());
+  groups.node_groups.assign(digests.size(), NO_GROUP);
+
+  std::vector<std::size_t> group_counts{};
+  for (std::size_t node : order) {
+    std::size_t group = insertDigest(map, digests[node]);
+    groups.node_groups[node] = group;
+
+    if (group == group_counts.size()) {
+      group_counts.push_back(0);
+    }
+    ++group_counts[group];
+  }
+
+  groups.group_offsets.assign(group_counts.size() + 1, 0);
+  for (std::size_t group = 0; group < group_counts.size(); ++group) {
+    groups.group_offsets[group + 1] =
+        groups.group_offsets[group] + group_counts[group];
+  }
+
+  std::vector<std::size_t> next_member(groups.group_offsets.begin(),
+                                       groups.group_offsets.end() - 1);
+  groups.members.resize(order.size());
+  for (std::size_t node : order) {
+    groups.members[next_member[groups.node_groups[node]]++] = node;
+  }
+
+  return groups;
+}
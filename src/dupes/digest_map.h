@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../lib.h"
+
+constexpr std::size_t NO_GROUP = SIZE_MAX;
+
+/**
+ * Open addressing map (linear probing) from a digest to a compact group id.
+ * Group ids are handed out in insertion order. The slots only hold group ids,
+ * the digest of each group is stored once in group_digests.
+ */
+struct digest_map {
+  std::vector<std::size_t> slots;
+  std::vector<digest> group_digests;
+};
+
+digest_map initDigestMap(std::size_t expected_digests);
+std::size_t insertDigest(digest_map &map, digest const &key);
+std::size_t findDigest(digest_map const &map, digest const &key);
+
+/**
+ * Nodes grouped by their digest. The members of group g are stored
+ * contiguously in members[group_offsets[g]] .. members[group_offsets[g + 1]]
+ * in the order the nodes were visited.
+ */
+struct digest_groups {
+  std::vector<std::size_t> node_groups;
+  std::vector<std::size_t> group_offsets;
+  std::vector<std::size_t> members;
+
+  std::size_t size() const;
+  std::size_t groupSize(std::size_t group) const;
+  std::size_t const *groupMembers(std::size_t group) const;
+};
+
+digest_groups groupDigests(std::vector<digest> const &digests,
+                           std::vector<std::size_t> const &order);
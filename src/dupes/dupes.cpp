@@ -1,19 +1,135 @@
-
 #include "dupes.h"
 
+#include "./digest_map.h"
+#include "./extents.h"
 #include "./load.h"
 #include "./transform.h"
+#include "./verify.h"
+
+void printArenaStats(std::ostream &console, arena_stats const &stats) {
+  console << "Arena Memory: " << stats.bytes_allocated << " bytes in "
+          << stats.allocations << " allocations across " << stats.blocks
+          << " blocks (" << stats.bytes_reserved << " bytes reserved).\n"
+          << std::endl;
+}
+
+/**
+ * Caches built without the option (or before options were recorded) fold
+ * the digests without names.
+ */
+digest_options fetchDigestOptions(sqlite3 *db) {
+  try {
+    cache_option_table_row row = fetchCacheOption(db, DIGEST_NAMES_OPTION);
+    return {.include_names = compareStrings(row.value, "1")};
+  } catch (not_found_error &error) {
+    return {.include_names = false};
+  }
+}
+
+/**
+ * Writes back the directory digests folded during this run so the next run
+ * only has to fold the directories update has cleared since.
+ */
+void persistDirectoryDigests(sqlite3 *db, inode_tree const &tree,
+                             std::ostream &console) {
+  std::vector<directory_digest_input> digest_inputs = collectDirtyDigests(tree);
+  if (digest_inputs.size() == 0) {
+    return;
+  }
+
+  updateDirectoryDigests(db, digest_inputs);
+  console << "Persisted " << digest_inputs.size()
+          << " directory digests to the SQLite Cache.\n"
+          << std::endl;
+}
 
-void dupes(std::string cache_path, std::ostream &console) {
+/**
+ * Splits the groups whose contents differ. Groups verified by an earlier run
+ * whose files have not changed since are not read again. The stamps the
+ * files of the remaining groups were verified with come back ordered by node.
+ */
+std::vector<verified_stamp>
+verifyDuplicates(sqlite3 *db, arena *dupes_arena,
+                 duplicate_node_set &duplicate_nodes_set,
+                 std::ostream &console) {
+  scan_meta_data_table_row meta_data_row = fetchScanMetaData(db);
+  verified_group_table_row::rows verified_rows =
+      fetchAllVerifiedGroups(db, dupes_arena);
+
+  digest_map verified_keys = initDigestMap(verified_rows.size());
+  for (verified_group_table_row const &verified_row : verified_rows) {
+    insertDigest(verified_keys, toDigest(verified_row.key));
+  }
+
+  verify_result result = verifyDuplicateNodeSet(
+      duplicate_nodes_set, meta_data_row.root_dir, verified_keys);
+
+  std::vector<verified_group_input> verified_inputs{};
+  for (digest const &key : result.verified_keys) {
+    verified_inputs.push_back({.key = key.bytes});
+  }
+  createVerifiedGroups(db, verified_inputs);
+
+  console << "Verified " << result.stats.groups_read
+          << " groups byte for byte (" << result.stats.bytes_read
+          << " bytes read), "
+          << result.stats.groups_cached
+          << " groups were already verified and " << result.stats.groups_split
+          << " groups were split.\n"
+          << std::endl;
+  return result.file_stamps;
+}
+
+void dupes(std::string cache_path, dupes_options const &options,
+           std::ostream &console) {
   sqlite3 *db = initDB(cache_path.c_str());
-  file_hash_rows rows = {fetchAllDirectories(db), fetchAllHashes(db)};
+  upgradeDB(db);
+  arena *dupes_arena = initArena();
+  file_hash_rows rows = {fetchAllDirectories(db, dupes_arena),
+                         fetchAllHashes(db, dupes_arena)};
   console
       << "Done extracting the files from the SQLite Cache. Total Directories "
       << rows.directory_rows.size()
       << " Total Hashes: " << rows.hash_rows.size() << '\n'
       << std::endl;
-  duplicate_path_seg_set transformation_results = transform(rows);
+  duplicate_node_set transformation_results =
+      transform(rows, fetchDigestOptions(db));
+  persistDirectoryDigests(db, transformation_results.tree, console);
+  if (options.verify) {
+    verifyDuplicates(db, dupes_arena, transformation_results, console);
+  }
+  std::size_t shared_groups =
+      markSharedExtents(transformation_results, rows.hash_rows);
+  if (shared_groups != 0) {
+    console << shared_groups
+            << " groups share all their extents already, deleting their "
+               "members frees nothing.\n"
+            << std::endl;
+  }
+  printArenaStats(console, arenaStats(dupes_arena));
 
-  load(console, transformation_results);
+  load_options group_options{.sort = options.sort,
+                             .top = options.top,
+                             .window = options.window,
+                             .format = options.format};
+  exec_stats stats{0, 0, 0};
+  if (options.exec.command != nullptr) {
+    sortDuplicateNodeSet(transformation_results, group_options);
+    stats = execDuplicates(transformation_results,
+                           fetchScanMetaData(db).root_dir, options.exec,
+                           console);
+  } else {
+    // Everything written to the console has to come out before the groups.
+    console.flush();
+    int output_fd = options.output_fd;
+    output_sink sink = initOutputSink(flushToFileDescriptor, &output_fd);
+    load(sink, transformation_results, group_options);
+  }
+  freeArena(dupes_arena);
   freeDB(db);
+
+  if (stats.commands_failed != 0) {
+    throw exec_error(std::to_string(stats.commands_failed) +
+                     " commands exited with an error.");
+  }
 }
@@ -1,5 +1,35 @@
+#pragma once
+
 #include <ostream>
 #include <string>
 #include <vector>
 
-void dupes(std::string cache_path, std::ostream &console);
\ No newline at end of file
+#include "./exec.h"
+#include "./load.h"
+#include "./transform.h"
+#include "./verify.h"
+
+/**
+ * With verify every group is checked byte for byte before it is printed. Sort,
+ * top and window decide which groups are printed and in what order, format
+ * decides how they are written. The groups are written straight to the
+ * output file descriptor, the console only gets the progress messages. With
+ * an exec command the groups are passed to it instead of being written.
+ */
+struct dupes_options {
+  bool verify;
+  group_sort sort;
+  std::size_t top;
+  std::size_t window;
+  output_format format;
+  int output_fd;
+  exec_options exec;
+};
+
+digest_options fetchDigestOptions(sqlite3 *db);
+std::vector<verified_stamp>
+verifyDuplicates(sqlite3 *db, arena *dupes_arena,
+                 duplicate_node_set &duplicate_nodes_set,
+                 std::ostream &console);
+void dupes(std::string cache_path, dupes_options const &options,
+           std::ostream &console);
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "./exec.h"
+
+#include <deque>
+
+#include "../env/env.h"
+#include "../fs/file_system.h"
+#include "./load.h"
+
+// The shell, -c, the script, the name the script sees as $0 and the null
+// which ends the arguments.
+constexpr std::size_t EXEC_FIXED_POINTERS = 5;
+constexpr char EXEC_SCRIPT_NAME[] = "ddupes";
+
+bool exec_stats::operator==(exec_stats const &rhs) const {
+  return rhs.commands_run == commands_run &&
+         rhs.commands_failed == commands_failed &&
+         rhs.paths_passed == paths_passed;
+}
+
+std::string buildExecScript(std::string const &command) {
+  std::string script{};
+  std::size_t run_start = 0;
+  for (std::size_t placeholder = command.find(EXEC_PLACEHOLDER);
+       placeholder != std::string::npos;
+       placeholder = command.find(EXEC_PLACEHOLDER, run_start)) {
+    script.append(command, run_start, placeholder - run_start);
+    script += EXEC_ARGUMENTS;
+    run_start = placeholder + sizeof(EXEC_PLACEHOLDER) - 1;
+  }
+
+  if (run_start == 0) {
+    return command + " " + EXEC_ARGUMENTS;
+  }
+  script.append(command, run_start, std::string::npos);
+  return script;
+}
+
+/**
+ * What a path costs against ARG_MAX, its bytes, its null and its pointer.
+ */
+std::size_t argumentCost(std::string const &argument) {
+  return argument.size() + 1 + sizeof(char *);
+}
+
+std::size_t scriptCost(std::string const &script) {
+  return stringLength(SHELL_PATH) + 1 + sizeof("-c") +
+         stringLength(EXEC_SCRIPT_NAME) + 1 + script.size() + 1 +
+         EXEC_FIXED_POINTERS * sizeof(char *);
+}
+
+/**
+ * Only the cost of each group is kept up front, the paths themselves are
+ * rendered again batch by batch.
+ */
+exec_batcher initExecBatcher(duplicate_node_set const &duplicate_nodes_set,
+                             std::string const &root_dir,
+                             exec_options const &options,
+                             std::size_t argument_bytes) {
+  exec_batcher batcher{.duplicate_nodes_set = &duplicate_nodes_set,
+                       .root_dir = &root_dir,
+                       .batch = options.batch,
+                       .batch_limit = argument_bytes,
+                       .group_costs =
+                           std::vector<std::size_t>(duplicate_nodes_set.size()),
+                       .group = 0,
+                       .member = 0,
+                       .segment_stack = {},
+                       .path = {}};
+
+  std::size_t total_cost = 0;
+  for (std::size_t group = 0; group < duplicate_nodes_set.size(); ++group) {
+    std::size_t const *members = duplicate_nodes_set.groupMembers(group);
+    for (std::size_t i = 0; i < duplicate_nodes_set.groupSize(group); ++i) {
+      renderPath(duplicate_nodes_set.tree, members[i], batcher.segment_stack,
+                 batcher.path);
+      batcher.group_costs[group] +=
+          argumentCost(joinPath({root_dir, batcher.path}));
+    }
+    total_cost += batcher.group_costs[group];
+  }
+
+  if (options.batch == EXEC_BATCH_PATHS && options.jobs > 1) {
+    batcher.batch_limit =
+        std::min(batcher.batch_limit, total_cost / options.jobs + 1);
+  }
+  return batcher;
+}
+
+/**
+ * Batches never go over the limit unless a single path does, that path gets
+ * a batch of its own. False once every path has been handed out.
+ */
+bool nextExecBatch(exec_batcher &batcher, std::vector<std::string> &batch) {
+  duplicate_node_set const &duplicate_nodes_set = *batcher.duplicate_nodes_set;
+  batch.clear();
+  std::size_t batch_cost = 0;
+
+  while (batcher.group < duplicate_nodes_set.size()) {
+    std::size_t group = batcher.group;
+    if (batcher.member == duplicate_nodes_set.groupSize(group)) {
+      ++batcher.group;
+      batcher.member = 0;
+      continue;
+    }
+
+    bool group_fits =
+        batch_cost + batcher.group_costs[group] <= batcher.batch_limit;
+    if (batcher.member == 0 && batch.size() != 0 &&
+        (batcher.batch == EXEC_BATCH_GROUP || !group_fits)) {
+      return true;
+    }
+
+    renderPath(duplicate_nodes_set.tree,
+               duplicate_nodes_set.groupMembers(group)[batcher.member],
+               batcher.segment_stack, batcher.path);
+    std::string member_path = joinPath({*batcher.root_dir, batcher.path});
+    std::size_t cost = argumentCost(member_path);
+    if (batch.size() != 0 && batch_cost + cost > batcher.batch_limit) {
+      return true;
+    }
+    batch.push_back(std::move(member_path));
+    batch_cost += cost;
+    ++batcher.member;
+  }
+
+  return batch.size() != 0;
+}
+
+void waitForCommand(std::deque<pid_t> &running, exec_stats &stats) {
+  bool succeeded = false;
+  if (waitForChild(running.front(), succeeded) != -1 && !succeeded) {
+    ++stats.commands_failed;
+  }
+  running.pop_front();
+}
+
+/**
+ * A command which fails does not stop the others, a command which can not be
+ * started does once the running ones are done. Each batch is only rendered
+ * once a job is free for it, and the commands are waited for in the order
+ * they were started so no other child of the process is reaped.
+ */
+exec_stats runExecBatches(std::string const &script, exec_batcher &batcher,
+                          std::size_t jobs) {
+  exec_stats stats{0, 0, 0};
+  std::deque<pid_t> running{};
+  std::vector<std::string> batch{};
+  bool spawn_failed = false;
+
+  while (nextExecBatch(batcher, batch)) {
+    if (running.size() == jobs) {
+      waitForCommand(running, stats);
+    }
+
+    pid_t pid = spawnShell(script, batch);
+    if (pid == -1) {
+      spawn_failed = true;
+      break;
+    }
+    running.push_back(pid);
+    ++stats.commands_run;
+    stats.paths_passed += batch.size();
+  }
+
+  while (running.size() != 0) {
+    waitForCommand(running, stats);
+  }
+
+  if (spawn_failed) {
+    throw exec_error("Could not start the command after running " +
+                     std::to_string(stats.commands_run) + " commands.");
+  }
+  return stats;
+}
+
+exec_stats execDuplicates(duplicate_node_set const &duplicate_nodes_set,
+                          std::string const &root_dir,
+                          exec_options const &options, std::ostream &console) {
+  std::string script = buildExecScript(options.command);
+  std::size_t argument_bytes = argumentBytesLimit();
+  if (argument_bytes <= scriptCost(script)) {
+    throw exec_error("The command leaves no room for paths in ARG_MAX.");
+  }
+
+  exec_batcher batcher =
+      initExecBatcher(duplicate_nodes_set, root_dir, options,
+                      argument_bytes - scriptCost(script));
+
+  // Anything written to the console has to come out before the commands'.
+  console.flush();
+  exec_stats stats = runExecBatches(script, batcher, options.jobs);
+  console << "Ran " << stats.commands_run << " commands over "
+          << stats.paths_passed << " paths, " << stats.commands_failed
+          << " commands failed.\n"
+          << std::endl;
+  return stats;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "./transform_output.h"
+
+/**
+ * Runs a command over the groups instead of writing them, the same way xargs
+ * would. Every {} in the command is replaced by the paths of a batch, a
+ * command without one gets them appended. The paths are passed as arguments
+ * of the shell rather than pasted into the command so they never have to be
+ * quoted.
+ *
+ * - paths: As many paths as fit in ARG_MAX per command. A group is only split
+ *   across commands when it does not fit in one by itself.
+ * - group: One command per group with the paths of its members.
+ *
+ * Up to jobs commands run at the same time. With more than one job the paths
+ * are spread so every job gets a batch.
+ */
+constexpr char EXEC_PLACEHOLDER[] = "{}";
+constexpr char EXEC_ARGUMENTS[] = "\"$@\"";
+
+enum exec_batch { EXEC_BATCH_PATHS, EXEC_BATCH_GROUP };
+
+struct exec_options {
+  char const *command;
+  std::size_t jobs;
+  exec_batch batch;
+};
+
+struct exec_stats {
+  std::size_t commands_run;
+  std::size_t commands_failed;
+  std::size_t paths_passed;
+
+  bool operator==(exec_stats const &rhs) const;
+};
+
+/**
+ * Hands out the batches one at a time, from the group and member the next
+ * one starts at.
+ */
+struct exec_batcher {
+  duplicate_node_set const *duplicate_nodes_set;
+  std::string const *root_dir;
+  exec_batch batch;
+  std::size_t batch_limit;
+  std::vector<std::size_t> group_costs;
+  std::size_t group;
+  std::size_t member;
+  std::vector<char const *> segment_stack;
+  std::string path;
+};
+
+std::string buildExecScript(std::string const &command);
+exec_batcher initExecBatcher(duplicate_node_set const &duplicate_nodes_set,
+                             std::string const &root_dir,
+                             exec_options const &options,
+                             std::size_t argument_bytes);
+bool nextExecBatch(exec_batcher &batcher, std::vector<std::string> &batch);
+exec_stats runExecBatches(std::string const &script, exec_batcher &batcher,
+                          std::size_t jobs);
+exec_stats execDuplicates(duplicate_node_set const &duplicate_nodes_set,
+                          std::string const &root_dir,
+                          exec_options const &options, std::ostream &console);
+
+class exec_error : public std::runtime_error {
+public:
+  exec_error(const std::string &message) : std::runtime_error(message) {}
+};
@@ -0,0 +1,68 @@
+#include "./extents.h"
+
+#include <unordered_map>
+
+#include "./verify.h"
+
+/**
+ * A file node's name points into the hash row it was loaded from, so the
+ * name's address finds the row's fingerprint.
+ */
+typedef std::unordered_map<char const *, uint8_t const *> extent_map;
+
+bool groupSharesExtents(duplicate_node_set const &duplicate_nodes_set,
+                        extent_map const &extents, std::size_t group) {
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::size_t const *members = duplicate_nodes_set.groupMembers(group);
+  std::vector<std::size_t> first_files = collectFileNodes(tree, members[0]);
+  std::vector<uint8_t const *> first_extents{};
+  for (std::size_t file_node : first_files) {
+    extent_map::const_iterator file_extents =
+        extents.find(tree.path_segments[file_node]);
+    if (file_extents == extents.end()) {
+      return false;
+    }
+    first_extents.push_back(file_extents->second);
+  }
+
+  for (std::size_t i = 1; i < duplicate_nodes_set.groupSize(group); ++i) {
+    std::vector<std::size_t> files = collectFileNodes(tree, members[i]);
+    if (files.size() != first_files.size()) {
+      return false;
+    }
+
+    for (std::size_t j = 0; j < files.size(); ++j) {
+      extent_map::const_iterator file_extents =
+          extents.find(tree.path_segments[files[j]]);
+      if (file_extents == extents.end() ||
+          !compareHashes(file_extents->second, first_extents[j])) {
+        return false;
+      }
+    }
+  }
+
+  return first_files.size() != 0;
+}
+
+std::size_t markSharedExtents(duplicate_node_set &duplicate_nodes_set,
+                              hash_table_row::rows const &hash_rows) {
+  extent_map extents{};
+  for (hash_table_row const &hash_row : hash_rows) {
+    if (hash_row.extents != nullptr) {
+      extents[hash_row.name] = hash_row.extents;
+    }
+  }
+
+  duplicate_nodes_set.shared_extents.clear();
+  if (extents.size() == 0) {
+    return 0;
+  }
+
+  std::size_t shared_groups = 0;
+  for (std::size_t group = 0; group < duplicate_nodes_set.size(); ++group) {
+    bool shared = groupSharesExtents(duplicate_nodes_set, extents, group);
+    duplicate_nodes_set.shared_extents.push_back(shared);
+    shared_groups += shared ? 1 : 0;
+  }
+  return shared_groups;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+#include "../sqlite/sqlite.h"
+#include "./transform_output.h"
+
+/**
+ * Marks the groups whose members already share all their extents, reflinks or
+ * hardlinks of the same file. Deleting all but one of them frees nothing, so
+ * they have no reclaimable bytes. A directory member shares its extents when
+ * each of its files does with the matching file of the first member, files
+ * are matched by digest the same way verify matches them. Files build could
+ * not fingerprint share nothing.
+ *
+ * Caches without any fingerprints are left unmarked. Gives back how many
+ * groups were marked.
+ */
+std::size_t markSharedExtents(duplicate_node_set &duplicate_nodes_set,
+                              hash_table_row::rows const &hash_rows);
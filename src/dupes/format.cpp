@@ -0,0 +1,321 @@
+#include "./format.h"
+
+#include <cstring>
+
+#include "./load.h"
+
+/**
+ * NOTE: The escaping writers look for the next byte which needs escaping and
+ * write everything before it in one go, so paths without any special bytes
+ * are written with a single copy.
+ */
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+constexpr char CSV_HEADER[] = "group,size,digest,path\n";
+
+format_writer initFormatWriter(output_format format) {
+  return {.format = format,
+          .segment_stack = {},
+          .path = {},
+          .prefix_ids = {},
+          .next_prefix_id = 0};
+}
+
+void writeHexDigest(output_sink &sink, digest const &value) {
+  char hex[MD5_DIGEST_LENGTH * 2];
+  for (std::size_t i = 0; i < MD5_DIGEST_LENGTH; ++i) {
+    hex[i * 2] = HEX_DIGITS[value.bytes[i] >> 4];
+    hex[i * 2 + 1] = HEX_DIGITS[value.bytes[i] & 0x0f];
+  }
+  writeSinkBytes(sink, hex, sizeof(hex));
+}
+
+/**
+ * The length of the UTF-8 sequence which starts at index, 0 when the bytes
+ * there are not one. Overlong forms, surrogates and code points past
+ * U+10FFFF are not UTF-8.
+ */
+std::size_t utf8SequenceLength(std::string const &value, std::size_t index) {
+  unsigned char lead = static_cast<unsigned char>(value[index]);
+  std::size_t length = 0;
+  unsigned char second_low = 0x80;
+  unsigned char second_high = 0xbf;
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    length = 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    length = 3;
+    second_low = lead == 0xe0 ? 0xa0 : 0x80;
+    second_high = lead == 0xed ? 0x9f : 0xbf;
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    length = 4;
+    second_low = lead == 0xf0 ? 0x90 : 0x80;
+    second_high = lead == 0xf4 ? 0x8f : 0xbf;
+  } else {
+    return 0;
+  }
+
+  if (value.size() - index < length) {
+    return 0;
+  }
+  for (std::size_t i = 1; i < length; ++i) {
+    unsigned char byte = static_cast<unsigned char>(value[index + i]);
+    unsigned char low = i == 1 ? second_low : 0x80;
+    unsigned char high = i == 1 ? second_high : 0xbf;
+    if (byte < low || byte > high) {
+      return 0;
+    }
+  }
+  return length;
+}
+
+/**
+ * Quotes, backslashes and control characters are escaped. UTF-8 is written
+ * as it is. Bytes which are not part of valid UTF-8 are escaped one by one
+ * as \u00XX so the output stays valid JSON. The path then reads as Latin-1
+ * for those bytes.
+ */
+void writeJsonString(output_sink &sink, std::string const &value) {
+  writeSinkBytes(sink, "\"", 1);
+
+  std::size_t run_start = 0;
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    unsigned char byte = static_cast<unsigned char>(value[i]);
+    if (byte >= 0x80) {
+      std::size_t length = utf8SequenceLength(value, i);
+      if (length != 0) {
+        i += length - 1;
+        continue;
+      }
+    } else if (byte >= 0x20 && byte != '"' && byte != '\\') {
+      continue;
+    }
+
+    writeSinkBytes(sink, value.data() + run_start, i - run_start);
+    run_start = i + 1;
+
+    switch (byte) {
+    case '"':
+      writeSinkBytes(sink, "\\\"", 2);
+      break;
+    case '\\':
+      writeSinkBytes(sink, "\\\\", 2);
+      break;
+    case '\n':
+      writeSinkBytes(sink, "\\n", 2);
+      break;
+    case '\r':
+      writeSinkBytes(sink, "\\r", 2);
+      break;
+    case '\t':
+      writeSinkBytes(sink, "\\t", 2);
+      break;
+    default: {
+      char escaped[] = {'\\', 'u', '0', '0', HEX_DIGITS[byte >> 4],
+                        HEX_DIGITS[byte & 0x0f]};
+      writeSinkBytes(sink, escaped, sizeof(escaped));
+    }
+    }
+  }
+
+  writeSinkBytes(sink, value.data() + run_start, value.size() - run_start);
+  writeSinkBytes(sink, "\"", 1);
+}
+
+/**
+ * Fields are only quoted when they have to be, a quote inside a quoted field
+ * is doubled.
+ */
+void writeCsvField(output_sink &sink, std::string const &value) {
+  if (value.find_first_of(",\"\r\n") == std::string::npos) {
+    writeSinkString(sink, value);
+    return;
+  }
+
+  writeSinkBytes(sink, "\"", 1);
+  std::size_t run_start = 0;
+  for (std::size_t quote = value.find('"'); quote != std::string::npos;
+       quote = value.find('"', quote + 1)) {
+    writeSinkBytes(sink, value.data() + run_start, quote + 1 - run_start);
+    writeSinkBytes(sink, "\"", 1);
+    run_start = quote + 1;
+  }
+  writeSinkBytes(sink, value.data() + run_start, value.size() - run_start);
+  writeSinkBytes(sink, "\"", 1);
+}
+
+void writeFormatHeader(output_sink &sink, format_writer const &writer,
+                       std::size_t group_count) {
+  if (writer.format == OUTPUT_FORMAT_CSV) {
+    writeSinkBytes(sink, CSV_HEADER, sizeof(CSV_HEADER) - 1);
+    return;
+  }
+
+  if (writer.format == OUTPUT_FORMAT_PREFIX) {
+    writeSinkBytes(sink, PREFIX_FORMAT_MAGIC, sizeof(PREFIX_FORMAT_MAGIC) - 1);
+    writeSinkBytes(sink, " ", 1);
+    writeSinkNumber(sink, PREFIX_FORMAT_VERSION);
+    writeSinkBytes(sink, " ", 1);
+    writeSinkNumber(sink, group_count);
+    writeSinkBytes(sink, "\n", 1);
+  }
+}
+
+void writeJsonlGroup(output_sink &sink, format_writer &writer,
+                     duplicate_node_set const &duplicate_nodes_set,
+                     std::size_t group) {
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::size_t const *members = duplicate_nodes_set.groupMembers(group);
+
+  writeSinkString(sink, "{\"group\":");
+  writeSinkNumber(sink, group);
+  writeSinkString(sink, ",\"size\":");
+  writeSinkNumber(sink, tree.sizes[members[0]]);
+  writeSinkString(sink, ",\"digest\":\"");
+  writeHexDigest(sink, tree.node_digests[members[0]]);
+  if (duplicate_nodes_set.sharesExtents(group)) {
+    writeSinkString(sink, "\",\"shared_extents\":true");
+    writeSinkString(sink, ",\"members\":[");
+  } else {
+    writeSinkString(sink, "\",\"members\":[");
+  }
+  for (std::size_t i = 0; i < duplicate_nodes_set.groupSize(group); ++i) {
+    if (i != 0) {
+      writeSinkBytes(sink, ",", 1);
+    }
+    renderPath(tree, members[i], writer.segment_stack, writer.path);
+    writeJsonString(sink, writer.path);
+  }
+  writeSinkString(sink, "]}\n");
+}
+
+/**
+ * Null and CSV share a row per member and only differ in their separators
+ * and in how the path is escaped.
+ */
+void writeMemberRows(output_sink &sink, format_writer &writer,
+                     duplicate_node_set const &duplicate_nodes_set,
+                     std::size_t group) {
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::size_t const *members = duplicate_nodes_set.groupMembers(group);
+  bool csv = writer.format == OUTPUT_FORMAT_CSV;
+  char separator = csv ? ',' : '\t';
+  char terminator = csv ? '\n' : '\0';
+
+  for (std::size_t i = 0; i < duplicate_nodes_set.groupSize(group); ++i) {
+    writeSinkNumber(sink, group);
+    writeSinkBytes(sink, &separator, 1);
+    writeSinkNumber(sink, tree.sizes[members[i]]);
+    writeSinkBytes(sink, &separator, 1);
+    writeHexDigest(sink, tree.node_digests[members[i]]);
+    writeSinkBytes(sink, &separator, 1);
+
+    renderPath(tree, members[i], writer.segment_stack, writer.path);
+    if (csv) {
+      writeCsvField(sink, writer.path);
+    } else {
+      writeSinkString(sink, writer.path);
+    }
+    writeSinkBytes(sink, &terminator, 1);
+  }
+}
+
+void writeSegment(output_sink &sink, char const *segment) {
+  writeSinkBytes(sink, segment, std::strlen(segment));
+}
+
+void writePrefixId(output_sink &sink, std::size_t prefix_id) {
+  if (prefix_id == NO_PREFIX_ID) {
+    writeSinkBytes(sink, "-1", 2);
+    return;
+  }
+  writeSinkNumber(sink, prefix_id);
+}
+
+/**
+ * Writes the directories above the node which have not been written yet,
+ * top down so a directory's parent is always written before it. Returns the
+ * id of the node's parent.
+ */
+std::size_t writePrefixDirectories(output_sink &sink, format_writer &writer,
+                                   inode_tree const &tree, std::size_t node) {
+  if (writer.prefix_ids.size() != tree.parents.size()) {
+    writer.prefix_ids.assign(tree.parents.size(), NO_PREFIX_ID);
+  }
+
+  std::vector<std::size_t> unwritten{};
+  std::size_t parent = tree.parents[node];
+  while (parent != NO_PARENT && writer.prefix_ids[parent] == NO_PREFIX_ID) {
+    unwritten.push_back(parent);
+    parent = tree.parents[parent];
+  }
+
+  for (std::size_t i = unwritten.size(); i-- > 0;) {
+    std::size_t directory = unwritten[i];
+    std::size_t directory_parent = tree.parents[directory];
+    writer.prefix_ids[directory] = writer.next_prefix_id++;
+
+    writeSinkBytes(sink, &PREFIX_DIRECTORY_TAG, 1);
+    writeSinkNumber(sink, writer.prefix_ids[directory]);
+    writeSinkBytes(sink, "\t", 1);
+    writePrefixId(sink, directory_parent == NO_PARENT
+                            ? NO_PREFIX_ID
+                            : writer.prefix_ids[directory_parent]);
+    writeSinkBytes(sink, "\t", 1);
+    writeSegment(sink, tree.path_segments[directory]);
+    writeSinkBytes(sink, "\0", 1);
+  }
+
+  std::size_t node_parent = tree.parents[node];
+  return node_parent == NO_PARENT ? NO_PREFIX_ID
+                                  : writer.prefix_ids[node_parent];
+}
+
+void writePrefixGroup(output_sink &sink, format_writer &writer,
+                      duplicate_node_set const &duplicate_nodes_set,
+                      std::size_t group) {
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::size_t const *members = duplicate_nodes_set.groupMembers(group);
+
+  // Directories come first so the member records of a group stay together.
+  std::vector<std::size_t> parent_ids{};
+  for (std::size_t i = 0; i < duplicate_nodes_set.groupSize(group); ++i) {
+    parent_ids.push_back(
+        writePrefixDirectories(sink, writer, tree, members[i]));
+  }
+
+  writeSinkBytes(sink, &PREFIX_GROUP_TAG, 1);
+  writeSinkNumber(sink, group);
+  writeSinkBytes(sink, "\t", 1);
+  writeSinkNumber(sink, tree.sizes[members[0]]);
+  writeSinkBytes(sink, "\t", 1);
+  writeHexDigest(sink, tree.node_digests[members[0]]);
+  writeSinkBytes(sink, "\0", 1);
+
+  for (std::size_t i = 0; i < duplicate_nodes_set.groupSize(group); ++i) {
+    writeSinkBytes(sink, &PREFIX_MEMBER_TAG, 1);
+    writePrefixId(sink, parent_ids[i]);
+    writeSinkBytes(sink, "\t", 1);
+    writeSegment(sink, tree.path_segments[members[i]]);
+    writeSinkBytes(sink, "\0", 1);
+  }
+}
+
+void writeGroupRecord(output_sink &sink, format_writer &writer,
+                      duplicate_node_set const &duplicate_nodes_set,
+                      std::size_t group) {
+  if (duplicate_nodes_set.groupSize(group) == 0) {
+    return;
+  }
+
+  if (writer.format == OUTPUT_FORMAT_JSONL) {
+    writeJsonlGroup(sink, writer, duplicate_nodes_set, group);
+    return;
+  }
+
+  if (writer.format == OUTPUT_FORMAT_PREFIX) {
+    writePrefixGroup(sink, writer, duplicate_nodes_set, group);
+    return;
+  }
+
+  writeMemberRows(sink, writer, duplicate_nodes_set, group);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "./sink.h"
+#include "./transform_output.h"
+
+/**
+ * How the groups are written. Text is the block list meant for people. The
+ * others write the group id, size, digest and path of every member so they
+ * can be consumed without parsing the text:
+ *
+ * - jsonl: One JSON object per group, {"group":0,"size":12,"digest":"..",
+ *   "members":[".."]}. Paths are escaped as JSON strings. Groups whose
+ *   members share all their extents have "shared_extents":true before the
+ *   members.
+ * - null: One record per member, "group\tsize\tdigest\tpath\0". Only the path
+ *   can hold a tab so it is everything after the third one.
+ * - csv: A "group,size,digest,path" header and then a row per member. Paths
+ *   are quoted when they hold a comma, quote or line break.
+ * - prefix: Paths are written against a table of the directories above them.
+ *   See below.
+ */
+enum output_format {
+  OUTPUT_FORMAT_TEXT,
+  OUTPUT_FORMAT_JSONL,
+  OUTPUT_FORMAT_NULL,
+  OUTPUT_FORMAT_CSV,
+  OUTPUT_FORMAT_PREFIX
+};
+
+/**
+ * The prefix format starts with "ddupes-prefix 1 <groups>\n" and is followed
+ * by records ending in a NUL, each starting with a tag:
+ *
+ * - 'd' "id\tparent\tsegment": A directory, parent is -1 for a root. A
+ *   directory is written once, right before the first record under it.
+ * - 'g' "group\tsize\tdigest": Starts a group.
+ * - 'm' "parent\tsegment": A member of the current group.
+ *
+ * Members sharing directories only write their last segment, so the output
+ * grows with the number of distinct directories instead of the length of
+ * every path. The ids are the order the directories were written in.
+ */
+constexpr char PREFIX_FORMAT_MAGIC[] = "ddupes-prefix";
+constexpr int PREFIX_FORMAT_VERSION = 1;
+constexpr char PREFIX_DIRECTORY_TAG = 'd';
+constexpr char PREFIX_GROUP_TAG = 'g';
+constexpr char PREFIX_MEMBER_TAG = 'm';
+constexpr std::size_t NO_PREFIX_ID = SIZE_MAX;
+
+/**
+ * What a format keeps between groups, the buffers paths are rendered into
+ * and the ids the prefix format gave the directories it has written.
+ */
+struct format_writer {
+  output_format format;
+  std::vector<char const *> segment_stack;
+  std::string path;
+  std::vector<std::size_t> prefix_ids;
+  std::size_t next_prefix_id;
+};
+
+format_writer initFormatWriter(output_format format);
+void writeHexDigest(output_sink &sink, digest const &value);
+void writeJsonString(output_sink &sink, std::string const &value);
+void writeCsvField(output_sink &sink, std::string const &value);
+void writeFormatHeader(output_sink &sink, format_writer const &writer,
+                       std::size_t group_count);
+void writeGroupRecord(output_sink &sink, format_writer &writer,
+                      duplicate_node_set const &duplicate_nodes_set,
+                      std::size_t group);
@@ -1,150 +1,475 @@
 #include "load.h"
 
 #include <algorithm>
+#include <cstring>
 
-typedef std::vector<std::string> str_path_segments;
-typedef std::vector<str_path_segments> str_duplicate_path_segments;
-typedef std::vector<str_duplicate_path_segments> str_duplicate_path_seg_set;
-typedef std::vector<std::vector<std::string>> duplicate_inode_output;
+#include "../thread/parallel.h"
 
-str_duplicate_path_seg_set convertToStrings(duplicate_path_seg_set const &set) {
-  str_duplicate_path_seg_set set_of_duplicate_path_seg_strings{set.size()};
+/**
+ * Paths are never stored. They are rendered from the tree, walking parent
+ * indices into a reused buffer, right before they are written out. Sorting
+ * compares nodes through their ancestors instead of comparing copied
+ * segments.
+ */
 
-  for (int i = 0; i < set.size(); ++i) {
-    str_duplicate_path_segments set_of_duplicate_path_strings{set[i].size()};
+constexpr char DELIMITER = '/';
 
-    for (int j = 0; j < set[i].size(); ++j) {
-      str_path_segments path_segments_string{set[i][j].size()};
+void renderPath(inode_tree const &tree, std::size_t node,
+                std::vector<char const *> &segment_stack, std::string &path) {
+  segment_stack.clear();
+  for (std::size_t current = node; current != NO_PARENT;
+       current = tree.parents[current]) {
+    segment_stack.push_back(tree.path_segments[current]);
+  }
 
-      for (int x = 0; x < set[i][j].size(); ++x) {
-        path_segments_string[x] = set[i][j][x];
-      }
-      set_of_duplicate_path_strings[j] = path_segments_string;
+  path.clear();
+  for (std::size_t i = segment_stack.size(); i-- > 0;) {
+    path += segment_stack[i];
+    if (i != 0) {
+      path += DELIMITER;
     }
+  }
+}
 
-    set_of_duplicate_path_seg_strings[i] = set_of_duplicate_path_strings;
+/**
+ * Every member but one can be deleted. Directory sizes are the sizes of all
+ * the files under them. Members sharing their extents free nothing.
+ */
+int64_t reclaimableBytes(duplicate_node_set const &duplicate_nodes_set,
+                         std::size_t group) {
+  std::size_t group_size = duplicate_nodes_set.groupSize(group);
+  if (group_size == 0 || duplicate_nodes_set.sharesExtents(group)) {
+    return 0;
   }
 
-  return set_of_duplicate_path_seg_strings;
+  std::size_t const *members = duplicate_nodes_set.groupMembers(group);
+  return duplicate_nodes_set.tree.sizes[members[0]] *
+         static_cast<int64_t>(group_size - 1);
 }
 
-std::string joinVectorString(str_path_segments const &vector_string,
-                             char delimiter) {
-  std::string combined_string{""};
-
-  auto one_before_end{--vector_string.cend()};
-  for (auto iter = vector_string.cbegin(); iter != vector_string.cend();
-       iter++) {
-    combined_string += *iter;
-    if (iter != one_before_end) {
-      combined_string += delimiter;
+void printGroups(output_sink &sink, format_writer &writer,
+                 duplicate_node_set const &duplicate_nodes_set,
+                 load_options const &options, std::size_t begin,
+                 std::size_t end) {
+  if (options.format != OUTPUT_FORMAT_TEXT) {
+    for (std::size_t group = begin; group < end; ++group) {
+      writeGroupRecord(sink, writer, duplicate_nodes_set, group);
     }
+    return;
   }
 
-  return combined_string;
-}
+  for (std::size_t group = begin; group < end; ++group) {
+    if (group != 0) {
+      writeSinkBytes(sink, "\n", 1);
+    }
 
-duplicate_inode_output
-joinDuplicateINodePaths(str_duplicate_path_seg_set const &duplicate_i_nodes_set,
-                        char delimiter) {
-  duplicate_inode_output duplicate_output;
+    if (options.sort == GROUP_SORT_BYTES) {
+      writeSinkNumber(sink, reclaimableBytes(duplicate_nodes_set, group));
+      writeSinkString(sink, " bytes reclaimable:\n");
+    }
 
-  for (auto &paths : duplicate_i_nodes_set) {
-    std::vector<std::string> joined_paths;
+    if (duplicate_nodes_set.sharesExtents(group)) {
+      writeSinkString(sink, "Members share all their extents already:\n");
+    }
 
-    for (auto &path : paths) {
-      joined_paths.push_back(joinVectorString(path, delimiter));
+    std::size_t const *members = duplicate_nodes_set.groupMembers(group);
+    for (std::size_t i = 0; i < duplicate_nodes_set.groupSize(group); ++i) {
+      renderPath(duplicate_nodes_set.tree, members[i], writer.segment_stack,
+                 writer.path);
+      writer.path += '\n';
+      writeSinkString(sink, writer.path);
     }
+  }
+}
 
-    duplicate_output.push_back(joined_paths);
+void printHeader(output_sink &sink, format_writer const &writer,
+                 std::size_t group_count) {
+  if (writer.format != OUTPUT_FORMAT_TEXT) {
+    writeFormatHeader(sink, writer, group_count);
+    return;
   }
 
-  return duplicate_output;
+  writeSinkNumber(sink, group_count);
+  writeSinkString(sink, " Sets of Duplicates Found:\n\n");
 }
 
-void printDuplicateINodeSet(
-    std::ostream &console,
-    duplicate_inode_output const &duplicate_i_nodes_output) {
-  console << duplicate_i_nodes_output.size()
-          << " Sets of Duplicates Found:\n\n";
+void printDuplicateNodeSet(output_sink &sink,
+                           duplicate_node_set const &duplicate_nodes_set,
+                           load_options const &options) {
+  format_writer writer = initFormatWriter(options.format);
+  printHeader(sink, writer, duplicate_nodes_set.size());
+  printGroups(sink, writer, duplicate_nodes_set, options, 0,
+              duplicate_nodes_set.size());
+}
 
-  auto one_before_end{--duplicate_i_nodes_output.end()};
-  for (auto iter = duplicate_i_nodes_output.cbegin();
-       iter != duplicate_i_nodes_output.end(); iter++) {
-    for (auto path_iter = iter->cbegin(); path_iter != iter->cend();
-         ++path_iter) {
-      console << *path_iter << "\n";
-    }
+std::size_t ancestorAtDepth(inode_tree const &tree, std::size_t node,
+                            int depth) {
+  while (tree.depths[node] > depth) {
+    node = tree.parents[node];
+  }
+  return node;
+}
+
+bool segmentLess(inode_tree const &tree, std::size_t node_one,
+                 std::size_t node_two) {
+  return std::strcmp(tree.path_segments[node_one],
+                     tree.path_segments[node_two]) < 0;
+}
 
-    if (iter != one_before_end) {
-      console << "\n";
+/**
+ * Orders two paths by every segment but their last, then by their last
+ * segment when they are the same length and otherwise by length. Both nodes
+ * are lifted to the deepest compared segment and walked up together until
+ * they share a parent, which finds the first differing segment in O(depth).
+ */
+bool comparePath(inode_tree const &tree, std::size_t node_one,
+                 std::size_t node_two) {
+  int depth_one = tree.depths[node_one];
+  int depth_two = tree.depths[node_two];
+  int compared_depth = std::min(depth_one, depth_two) - 1;
+
+  if (compared_depth > 0) {
+    std::size_t ancestor_one = ancestorAtDepth(tree, node_one, compared_depth);
+    std::size_t ancestor_two = ancestorAtDepth(tree, node_two, compared_depth);
+
+    if (ancestor_one != ancestor_two) {
+      while (tree.parents[ancestor_one] != tree.parents[ancestor_two]) {
+        ancestor_one = tree.parents[ancestor_one];
+        ancestor_two = tree.parents[ancestor_two];
+      }
+
+      return segmentLess(tree, ancestor_one, ancestor_two);
     }
   }
+
+  // The same except for the last file.
+  if (depth_one == depth_two) {
+    return segmentLess(tree, node_one, node_two);
+  }
+
+  return depth_one < depth_two;
 }
-int countShortestPath(str_duplicate_path_segments const &paths) {
-  if (paths.size() == 0) {
+
+int countShortestPath(duplicate_node_set const &duplicate_nodes_set,
+                      std::size_t group) {
+  if (duplicate_nodes_set.groupSize(group) == 0) {
     return 0;
   }
 
-  int shortest_vector = paths[0].size();
-  for (auto &vector : paths) {
-    if (vector.size() < shortest_vector) {
-      shortest_vector = vector.size();
-    }
+  std::size_t const *members = duplicate_nodes_set.groupMembers(group);
+  int shortest_path = duplicate_nodes_set.tree.depths[members[0]];
+  for (std::size_t i = 1; i < duplicate_nodes_set.groupSize(group); ++i) {
+    shortest_path =
+        std::min(shortest_path, duplicate_nodes_set.tree.depths[members[i]]);
   }
 
-  return shortest_vector;
+  return shortest_path;
 }
 
-bool comparePath(str_path_segments const &path_one,
-                 str_path_segments const &path_two) {
-  for (int i = 0; i < path_one.size() - 1 && i < path_two.size() - 1; i++) {
-    if (path_one[i] == path_two[i]) {
-      continue;
-    }
+bool shortestPathAndLeastCount(duplicate_node_set const &duplicate_nodes_set,
+                               std::size_t group_one, std::size_t group_two) {
+  int path_one_shortest_count =
+      countShortestPath(duplicate_nodes_set, group_one);
+  int path_two_shortest_count =
+      countShortestPath(duplicate_nodes_set, group_two);
 
-    return path_one[i] < path_two[i];
+  if (path_one_shortest_count == path_two_shortest_count) {
+    return duplicate_nodes_set.groupSize(group_one) <
+           duplicate_nodes_set.groupSize(group_two);
   }
 
-  // The same except for the last file.
-  if (path_one.size() == path_two.size()) {
-    return path_one[path_one.size() - 1] < path_two[path_two.size() - 1];
+  return path_one_shortest_count < path_two_shortest_count;
+}
+
+void sortPaths(duplicate_node_set &duplicate_nodes_set, std::size_t group) {
+  std::size_t *members = duplicate_nodes_set.groupMembers(group);
+  inode_tree const &tree = duplicate_nodes_set.tree;
+
+  std::sort(members, members + duplicate_nodes_set.groupSize(group),
+            [&tree](std::size_t node_one, std::size_t node_two) {
+              return comparePath(tree, node_one, node_two);
+            });
+}
+
+/**
+ * Everything the group order looks at, computed once per group instead of on
+ * every comparison. Bytes are left at zero when sorting by path so the same
+ * comparison serves both orders.
+ */
+struct group_sort_key {
+  int64_t bytes;
+  int shortest_path;
+  std::size_t member_count;
+  std::size_t group;
+};
+
+struct sort_key_context {
+  duplicate_node_set const *duplicate_nodes_set;
+  group_sort sort;
+  std::size_t first_group;
+  std::vector<group_sort_key> *keys;
+};
+
+struct key_sort_context {
+  std::vector<group_sort_key> *keys;
+  std::vector<group_sort_key> *scratch;
+  std::size_t run_size;
+};
+
+/**
+ * Groups with more reclaimable bytes come first when sorting by bytes. Ties,
+ * and every group when sorting by path, fall back to the shortest path, the
+ * least members and then to the group index so the order is total.
+ */
+bool keyBefore(group_sort_key const &key_one, group_sort_key const &key_two) {
+  if (key_one.bytes != key_two.bytes) {
+    return key_one.bytes > key_two.bytes;
+  }
+  if (key_one.shortest_path != key_two.shortest_path) {
+    return key_one.shortest_path < key_two.shortest_path;
+  }
+  if (key_one.member_count != key_two.member_count) {
+    return key_one.member_count < key_two.member_count;
   }
+  return key_one.group < key_two.group;
+}
 
-  return path_one.size() < path_two.size();
+void computeSortKeys(std::size_t begin, std::size_t end, void *context) {
+  sort_key_context *sort_keys = static_cast<sort_key_context *>(context);
+  duplicate_node_set const &duplicate_nodes_set =
+      *sort_keys->duplicate_nodes_set;
+
+  for (std::size_t i = begin; i < end; ++i) {
+    std::size_t group = sort_keys->first_group + i;
+    (*sort_keys->keys)[i] = {
+        .bytes = sort_keys->sort == GROUP_SORT_BYTES
+                     ? reclaimableBytes(duplicate_nodes_set, group)
+                     : 0,
+        .shortest_path = countShortestPath(duplicate_nodes_set, group),
+        .member_count = duplicate_nodes_set.groupSize(group),
+        .group = group};
+  }
 }
 
-bool shortestPathAndLeastCount(str_duplicate_path_segments const &paths_one,
-                               str_duplicate_path_segments const &paths_two) {
-  int path_one_shortest_count = countShortestPath(paths_one);
-  int path_two_shortest_count = countShortestPath(paths_two);
+std::vector<group_sort_key>
+buildSortKeys(duplicate_node_set const &duplicate_nodes_set, group_sort sort,
+              std::size_t begin, std::size_t end) {
+  std::vector<group_sort_key> keys(end - begin);
+  sort_key_context context{&duplicate_nodes_set, sort, begin, &keys};
+  parallelFor(0, keys.size(), computeSortKeys, &context);
+  return keys;
+}
 
-  if (path_one_shortest_count == path_two_shortest_count) {
-    return paths_one.size() < paths_two.size();
+void sortKeyRuns(std::size_t begin, std::size_t end, void *context) {
+  key_sort_context *key_sort = static_cast<key_sort_context *>(context);
+  std::vector<group_sort_key> &keys = *key_sort->keys;
+
+  for (std::size_t run = begin; run < end; ++run) {
+    std::size_t run_begin = run * key_sort->run_size;
+    std::size_t run_end = std::min(run_begin + key_sort->run_size, keys.size());
+    std::sort(keys.begin() + run_begin, keys.begin() + run_end, keyBefore);
   }
+}
 
-  return path_one_shortest_count < path_two_shortest_count;
+void mergeKeyRuns(std::size_t begin, std::size_t end, void *context) {
+  key_sort_context *key_sort = static_cast<key_sort_context *>(context);
+  std::vector<group_sort_key> &keys = *key_sort->keys;
+
+  for (std::size_t pair = begin; pair < end; ++pair) {
+    std::size_t pair_begin = pair * key_sort->run_size * 2;
+    std::size_t middle = std::min(pair_begin + key_sort->run_size, keys.size());
+    std::size_t pair_end =
+        std::min(pair_begin + key_sort->run_size * 2, keys.size());
+    std::merge(keys.begin() + pair_begin, keys.begin() + middle,
+               keys.begin() + middle, keys.begin() + pair_end,
+               key_sort->scratch->begin() + pair_begin, keyBefore);
+  }
 }
 
-void sortPaths(str_duplicate_path_segments &paths) {
-  std::sort(paths.begin(), paths.end(), comparePath);
+/**
+ * Merge sort across threads. One run per thread is sorted on its own and
+ * then neighbouring runs are merged pairwise, every round of merges running
+ * in parallel, until a single run is left. The order is total so the result
+ * is the same as sorting on one thread.
+ */
+void sortKeys(std::vector<group_sort_key> &keys) {
+  std::size_t runs =
+      std::min(threadCount(),
+               std::max<std::size_t>(keys.size() / PARALLEL_MIN_CHUNK, 1));
+  if (runs <= 1) {
+    std::sort(keys.begin(), keys.end(), keyBefore);
+    return;
+  }
+
+  std::vector<group_sort_key> scratch(keys.size());
+  key_sort_context context{&keys, &scratch, (keys.size() + runs - 1) / runs};
+  parallelFor(0, runs, sortKeyRuns, &context, 1);
+
+  while (context.run_size < keys.size()) {
+    std::size_t pairs =
+        (keys.size() + context.run_size * 2 - 1) / (context.run_size * 2);
+    parallelFor(0, pairs, mergeKeyRuns, &context, 1);
+    keys.swap(scratch);
+    context.run_size *= 2;
+  }
 }
 
-void sortDuplicateINodesSet(str_duplicate_path_seg_set &duplicate_i_nodes_set) {
-  sort(duplicate_i_nodes_set.begin(), duplicate_i_nodes_set.end(),
-       shortestPathAndLeastCount);
+std::vector<std::size_t>
+keyGroups(std::vector<group_sort_key> const &keys) {
+  std::vector<std::size_t> group_order(keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    group_order[i] = keys[i].group;
+  }
+  return group_order;
+}
 
-  for (auto &paths : duplicate_i_nodes_set) {
-    sortPaths(paths);
+/**
+ * The first top groups in order. A heap of at most top keys is kept whose
+ * root is the last of them, so each key is compared against the root and
+ * only pushed when it comes before it. The groups are never sorted as a
+ * whole, which is O(groups * log(top)) instead of O(groups * log(groups)).
+ */
+std::vector<std::size_t>
+selectTopGroups(duplicate_node_set const &duplicate_nodes_set,
+                load_options const &options) {
+  std::vector<group_sort_key> keys = buildSortKeys(
+      duplicate_nodes_set, options.sort, 0, duplicate_nodes_set.size());
+
+  std::vector<group_sort_key> kept_keys{};
+  kept_keys.reserve(options.top);
+  for (group_sort_key const &key : keys) {
+    if (kept_keys.size() < options.top) {
+      kept_keys.push_back(key);
+      std::push_heap(kept_keys.begin(), kept_keys.end(), keyBefore);
+    } else if (keyBefore(key, kept_keys.front())) {
+      std::pop_heap(kept_keys.begin(), kept_keys.end(), keyBefore);
+      kept_keys.back() = key;
+      std::push_heap(kept_keys.begin(), kept_keys.end(), keyBefore);
+    }
   }
+
+  std::sort_heap(kept_keys.begin(), kept_keys.end(), keyBefore);
+  return keyGroups(kept_keys);
+}
+
+std::vector<std::size_t>
+sortGroupRange(duplicate_node_set const &duplicate_nodes_set,
+               load_options const &options, std::size_t begin,
+               std::size_t end) {
+  std::vector<group_sort_key> keys =
+      buildSortKeys(duplicate_nodes_set, options.sort, begin, end);
+  sortKeys(keys);
+  return keyGroups(keys);
 }
 
-void load(std::ostream &console,
-          duplicate_path_seg_set &duplicate_i_nodes_set) {
-  str_duplicate_path_seg_set duplicate_path_seg_set_str =
-      convertToStrings(duplicate_i_nodes_set);
-  sortDuplicateINodesSet(duplicate_path_seg_set_str);
-  duplicate_inode_output duplicate_i_nodes_output =
-      joinDuplicateINodePaths(duplicate_path_seg_set_str, '/');
-  printDuplicateINodeSet(console, duplicate_i_nodes_output);
+void sortGroupsPaths(std::size_t begin, std::size_t end, void *context) {
+  duplicate_node_set &duplicate_nodes_set =
+      *static_cast<duplicate_node_set *>(context);
+  for (std::size_t group = begin; group < end; ++group) {
+    sortPaths(duplicate_nodes_set, group);
+  }
+}
+
+/**
+ * Sorts the groups by an index permutation and then rewrites the member runs
+ * in the new order, dropping the groups past top. Only the member indices
+ * are moved.
+ */
+void sortDuplicateNodeSet(duplicate_node_set &duplicate_nodes_set,
+                          load_options const &options) {
+  std::vector<std::size_t> group_order =
+      options.top != 0 && options.top < duplicate_nodes_set.size()
+          ? selectTopGroups(duplicate_nodes_set, options)
+          : sortGroupRange(duplicate_nodes_set, options, 0,
+                           duplicate_nodes_set.size());
+
+  std::vector<std::size_t> group_offsets{0};
+  std::vector<std::size_t> members{};
+  std::vector<bool> shared_extents{};
+  members.reserve(duplicate_nodes_set.members.size());
+  for (std::size_t group : group_order) {
+    std::size_t const *group_members = duplicate_nodes_set.groupMembers(group);
+    members.insert(members.end(), group_members,
+                   group_members + duplicate_nodes_set.groupSize(group));
+    group_offsets.push_back(members.size());
+    if (duplicate_nodes_set.shared_extents.size() != 0) {
+      shared_extents.push_back(duplicate_nodes_set.shared_extents[group]);
+    }
+  }
+  duplicate_nodes_set.group_offsets = group_offsets;
+  duplicate_nodes_set.members = members;
+  duplicate_nodes_set.shared_extents = shared_extents;
+
+  // Every group's members are a separate run so they sort independently.
+  parallelFor(0, duplicate_nodes_set.size(), sortGroupsPaths,
+              &duplicate_nodes_set);
+}
+
+/**
+ * Sorts the groups of the window among themselves. The window keeps the same
+ * members so they are rewritten in place.
+ */
+void sortGroupWindow(duplicate_node_set &duplicate_nodes_set,
+                     load_options const &options, std::size_t begin,
+                     std::size_t end) {
+  std::vector<std::size_t> group_order =
+      sortGroupRange(duplicate_nodes_set, options, begin, end);
+
+  std::vector<std::size_t> group_sizes{};
+  std::vector<std::size_t> members{};
+  std::vector<bool> shared_extents{};
+  for (std::size_t group : group_order) {
+    std::size_t const *group_members = duplicate_nodes_set.groupMembers(group);
+    members.insert(members.end(), group_members,
+                   group_members + duplicate_nodes_set.groupSize(group));
+    group_sizes.push_back(duplicate_nodes_set.groupSize(group));
+    shared_extents.push_back(duplicate_nodes_set.sharesExtents(group));
+  }
+
+  std::copy(members.begin(), members.end(),
+            duplicate_nodes_set.groupMembers(begin));
+  for (std::size_t i = 0; i < group_sizes.size(); ++i) {
+    duplicate_nodes_set.group_offsets[begin + i + 1] =
+        duplicate_nodes_set.group_offsets[begin + i] + group_sizes[i];
+    if (duplicate_nodes_set.shared_extents.size() != 0) {
+      duplicate_nodes_set.shared_extents[begin + i] = shared_extents[i];
+    }
+  }
+
+  parallelFor(begin, end, sortGroupsPaths, &duplicate_nodes_set);
+}
+
+/**
+ * With a window the groups are sorted and written a window at a time, and
+ * the sink is flushed after every window, so output starts after the first
+ * window instead of after the whole set is sorted. The order is only sorted
+ * within each window. Top needs every group so it ignores the window.
+ */
+void load(output_sink &sink, duplicate_node_set &duplicate_nodes_set,
+          load_options const &options) {
+  std::size_t group_count = duplicate_nodes_set.size();
+  if (options.window != 0 && options.top == 0) {
+    format_writer writer = initFormatWriter(options.format);
+    printHeader(sink, writer, group_count);
+    for (std::size_t begin = 0; begin < group_count; begin += options.window) {
+      std::size_t end = std::min(begin + options.window, group_count);
+      sortGroupWindow(duplicate_nodes_set, options, begin, end);
+      printGroups(sink, writer, duplicate_nodes_set, options, begin, end);
+      flushSink(sink);
+    }
+    flushSink(sink);
+    return;
+  }
+
+  sortDuplicateNodeSet(duplicate_nodes_set, options);
+  if (duplicate_nodes_set.size() != group_count &&
+      options.format == OUTPUT_FORMAT_TEXT) {
+    writeSinkString(sink, "Showing the top ");
+    writeSinkNumber(sink, duplicate_nodes_set.size());
+    writeSinkString(sink, " of ");
+    writeSinkNumber(sink, group_count);
+    writeSinkString(sink, " Sets of Duplicates.\n");
+  }
+  printDuplicateNodeSet(sink, duplicate_nodes_set, options);
+  flushSink(sink);
 }
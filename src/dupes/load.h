@@ -1,6 +1,33 @@
+#pragma once
+
 #include <ostream>
 #include <string>
 
+#include "./format.h"
+#include "./sink.h"
 #include "./transform_output.h"
 
-void load(std::ostream &console, duplicate_path_seg_set &duplicate_i_nodes_set);
\ No newline at end of file
+/**
+ * Groups are ordered by their shortest path, or by the bytes deleting all but
+ * one member would free. With top only the first top groups are kept, zero
+ * keeps every group. A window sorts and writes that many groups at a time,
+ * zero sorts every group before writing any. The format decides how each
+ * group is written.
+ */
+enum group_sort { GROUP_SORT_PATH, GROUP_SORT_BYTES };
+
+struct load_options {
+  group_sort sort;
+  std::size_t top;
+  std::size_t window;
+  output_format format;
+};
+
+int64_t reclaimableBytes(duplicate_node_set const &duplicate_nodes_set,
+                         std::size_t group);
+void renderPath(inode_tree const &tree, std::size_t node,
+                std::vector<char const *> &segment_stack, std::string &path);
+void sortDuplicateNodeSet(duplicate_node_set &duplicate_nodes_set,
+                          load_options const &options);
+void load(output_sink &sink, duplicate_node_set &duplicate_nodes_set,
+          load_options const &options);
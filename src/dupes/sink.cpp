@@ -0,0 +1,61 @@
+#include "./sink.h"
+
+#include <charconv>
+#include <cstring>
+
+#include "../fs/file_system.h"
+
+output_sink initOutputSink(sink_flush_callback flush, void *context,
+                           std::size_t capacity) {
+  return {.buffer = std::vector<char>(capacity),
+          .used = 0,
+          .flush = flush,
+          .context = context};
+}
+
+void flushSink(output_sink &sink) {
+  if (sink.used == 0) {
+    return;
+  }
+
+  sink.flush(sink.buffer.data(), sink.used, sink.context);
+  sink.used = 0;
+}
+
+/**
+ * Data larger than the whole buffer skips it and goes straight to the flush
+ * callback once what was already buffered is flushed.
+ */
+void writeSinkBytes(output_sink &sink, char const *data, std::size_t length) {
+  if (length > sink.buffer.size() - sink.used) {
+    flushSink(sink);
+  }
+
+  if (length > sink.buffer.size()) {
+    sink.flush(data, length, sink.context);
+    return;
+  }
+
+  std::memcpy(sink.buffer.data() + sink.used, data, length);
+  sink.used += length;
+}
+
+void writeSinkString(output_sink &sink, std::string const &value) {
+  writeSinkBytes(sink, value.data(), value.size());
+}
+
+void writeSinkNumber(output_sink &sink, int64_t value) {
+  char digits[24];
+  std::to_chars_result result =
+      std::to_chars(digits, digits + sizeof(digits), value);
+  writeSinkBytes(sink, digits, result.ptr - digits);
+}
+
+void flushToFileDescriptor(char const *data, std::size_t length,
+                           void *context) {
+  writeFileDescriptor(*static_cast<int *>(context), data, length);
+}
+
+void flushToStream(char const *data, std::size_t length, void *context) {
+  static_cast<std::ostream *>(context)->write(data, length);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Output is written into one large buffer which is only handed to the flush
+ * callback when it fills up or when it is flushed by hand, so a report costs
+ * a write per buffer instead of a stream insertion per path.
+ */
+constexpr std::size_t OUTPUT_SINK_CAPACITY = 1 << 20;
+
+typedef void (*sink_flush_callback)(char const *, std::size_t, void *);
+
+struct output_sink {
+  std::vector<char> buffer;
+  std::size_t used;
+  sink_flush_callback flush;
+  void *context;
+};
+
+output_sink initOutputSink(sink_flush_callback flush, void *context,
+                           std::size_t capacity = OUTPUT_SINK_CAPACITY);
+void writeSinkBytes(output_sink &sink, char const *data, std::size_t length);
+void writeSinkString(output_sink &sink, std::string const &value);
+void writeSinkNumber(output_sink &sink, int64_t value);
+void flushSink(output_sink &sink);
+
+/**
+ * Flush callbacks. The context is an int * holding the file descriptor or the
+ * std::ostream * to write to.
+ */
+void flushToFileDescriptor(char const *data, std::size_t length,
+                           void *context);
+void flushToStream(char const *data, std::size_t length, void *context);
@@ -1,17 +1,20 @@
 #include "transform.h"
 
-#include <iostream>
-#include <queue>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "../thread/parallel.h"
+#include "./digest_map.h"
 
 /**
  * NOTE: Thoughts and Ideas:
  * - The hash table will only have to be as large as the amount of files
  * and directories we have. I think this may be idealistic though since the
  * hash tables key space is larger than the actual slots.
- * - I may never have to delete the in memory hash data unless we convert
- * to a string for the hash map. Only delete then! Even though it would
- * be best to delete all the hash data in one go. I could get a page
- * of memory for this.
+ * - The names all come from the arena owned by the dupes command so they are
+ * deleted in one go once the results are printed. Digests are stored inline
+ * in the tree.
  */
 
 typedef std::vector<directory_table_row_const *> *parent_directory_map;
@@ -21,46 +24,32 @@ typedef std::vector<directory_table_row_const *> const
 typedef std::vector<hash_table_row_const *> *parent_hash_map;
 typedef std::vector<hash_table_row_const *> const *const parent_hash_map_const;
 
-struct inode {
-  int depth;
-  char const *path_segment;
-  hash node_hash;
-  std::vector<inode> inodes;
-  inode const *parent_node;
-
-  bool operator==(inode const &rhs) const;
-};
-
-struct inode_hasher {
-  std::size_t operator()(hash_const k) const;
-};
-
-struct inode_key_equal {
-  bool operator()(hash_const lhs, hash_const rhs) const;
+/**
+ * Nodes grouped by digest. A group is active while it still holds duplicates
+ * which have not been reported (or filtered out) yet.
+ */
+struct duplicate_groups {
+  digest_groups groups;
+  std::vector<bool> active;
 };
 
-typedef std::unordered_map<hash, std::vector<inode const *>, inode_hasher,
-                           inode_key_equal>
-    hash_inode_map;
-
-bool inode::operator==(inode const &rhs) const {
-  return compareStrings(path_segment, rhs.path_segment) &&
-         compareHashes(node_hash, rhs.node_hash) && inodes == rhs.inodes &&
-         parent_node == rhs.parent_node;
-}
-
-std::size_t inode_hasher::operator()(hash_const k) const {
-  std::size_t hash = 0;
+std::size_t inode_tree::size() const { return parents.size(); }
 
-  for (uint i = 0; i < 8; ++i) {
-    hash |= (std::size_t)k[i] << (64 - (8 * (i + 1)));
+bool inode_tree::operator==(inode_tree const &rhs) const {
+  if (size() != rhs.size()) {
+    return false;
   }
 
-  return hash;
-}
+  for (std::size_t i = 0; i < size(); ++i) {
+    if (!compareStrings(path_segments[i], rhs.path_segments[i])) {
+      return false;
+    }
+  }
 
-bool inode_key_equal::operator()(hash_const lhs, hash_const rhs) const {
-  return compareHashes(lhs, rhs);
+  return parents == rhs.parents && first_children == rhs.first_children &&
+         child_counts == rhs.child_counts && depths == rhs.depths &&
+         node_digests == rhs.node_digests && sizes == rhs.sizes &&
+         directory_ids == rhs.directory_ids && dirty == rhs.dirty;
 }
 
 bool file_hash_rows::operator==(file_hash_rows const &rhs) const {
@@ -73,13 +62,14 @@ buildParentDirectoryMap(directory_table_row::rows const &directory_table_rows) {
       new std::vector<directory_table_row_const *>[directory_table_rows.size() +
                                                    1] {};
 
-  for (int i = 0; i < directory_table_rows.size(); ++i) {
+  for (std::size_t i = 0; i < directory_table_rows.size(); ++i) {
     directory_table_row const &table_row = directory_table_rows[i];
     if (table_row.parent_id == -1) {
       continue;
     }
 
-    if (table_row.parent_id > directory_table_rows.size()) {
+    if (static_cast<std::size_t>(table_row.parent_id) >
+        directory_table_rows.size()) {
       return map;
     }
 
@@ -90,14 +80,15 @@ buildParentDirectoryMap(directory_table_row::rows const &directory_table_rows) {
 }
 
 parent_hash_map buildParentHashMap(hash_table_row::rows const &hash_table_rows,
-                                   int num_of_directories) {
+                                   std::size_t num_of_directories) {
   parent_hash_map map =
       new std::vector<hash_table_row_const *>[num_of_directories + 1];
 
-  for (int i = 0; i < hash_table_rows.size(); ++i) {
+  for (std::size_t i = 0; i < hash_table_rows.size(); ++i) {
     hash_table_row const &table_row = hash_table_rows[i];
 
-    if (table_row.directory_id > num_of_directories) {
+    if (static_cast<std::size_t>(table_row.directory_id) >
+        num_of_directories) {
       return map;
     }
 
@@ -107,306 +98,383 @@ parent_hash_map buildParentHashMap(hash_table_row::rows const &hash_table_rows,
   return map;
 }
 
-inode buildINodeTree(parent_directory_map_const directory_map,
-                     parent_hash_map_const hash_map,
-                     directory_table_row_const *const current_directory_row,
-                     int depth = 1) {
-  inode inode_tree{depth, stringDup(current_directory_row->name), nullptr};
-  // Creates a new inode on the stack. Takes the size of the sizeof(char
-  // const*), sizeof(hash), and sizeof(vector).
-
-  ++depth;
-  for (hash_table_row_const *hash_table_row :
-       hash_map[current_directory_row->id]) {
-    inode_tree.inodes.push_back({
-        depth,
-        stringDup(hash_table_row->name),
-        hashDup(hash_table_row->hash),
-    }); // Creates an inode on the heap. It does a malloc in push_back
-  }
-
-  for (directory_table_row_const *directory_table_row :
-       directory_map[current_directory_row->id]) {
-    inode_tree.inodes.push_back(
-        buildINodeTree(directory_map, hash_map, directory_table_row, depth));
-    // Creates an inode on the heap. It does a malloc in push_back;
-  }
 
-  return inode_tree; // Copy the return value into whatever variable we are
-                     // assinging to from the caller.
+void appendINode(inode_tree &tree, std::size_t parent, int depth,
+                 char const *path_segment, digest const &node_digest,
+                 int64_t size, row_id directory_id, bool dirty) {
+  tree.parents.push_back(parent);
+  tree.first_children.push_back(0);
+  tree.child_counts.push_back(0);
+  tree.depths.push_back(depth);
+  tree.path_segments.push_back(path_segment);
+  tree.node_digests.push_back(node_digest);
+  tree.sizes.push_back(size);
+  tree.directory_ids.push_back(directory_id);
+  tree.dirty.push_back(dirty);
 }
 
-void addInodePointerToHashMap(inode &directory_tree,
-                              hash_inode_map &duplicate_inodes_map) {
-  // TODO Does this make a copy of the hash? Should I just put in a poitner to
-  // the hash on the original inode?
-  if (duplicate_inodes_map.count(directory_tree.node_hash) == 0) {
-    duplicate_inodes_map[directory_tree.node_hash] = {&directory_tree};
-    return;
-  }
-
-  duplicate_inodes_map[directory_tree.node_hash].push_back(&directory_tree);
-  return;
+void appendFileINode(inode_tree &tree, std::size_t parent, int depth,
+                     hash_table_row_const *const hash_row) {
+  appendINode(tree, parent, depth, hash_row->name, toDigest(hash_row->hash),
+              hash_row->size, -1, false);
 }
 
-void removeEmptyINodes(inode &directory_tree) {
-  if (directory_tree.inodes.size() == 0) { // At leaf node.
-    return;
-  }
-
-  for (inode &leaf_node : directory_tree.inodes) {
-    removeEmptyINodes(leaf_node);
-  }
+/**
+ * Directories without a persisted digest start from the empty digest and are
+ * marked dirty so calculateHashes folds them again.
+ */
+void appendDirectoryINode(inode_tree &tree, std::size_t parent, int depth,
+                          directory_table_row_const *const directory_row) {
+  bool dirty = directory_row->hash == nullptr;
+  appendINode(tree, parent, depth, directory_row->name,
+              dirty ? EMPTY_DIGEST : toDigest(directory_row->hash),
+              dirty ? 0 : directory_row->size, directory_row->id, dirty);
+}
 
-  for (auto iter = directory_tree.inodes.begin();
-       iter != directory_tree.inodes.end();) {
-    bool is_empty_folder =
-        (*iter).node_hash == nullptr && (*iter).inodes.size() == 0;
-    bool is_empty_file = compareHashes((*iter).node_hash, EMPTY_HASH);
+void copyINode(inode_tree &tree, std::size_t parent, inode_tree const &source,
+               std::size_t node) {
+  appendINode(tree, parent, source.depths[node], source.path_segments[node],
+              source.node_digests[node], source.sizes[node],
+              source.directory_ids[node], source.dirty[node]);
+}
 
-    if (is_empty_file || is_empty_folder) {
-      directory_tree.inodes.erase(iter);
+/**
+ * Builds the tree breadth first in a single pass over the row maps. Each
+ * directory appends its files and then its sub directories, which keeps the
+ * same child order the rows came out of the cache in.
+ */
+inode_tree buildINodeTree(parent_directory_map_const directory_map,
+                          parent_hash_map_const hash_map,
+                          directory_table_row_const *const root_directory_row) {
+  inode_tree tree{};
+  std::vector<directory_table_row_const *> node_directories{
+      root_directory_row};
+  appendDirectoryINode(tree, NO_PARENT, 1, root_directory_row);
+
+  for (std::size_t i = 0; i < tree.size(); ++i) {
+    directory_table_row_const *directory_row = node_directories[i];
+    tree.first_children[i] = tree.size();
+
+    if (directory_row == nullptr) { // Files do not have children.
       continue;
     }
-    ++iter;
-  }
-}
-
-hash calculateINodeHashesRecursive(inode &directory_tree,
-                                   hash_inode_map &duplicate_inodes_map,
-                                   inode const *parent_pointer = nullptr) {
-  directory_tree.parent_node = parent_pointer;
-
-  if (directory_tree.inodes.size() == 0 &&
-      directory_tree.node_hash == nullptr) {
-    directory_tree.node_hash = new uint8_t[MD5_DIGEST_LENGTH]{};
-  }
 
-  if (directory_tree.inodes.size() == 0) {
-    addInodePointerToHashMap(directory_tree, duplicate_inodes_map);
-    return directory_tree.node_hash;
-  }
+    int child_depth = tree.depths[i] + 1;
+    for (hash_table_row_const *hash_table_row : hash_map[directory_row->id]) {
+      appendFileINode(tree, i, child_depth, hash_table_row);
+      node_directories.push_back(nullptr);
+    }
 
-  int num_of_hashes = directory_tree.inodes.size();
-  hashes sub_node_hashes = new hash[num_of_hashes];
+    for (directory_table_row_const *directory_table_row :
+         directory_map[directory_row->id]) {
+      appendDirectoryINode(tree, i, child_depth, directory_table_row);
+      node_directories.push_back(directory_table_row);
+    }
 
-  for (int i = 0; i < directory_tree.inodes.size(); ++i) {
-    sub_node_hashes[i] = calculateINodeHashesRecursive(
-        directory_tree.inodes[i], duplicate_inodes_map, &directory_tree);
+    tree.child_counts[i] = tree.size() - tree.first_children[i];
   }
 
-  directory_tree.node_hash = computeHash(sub_node_hashes, num_of_hashes);
-  addInodePointerToHashMap(directory_tree, duplicate_inodes_map);
-  delete[] sub_node_hashes;
-
-  return directory_tree.node_hash;
-}
-
-hash_inode_map *calculateHashes(inode &directory_tree) {
-  hash_inode_map *duplicate_inodes_map = new hash_inode_map;
-  calculateINodeHashesRecursive(directory_tree, *duplicate_inodes_map);
-  return duplicate_inodes_map;
+  return tree;
 }
 
-int countShortestDepth(std::vector<inode const *> const &inode_references) {
-  if (inode_references.size() == 0) {
-    return 0;
+/**
+ * Post-order (children before their parent, siblings in order) computed
+ * without recursion. Reversing a pre-order that pushes the children left to
+ * right yields the post-order.
+ */
+std::vector<std::size_t> postOrder(inode_tree const &tree) {
+  std::vector<std::size_t> order{};
+  if (tree.size() == 0) {
+    return order;
   }
 
-  int min_size = INT32_MAX;
+  order.reserve(tree.size());
+  std::vector<std::size_t> stack{0};
+  while (stack.size() != 0) {
+    std::size_t node = stack.back();
+    stack.pop_back();
+    order.push_back(node);
 
-  for (auto inode_reference : inode_references) {
-    if (inode_reference->depth < min_size) {
-      min_size = inode_reference->depth;
+    for (std::size_t i = 0; i < tree.child_counts[node]; ++i) {
+      stack.push_back(tree.first_children[node] + i);
     }
   }
 
-  return min_size;
+  std::reverse(order.begin(), order.end());
+  return order;
 }
 
 /**
- * In order to determine if any of the inodes have a shared parent they all must
- * be at the same depth. When checking if inodes have a shared parent you only
- * have to check the depth of shallowist node.
+ * Drops empty files and directories that are empty (or only contain empty
+ * nodes) and compacts what is left into a new breadth first tree. Empty
+ * directories are never given a persisted digest, they stay dirty, so the
+ * digests stored for the kept directories always describe the compacted
+ * tree. The root is always kept.
  */
-std::vector<inode const *>
-fastForwardINodeReferences(std::vector<inode const *> const inode_references) {
-  int shortest_path = countShortestDepth(inode_references);
+void removeEmptyINodes(inode_tree &tree) {
+  if (tree.size() == 0) {
+    return;
+  }
+
+  // Children always come after their parent so a reverse scan sees every
+  // child before its parent.
+  std::vector<bool> keep(tree.size(), false);
+  for (std::size_t i = tree.size(); i-- > 0;) {
+    if (tree.child_counts[i] == 0) {
+      keep[i] = tree.directory_ids[i] == -1 &&
+                tree.node_digests[i] != EMPTY_DIGEST;
+      continue;
+    }
 
-  if (shortest_path == 0) {
-    return inode_references;
+    for (std::size_t j = 0; j < tree.child_counts[i]; ++j) {
+      if (keep[tree.first_children[i] + j]) {
+        keep[i] = true;
+        break;
+      }
+    }
   }
+  keep[0] = true;
 
-  // Skip the last element because this will always be shared across all the
-  // duplicate paths.
-  std::vector<inode const *> current_inode_references{};
-  for (auto iter = inode_references.cbegin(); iter != inode_references.end();
-       ++iter) {
+  inode_tree compacted{};
+  std::vector<std::size_t> original_nodes{0};
+  copyINode(compacted, NO_PARENT, tree, 0);
 
-    inode const *current_inode_reference = (*iter);
+  for (std::size_t i = 0; i < compacted.size(); ++i) {
+    std::size_t original = original_nodes[i];
+    compacted.first_children[i] = compacted.size();
 
-    while (current_inode_reference->depth != shortest_path) {
-      current_inode_reference = current_inode_reference->parent_node;
+    for (std::size_t j = 0; j < tree.child_counts[original]; ++j) {
+      std::size_t child = tree.first_children[original] + j;
+      if (!keep[child]) {
+        continue;
+      }
+
+      copyINode(compacted, i, tree, child);
+      original_nodes.push_back(child);
     }
 
-    current_inode_references.push_back(current_inode_reference->parent_node);
+    compacted.child_counts[i] = compacted.size() - compacted.first_children[i];
   }
-  return current_inode_references;
+
+  tree = compacted;
 }
 
+struct hash_directories_context {
+  inode_tree *tree;
+  digest_options const *options;
+};
+
 /**
- *
- * This code will essentially take a list of list of node pointers each
- * representing a group of node pointers with the same hash. If any of the node
- * pointers share a common ancestor that is also a duplicate (meaning it's in a
- * duplicate folder) then you remove that from the list. Otherwise, if one
- * ancestor does not share a ancestor with a duplicate hash then you keep those
- * in the list because even if other entries are in a duplicate folder the fact
- * that no ancestors had the same folder hash means that one is outside the
- * duplicate folder which we want to list.
+ * Directory digests are folded over the child digests in sorted order so
+ * the result does not depend on the order the rows were written to the cache.
+ * Only dirty directories are folded. A clean directory keeps the digest and
+ * size loaded from the cache, which also covers its whole sub tree since
+ * clearing a digest always clears every ancestor too.
  */
-bool hasSharedParent(std::vector<inode const *> const inode_references,
-                     hash_inode_map const *hash_to_duplicate_nodes) {
-  if (inode_references.size() == 0) {
-    return false;
-  }
-
-  std::vector<inode const *> fast_forwarded_references =
-      fastForwardINodeReferences(inode_references);
-
-  // Skip the leaf node of the shortest
-
-  while (fast_forwarded_references[0] != nullptr) {
-    bool all_have_same_hash = true;
-    hash const &first_hash = fast_forwarded_references[0]->node_hash;
-    fast_forwarded_references[0] = fast_forwarded_references[0]->parent_node;
-
-    for (auto iter = fast_forwarded_references.begin() + 1;
-         iter != fast_forwarded_references.end(); ++iter) {
-      all_have_same_hash = compareHashes((*iter)->node_hash, first_hash);
-      (*iter) = (*iter)->parent_node;
+void hashDirectories(std::size_t begin, std::size_t end, void *context) {
+  hash_directories_context *hash_context =
+      static_cast<hash_directories_context *>(context);
+  inode_tree &tree = *hash_context->tree;
+  std::vector<digest> children{};
+  std::vector<digest> scratch{};
+
+  for (std::size_t node = begin; node < end; ++node) {
+    std::size_t child_count = tree.child_counts[node];
+    if (child_count == 0 || !tree.dirty[node]) {
+      continue;
     }
 
-    // Do all the nodes have the same hash and is the node actually duplicated
-    // with another?
-    if (all_have_same_hash && hash_to_duplicate_nodes->count(first_hash) != 0) {
-      return true;
+    std::size_t first_child = tree.first_children[node];
+    int64_t size = 0;
+    for (std::size_t i = 0; i < child_count; ++i) {
+      size += tree.sizes[first_child + i];
+    }
+    tree.sizes[node] = size;
+
+    children.assign(&tree.node_digests[first_child],
+                    &tree.node_digests[first_child] + child_count);
+    if (hash_context->options->include_names) {
+      for (std::size_t i = 0; i < child_count; ++i) {
+        computeNamedDigest(children[i], tree.path_segments[first_child + i],
+                           tree.node_digests[first_child + i]);
+      }
     }
-  }
 
-  return false;
+    scratch.resize(child_count);
+    sortDigests(children.data(), child_count, scratch.data());
+    computeDigest(tree.node_digests[node], children.data(), child_count);
+  }
 }
 
-void filterNonDupesRecursive(inode const &node_to_process,
-                             hash_inode_map *hash_inode_map) {
-  // Post-order DFS.
-  if (node_to_process.inodes.size() > 0) {
-    for (auto node : node_to_process.inodes) {
-      filterNonDupesRecursive(node, hash_inode_map);
+/**
+ * The tree is breadth first so every level is a contiguous range of nodes and
+ * a node's children are all on the next level. Levels are hashed from the
+ * deepest up, each one split across threads since the nodes of a level only
+ * read the digests of the level below. The digests are then grouped in
+ * post-order on the calling thread.
+ */
+duplicate_groups calculateHashes(inode_tree &tree,
+                                 digest_options const &options) {
+  hash_directories_context context{&tree, &options};
+  std::size_t level_end = tree.size();
+  while (level_end > 0) {
+    std::size_t level_begin = level_end - 1;
+    while (level_begin > 0 &&
+           tree.depths[level_begin - 1] == tree.depths[level_end - 1]) {
+      --level_begin;
     }
+
+    parallelFor(level_begin, level_end, hashDirectories, &context);
+    level_end = level_begin;
   }
 
-  // Hash was already removed or Hash has duplicates.
-  if (hash_inode_map->count(node_to_process.node_hash) == 0 ||
-      hash_inode_map->at(node_to_process.node_hash).size() != 1) {
-    return;
+  duplicate_groups duplicates{};
+  duplicates.groups = groupDigests(tree.node_digests, postOrder(tree));
+  duplicates.active.assign(duplicates.groups.size(), true);
+  return duplicates;
+}
+
+/**
+ * Single top down pass recording, for every node, the closest proper ancestor
+ * which is duplicated somewhere else in the tree (NO_PARENT when there is
+ * none). Parents always come before their children in the tree so each node
+ * only looks at its parent.
+ */
+std::vector<std::size_t>
+findNearestDuplicateAncestors(inode_tree const &tree,
+                              duplicate_groups const &duplicates) {
+  std::vector<std::size_t> nearest_ancestors(tree.size(), NO_PARENT);
+
+  for (std::size_t node = 1; node < tree.size(); ++node) {
+    std::size_t parent = tree.parents[node];
+    std::size_t parent_group = duplicates.groups.node_groups[parent];
+    nearest_ancestors[node] = duplicates.groups.groupSize(parent_group) > 1
+                                  ? parent
+                                  : nearest_ancestors[parent];
   }
 
-  // Hash does not have duplicates so remove.
-  hash_inode_map->erase(node_to_process.node_hash);
+  return nearest_ancestors;
 }
 
-// TODO: Should this be moved to the view? I would argue that we have already
-// found the duplicates once we have a vector of all the duplicated node
-// references.
-duplicate_path_segments buildDuplicatePathSegments(
-    std::vector<inode const *> const &duplicate_inode_references) {
-  duplicate_path_segments
-      duplicate_inodes_result{}; // Create a new vector on stack.
-
-  for (auto inode_reference : duplicate_inode_references) {
-    // TODO: This could just be a staic array with the length (if we calc depth
-    // on calculateHashes)
-    std::vector<const char *>
-        path_segments{}; // Create vector on stack and copy the
-                         // string from the inode tree.
-
-    inode const *current_inode_pointer = inode_reference;
-
-    while (current_inode_pointer != nullptr) {
-      path_segments.insert(
-          path_segments.begin(),
-          stringDup(current_inode_pointer
-                        ->path_segment)); // Create copy of string and push the
-      // pointer to the vector.
-      current_inode_pointer = current_inode_pointer->parent_node;
+/**
+ * A group is nested when every member sits inside a different copy of the
+ * same duplicated directory. Reporting that directory already covers the
+ * group. Two members inside the same copy are a duplicate the directory does
+ * not explain, so those groups are kept. Runs in O(members) by stamping each
+ * ancestor with the group that last claimed it.
+ */
+bool hasSharedParent(duplicate_groups const &duplicates, std::size_t group,
+                     std::vector<std::size_t> const &nearest_ancestors,
+                     std::vector<std::size_t> &claimed_ancestors) {
+  std::size_t const *members = duplicates.groups.groupMembers(group);
+  std::size_t member_count = duplicates.groups.groupSize(group);
+
+  std::size_t first_ancestor = nearest_ancestors[members[0]];
+  if (first_ancestor == NO_PARENT) {
+    return false;
+  }
+  std::size_t ancestor_group = duplicates.groups.node_groups[first_ancestor];
+
+  for (std::size_t i = 0; i < member_count; ++i) {
+    std::size_t ancestor = nearest_ancestors[members[i]];
+    if (ancestor == NO_PARENT ||
+        duplicates.groups.node_groups[ancestor] != ancestor_group ||
+        claimed_ancestors[ancestor] == group) {
+      return false;
     }
-
-    duplicate_inodes_result.push_back(
-        path_segments); // Push copy of the path_segments vector.
-    // path_segments vector goes out of scope. Call destructor (does not delete
-    // the string only deletes it's pointer)
+    claimed_ancestors[ancestor] = group;
   }
 
-  return duplicate_inodes_result;
+  return true;
 }
 
-void filterNestedHashesRecursive(inode const &node_to_process,
-                                 hash_inode_map *hash_inode_map,
-                                 duplicate_path_seg_set &duplicate_nodes) {
-  // Post-order DFS.
-  if (node_to_process.inodes.size() > 0) {
-    for (auto node : node_to_process.inodes) {
-      filterNestedHashesRecursive(node, hash_inode_map, duplicate_nodes);
+/**
+ * Hashes that only belong to a single node are not duplicates.
+ */
+void filterNonDupes(duplicate_groups &duplicates) {
+  for (std::size_t group = 0; group < duplicates.groups.size(); ++group) {
+    if (duplicates.groups.groupSize(group) == 1) {
+      duplicates.active[group] = false;
     }
   }
+}
 
-  if (hash_inode_map->count(node_to_process.node_hash) == 0) {
-    // Already process the node previously since it was removed from the hash
-    // map.
-    return;
-  }
+/**
+ * Group ids are handed out in post-order so walking the groups in order
+ * reports them in the same order as walking the tree.
+ */
+void filterNestedHashes(inode_tree const &tree, duplicate_groups &duplicates,
+                        duplicate_node_set &duplicate_nodes) {
+  std::vector<std::size_t> nearest_ancestors =
+      findNearestDuplicateAncestors(tree, duplicates);
+  std::vector<std::size_t> claimed_ancestors(tree.size(), NO_GROUP);
+
+  for (std::size_t group = 0; group < duplicates.groups.size(); ++group) {
+    if (!duplicates.active[group]) {
+      // Nothing to do. The node was not a duplicate.
+      continue;
+    }
 
-  std::vector<inode const *> duplicate_inodes =
-      (*hash_inode_map)[node_to_process.node_hash];
+    if (!hasSharedParent(duplicates, group, nearest_ancestors,
+                         claimed_ancestors)) {
+      // These are actual duplicates.
+      std::size_t const *members = duplicates.groups.groupMembers(group);
+      duplicate_nodes.members.insert(
+          duplicate_nodes.members.end(), members,
+          members + duplicates.groups.groupSize(group));
+      duplicate_nodes.group_offsets.push_back(duplicate_nodes.members.size());
+    }
 
-  if (duplicate_inodes.size() < 2) {
-    // Nothing to do. The node was not a duplicate or it was just created.
-    return;
+    duplicates.active[group] = false;
   }
+}
 
-  if (hasSharedParent(duplicate_inodes, hash_inode_map)) {
-    hash_inode_map->erase(node_to_process.node_hash);
-    return;
-  }
+duplicate_node_set filterNonDupsAndNestedHashes(inode_tree const &tree,
+                                                duplicate_groups &map) {
+  filterNonDupes(map);
 
-  // Add the current duplicate_inodes to duplicate_nodes. These are actual
-  // duplicates.
-  hash_inode_map->erase(node_to_process.node_hash);
-  duplicate_nodes.push_back(buildDuplicatePathSegments(duplicate_inodes));
+  duplicate_node_set duplicate_nodes_set{};
+  filterNestedHashes(tree, map, duplicate_nodes_set);
+  return duplicate_nodes_set;
 }
 
-duplicate_path_seg_set
-filterNonDupsAndNestedHashes(inode const &root_node,
-                             hash_inode_map *hash_inode_map) {
+/**
+ * Digests folded by calculateHashes which are not in the cache yet. Empty
+ * directories were removed from the tree so they are never persisted. The
+ * hashes point into the tree.
+ */
+std::vector<directory_digest_input>
+collectDirtyDigests(inode_tree const &tree) {
+  std::vector<directory_digest_input> digest_inputs{};
+  for (std::size_t node = 0; node < tree.size(); ++node) {
+    if (!tree.dirty[node] || tree.child_counts[node] == 0) {
+      continue;
+    }
 
-  filterNonDupesRecursive(root_node, hash_inode_map);
+    digest_inputs.push_back({.id = tree.directory_ids[node],
+                             .hash = tree.node_digests[node].bytes,
+                             .size = tree.sizes[node]});
+  }
 
-  duplicate_path_seg_set duplicate_nodes_set{};
-  filterNestedHashesRecursive(root_node, hash_inode_map, duplicate_nodes_set);
-  return duplicate_nodes_set;
+  return digest_inputs;
 }
 
-duplicate_path_seg_set transform(file_hash_rows const &file_hashes) {
+duplicate_node_set transform(file_hash_rows const &file_hashes,
+                             digest_options const &options) {
   parent_directory_map directory_map =
       buildParentDirectoryMap(file_hashes.directory_rows);
   parent_hash_map hash_map = buildParentHashMap(
       file_hashes.hash_rows, file_hashes.directory_rows.size());
-  inode root_inode =
+  inode_tree tree =
       buildINodeTree(directory_map, hash_map, &file_hashes.directory_rows[0]);
 
-  removeEmptyINodes(root_inode);
-  hash_inode_map *hash_to_inode_map = calculateHashes(root_inode);
+  removeEmptyINodes(tree);
+  duplicate_groups duplicates = calculateHashes(tree, options);
 
-  return filterNonDupsAndNestedHashes(root_inode, hash_to_inode_map);
+  duplicate_node_set duplicate_nodes_set =
+      filterNonDupsAndNestedHashes(tree, duplicates);
+  // The results only hold node indices so they keep the tree to render the
+  // paths from.
+  duplicate_nodes_set.tree = std::move(tree);
+  return duplicate_nodes_set;
 }
@@ -1,6 +1,7 @@
+#pragma once
+
 #include <list>
 #include <ostream>
-#include <unordered_map>
 
 #include "../lib.h"
 #include "../sqlite/sqlite.h"
@@ -13,4 +14,14 @@ struct file_hash_rows {
   bool operator==(const file_hash_rows &rhs) const;
 };
 
-duplicate_path_seg_set transform(file_hash_rows const &);
+/**
+ * How directory digests are folded from their children. With include_names a
+ * child's name is hashed together with its digest, so directories only match
+ * when their entries have the same names as well as the same contents.
+ */
+struct digest_options {
+  bool include_names;
+};
+
+duplicate_node_set transform(file_hash_rows const &, digest_options const &);
+std::vector<directory_digest_input> collectDirtyDigests(inode_tree const &);
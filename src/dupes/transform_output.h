@@ -1,6 +1,67 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 
-typedef std::vector<char const *> path_segments;
-typedef std::vector<path_segments> duplicate_path_segments;
-typedef std::vector<duplicate_path_segments> duplicate_path_seg_set;
+#include "../lib.h"
+#include "../sqlite/sqlite.h"
+
+/**
+ * The directory tree is stored flat. Every node is an index into the arrays
+ * below. Nodes are laid out breadth first so a node's children are always
+ * contiguous (first_children[i] .. first_children[i] + child_counts[i]) and
+ * always come after their parent, which also means the digests of a node's
+ * children form one contiguous array. Names point into the table rows which
+ * outlive the tree.
+ *
+ * Directories keep the row they were loaded from. A directory is dirty when
+ * the cache holds no digest for it, in which case its digest and size are
+ * recomputed from its children. Files are never dirty and have no row.
+ */
+constexpr std::size_t NO_PARENT = SIZE_MAX;
+
+struct inode_tree {
+  std::vector<std::size_t> parents;
+  std::vector<std::size_t> first_children;
+  std::vector<std::size_t> child_counts;
+  std::vector<int> depths;
+  std::vector<char const *> path_segments;
+  std::vector<digest> node_digests;
+  std::vector<int64_t> sizes;
+  std::vector<row_id> directory_ids;
+  std::vector<bool> dirty;
+
+  std::size_t size() const;
+  bool operator==(inode_tree const &rhs) const;
+};
+
+/**
+ * Result of the transform. Each group is a run of node indices into the tree,
+ * members[group_offsets[g]] .. members[group_offsets[g + 1]]. Paths are only
+ * rendered from the tree when they are printed. Shared extents has a flag per
+ * group once markSharedExtents ran on a cache with fingerprints, and is empty
+ * otherwise.
+ */
+struct duplicate_node_set {
+  inode_tree tree;
+  std::vector<std::size_t> group_offsets{0};
+  std::vector<std::size_t> members;
+  std::vector<bool> shared_extents;
+
+  std::size_t size() const { return group_offsets.size() - 1; }
+
+  std::size_t groupSize(std::size_t group) const {
+    return group_offsets[group + 1] - group_offsets[group];
+  }
+
+  std::size_t *groupMembers(std::size_t group) {
+    return members.data() + group_offsets[group];
+  }
+
+  std::size_t const *groupMembers(std::size_t group) const {
+    return members.data() + group_offsets[group];
+  }
+
+  bool sharesExtents(std::size_t group) const {
+    return shared_extents.size() != 0 && shared_extents[group];
+  }
+};
@@ -0,0 +1,449 @@
+#include "./verify.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../fs/file_system.h"
+#include "../thread/parallel.h"
+#include "./load.h"
+
+/**
+ * NOTE: Every group is handled by a single thread and the groups are spread
+ * across threads, so a thread only ever streams one group at a time. Memory
+ * stays at one chunk per member of the group being read, and the chunks of a
+ * large group are shrunk to fit in VERIFY_MAX_BUFFER. Each thread keeps the
+ * files it reads open in a pool of its own.
+ */
+
+/**
+ * A group member as the files it is made of, in the order they are read.
+ * Each file also has a key made from its path and stamp.
+ */
+struct verify_member {
+  std::vector<std::string> file_paths;
+  std::vector<digest> file_keys;
+  std::vector<verified_stamp> file_stamps;
+  bool stamped;
+};
+
+/**
+ * Members (indices into the group) still being compared. They are read from
+ * file_index at offset onwards.
+ */
+struct lockstep_task {
+  std::vector<std::size_t> members;
+  std::size_t file_index;
+  int64_t offset;
+};
+
+/**
+ * How one group came out of verification. Every class is a run of indices
+ * into the group whose contents are identical.
+ */
+struct group_verification {
+  std::vector<std::vector<std::size_t>> classes;
+  std::vector<digest> verified_keys;
+  std::vector<verified_stamp> file_stamps;
+  bool cached;
+  int64_t bytes_read;
+  std::string read_error;
+};
+
+struct verify_context {
+  duplicate_node_set const *duplicate_nodes_set;
+  std::string const *root_dir;
+  digest_map const *verified_keys;
+  std::vector<group_verification> *verifications;
+};
+
+bool verify_stats::operator==(verify_stats const &rhs) const {
+  return rhs.groups_read == groups_read &&
+         rhs.groups_cached == groups_cached &&
+         rhs.groups_split == groups_split && rhs.bytes_read == bytes_read;
+}
+
+/**
+ * The files under a node ordered by digest. Equal directory digests mean the
+ * sorted file digests are equal too, so the n-th files of two members are
+ * the ones claimed to be the same. Ties keep tree order.
+ */
+std::vector<std::size_t> collectFileNodes(inode_tree const &tree,
+                                          std::size_t node) {
+  std::vector<std::size_t> file_nodes{};
+  std::vector<std::size_t> stack{node};
+  while (stack.size() != 0) {
+    std::size_t current = stack.back();
+    stack.pop_back();
+
+    if (tree.directory_ids[current] == -1) {
+      file_nodes.push_back(current);
+      continue;
+    }
+
+    for (std::size_t i = tree.child_counts[current]; i-- > 0;) {
+      stack.push_back(tree.first_children[current] + i);
+    }
+  }
+
+  std::stable_sort(file_nodes.begin(), file_nodes.end(),
+                   [&tree](std::size_t node_one, std::size_t node_two) {
+                     return tree.node_digests[node_one] <
+                            tree.node_digests[node_two];
+                   });
+  return file_nodes;
+}
+
+/**
+ * The stamps are sorted by node. False when the file could not be stat'ed
+ * when its group was verified.
+ */
+bool findVerifiedStamp(std::vector<verified_stamp> const &file_stamps,
+                       std::size_t node, file_stamp &stamp) {
+  std::vector<verified_stamp>::const_iterator found = std::lower_bound(
+      file_stamps.begin(), file_stamps.end(), node,
+      [](verified_stamp const &file_stamp, std::size_t file_node) {
+        return file_stamp.node < file_node;
+      });
+  if (found == file_stamps.end() || found->node != node) {
+    return false;
+  }
+  stamp = found->stamp;
+  return true;
+}
+
+digest stampDigest(file_stamp const &stamp) {
+  digest stamp_digest{};
+  std::memcpy(stamp_digest.bytes, &stamp.size, sizeof(stamp.size));
+  std::memcpy(stamp_digest.bytes + sizeof(stamp.size), &stamp.modified_ns,
+              sizeof(stamp.modified_ns));
+  return stamp_digest;
+}
+
+verify_member buildVerifyMember(inode_tree const &tree, std::size_t node,
+                                std::string const &root_dir,
+                                std::vector<char const *> &segment_stack,
+                                std::string &path) {
+  verify_member member{
+      .file_paths = {}, .file_keys = {}, .file_stamps = {}, .stamped = true};
+  for (std::size_t file_node : collectFileNodes(tree, node)) {
+    renderPath(tree, file_node, segment_stack, path);
+    member.file_paths.push_back(joinPath({root_dir, path}));
+
+    file_stamp stamp{};
+    if (!stampFile(member.file_paths.back(), stamp)) {
+      member.stamped = false;
+      continue;
+    }
+
+    digest file_key{};
+    computeNamedDigest(file_key, member.file_paths.back().c_str(),
+                       stampDigest(stamp));
+    member.file_keys.push_back(file_key);
+    member.file_stamps.push_back({.node = file_node, .stamp = stamp});
+  }
+
+  return member;
+}
+
+/**
+ * False when a file of one of the members could not be stat'ed, those
+ * members can not be cached as verified.
+ */
+bool buildGroupKey(std::vector<verify_member> const &members,
+                   std::vector<std::size_t> const &indices,
+                   digest const &content_digest, digest &key) {
+  std::vector<digest> keys{content_digest};
+  for (std::size_t index : indices) {
+    if (!members[index].stamped) {
+      return false;
+    }
+    keys.insert(keys.end(), members[index].file_keys.begin(),
+                members[index].file_keys.end());
+  }
+
+  std::sort(keys.begin(), keys.end());
+  computeDigest(key, keys.data(), keys.size());
+  return true;
+}
+
+/**
+ * The key the whole group would be stored under if it was verified now, false
+ * when one of its files can not be stat'ed.
+ */
+bool buildVerifiedKey(duplicate_node_set const &duplicate_nodes_set,
+                      std::size_t group, std::string const &root_dir,
+                      digest &key) {
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::size_t const *group_members = duplicate_nodes_set.groupMembers(group);
+  std::vector<char const *> segment_stack{};
+  std::string path{};
+
+  std::vector<verify_member> members{};
+  std::vector<std::size_t> indices{};
+  for (std::size_t i = 0; i < duplicate_nodes_set.groupSize(group); ++i) {
+    members.push_back(buildVerifyMember(tree, group_members[i], root_dir,
+                                        segment_stack, path));
+    indices.push_back(i);
+  }
+
+  return buildGroupKey(members, indices, tree.node_digests[group_members[0]],
+                       key);
+}
+
+/**
+ * Splits the members into the runs with the same number of files. Runs with
+ * a single member can not be duplicates and are dropped.
+ */
+void pushFileCountTasks(std::vector<verify_member> const &members,
+                        std::vector<lockstep_task> &tasks) {
+  std::vector<bool> assigned(members.size(), false);
+  for (std::size_t i = 0; i < members.size(); ++i) {
+    if (assigned[i]) {
+      continue;
+    }
+
+    lockstep_task task{.members = {i}, .file_index = 0, .offset = 0};
+    for (std::size_t j = i + 1; j < members.size(); ++j) {
+      if (!assigned[j] &&
+          members[j].file_paths.size() == members[i].file_paths.size()) {
+        assigned[j] = true;
+        task.members.push_back(j);
+      }
+    }
+
+    if (task.members.size() > 1) {
+      tasks.push_back(task);
+    }
+  }
+}
+
+/**
+ * Reads the next chunk of the current file of every member of the task and
+ * partitions the members by what was read. Parts are in task order and so
+ * are the members in each part, as indices into the task.
+ */
+std::vector<std::vector<std::size_t>>
+readAndPartition(std::vector<verify_member> const &members,
+                 lockstep_task const &task, int64_t offset, std::size_t length,
+                 open_file_pool &pool, std::vector<std::size_t> &counts,
+                 std::vector<char> &buffer, int64_t &bytes_read) {
+  std::vector<std::vector<std::size_t>> parts{};
+  for (std::size_t k = 0; k < task.members.size(); ++k) {
+    char *chunk = buffer.data() + k * length;
+    counts[k] = readPooledFileChunk(
+        pool, members[task.members[k]].file_paths[task.file_index], offset,
+        chunk, length);
+    bytes_read += counts[k];
+
+    bool placed = false;
+    for (std::vector<std::size_t> &part : parts) {
+      std::size_t representative = part[0];
+      if (counts[representative] == counts[k] &&
+          std::memcmp(buffer.data() + representative * length, chunk,
+                      counts[k]) == 0) {
+        part.push_back(k);
+        placed = true;
+        break;
+      }
+    }
+
+    if (!placed) {
+      parts.push_back({k});
+    }
+  }
+
+  return parts;
+}
+
+/**
+ * Compares the members chunk by chunk, splitting them as soon as their
+ * chunks differ and dropping members which are left on their own. Splits are
+ * rare so the parts are pushed back as new tasks which carry on from the
+ * offset the split happened. A file which can not be read stops the
+ * comparison, read_error says which and no classes come out.
+ */
+std::vector<std::vector<std::size_t>>
+compareInLockstep(std::vector<verify_member> const &members,
+                  open_file_pool &pool, std::vector<char> &buffer,
+                  int64_t &bytes_read, std::string &read_error) {
+  std::vector<std::vector<std::size_t>> classes{};
+  std::vector<lockstep_task> tasks{};
+  pushFileCountTasks(members, tasks);
+
+  while (tasks.size() != 0) {
+    lockstep_task task = tasks.back();
+    tasks.pop_back();
+
+    if (task.file_index == members[task.members[0]].file_paths.size()) {
+      classes.push_back(task.members);
+      continue;
+    }
+
+    std::size_t length = std::min<std::size_t>(
+        VERIFY_CHUNK_SIZE,
+        std::max<std::size_t>(VERIFY_MAX_BUFFER / task.members.size(), 1));
+    std::vector<std::size_t> counts(task.members.size(), 0);
+    buffer.resize(task.members.size() * length);
+    int64_t offset = task.offset;
+    while (true) {
+      std::vector<std::vector<std::size_t>> parts{};
+      try {
+        parts = readAndPartition(members, task, offset, length, pool, counts,
+                                 buffer, bytes_read);
+      } catch (file_open_error &error) {
+        read_error = error.what();
+        return {};
+      }
+
+      bool file_done = counts[parts[0][0]] < length || parts.size() > 1;
+      if (!file_done) {
+        offset += length;
+        continue;
+      }
+
+      for (std::vector<std::size_t> const &part : parts) {
+        std::size_t count = counts[part[0]];
+        bool file_read = count < length;
+        lockstep_task next_task{
+            .members = {},
+            .file_index = file_read ? task.file_index + 1 : task.file_index,
+            .offset = file_read ? 0 : offset + static_cast<int64_t>(count)};
+        for (std::size_t k : part) {
+          std::size_t member = task.members[k];
+          next_task.members.push_back(member);
+          if (file_read || part.size() < 2) {
+            closePooledFile(pool, members[member].file_paths[task.file_index]);
+          }
+        }
+
+        if (part.size() > 1) {
+          tasks.push_back(next_task);
+        }
+      }
+      break;
+    }
+  }
+
+  std::sort(classes.begin(), classes.end());
+  return classes;
+}
+
+void verifyGroups(std::size_t begin, std::size_t end, void *context) {
+  verify_context *verify = static_cast<verify_context *>(context);
+  duplicate_node_set const &duplicate_nodes_set = *verify->duplicate_nodes_set;
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::vector<char const *> segment_stack{};
+  std::string path{};
+  std::vector<char> buffer{};
+  open_file_pool pool = initOpenFilePool(OPEN_FILE_POOL_SIZE);
+
+  for (std::size_t group = begin; group < end; ++group) {
+    group_verification &verification = (*verify->verifications)[group];
+    std::size_t const *group_members = duplicate_nodes_set.groupMembers(group);
+    std::size_t group_size = duplicate_nodes_set.groupSize(group);
+    digest const &content_digest = tree.node_digests[group_members[0]];
+
+    std::vector<verify_member> members{};
+    std::vector<std::size_t> indices{};
+    for (std::size_t i = 0; i < group_size; ++i) {
+      members.push_back(buildVerifyMember(tree, group_members[i],
+                                          *verify->root_dir, segment_stack,
+                                          path));
+      indices.push_back(i);
+    }
+
+    digest key{};
+    if (buildGroupKey(members, indices, content_digest, key) &&
+        findDigest(*verify->verified_keys, key) != NO_GROUP) {
+      verification.classes = {indices};
+      verification.cached = true;
+    } else {
+      verification.classes =
+          compareInLockstep(members, pool, buffer, verification.bytes_read,
+                            verification.read_error);
+      for (std::vector<std::size_t> const &verified_class :
+           verification.classes) {
+        if (buildGroupKey(members, verified_class, content_digest, key)) {
+          verification.verified_keys.push_back(key);
+        }
+      }
+    }
+
+    for (std::vector<std::size_t> const &verified_class :
+         verification.classes) {
+      for (std::size_t index : verified_class) {
+        verification.file_stamps.insert(verification.file_stamps.end(),
+                                        members[index].file_stamps.begin(),
+                                        members[index].file_stamps.end());
+      }
+    }
+  }
+  closeOpenFilePool(pool);
+}
+
+/**
+ * Groups are verified in parallel and then rebuilt in their original order.
+ * A group which split is replaced by its parts, members which did not match
+ * any other member are dropped. A file which could not be read throws rather
+ * than leaving its member out of a group it may belong to.
+ */
+verify_result verifyDuplicateNodeSet(duplicate_node_set &duplicate_nodes_set,
+                                     std::string const &root_dir,
+                                     digest_map const &verified_keys) {
+  std::vector<group_verification> verifications(duplicate_nodes_set.size(),
+                                                group_verification{});
+  verify_context context{&duplicate_nodes_set, &root_dir, &verified_keys,
+                         &verifications};
+  parallelFor(0, duplicate_nodes_set.size(), verifyGroups, &context, 1);
+  for (group_verification const &verification : verifications) {
+    if (!verification.read_error.empty()) {
+      throw verify_error(verification.read_error +
+                         ", update the cache before verifying again.");
+    }
+  }
+
+  verify_result result{
+      .stats = {0, 0, 0, 0}, .verified_keys = {}, .file_stamps = {}};
+  std::vector<std::size_t> group_offsets{0};
+  std::vector<std::size_t> members{};
+  for (std::size_t group = 0; group < duplicate_nodes_set.size(); ++group) {
+    group_verification const &verification = verifications[group];
+    std::size_t const *group_members = duplicate_nodes_set.groupMembers(group);
+
+    for (std::vector<std::size_t> const &verified_class :
+         verification.classes) {
+      for (std::size_t index : verified_class) {
+        members.push_back(group_members[index]);
+      }
+      group_offsets.push_back(members.size());
+    }
+
+    if (verification.cached) {
+      ++result.stats.groups_cached;
+    } else {
+      ++result.stats.groups_read;
+    }
+    if (verification.classes.size() != 1 ||
+        verification.classes[0].size() !=
+            duplicate_nodes_set.groupSize(group)) {
+      ++result.stats.groups_split;
+    }
+    result.stats.bytes_read += verification.bytes_read;
+    result.verified_keys.insert(result.verified_keys.end(),
+                                verification.verified_keys.begin(),
+                                verification.verified_keys.end());
+    result.file_stamps.insert(result.file_stamps.end(),
+                              verification.file_stamps.begin(),
+                              verification.file_stamps.end());
+  }
+
+  std::sort(result.file_stamps.begin(), result.file_stamps.end(),
+            [](verified_stamp const &stamp_one,
+               verified_stamp const &stamp_two) {
+              return stamp_one.node < stamp_two.node;
+            });
+
+  duplicate_nodes_set.group_offsets = std::move(group_offsets);
+  duplicate_nodes_set.members = std::move(members);
+  return result;
+}
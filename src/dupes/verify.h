@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../fs/file_system.h"
+#include "../lib.h"
+#include "./digest_map.h"
+#include "./transform_output.h"
+
+/**
+ * Byte for byte check of the groups found by their digests. The members of a
+ * group are read in lockstep, one chunk of every member at a time, and the
+ * group is split as soon as the chunks differ. A directory is read as the
+ * files under it ordered by digest, which pairs up the files the digest
+ * claims are the same. Files stay open between chunks in a bounded pool and
+ * a group with many members reads smaller chunks to stay within
+ * VERIFY_MAX_BUFFER. A file which can not be read fails the verification.
+ */
+constexpr std::size_t VERIFY_CHUNK_SIZE = 1 << 16;
+constexpr std::size_t VERIFY_MAX_BUFFER = 1 << 26;
+
+struct verify_stats {
+  std::size_t groups_read;
+  std::size_t groups_cached;
+  std::size_t groups_split;
+  int64_t bytes_read;
+
+  bool operator==(verify_stats const &rhs) const;
+};
+
+/**
+ * The stamp a file of a verified group had when the group was verified, taken
+ * before the file was read.
+ */
+struct verified_stamp {
+  std::size_t node;
+  file_stamp stamp;
+};
+
+/**
+ * Keys of the groups which were read and found to be identical. A key covers
+ * the group's digest and the path, size and modification time of every file
+ * in it, so a group only stays verified while none of its files change. The
+ * stamps of the files in the groups which came out are ordered by node, so
+ * whatever replaces those files can check they are still what was verified.
+ */
+struct verify_result {
+  verify_stats stats;
+  std::vector<digest> verified_keys;
+  std::vector<verified_stamp> file_stamps;
+};
+
+std::vector<std::size_t> collectFileNodes(inode_tree const &tree,
+                                          std::size_t node);
+bool findVerifiedStamp(std::vector<verified_stamp> const &file_stamps,
+                       std::size_t node, file_stamp &stamp);
+bool buildVerifiedKey(duplicate_node_set const &duplicate_nodes_set,
+                      std::size_t group, std::string const &root_dir,
+                      digest &key);
+verify_result verifyDuplicateNodeSet(duplicate_node_set &duplicate_nodes_set,
+                                     std::string const &root_dir,
+                                     digest_map const &verified_keys);
+
+class verify_error : public std::runtime_error {
+public:
+  verify_error(const std::string &message) : std::runtime_error(message) {}
+};
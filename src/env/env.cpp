@@ -1,5 +1,78 @@
 #include "./env.h"
 
+#include <cerrno>
+#include <cstring>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
 const char *CACHE_DIR = "/.cache/ddupes";
+const char *SHELL_PATH = "/bin/sh";
+
+// Room left for the shell's own arguments, the same headroom POSIX asks of
+// xargs.
+constexpr std::size_t ARGUMENT_HEADROOM = 2048;
 
 char *fetchHomeDirectory() { return getenv("HOME"); }
+
+/**
+ * The bytes a spawned command can take in arguments. The environment is
+ * passed along with them so its strings and pointers count against ARG_MAX
+ * too.
+ */
+std::size_t argumentBytesLimit() {
+  long argument_max = sysconf(_SC_ARG_MAX);
+  std::size_t environment_bytes = ARGUMENT_HEADROOM;
+  for (char **variable = environ; *variable != nullptr; ++variable) {
+    environment_bytes += std::strlen(*variable) + 1 + sizeof(char *);
+  }
+
+  if (argument_max <= 0 ||
+      static_cast<std::size_t>(argument_max) <= environment_bytes) {
+    return 0;
+  }
+  return static_cast<std::size_t>(argument_max) - environment_bytes;
+}
+
+/**
+ * The child shares stdin, stdout and stderr. -1 when the shell could not be
+ * started.
+ */
+pid_t spawnShell(std::string const &script,
+                 std::vector<std::string> const &arguments) {
+  std::vector<char *> shell_arguments{};
+  shell_arguments.push_back(const_cast<char *>(SHELL_PATH));
+  shell_arguments.push_back(const_cast<char *>("-c"));
+  shell_arguments.push_back(const_cast<char *>(script.c_str()));
+  shell_arguments.push_back(const_cast<char *>("ddupes"));
+  for (std::string const &argument : arguments) {
+    shell_arguments.push_back(const_cast<char *>(argument.c_str()));
+  }
+  shell_arguments.push_back(nullptr);
+
+  pid_t pid = -1;
+  if (posix_spawn(&pid, SHELL_PATH, nullptr, nullptr, shell_arguments.data(),
+                  environ) != 0) {
+    return -1;
+  }
+  return pid;
+}
+
+/**
+ * Waits for the child spawnShell started to finish, leaving any other child
+ * of the process alone. Succeeded is only set when it exited with zero. -1
+ * when it could not be waited for.
+ */
+pid_t waitForChild(pid_t pid, bool &succeeded) {
+  int status = 0;
+  pid_t waited_pid = -1;
+  do {
+    waited_pid = waitpid(pid, &status, 0);
+  } while (waited_pid == -1 && errno == EINTR);
+
+  succeeded =
+      waited_pid != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  return waited_pid;
+}
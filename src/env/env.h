@@ -1,5 +1,18 @@
 #include "stdlib.h"
+#include <string>
+#include <sys/types.h>
+#include <vector>
 
 extern const char *CACHE_DIR;
 
-char *fetchHomeDirectory();
\ No newline at end of file
+/**
+ * The shell commands are run with, the script is passed to it with -c and the
+ * arguments become "$@".
+ */
+extern const char *SHELL_PATH;
+
+char *fetchHomeDirectory();
+std::size_t argumentBytesLimit();
+pid_t spawnShell(std::string const &script,
+                 std::vector<std::string> const &arguments);
+pid_t waitForChild(pid_t pid, bool &succeeded);
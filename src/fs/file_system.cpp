@@ -2,11 +2,21 @@
 
 #include "./file_system.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
 #include <openssl/evp.h>
 #include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
-#include <fstream>
 
 #include "../lib.h"
 
@@ -25,7 +35,7 @@ std::string joinPath(std::vector<std::string> const &path_segments) {
   }
 
   std::string joined_path{};
-  int i = 0;
+  std::size_t i = 0;
   if (path_segments[0].size() == 1 &&
       path_segments[0][0] == std::filesystem::path::preferred_separator) {
     joined_path += std::filesystem::path::preferred_separator;
@@ -40,14 +50,6 @@ std::string joinPath(std::vector<std::string> const &path_segments) {
   return joined_path;
 }
 
-std::ifstream openFile(std::string filePath) {
-  std::ifstream file(filePath, std::ios::binary);
-  if (!file) {
-    throw file_open_error("Could not open the file: " + filePath);
-  }
-  return file;
-}
-
 void visitFiles(const std::string &directory_path,
                 file_visitor_callback callback, void *context) {
   for (const auto &entry : std::filesystem::recursive_directory_iterator(
@@ -62,46 +64,490 @@ void visitFiles(const std::string &directory_path,
   }
 }
 
-void extractHash(hash hash, std::string path) {
-  std::ifstream file = openFile(path);
-  EVP_MD_CTX *md_context;
-  unsigned char *md5_digest;
-  unsigned int md5_digest_length = MD5_DIGEST_LENGTH;
-  const int BUFFER_SIZE =
-      4194304; // This should give us an stack overflow error.
-  char buffer[BUFFER_SIZE];
-  int blocks_read = 0;
+/**
+ * A run of a file's bytes as FIEMAP reports it. Runs come back in file order
+ * and the gaps between them are holes.
+ */
+struct file_extent {
+  int64_t logical;
+  int64_t physical;
+  int64_t length;
+  uint32_t flags;
+};
 
-  md_context = EVP_MD_CTX_new();
-  EVP_DigestInit_ex(md_context, EVP_md5(), nullptr);
+constexpr std::size_t HASH_READ_SIZE = 1 << 22;
+constexpr std::size_t ZERO_RUN_SIZE = 1 << 16;
+constexpr uint32_t FIEMAP_BATCH_EXTENTS = 256;
+// Extents whose physical address says nothing about where the bytes are.
+constexpr uint32_t FIEMAP_UNPLACED_FLAGS =
+    FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_ENCODED |
+    FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL |
+    FIEMAP_EXTENT_NOT_ALIGNED;
+
+/**
+ * False when the file system can not map the file, FIEMAP is not supported
+ * everywhere (tmpfs, NFS). Each call maps up to FIEMAP_BATCH_EXTENTS. With
+ * sync the file is written out first, bytes still in the page cache could sit
+ * over a hole or an unwritten extent in the map otherwise.
+ */
+bool mapExtents(int file_descriptor, bool sync,
+                std::vector<file_extent> &extents) {
+  std::vector<uint8_t> request(sizeof(fiemap) +
+                               FIEMAP_BATCH_EXTENTS * sizeof(fiemap_extent));
+  fiemap *map = reinterpret_cast<fiemap *>(request.data());
+  uint64_t start = 0;
+  while (true) {
+    std::fill(request.begin(), request.end(), 0);
+    map->fm_start = start;
+    map->fm_length = FIEMAP_MAX_OFFSET - start;
+    map->fm_flags = sync ? FIEMAP_FLAG_SYNC : 0;
+    map->fm_extent_count = FIEMAP_BATCH_EXTENTS;
+    if (ioctl(file_descriptor, FS_IOC_FIEMAP, map) != 0) {
+      return false;
+    }
+
+    if (map->fm_mapped_extents == 0) {
+      return true;
+    }
 
-  while (file.read(buffer, BUFFER_SIZE) || file.gcount()) {
-    ++blocks_read;
-    EVP_DigestUpdate(md_context, buffer, file.gcount());
+    for (uint32_t i = 0; i < map->fm_mapped_extents; ++i) {
+      fiemap_extent const &extent = map->fm_extents[i];
+      extents.push_back({.logical = static_cast<int64_t>(extent.fe_logical),
+                         .physical = static_cast<int64_t>(extent.fe_physical),
+                         .length = static_cast<int64_t>(extent.fe_length),
+                         .flags = extent.fe_flags});
+      if (extent.fe_flags & FIEMAP_EXTENT_LAST) {
+        return true;
+      }
+    }
+
+    fiemap_extent const &last = map->fm_extents[map->fm_mapped_extents - 1];
+    start = last.fe_logical + last.fe_length;
+  }
+}
+
+void hashZeros(EVP_MD_CTX *md_context, int64_t length) {
+  static char const zeros[ZERO_RUN_SIZE] = {};
+  while (length > 0) {
+    std::size_t run =
+        static_cast<std::size_t>(std::min<int64_t>(length, ZERO_RUN_SIZE));
+    EVP_DigestUpdate(md_context, zeros, run);
+    length -= run;
   }
+}
 
-  if (!blocks_read) {
-    for (int i = 0; i < md5_digest_length; ++i) {
-      hash[i] = 0;
+/**
+ * Hashes up to length bytes from offset and gives back how many there were,
+ * fewer when the file was cut short since it was stat'ed.
+ */
+int64_t hashBytes(EVP_MD_CTX *md_context, int file_descriptor, int64_t offset,
+                  int64_t length, std::vector<char> &buffer) {
+  int64_t hashed = 0;
+  while (hashed < length) {
+    std::size_t want = static_cast<std::size_t>(
+        std::min<int64_t>(length - hashed, buffer.size()));
+    ssize_t count =
+        pread(file_descriptor, buffer.data(), want, offset + hashed);
+    if (count < 0) {
+      return -1;
     }
-    return;
+    if (count == 0) {
+      break;
+    }
+    EVP_DigestUpdate(md_context, buffer.data(), count);
+    hashed += count;
+  }
+  return hashed;
+}
+
+/**
+ * Hashes the size bytes of a mapped file, the bytes which are not in any
+ * extent as zeros. Gives back how many bytes were hashed, -1 when a read
+ * failed.
+ */
+int64_t hashMappedFile(EVP_MD_CTX *md_context, int file_descriptor,
+                       std::vector<file_extent> const &extents, int64_t size,
+                       std::vector<char> &buffer) {
+  int64_t position = 0;
+  for (file_extent const &extent : extents) {
+    // Extents can reach past the end, preallocated or rounded to blocks.
+    int64_t extent_start = std::min(std::max(extent.logical, position), size);
+    int64_t extent_end = std::min(extent.logical + extent.length, size);
+    if (extent_end <= extent_start) {
+      continue;
+    }
+
+    hashZeros(md_context, extent_start - position);
+    position = extent_start;
+    if (extent.flags & FIEMAP_EXTENT_UNWRITTEN) {
+      hashZeros(md_context, extent_end - position);
+      position = extent_end;
+      continue;
+    }
+
+    int64_t hashed = hashBytes(md_context, file_descriptor, position,
+                               extent_end - position, buffer);
+    if (hashed < 0) {
+      return -1;
+    }
+    position += hashed;
+    if (position < extent_end) {
+      return position;
+    }
+  }
+
+  hashZeros(md_context, size - position);
+  return size;
+}
+
+/**
+ * A file with blocks on disk holds data somewhere in its size. A map without
+ * a written extent there, which some file systems give back for files they
+ * keep elsewhere, would have those bytes hashed as zeros.
+ */
+bool mapHoldsData(std::vector<file_extent> const &extents, int64_t size,
+                  int64_t blocks) {
+  if (blocks == 0) {
+    return true;
+  }
+
+  for (file_extent const &extent : extents) {
+    if (!(extent.flags & FIEMAP_EXTENT_UNWRITTEN) && extent.length > 0 &&
+        extent.logical < size) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Holes and unwritten extents read as zeros, so they are hashed as runs of
+ * zeros without being read. Files the file system can not map, or whose map
+ * misses their data, are read to the end. Empty files get a digest of all
+ * zeros.
+ */
+void extractHash(hash hash, std::string path) {
+  int file_descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat file_stat;
+  if (file_descriptor < 0 || fstat(file_descriptor, &file_stat) != 0) {
+    if (file_descriptor >= 0) {
+      close(file_descriptor);
+    }
+    throw file_open_error("Could not open the file: " + path);
   }
 
-  md5_digest = (unsigned char *)OPENSSL_malloc(md5_digest_length);
-  EVP_DigestFinal_ex(md_context, md5_digest, &md5_digest_length);
+  std::vector<char> buffer(static_cast<std::size_t>(std::clamp<int64_t>(
+      file_stat.st_size, ZERO_RUN_SIZE, HASH_READ_SIZE)));
+  EVP_MD_CTX *md_context = EVP_MD_CTX_new();
+  EVP_DigestInit_ex(md_context, EVP_md5(), nullptr);
+
+  std::vector<file_extent> extents{};
+  bool mapped = mapExtents(file_descriptor, true, extents) &&
+                mapHoldsData(extents, file_stat.st_size, file_stat.st_blocks);
+  int64_t hashed = mapped ? hashMappedFile(md_context, file_descriptor,
+                                          extents, file_stat.st_size, buffer)
+                          : hashBytes(md_context, file_descriptor, 0,
+                                      INT64_MAX, buffer);
+  close(file_descriptor);
+
+  if (hashed < 0) {
+    EVP_MD_CTX_free(md_context);
+    throw file_open_error("Could not read the file: " + path);
+  }
+
+  if (hashed == 0) {
+    std::fill(hash, hash + MD5_DIGEST_LENGTH, 0);
+  } else {
+    unsigned int md5_digest_length = MD5_DIGEST_LENGTH;
+    EVP_DigestFinal_ex(md_context, hash, &md5_digest_length);
+  }
   EVP_MD_CTX_free(md_context);
+}
+
+/**
+ * A fingerprint of where a file's bytes are on disk, the md5 of every
+ * extent's logical offset, physical address and length. Files which share all
+ * their extents, reflinks of each other or hardlinks, have the same
+ * fingerprint and deleting one of them frees nothing. False when the file
+ * system can not map the file, the file has no extents or part of it has no
+ * fixed place on disk yet. The file is not synced, writes still in the page
+ * cache leave it without a fingerprint rather than forcing them out.
+ */
+bool fingerprintExtents(std::string const &path, uint8_t *fingerprint) {
+  int file_descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file_descriptor < 0) {
+    return false;
+  }
+
+  std::vector<file_extent> extents{};
+  bool mapped = mapExtents(file_descriptor, false, extents);
+  close(file_descriptor);
+  if (!mapped || extents.size() == 0) {
+    return false;
+  }
 
-  for (int i = 0; i < md5_digest_length; ++i) {
-    hash[i] = md5_digest[i];
+  EVP_MD_CTX *md_context = EVP_MD_CTX_new();
+  EVP_DigestInit_ex(md_context, EVP_md5(), nullptr);
+  for (file_extent const &extent : extents) {
+    if (extent.flags & FIEMAP_UNPLACED_FLAGS) {
+      EVP_MD_CTX_free(md_context);
+      return false;
+    }
+
+    int64_t fields[] = {extent.logical, extent.physical, extent.length};
+    EVP_DigestUpdate(md_context, fields, sizeof(fields));
   }
 
-  OPENSSL_free(md5_digest);
+  unsigned int md5_digest_length = MD5_DIGEST_LENGTH;
+  EVP_DigestFinal_ex(md_context, fingerprint, &md5_digest_length);
+  EVP_MD_CTX_free(md_context);
+  return true;
 }
 
 bool fileExists(std::string const &file_path) {
   return std::filesystem::exists(file_path);
 }
 
+/**
+ * Names are appended in the order the directory returns them, without "."
+ * and "..". The whole directory is read in a few getdents calls instead of a
+ * stat per name.
+ */
+directory_listing listDirectory(std::string const &directory_path,
+                                std::vector<std::string> &names) {
+  DIR *directory = opendir(directory_path.c_str());
+  if (directory == nullptr) {
+    return errno == ENOENT || errno == ENOTDIR ? DIRECTORY_LISTING_MISSING
+                                               : DIRECTORY_LISTING_UNREADABLE;
+  }
+
+  // Readdir only tells the end from an error through errno.
+  dirent *entry = nullptr;
+  for (errno = 0; (entry = readdir(directory)) != nullptr; errno = 0) {
+    if (std::strcmp(entry->d_name, ".") == 0 ||
+        std::strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+    names.push_back(entry->d_name);
+  }
+
+  bool read_failed = errno != 0;
+  closedir(directory);
+  return read_failed ? DIRECTORY_LISTING_UNREADABLE : DIRECTORY_LISTING_READ;
+}
+
+/**
+ * Size of a regular file in bytes. Returns 0 when the file can not be stat'ed
+ * which matches the empty digest extractHash falls back to.
+ */
+int64_t fileSize(std::string const &file_path) {
+  std::error_code error;
+  std::uintmax_t size = std::filesystem::file_size(file_path, error);
+  if (error) {
+    return 0;
+  }
+  return static_cast<int64_t>(size);
+}
+
+bool file_stamp::operator==(file_stamp const &rhs) const {
+  return rhs.size == size && rhs.modified_ns == modified_ns &&
+         rhs.device == device && rhs.inode == inode;
+}
+
+file_stamp statStamp(struct stat const &file_stat) {
+  return {.size = static_cast<int64_t>(file_stat.st_size),
+          .modified_ns =
+              static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 +
+              file_stat.st_mtim.tv_nsec,
+          .device = static_cast<int64_t>(file_stat.st_dev),
+          .inode = static_cast<int64_t>(file_stat.st_ino)};
+}
+
+/**
+ * False when the file can not be stat'ed, the stamp is left untouched. The
+ * modification time is in nanoseconds since the epoch.
+ */
+bool stampFile(std::string const &file_path, file_stamp &stamp) {
+  struct stat file_stat;
+  if (stat(file_path.c_str(), &file_stat) != 0) {
+    return false;
+  }
+
+  stamp = statStamp(file_stat);
+  return true;
+}
+
+/**
+ * Stamps a directory entry and tells files from directories. Links are
+ * followed to files but not to directories so a walk can not loop, anything
+ * else is skipped by returning false.
+ */
+bool stampEntry(std::string const &path, file_stamp &stamp, file_type &type) {
+  struct stat entry_stat;
+  if (lstat(path.c_str(), &entry_stat) != 0) {
+    return false;
+  }
+
+  if (S_ISLNK(entry_stat.st_mode) &&
+      (stat(path.c_str(), &entry_stat) != 0 || !S_ISREG(entry_stat.st_mode))) {
+    return false;
+  }
+
+  if (!S_ISREG(entry_stat.st_mode) && !S_ISDIR(entry_stat.st_mode)) {
+    return false;
+  }
+
+  type = S_ISDIR(entry_stat.st_mode) ? FILE_TYPE_DIRECTORY : FILE_TYPE_FILE;
+  stamp = statStamp(entry_stat);
+  return true;
+}
+
+/**
+ * Extended attributes are small so they are read into a fixed buffer, one
+ * which does not fit is treated the same as a missing one. False covers
+ * file systems without them as well.
+ */
+bool readAttribute(std::string const &path, char const *name,
+                   std::string &value) {
+  char buffer[256];
+  ssize_t length = getxattr(path.c_str(), name, buffer, sizeof(buffer));
+  if (length < 0) {
+    return false;
+  }
+
+  value.assign(buffer, static_cast<std::size_t>(length));
+  return true;
+}
+
+bool writeAttribute(std::string const &path, char const *name,
+                    std::string const &value) {
+  return setxattr(path.c_str(), name, value.data(), value.size(), 0) == 0;
+}
+
+/**
+ * Keeps reading until length bytes are read or the end of the file is
+ * reached, -1 when the read failed.
+ */
+int64_t readDescriptorChunk(int file_descriptor, int64_t offset, char *buffer,
+                            std::size_t length) {
+  std::size_t total_read = 0;
+  while (total_read < length) {
+    ssize_t count = pread(file_descriptor, buffer + total_read,
+                          length - total_read, offset + total_read);
+    if (count < 0) {
+      return -1;
+    }
+    if (count == 0) {
+      break;
+    }
+    total_read += count;
+  }
+  return static_cast<int64_t>(total_read);
+}
+
+/**
+ * Reads up to length bytes starting at offset. The file is only open for the
+ * duration of the read so callers can hold any number of files in flight.
+ * Fewer bytes than asked for means the end of the file was reached.
+ */
+std::size_t readFileChunk(std::string const &file_path, int64_t offset,
+                          char *buffer, std::size_t length) {
+  int file_descriptor = open(file_path.c_str(), O_RDONLY);
+  if (file_descriptor < 0) {
+    throw file_open_error("Could not open the file: " + file_path);
+  }
+
+  int64_t total_read =
+      readDescriptorChunk(file_descriptor, offset, buffer, length);
+  close(file_descriptor);
+  if (total_read < 0) {
+    throw file_open_error("Could not read the file: " + file_path);
+  }
+  return static_cast<std::size_t>(total_read);
+}
+
+open_file_pool initOpenFilePool(std::size_t max_open) {
+  return {.max_open = max_open, .descriptors = {}, .open_order = {}};
+}
+
+/**
+ * Same as readFileChunk but the file stays open in the pool for the next
+ * read. A file which fails to read is closed before the error is thrown.
+ */
+std::size_t readPooledFileChunk(open_file_pool &pool,
+                                std::string const &file_path, int64_t offset,
+                                char *buffer, std::size_t length) {
+  std::unordered_map<std::string, int>::iterator descriptor =
+      pool.descriptors.find(file_path);
+  if (descriptor == pool.descriptors.end()) {
+    if (pool.open_order.size() >= pool.max_open) {
+      std::string oldest_path = pool.open_order.front();
+      closePooledFile(pool, oldest_path);
+    }
+
+    int file_descriptor = open(file_path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+      throw file_open_error("Could not open the file: " + file_path);
+    }
+    descriptor = pool.descriptors.emplace(file_path, file_descriptor).first;
+    pool.open_order.push_back(file_path);
+  }
+
+  int64_t total_read =
+      readDescriptorChunk(descriptor->second, offset, buffer, length);
+  if (total_read < 0) {
+    closePooledFile(pool, file_path);
+    throw file_open_error("Could not read the file: " + file_path);
+  }
+  return static_cast<std::size_t>(total_read);
+}
+
+/**
+ * Files which are not open in the pool are left alone.
+ */
+void closePooledFile(open_file_pool &pool, std::string const &file_path) {
+  std::unordered_map<std::string, int>::iterator descriptor =
+      pool.descriptors.find(file_path);
+  if (descriptor == pool.descriptors.end()) {
+    return;
+  }
+
+  close(descriptor->second);
+  pool.descriptors.erase(descriptor);
+  pool.open_order.erase(
+      std::find(pool.open_order.begin(), pool.open_order.end(), file_path));
+}
+
+void closeOpenFilePool(open_file_pool &pool) {
+  for (std::pair<std::string const, int> const &descriptor :
+       pool.descriptors) {
+    close(descriptor.second);
+  }
+  pool.descriptors.clear();
+  pool.open_order.clear();
+}
+
+/**
+ * Keeps writing until everything is written, write can stop part way through
+ * on pipes and when interrupted.
+ */
+void writeFileDescriptor(int file_descriptor, char const *data,
+                         std::size_t length) {
+  std::size_t total_written = 0;
+  while (total_written < length) {
+    ssize_t count = write(file_descriptor, data + total_written,
+                          length - total_written);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count < 0) {
+      throw file_write_error("Could not write to file descriptor: " +
+                             std::to_string(file_descriptor));
+    }
+    total_written += count;
+  }
+}
+
 void createDirectory(std::string const &path) {
   try {
     std::filesystem::create_directory(path);
@@ -113,3 +559,141 @@ void createDirectory(std::string const &path) {
     throw create_directory_error(e.what());
   }
 }
+
+bool removeFile(std::string const &file_path) {
+  return unlink(file_path.c_str()) == 0;
+}
+
+/**
+ * A link is made under a temporary name next to the target and renamed over
+ * it, so the target is never missing or half written. Both files are stamped
+ * again right before and compared with the stamps they were verified with,
+ * size, time and inode, so a file which was rewritten or replaced since it
+ * was read is kept even when its size stayed the same.
+ */
+constexpr char LINK_SUFFIX[] = ".ddupes-link";
+
+link_result checkLinkTarget(std::string const &source_path,
+                            std::string const &target_path,
+                            file_stamp const &source_stamp,
+                            file_stamp const &target_stamp,
+                            struct stat &source_stat,
+                            struct stat &target_stat) {
+  if (stat(source_path.c_str(), &source_stat) != 0 ||
+      stat(target_path.c_str(), &target_stat) != 0) {
+    return LINK_RESULT_CHANGED;
+  }
+
+  if (source_stat.st_dev == target_stat.st_dev &&
+      source_stat.st_ino == target_stat.st_ino) {
+    return LINK_RESULT_SAME_FILE;
+  }
+
+  if (!(statStamp(source_stat) == source_stamp) ||
+      !(statStamp(target_stat) == target_stamp)) {
+    return LINK_RESULT_CHANGED;
+  }
+
+  return LINK_RESULT_LINKED;
+}
+
+/**
+ * The temporary name of the link. One left behind by a run which stopped
+ * before its rename is removed first, it would keep every later run from
+ * linking the target.
+ */
+std::string clearLinkPath(std::string const &target_path) {
+  std::string link_path = target_path + LINK_SUFFIX;
+  unlink(link_path.c_str());
+  return link_path;
+}
+
+link_result renameLink(std::string const &link_path,
+                       std::string const &target_path) {
+  if (rename(link_path.c_str(), target_path.c_str()) != 0) {
+    unlink(link_path.c_str());
+    return LINK_RESULT_FAILED;
+  }
+  return LINK_RESULT_LINKED;
+}
+
+/**
+ * The target takes the source's owner, permissions and times, it is the same
+ * file from now on.
+ */
+link_result hardlinkFile(std::string const &source_path,
+                         std::string const &target_path,
+                         file_stamp const &source_stamp,
+                         file_stamp const &target_stamp) {
+  struct stat source_stat;
+  struct stat target_stat;
+  link_result check = checkLinkTarget(source_path, target_path, source_stamp,
+                                      target_stamp, source_stat, target_stat);
+  if (check != LINK_RESULT_LINKED) {
+    return check;
+  }
+
+  std::string link_path = clearLinkPath(target_path);
+  if (link(source_path.c_str(), link_path.c_str()) != 0) {
+    return errno == EXDEV ? LINK_RESULT_UNSUPPORTED : LINK_RESULT_FAILED;
+  }
+
+  return renameLink(link_path, target_path);
+}
+
+/**
+ * The clone shares the source's extents but stays a separate file, it keeps
+ * the target's permissions and times. It keeps the target's owner too when
+ * the user running this may give it away, and is owned by that user
+ * otherwise.
+ */
+link_result reflinkFile(std::string const &source_path,
+                        std::string const &target_path,
+                        file_stamp const &source_stamp,
+                        file_stamp const &target_stamp) {
+  struct stat source_stat;
+  struct stat target_stat;
+  link_result check = checkLinkTarget(source_path, target_path, source_stamp,
+                                      target_stamp, source_stat, target_stat);
+  if (check != LINK_RESULT_LINKED) {
+    return check;
+  }
+
+  int source_fd = open(source_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (source_fd < 0) {
+    return LINK_RESULT_FAILED;
+  }
+
+  std::string link_path = clearLinkPath(target_path);
+  int link_fd = open(link_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                     S_IRUSR | S_IWUSR);
+  if (link_fd < 0) {
+    close(source_fd);
+    return LINK_RESULT_FAILED;
+  }
+
+  link_result result = LINK_RESULT_LINKED;
+  if (ioctl(link_fd, FICLONE, source_fd) != 0) {
+    result = errno == EOPNOTSUPP || errno == EXDEV || errno == EINVAL ||
+                     errno == ENOTTY
+                 ? LINK_RESULT_UNSUPPORTED
+                 : LINK_RESULT_FAILED;
+  } else {
+    // The owner goes first, changing it clears the set-id bits.
+    if (fchown(link_fd, target_stat.st_uid, target_stat.st_gid) != 0) {
+      fchown(link_fd, -1, target_stat.st_gid);
+    }
+    fchmod(link_fd, target_stat.st_mode & 07777);
+    struct timespec times[2] = {target_stat.st_atim, target_stat.st_mtim};
+    futimens(link_fd, times);
+  }
+  close(link_fd);
+  close(source_fd);
+
+  if (result != LINK_RESULT_LINKED) {
+    unlink(link_path.c_str());
+    return result;
+  }
+
+  return renameLink(link_path, target_path);
+}
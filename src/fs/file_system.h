@@ -1,11 +1,63 @@
 #pragma once
 
+#include <cstdint>
+#include <deque>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 enum file_type { FILE_TYPE_FILE, FILE_TYPE_DIRECTORY };
 
+// What a file looked like the last time it was stat'ed, and where it lives.
+struct file_stamp {
+  int64_t size;
+  int64_t modified_ns;
+  int64_t device;
+  int64_t inode;
+
+  bool operator==(file_stamp const &rhs) const;
+};
+
+/**
+ * How replacing a file with a link to another came out. A file which already
+ * is the other file is left alone, and so is a pair where either file no
+ * longer has the stamp it was verified with.
+ * Unsupported means the file system can not link the two, a reflink on a file
+ * system without them or a hardlink across devices.
+ */
+enum link_result {
+  LINK_RESULT_LINKED,
+  LINK_RESULT_SAME_FILE,
+  LINK_RESULT_CHANGED,
+  LINK_RESULT_UNSUPPORTED,
+  LINK_RESULT_FAILED
+};
+
+/**
+ * How reading the names in a directory came out. Missing means the directory
+ * or one above it is gone, unreadable covers every other error.
+ */
+enum directory_listing {
+  DIRECTORY_LISTING_READ,
+  DIRECTORY_LISTING_MISSING,
+  DIRECTORY_LISTING_UNREADABLE
+};
+
+/**
+ * Files kept open between reads of the same files, at most max_open of them.
+ * Opening one more closes the file opened longest ago, which is opened again
+ * on its next read. Keeps the descriptors of a thread bounded no matter how
+ * many files it reads in turn.
+ */
+constexpr std::size_t OPEN_FILE_POOL_SIZE = 64;
+
+struct open_file_pool {
+  std::size_t max_open;
+  std::unordered_map<std::string, int> descriptors;
+  std::deque<std::string> open_order;
+};
+
 typedef void (*file_visitor_callback)(const std::string, const enum file_type,
                                       void *);
 
@@ -17,8 +69,37 @@ std::string joinPath(std::vector<std::string> const &path_segments);
 void visitFiles(const std::string &directory_path,
                 file_visitor_callback visitor_callback, void *context);
 void extractHash(uint8_t *hash, std::string path);
+bool fingerprintExtents(std::string const &path, uint8_t *fingerprint);
 bool fileExists(std::string const &file_path);
+directory_listing listDirectory(std::string const &directory_path,
+                                std::vector<std::string> &names);
+int64_t fileSize(std::string const &file_path);
+bool stampFile(std::string const &file_path, file_stamp &stamp);
+bool stampEntry(std::string const &path, file_stamp &stamp, file_type &type);
+bool readAttribute(std::string const &path, char const *name,
+                   std::string &value);
+bool writeAttribute(std::string const &path, char const *name,
+                    std::string const &value);
+std::size_t readFileChunk(std::string const &file_path, int64_t offset,
+                          char *buffer, std::size_t length);
+open_file_pool initOpenFilePool(std::size_t max_open);
+std::size_t readPooledFileChunk(open_file_pool &pool,
+                                std::string const &file_path, int64_t offset,
+                                char *buffer, std::size_t length);
+void closePooledFile(open_file_pool &pool, std::string const &file_path);
+void closeOpenFilePool(open_file_pool &pool);
+void writeFileDescriptor(int file_descriptor, char const *data,
+                         std::size_t length);
 void createDirectory(std::string const &path);
+bool removeFile(std::string const &file_path);
+link_result hardlinkFile(std::string const &source_path,
+                         std::string const &target_path,
+                         file_stamp const &source_stamp,
+                         file_stamp const &target_stamp);
+link_result reflinkFile(std::string const &source_path,
+                        std::string const &target_path,
+                        file_stamp const &source_stamp,
+                        file_stamp const &target_stamp);
 
 /* --------------------------------------------------------------------------
  */
@@ -30,6 +111,11 @@ public:
   file_open_error(const std::string &message) : std::runtime_error(message) {}
 };
 
+class file_write_error : public std::runtime_error {
+public:
+  file_write_error(const std::string &message) : std::runtime_error(message) {}
+};
+
 class create_directory_error : public std::runtime_error {
 public:
   create_directory_error(const std::string &message)
@@ -2,8 +2,11 @@
 
 #include <openssl/evp.h>
 
-int stringLength(str_const str) {
-  int length = 0;
+#include <cstdint>
+#include <cstring>
+
+std::size_t stringLength(str_const str) {
+  std::size_t length = 0;
   while (str[length] != '\0') {
     ++length;
   }
@@ -12,10 +15,10 @@ int stringLength(str_const str) {
 }
 
 char *stringDup(str_const string_one) {
-  int length = stringLength(string_one);
+  std::size_t length = stringLength(string_one);
 
   char *string_two = new char[length];
-  for (int i = 0; i < length; i++) {
+  for (std::size_t i = 0; i < length; i++) {
     string_two[i] = string_one[i];
   }
 
@@ -27,17 +30,17 @@ char *stringConcat(str_const one, str_const two) {
     return new char[1]{'\0'};
   }
 
-  int string_one_length = stringLength(one);
-  int string_two_length = stringLength(two);
+  std::size_t string_one_length = stringLength(one);
+  std::size_t string_two_length = stringLength(two);
   char *concated_string = new char[string_one_length + string_two_length -
                                    1]; // Minus one because stringLength
                                        // includes the null terminator.
 
-  for (int i = 0; i < string_one_length - 1; ++i) {
+  for (std::size_t i = 0; i < string_one_length - 1; ++i) {
     concated_string[i] = one[i];
   }
 
-  for (int i = 0; i < string_two_length - 1; ++i) {
+  for (std::size_t i = 0; i < string_two_length - 1; ++i) {
     concated_string[i + (string_one_length - 1)] = two[i];
   }
 
@@ -46,7 +49,7 @@ char *stringConcat(str_const one, str_const two) {
 }
 
 bool compareStrings(str_const string_one, str_const string_two) {
-  int i = 0;
+  std::size_t i = 0;
   while (string_one[i] != '\0' && string_two[i] != '\0') {
     if (string_one[i] != string_two[i]) {
       return false;
@@ -57,28 +60,36 @@ bool compareStrings(str_const string_one, str_const string_two) {
   return string_one[i] == string_two[i];
 }
 
-hash computeHash(hashes_const hashes, int num_of_hashes) {
-  EVP_MD_CTX *md_context;
-  unsigned char *md5_digest;
-  unsigned int md5_digest_len = EVP_MD_size(EVP_md5());
+/**
+ * One MD5 context per thread, reset for every digest instead of allocating a
+ * new context each time. Freed when the thread exits.
+ */
+struct thread_md_context {
+  EVP_MD_CTX *md_context = EVP_MD_CTX_new();
+
+  ~thread_md_context() { EVP_MD_CTX_free(md_context); }
+};
+
+EVP_MD_CTX *threadMdContext() {
+  thread_local thread_md_context context{};
+  return context.md_context;
+}
+
+/**
+ * Writes the MD5 of the concatenated hashes into digest, which must have room
+ * for MD5_DIGEST_LENGTH bytes.
+ */
+void computeHash(hash digest, hashes_const hashes, std::size_t num_of_hashes) {
+  EVP_MD_CTX *md_context = threadMdContext();
+  unsigned int md5_digest_len = MD5_DIGEST_LENGTH;
 
-  md_context = EVP_MD_CTX_new();
   EVP_DigestInit_ex(md_context, EVP_md5(), nullptr);
 
-  for (int i = 0; i < num_of_hashes; ++i) {
+  for (std::size_t i = 0; i < num_of_hashes; ++i) {
     EVP_DigestUpdate(md_context, hashes[i], MD5_DIGEST_LENGTH);
   }
 
-  md5_digest = (unsigned char *)OPENSSL_malloc(md5_digest_len);
-  EVP_DigestFinal_ex(md_context, md5_digest, &md5_digest_len);
-  EVP_MD_CTX_free(md_context);
-
-  /**
-   * TODO: Do I really need a free below, if I can free later so
-  // I don't need to do a memcp?
-   * OPENSSL_free(md5_digest);
-   */
-  return (hash)md5_digest;
+  EVP_DigestFinal_ex(md_context, digest, &md5_digest_len);
 }
 
 bool compareHashes(hash_const hash_one, hash_const hash_two) {
@@ -104,3 +115,128 @@ hash hashDup(hash_const hash_one) {
 
   return tmp_hash;
 }
+
+bool digest::operator==(digest const &rhs) const {
+  // Fixed size compare. Compilers lower this to two 64-bit loads and compares.
+  return std::memcmp(bytes, rhs.bytes, MD5_DIGEST_LENGTH) == 0;
+}
+
+bool digest::operator!=(digest const &rhs) const { return !(*this == rhs); }
+
+bool digest::operator<(digest const &rhs) const {
+  return std::memcmp(bytes, rhs.bytes, MD5_DIGEST_LENGTH) < 0;
+}
+
+bool isPlaceholderDigest(hash_const hash_one) {
+  return std::memcmp(hash_one + MD5_DIGEST_LENGTH - PLACEHOLDER_MARKER_LENGTH,
+                     PLACEHOLDER_MARKER, PLACEHOLDER_MARKER_LENGTH) == 0;
+}
+
+digest toDigest(hash_const hash_one) {
+  digest hash_digest;
+  std::memcpy(hash_digest.bytes, hash_one, MD5_DIGEST_LENGTH);
+  return hash_digest;
+}
+
+/**
+ * Folds both halves of the digest and runs them through the murmur3 64-bit
+ * finalizer so every input byte affects every output bit.
+ */
+std::size_t hashDigest(digest const &hash_digest) {
+  uint64_t low;
+  uint64_t high;
+  std::memcpy(&low, hash_digest.bytes, sizeof(low));
+  std::memcpy(&high, hash_digest.bytes + sizeof(low), sizeof(high));
+
+  uint64_t mixed = low ^ (high * 0x9e3779b97f4a7c15ULL);
+  mixed ^= mixed >> 33;
+  mixed *= 0xff51afd7ed558ccdULL;
+  mixed ^= mixed >> 33;
+  mixed *= 0xc4ceb9fe1a85ec53ULL;
+  mixed ^= mixed >> 33;
+  return mixed;
+}
+
+/**
+ * Same result as computeHash over the same hashes but the digests are
+ * contiguous so they are fed to MD5 in one update.
+ */
+void computeDigest(digest &output, digest const *digests,
+                   std::size_t num_of_digests) {
+  EVP_MD_CTX *md_context = threadMdContext();
+  unsigned int md5_digest_len = MD5_DIGEST_LENGTH;
+
+  EVP_DigestInit_ex(md_context, EVP_md5(), nullptr);
+  EVP_DigestUpdate(md_context, digests, num_of_digests * sizeof(digest));
+  EVP_DigestFinal_ex(md_context, output.bytes, &md5_digest_len);
+}
+
+/**
+ * MD5 of a name followed by a digest. The terminating null byte of the name is
+ * hashed as well so a name can not run into the digest bytes.
+ */
+void computeNamedDigest(digest &output, str_const name,
+                        digest const &name_digest) {
+  EVP_MD_CTX *md_context = threadMdContext();
+  unsigned int md5_digest_len = MD5_DIGEST_LENGTH;
+
+  EVP_DigestInit_ex(md_context, EVP_md5(), nullptr);
+  EVP_DigestUpdate(md_context, name, stringLength(name));
+  EVP_DigestUpdate(md_context, name_digest.bytes, MD5_DIGEST_LENGTH);
+  EVP_DigestFinal_ex(md_context, output.bytes, &md5_digest_len);
+}
+
+constexpr std::size_t RADIX_SORT_THRESHOLD = 64;
+
+/**
+ * Sorts digests by their bytes. Short lists use an insertion sort. Longer
+ * lists use a least significant byte first radix sort, one counting pass per
+ * byte, skipping the bytes every digest shares. scratch must have room for
+ * num_of_digests digests.
+ */
+void sortDigests(digest *digests, std::size_t num_of_digests,
+                 digest *scratch) {
+  if (num_of_digests < RADIX_SORT_THRESHOLD) {
+    for (std::size_t i = 1; i < num_of_digests; ++i) {
+      digest current = digests[i];
+      std::size_t j = i;
+      for (; j > 0 && current < digests[j - 1]; --j) {
+        digests[j] = digests[j - 1];
+      }
+      digests[j] = current;
+    }
+    return;
+  }
+
+  digest *source = digests;
+  digest *destination = scratch;
+  for (std::size_t byte = MD5_DIGEST_LENGTH; byte-- > 0;) {
+    std::size_t offsets[256] = {};
+    for (std::size_t i = 0; i < num_of_digests; ++i) {
+      ++offsets[source[i].bytes[byte]];
+    }
+
+    if (offsets[source[0].bytes[byte]] == num_of_digests) {
+      continue; // Every digest has the same byte.
+    }
+
+    std::size_t total = 0;
+    for (std::size_t &offset : offsets) {
+      std::size_t count = offset;
+      offset = total;
+      total += count;
+    }
+
+    for (std::size_t i = 0; i < num_of_digests; ++i) {
+      destination[offsets[source[i].bytes[byte]]++] = source[i];
+    }
+
+    digest *swap = source;
+    source = destination;
+    destination = swap;
+  }
+
+  if (source != digests) {
+    std::memcpy(digests, source, num_of_digests * sizeof(digest));
+  }
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 typedef char const *const str_const;
 
 typedef unsigned char uint8_t;
@@ -13,10 +15,40 @@ constexpr unsigned short int MD5_DIGEST_LENGTH = 16;
 constexpr uint8_t const EMPTY_HASH[MD5_DIGEST_LENGTH] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
-int stringLength(str_const);
+// Trivially copyable hash value. Stored inline instead of behind a pointer.
+struct digest {
+  uint8_t bytes[MD5_DIGEST_LENGTH];
+
+  bool operator==(digest const &rhs) const;
+  bool operator!=(digest const &rhs) const;
+  bool operator<(digest const &rhs) const;
+};
+
+static_assert(sizeof(digest) == MD5_DIGEST_LENGTH,
+              "Digest arrays must be contiguous hash bytes.");
+
+constexpr digest EMPTY_DIGEST{};
+
+/**
+ * Lockstep gives a file which matched no other file a placeholder rather than
+ * the MD5 of its contents. Placeholders end in this marker so they can be
+ * found and hashed for real later, a real MD5 ending in it is only hashed
+ * again.
+ */
+constexpr std::size_t PLACEHOLDER_MARKER_LENGTH = 4;
+constexpr uint8_t const PLACEHOLDER_MARKER[PLACEHOLDER_MARKER_LENGTH] = {
+    0xdd, 0x0b, 0x1e, 0x5c};
+
+std::size_t stringLength(str_const);
 char *stringDup(str_const);
 char *stringConcat(str_const, str_const);
 bool compareStrings(str_const, str_const);
-hash computeHash(hashes_const, int);
+void computeHash(hash, hashes_const, std::size_t);
 bool compareHashes(hash_const, hash_const);
-hash hashDup(hash_const);
\ No newline at end of file
+bool isPlaceholderDigest(hash_const);
+hash hashDup(hash_const);
+digest toDigest(hash_const);
+std::size_t hashDigest(digest const &);
+void computeDigest(digest &, digest const *, std::size_t);
+void computeNamedDigest(digest &, str_const, digest const &);
+void sortDigests(digest *, std::size_t, digest *);
\ No newline at end of file
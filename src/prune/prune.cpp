@@ -0,0 +1,341 @@
+#include "./prune.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "../dupes/dupes.h"
+#include "../dupes/verify.h"
+#include "../thread/parallel.h"
+
+/**
+ * A file node's name points into the hash row it was loaded from, so the
+ * name's address finds the row.
+ */
+typedef std::unordered_map<char const *, row_id> hash_id_map;
+
+/**
+ * A member as its files in verify order, with the stamps they were verified
+ * with. The time of the member is the modification time of its oldest file.
+ */
+struct prune_member {
+  std::vector<std::size_t> file_nodes;
+  std::vector<std::string> file_paths;
+  std::vector<file_stamp> stamps;
+  std::vector<bool> stamped;
+  bool all_stamped;
+  int64_t oldest_ns;
+};
+
+struct plan_context {
+  duplicate_node_set const *duplicate_nodes_set;
+  std::string const *root_dir;
+  std::vector<verified_stamp> const *file_stamps;
+  std::vector<std::vector<prune_member>> *group_members;
+};
+
+enum prune_result {
+  PRUNE_RESULT_DELETED,
+  PRUNE_RESULT_GONE,
+  PRUNE_RESULT_CHANGED,
+  PRUNE_RESULT_FAILED
+};
+
+struct delete_context {
+  prune_journal_table_row::rows const *journal_rows;
+  std::vector<prune_result> *results;
+};
+
+bool prune_stats::operator==(prune_stats const &rhs) const {
+  return rhs.files_deleted == files_deleted && rhs.files_gone == files_gone &&
+         rhs.files_changed == files_changed &&
+         rhs.files_failed == files_failed && rhs.bytes_freed == bytes_freed;
+}
+
+prune_member buildPruneMember(inode_tree const &tree, std::size_t node,
+                              std::string const &root_dir,
+                              std::vector<verified_stamp> const &file_stamps,
+                              std::vector<char const *> &segment_stack,
+                              std::string &path) {
+  prune_member member{.file_nodes = {},
+                      .file_paths = {},
+                      .stamps = {},
+                      .stamped = {},
+                      .all_stamped = true,
+                      .oldest_ns = INT64_MAX};
+  member.file_nodes = collectFileNodes(tree, node);
+  for (std::size_t file_node : member.file_nodes) {
+    renderPath(tree, file_node, segment_stack, path);
+    member.file_paths.push_back(joinPath({root_dir, path}));
+
+    // A file verify could not stat was never read.
+    file_stamp stamp{};
+    bool stamped = findVerifiedStamp(file_stamps, file_node, stamp);
+    member.stamps.push_back(stamp);
+    member.stamped.push_back(stamped);
+    member.all_stamped = member.all_stamped && stamped;
+    if (stamped && stamp.modified_ns < member.oldest_ns) {
+      member.oldest_ns = stamp.modified_ns;
+    }
+  }
+
+  return member;
+}
+
+/**
+ * Members are in path order so the first is the shortest path, and ties on
+ * age keep the shortest path too. A keeper needs every one of its files. A
+ * member holding a file an earlier group keeps is kept whatever the rule, so
+ * nested and overlapping groups agree on what stays.
+ */
+std::size_t chooseKeeper(std::vector<prune_member> const &members,
+                         prune_keep keep, std::vector<bool> const &kept) {
+  for (std::size_t i = 0; i < members.size(); ++i) {
+    if (members[i].all_stamped &&
+        std::any_of(members[i].file_nodes.begin(), members[i].file_nodes.end(),
+                    [&kept](std::size_t file_node) {
+                      return kept[file_node];
+                    })) {
+      return i;
+    }
+  }
+
+  std::size_t keeper = members.size();
+  for (std::size_t i = 0; i < members.size(); ++i) {
+    if (!members[i].all_stamped) {
+      continue;
+    }
+
+    if (keep == PRUNE_KEEP_SHORTEST_PATH) {
+      return i;
+    }
+
+    if (keeper == members.size() ||
+        members[i].oldest_ns < members[keeper].oldest_ns) {
+      keeper = i;
+    }
+  }
+
+  return keeper;
+}
+
+void buildGroups(std::size_t begin, std::size_t end, void *context) {
+  plan_context *plan = static_cast<plan_context *>(context);
+  duplicate_node_set const &duplicate_nodes_set = *plan->duplicate_nodes_set;
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::vector<char const *> segment_stack{};
+  std::string path{};
+
+  for (std::size_t group = begin; group < end; ++group) {
+    std::size_t const *group_members = duplicate_nodes_set.groupMembers(group);
+    std::vector<prune_member> &members = (*plan->group_members)[group];
+    for (std::size_t i = 0; i < duplicate_nodes_set.groupSize(group); ++i) {
+      members.push_back(buildPruneMember(tree, group_members[i],
+                                         *plan->root_dir, *plan->file_stamps,
+                                         segment_stack, path));
+    }
+  }
+}
+
+/**
+ * The files to delete in group order, journaled with the stamps verify took
+ * before reading them. Files without one are neither deleted nor kept.
+ * Members are built in parallel, then keepers are chosen group by group, and
+ * a file any group keeps, or an earlier group already deletes, is left out
+ * of every other group's deletions.
+ */
+std::vector<prune_entry>
+planPrune(duplicate_node_set const &duplicate_nodes_set,
+          hash_table_row::rows const &hash_rows, std::string const &root_dir,
+          prune_keep keep, std::vector<verified_stamp> const &file_stamps) {
+  hash_id_map hash_ids{};
+  for (hash_table_row const &hash_row : hash_rows) {
+    hash_ids[hash_row.name] = hash_row.id;
+  }
+
+  std::vector<std::vector<prune_member>> group_members(
+      duplicate_nodes_set.size());
+  plan_context context{&duplicate_nodes_set, &root_dir, &file_stamps,
+                       &group_members};
+  parallelFor(0, duplicate_nodes_set.size(), buildGroups, &context, 1);
+
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::vector<bool> kept(tree.parents.size(), false);
+  std::vector<std::size_t> keepers(group_members.size());
+  for (std::size_t group = 0; group < group_members.size(); ++group) {
+    keepers[group] = chooseKeeper(group_members[group], keep, kept);
+    if (keepers[group] == group_members[group].size()) {
+      continue;
+    }
+    for (std::size_t file_node :
+         group_members[group][keepers[group]].file_nodes) {
+      kept[file_node] = true;
+    }
+  }
+
+  std::vector<prune_entry> entries{};
+  std::vector<bool> planned(tree.parents.size(), false);
+  for (std::size_t group = 0; group < group_members.size(); ++group) {
+    std::vector<prune_member> const &members = group_members[group];
+    std::size_t keeper = keepers[group];
+    if (keeper == members.size()) {
+      continue;
+    }
+
+    for (std::size_t i = 0; i < members.size(); ++i) {
+      if (i == keeper ||
+          members[i].file_nodes.size() != members[keeper].file_nodes.size()) {
+        continue;
+      }
+
+      for (std::size_t j = 0; j < members[i].file_nodes.size(); ++j) {
+        std::size_t file_node = members[i].file_nodes[j];
+        hash_id_map::const_iterator hash_id =
+            hash_ids.find(tree.path_segments[file_node]);
+        if (!members[i].stamped[j] || kept[file_node] || planned[file_node] ||
+            hash_id == hash_ids.end()) {
+          continue;
+        }
+
+        planned[file_node] = true;
+        entries.push_back({.hash_id = hash_id->second,
+                           .path = members[i].file_paths[j],
+                           .keeper_path = members[keeper].file_paths[j],
+                           .stamp = members[i].stamps[j],
+                           .keeper_stamp = members[keeper].stamps[j]});
+      }
+    }
+  }
+  return entries;
+}
+
+void deleteFiles(std::size_t begin, std::size_t end, void *context) {
+  delete_context *deletion = static_cast<delete_context *>(context);
+
+  for (std::size_t i = begin; i < end; ++i) {
+    prune_journal_table_row const &row = (*deletion->journal_rows)[i];
+    prune_result &result = (*deletion->results)[i];
+
+    file_stamp stamp{};
+    file_stamp keeper_stamp{};
+    if (!stampFile(row.path, stamp)) {
+      result = PRUNE_RESULT_GONE;
+    } else if (stamp.size != row.size ||
+               stamp.modified_ns != row.modified_ns ||
+               !stampFile(row.keeper_path, keeper_stamp) ||
+               keeper_stamp.size != row.size ||
+               keeper_stamp.modified_ns != row.keeper_modified_ns ||
+               keeper_stamp.inode != row.keeper_inode) {
+      result = PRUNE_RESULT_CHANGED;
+    } else if (!removeFile(row.path)) {
+      result = PRUNE_RESULT_FAILED;
+    } else {
+      result = PRUNE_RESULT_DELETED;
+    }
+  }
+}
+
+/**
+ * Deleted and gone files leave the cache, changed and failed files stay in
+ * it. Either way they leave the journal.
+ */
+prune_stats pruneJournal(sqlite3 *db,
+                         prune_journal_table_row::rows const &journal_rows,
+                         std::size_t batch_size) {
+  std::vector<prune_result> results(journal_rows.size(), PRUNE_RESULT_FAILED);
+  delete_context context{&journal_rows, &results};
+  prune_stats stats{0, 0, 0, 0, 0};
+
+  for (std::size_t batch = 0; batch < journal_rows.size();
+       batch += batch_size) {
+    std::size_t batch_end = std::min(batch + batch_size, journal_rows.size());
+    parallelFor(batch, batch_end, deleteFiles, &context, 1);
+
+    std::vector<prune_outcome_input> outcome_inputs{};
+    for (std::size_t i = batch; i < batch_end; ++i) {
+      prune_outcome outcome = PRUNE_OUTCOME_DELETED;
+      switch (results[i]) {
+      case PRUNE_RESULT_DELETED:
+        ++stats.files_deleted;
+        stats.bytes_freed += journal_rows[i].size;
+        break;
+      case PRUNE_RESULT_GONE:
+        ++stats.files_gone;
+        break;
+      case PRUNE_RESULT_CHANGED:
+        ++stats.files_changed;
+        outcome = PRUNE_OUTCOME_KEPT;
+        break;
+      case PRUNE_RESULT_FAILED:
+        ++stats.files_failed;
+        outcome = PRUNE_OUTCOME_KEPT;
+        break;
+      }
+      outcome_inputs.push_back({.id = journal_rows[i].id, .outcome = outcome});
+    }
+    finishPruneJournal(db, outcome_inputs);
+  }
+
+  return stats;
+}
+
+void writePruneJournal(sqlite3 *db, std::vector<prune_entry> const &entries) {
+  std::vector<prune_journal_input> journal_inputs{};
+  for (prune_entry const &entry : entries) {
+    journal_inputs.push_back({.hash_id = entry.hash_id,
+                              .path = entry.path.c_str(),
+                              .keeper_path = entry.keeper_path.c_str(),
+                              .size = entry.stamp.size,
+                              .modified_ns = entry.stamp.modified_ns,
+                              .keeper_modified_ns =
+                                  entry.keeper_stamp.modified_ns,
+                              .keeper_inode = entry.keeper_stamp.inode});
+  }
+  createPruneJournal(db, journal_inputs);
+}
+
+void prune(std::string cache_path, prune_options const &options,
+           std::ostream &console) {
+  sqlite3 *db = initDB(cache_path.c_str());
+  upgradeDB(db);
+  arena *prune_arena = initArena();
+
+  prune_journal_table_row::rows journal_rows =
+      fetchPendingPruneJournal(db, prune_arena);
+  if (journal_rows.size() != 0) {
+    console << "Resuming the prune left in the journal, "
+            << journal_rows.size() << " files are left to delete.\n"
+            << std::endl;
+  } else {
+    file_hash_rows rows = {fetchAllDirectories(db, prune_arena),
+                           fetchAllHashes(db, prune_arena)};
+    duplicate_node_set duplicate_nodes_set =
+        transform(rows, fetchDigestOptions(db));
+
+    // Nothing is deleted which was not read byte for byte first.
+    std::vector<verified_stamp> file_stamps =
+        verifyDuplicates(db, prune_arena, duplicate_nodes_set, console);
+    sortDuplicateNodeSet(duplicate_nodes_set, {.sort = GROUP_SORT_PATH,
+                                               .top = 0,
+                                               .window = 0,
+                                               .format = OUTPUT_FORMAT_TEXT});
+
+    std::vector<prune_entry> entries =
+        planPrune(duplicate_nodes_set, rows.hash_rows,
+                  fetchScanMetaData(db).root_dir, options.keep, file_stamps);
+    writePruneJournal(db, entries);
+    console << "Wrote a plan to delete " << entries.size()
+            << " files to the journal.\n"
+            << std::endl;
+    journal_rows = fetchPendingPruneJournal(db, prune_arena);
+  }
+
+  prune_stats stats = pruneJournal(db, journal_rows, PRUNE_BATCH_SIZE);
+  console << "Deleted " << stats.files_deleted << " files ("
+          << stats.bytes_freed << " bytes freed), " << stats.files_gone
+          << " files were already gone, " << stats.files_changed
+          << " files were kept because they or their keeper changed and "
+          << stats.files_failed << " files could not be deleted.\n"
+          << std::endl;
+  freeArena(prune_arena);
+  freeDB(db);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../dupes/transform_output.h"
+#include "../dupes/verify.h"
+#include "../fs/file_system.h"
+#include "../sqlite/sqlite.h"
+
+/**
+ * Deletes the verified duplicates of a cache and keeps one member of every
+ * group, the one with the shortest path or the one with the oldest files.
+ * Directory members are deleted file by file, paired with the keeper's files
+ * by digest the same way verify pairs them. Groups which share files agree on
+ * their keepers and no file kept by one group is deleted by another.
+ *
+ * The plan is written to a journal in the cache before anything is deleted.
+ * A prune which finds a journal left behind resumes it instead of planning
+ * again. Files are planned with the stamps verify took before reading them.
+ * A file is only deleted while it has the size and modification time it was
+ * planned with and its keeper still has the same size, modification time and
+ * inode. Files are deleted a batch at a time across threads, and
+ * each batch is applied to the cache and leaves the journal in one
+ * transaction.
+ */
+enum prune_keep { PRUNE_KEEP_SHORTEST_PATH, PRUNE_KEEP_OLDEST };
+
+constexpr std::size_t PRUNE_BATCH_SIZE = 4096;
+
+struct prune_options {
+  prune_keep keep;
+};
+
+struct prune_entry {
+  row_id hash_id;
+  std::string path;
+  std::string keeper_path;
+  file_stamp stamp;
+  file_stamp keeper_stamp;
+};
+
+/**
+ * Gone files were deleted before the journal recorded it, by an interrupted
+ * prune or by hand. Changed files, or files whose keeper changed, are kept.
+ */
+struct prune_stats {
+  std::size_t files_deleted;
+  std::size_t files_gone;
+  std::size_t files_changed;
+  std::size_t files_failed;
+  int64_t bytes_freed;
+
+  bool operator==(prune_stats const &rhs) const;
+};
+
+std::vector<prune_entry>
+planPrune(duplicate_node_set const &duplicate_nodes_set,
+          hash_table_row::rows const &hash_rows, std::string const &root_dir,
+          prune_keep keep, std::vector<verified_stamp> const &file_stamps);
+prune_stats pruneJournal(sqlite3 *db,
+                         prune_journal_table_row::rows const &journal_rows,
+                         std::size_t batch_size);
+void prune(std::string cache_path, prune_options const &options,
+           std::ostream &console);
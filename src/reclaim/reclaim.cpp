@@ -0,0 +1,248 @@
+#include "./reclaim.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "../dupes/dupes.h"
+#include "../dupes/verify.h"
+#include "../thread/parallel.h"
+
+/**
+ * The tree names files by the names of their hash rows, so looking up a
+ * name's address finds the row.
+ */
+typedef std::unordered_map<char const *, hash_table_row const *> hash_row_map;
+
+struct link_context {
+  std::vector<reclaim_task> const *tasks;
+  reclaim_mode mode;
+  std::vector<link_result> *results;
+};
+
+bool reclaim_stats::operator==(reclaim_stats const &rhs) const {
+  return rhs.files_linked == files_linked &&
+         rhs.files_skipped == files_skipped &&
+         rhs.files_unsupported == files_unsupported &&
+         rhs.files_failed == files_failed &&
+         rhs.bytes_reclaimed == bytes_reclaimed;
+}
+
+/**
+ * Every file of every member but the first, paired with the keeper's file.
+ * Verified members have the same number of files, members which do not are
+ * skipped and so are files without a stamp from the verification.
+ */
+std::vector<reclaim_task>
+collectReclaimTasks(duplicate_node_set const &duplicate_nodes_set,
+                    std::string const &root_dir,
+                    std::vector<verified_stamp> const &file_stamps) {
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::vector<char const *> segment_stack{};
+  std::string path{};
+  std::vector<reclaim_task> tasks{};
+
+  for (std::size_t group = 0; group < duplicate_nodes_set.size(); ++group) {
+    std::size_t const *group_members = duplicate_nodes_set.groupMembers(group);
+    std::vector<std::size_t> keeper_files =
+        collectFileNodes(tree, group_members[0]);
+    std::vector<std::string> keeper_paths{};
+    for (std::size_t keeper_file : keeper_files) {
+      renderPath(tree, keeper_file, segment_stack, path);
+      keeper_paths.push_back(joinPath({root_dir, path}));
+    }
+
+    for (std::size_t i = 1; i < duplicate_nodes_set.groupSize(group); ++i) {
+      std::vector<std::size_t> target_files =
+          collectFileNodes(tree, group_members[i]);
+      if (target_files.size() != keeper_files.size()) {
+        continue;
+      }
+
+      for (std::size_t j = 0; j < target_files.size(); ++j) {
+        file_stamp keeper_stamp{};
+        file_stamp target_stamp{};
+        if (!findVerifiedStamp(file_stamps, keeper_files[j], keeper_stamp) ||
+            !findVerifiedStamp(file_stamps, target_files[j], target_stamp)) {
+          continue;
+        }
+
+        renderPath(tree, target_files[j], segment_stack, path);
+        tasks.push_back({.keeper_path = keeper_paths[j],
+                         .target_path = joinPath({root_dir, path}),
+                         .size = tree.sizes[target_files[j]],
+                         .group = group,
+                         .target_node = target_files[j],
+                         .keeper_stamp = keeper_stamp,
+                         .target_stamp = target_stamp});
+      }
+    }
+  }
+
+  return tasks;
+}
+
+void linkFiles(std::size_t begin, std::size_t end, void *context) {
+  link_context *link = static_cast<link_context *>(context);
+  for (std::size_t i = begin; i < end; ++i) {
+    reclaim_task const &task = (*link->tasks)[i];
+    if (link->mode == RECLAIM_MODE_REFLINK) {
+      (*link->results)[i] =
+          reflinkFile(task.keeper_path, task.target_path, task.keeper_stamp,
+                      task.target_stamp);
+    } else {
+      (*link->results)[i] =
+          hardlinkFile(task.keeper_path, task.target_path, task.keeper_stamp,
+                       task.target_stamp);
+    }
+  }
+}
+
+/**
+ * The tasks whose file was linked are marked in linked_tasks.
+ */
+reclaim_stats reclaimFiles(std::vector<reclaim_task> const &tasks,
+                           reclaim_mode mode, std::size_t batch_size,
+                           std::vector<bool> &linked_tasks) {
+  std::vector<link_result> results(tasks.size(), LINK_RESULT_FAILED);
+  link_context context{&tasks, mode, &results};
+  reclaim_stats stats{0, 0, 0, 0, 0};
+
+  for (std::size_t batch = 0; batch < tasks.size(); batch += batch_size) {
+    std::size_t batch_end = std::min(batch + batch_size, tasks.size());
+    parallelFor(batch, batch_end, linkFiles, &context, 1);
+
+    for (std::size_t i = batch; i < batch_end; ++i) {
+      switch (results[i]) {
+      case LINK_RESULT_LINKED:
+        ++stats.files_linked;
+        stats.bytes_reclaimed += tasks[i].size;
+        linked_tasks[i] = true;
+        break;
+      case LINK_RESULT_SAME_FILE:
+      case LINK_RESULT_CHANGED:
+        ++stats.files_skipped;
+        break;
+      case LINK_RESULT_UNSUPPORTED:
+        ++stats.files_unsupported;
+        break;
+      case LINK_RESULT_FAILED:
+        ++stats.files_failed;
+        break;
+      }
+    }
+
+    if (stats.files_failed != 0) {
+      break;
+    }
+  }
+
+  return stats;
+}
+
+/**
+ * A linked file has the keeper's time after a hardlink and shares the
+ * keeper's extents after either link, so its row takes its new stamp and
+ * fingerprint. Otherwise the next rescan would hash it again and dupes would
+ * keep reporting space which is already reclaimed. The groups which had files
+ * linked are then stored as verified again under their new stamps. Both are
+ * written in a single transaction each once every batch is done.
+ */
+void storeReclaimedGroups(sqlite3 *db,
+                          duplicate_node_set const &duplicate_nodes_set,
+                          hash_table_row::rows const &hash_rows,
+                          std::string const &root_dir,
+                          std::vector<reclaim_task> const &tasks,
+                          std::vector<bool> const &linked_tasks) {
+  hash_row_map rows_by_name{};
+  for (hash_table_row const &hash_row : hash_rows) {
+    rows_by_name[hash_row.name] = &hash_row;
+  }
+
+  inode_tree const &tree = duplicate_nodes_set.tree;
+  std::vector<bool> linked_groups(duplicate_nodes_set.size(), false);
+  std::vector<digest> fingerprints(tasks.size());
+  std::vector<hash_update_input> update_inputs{};
+  for (std::size_t i = 0; i < tasks.size(); ++i) {
+    if (!linked_tasks[i]) {
+      continue;
+    }
+    linked_groups[tasks[i].group] = true;
+
+    hash_row_map::const_iterator hash_row =
+        rows_by_name.find(tree.path_segments[tasks[i].target_node]);
+    file_stamp stamp{};
+    if (hash_row == rows_by_name.end() ||
+        !stampFile(tasks[i].target_path, stamp)) {
+      continue;
+    }
+
+    bool mapped =
+        fingerprintExtents(tasks[i].target_path, fingerprints[i].bytes);
+    update_inputs.push_back({.id = hash_row->second->id,
+                             .hash = hash_row->second->hash,
+                             .size = stamp.size,
+                             .modified_ns = stamp.modified_ns,
+                             .extents = mapped ? fingerprints[i].bytes
+                                               : nullptr});
+  }
+  updateHashes(db, update_inputs);
+
+  std::vector<digest> keys{};
+  for (std::size_t group = 0; group < duplicate_nodes_set.size(); ++group) {
+    digest key{};
+    if (linked_groups[group] &&
+        buildVerifiedKey(duplicate_nodes_set, group, root_dir, key)) {
+      keys.push_back(key);
+    }
+  }
+
+  std::vector<verified_group_input> verified_inputs{};
+  for (digest const &key : keys) {
+    verified_inputs.push_back({.key = key.bytes});
+  }
+  createVerifiedGroups(db, verified_inputs);
+}
+
+void reclaim(std::string cache_path, reclaim_options const &options,
+             std::ostream &console) {
+  sqlite3 *db = initDB(cache_path.c_str());
+  upgradeDB(db);
+  arena *reclaim_arena = initArena();
+  file_hash_rows rows = {fetchAllDirectories(db, reclaim_arena),
+                         fetchAllHashes(db, reclaim_arena)};
+  duplicate_node_set duplicate_nodes_set =
+      transform(rows, fetchDigestOptions(db));
+
+  // Nothing is replaced which was not read byte for byte first.
+  std::vector<verified_stamp> file_stamps =
+      verifyDuplicates(db, reclaim_arena, duplicate_nodes_set, console);
+  sortDuplicateNodeSet(duplicate_nodes_set, {.sort = GROUP_SORT_PATH,
+                                             .top = 0,
+                                             .window = 0,
+                                             .format = OUTPUT_FORMAT_TEXT});
+
+  std::string root_dir = fetchScanMetaData(db).root_dir;
+  std::vector<reclaim_task> tasks =
+      collectReclaimTasks(duplicate_nodes_set, root_dir, file_stamps);
+  std::vector<bool> linked_tasks(tasks.size(), false);
+  reclaim_stats stats = reclaimFiles(tasks, options.mode, RECLAIM_BATCH_SIZE,
+                                     linked_tasks);
+  storeReclaimedGroups(db, duplicate_nodes_set, rows.hash_rows, root_dir,
+                       tasks, linked_tasks);
+
+  console << "Linked " << stats.files_linked << " files ("
+          << stats.bytes_reclaimed << " bytes reclaimed), "
+          << stats.files_skipped
+          << " files were already linked or had changed, "
+          << stats.files_unsupported
+          << " files could not be linked on their file system and "
+          << stats.files_failed << " files failed.\n"
+          << std::endl;
+  freeArena(reclaim_arena);
+  freeDB(db);
+
+  if (stats.files_failed != 0) {
+    throw reclaim_error("Stopped after a batch with files which could not be "
+                        "linked.");
+  }
+}
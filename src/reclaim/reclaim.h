@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../dupes/transform_output.h"
+#include "../dupes/verify.h"
+#include "../fs/file_system.h"
+
+/**
+ * Turns the verified duplicates of a cache into reclaimed space. The first
+ * member of every group, the one with the shortest path, is kept and the
+ * files of the other members are replaced with reflinks or hardlinks to the
+ * files of the keeper. A directory member is replaced file by file, paired
+ * with the keeper's files by digest the same way verify pairs them.
+ *
+ * Files are linked a batch at a time, the files of a batch are spread across
+ * threads. A batch with a failed file is the last one, files already linked
+ * stay linked. A file is only replaced while it and the keeper's file still
+ * have the stamps they were verified with.
+ */
+enum reclaim_mode { RECLAIM_MODE_REFLINK, RECLAIM_MODE_HARDLINK };
+
+constexpr std::size_t RECLAIM_BATCH_SIZE = 256;
+
+struct reclaim_options {
+  reclaim_mode mode;
+};
+
+struct reclaim_task {
+  std::string keeper_path;
+  std::string target_path;
+  int64_t size;
+  std::size_t group;
+  std::size_t target_node;
+  file_stamp keeper_stamp;
+  file_stamp target_stamp;
+};
+
+struct reclaim_stats {
+  std::size_t files_linked;
+  std::size_t files_skipped;
+  std::size_t files_unsupported;
+  std::size_t files_failed;
+  int64_t bytes_reclaimed;
+
+  bool operator==(reclaim_stats const &rhs) const;
+};
+
+std::vector<reclaim_task>
+collectReclaimTasks(duplicate_node_set const &duplicate_nodes_set,
+                    std::string const &root_dir,
+                    std::vector<verified_stamp> const &file_stamps);
+reclaim_stats reclaimFiles(std::vector<reclaim_task> const &tasks,
+                           reclaim_mode mode, std::size_t batch_size,
+                           std::vector<bool> &linked_tasks);
+void storeReclaimedGroups(sqlite3 *db,
+                          duplicate_node_set const &duplicate_nodes_set,
+                          hash_table_row::rows const &hash_rows,
+                          std::string const &root_dir,
+                          std::vector<reclaim_task> const &tasks,
+                          std::vector<bool> const &linked_tasks);
+void reclaim(std::string cache_path, reclaim_options const &options,
+             std::ostream &console);
+
+class reclaim_error : public std::runtime_error {
+public:
+  reclaim_error(const std::string &message) : std::runtime_error(message) {}
+};
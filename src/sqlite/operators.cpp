@@ -2,12 +2,15 @@
 
 bool directory_table_row::operator==(const directory_table_row &rhs) const {
   return rhs.id == id && compareStrings(rhs.name, name) &&
-         rhs.parent_id == parent_id;
+         rhs.parent_id == parent_id && compareHashes(hash, rhs.hash) &&
+         rhs.size == size && rhs.modified_ns == modified_ns;
 };
 
 bool hash_table_row::operator==(const hash_table_row &rhs) const {
   return rhs.id == id && rhs.directory_id == directory_id &&
-         compareStrings(rhs.name, name) && compareHashes(hash, rhs.hash);
+         compareStrings(rhs.name, name) && compareHashes(hash, rhs.hash) &&
+         rhs.size == size && rhs.modified_ns == modified_ns &&
+         compareHashes(extents, rhs.extents);
 };
 
 bool scan_meta_data_table_row::operator==(
@@ -15,15 +18,81 @@ bool scan_meta_data_table_row::operator==(
   return compareStrings(rhs.root_dir, root_dir);
 };
 
+bool verified_group_table_row::operator==(
+    const verified_group_table_row &rhs) const {
+  return compareHashes(key, rhs.key);
+}
+
+bool cache_option_table_row::operator==(
+    const cache_option_table_row &rhs) const {
+  return compareStrings(rhs.name, name) && compareStrings(rhs.value, value);
+}
+
+bool prune_journal_table_row::operator==(
+    const prune_journal_table_row &rhs) const {
+  return rhs.id == id && rhs.hash_id == hash_id &&
+         compareStrings(rhs.path, path) &&
+         compareStrings(rhs.keeper_path, keeper_path) && rhs.size == size &&
+         rhs.modified_ns == modified_ns &&
+         rhs.keeper_modified_ns == keeper_modified_ns &&
+         rhs.keeper_inode == keeper_inode;
+}
+
 bool directory_input::operator==(const directory_input &rhs) const {
-  return rhs.parent_id == parent_id && compareStrings(rhs.name, name);
+  return rhs.parent_id == parent_id && compareStrings(rhs.name, name) &&
+         rhs.modified_ns == modified_ns;
 }
 
 bool hash_input::operator==(const hash_input &rhs) const {
   return rhs.directory_id == directory_id && compareStrings(rhs.name, name) &&
-         compareHashes(hash, rhs.hash);
+         compareHashes(hash, rhs.hash) && rhs.size == size &&
+         rhs.modified_ns == modified_ns && compareHashes(extents, rhs.extents);
+}
+
+bool hash_update_input::operator==(const hash_update_input &rhs) const {
+  return rhs.id == id && compareHashes(hash, rhs.hash) && rhs.size == size &&
+         rhs.modified_ns == modified_ns && compareHashes(extents, rhs.extents);
+}
+
+bool directory_stamp_input::operator==(
+    const directory_stamp_input &rhs) const {
+  return rhs.id == id && rhs.modified_ns == modified_ns;
+}
+
+bool directory_digest_input::operator==(
+    const directory_digest_input &rhs) const {
+  return rhs.id == id && compareHashes(hash, rhs.hash) && rhs.size == size;
 }
 
 bool scan_meta_data_input::operator==(const scan_meta_data_input &rhs) const {
   return compareStrings(rhs.root_dir, root_dir);
-};
\ No newline at end of file
+};
+bool verified_group_input::operator==(
+    const verified_group_input &rhs) const {
+  return compareHashes(key, rhs.key);
+}
+
+bool prune_journal_input::operator==(const prune_journal_input &rhs) const {
+  return rhs.hash_id == hash_id && compareStrings(rhs.path, path) &&
+         compareStrings(rhs.keeper_path, keeper_path) && rhs.size == size &&
+         rhs.modified_ns == modified_ns &&
+         rhs.keeper_modified_ns == keeper_modified_ns &&
+         rhs.keeper_inode == keeper_inode;
+}
+
+bool prune_outcome_input::operator==(const prune_outcome_input &rhs) const {
+  return rhs.id == id && rhs.outcome == outcome;
+}
+
+bool cache_option_input::operator==(const cache_option_input &rhs) const {
+  return compareStrings(rhs.name, name) && compareStrings(rhs.value, value);
+}
+
+bool stored_digest_key::operator==(stored_digest_key const &rhs) const {
+  return rhs.device == device && rhs.inode == inode && rhs.size == size &&
+         rhs.modified_ns == modified_ns;
+}
+
+bool stored_digest_input::operator==(stored_digest_input const &rhs) const {
+  return rhs.key == key && compareHashes(rhs.hash, hash) && rhs.used == used;
+}
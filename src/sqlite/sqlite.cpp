@@ -32,7 +32,9 @@ void resetDB(sqlite3 *db) {
   if (truncate_directories_result != SQLITE_OK) {
     const char *create_directories_table_ddl =
         "CREATE TABLE Directories (id INTEGER PRIMARY KEY AUTOINCREMENT, "
-        "name TEXT NOT NULL, parent_id INTEGER NOT NULL );";
+        "name TEXT NOT NULL, parent_id INTEGER NOT NULL, hash BLOB, "
+        "size INTEGER NOT NULL DEFAULT 0, modified_ns INTEGER NOT NULL "
+        "DEFAULT 0 );";
 
     int create_directories_result =
         sqlite3_exec(db, create_directories_table_ddl, 0, 0, 0);
@@ -55,7 +57,9 @@ void resetDB(sqlite3 *db) {
     const char *create_hash_table_ddl =
         "CREATE TABLE Hashes (id INTEGER PRIMARY KEY "
         "AUTOINCREMENT, directory_id INTEGER NOT NULL, "
-        "name TEXT NOT NULL, hash BLOB NOT NULL );";
+        "name TEXT NOT NULL, hash BLOB NOT NULL, "
+        "size INTEGER NOT NULL DEFAULT 0, modified_ns INTEGER NOT NULL "
+        "DEFAULT 0, extents BLOB );";
 
     int create_hashes_result = sqlite3_exec(db, create_hash_table_ddl, 0, 0, 0);
 
@@ -81,14 +85,171 @@ void resetDB(sqlite3 *db) {
           "Could not create the ScanMetaData table.");
     }
   }
+
+  // Reset or create CacheOptions table.
+  const char *delete_all_cache_options_stmt = "DELETE FROM CacheOptions;";
+  int truncate_cache_options_result =
+      sqlite3_exec(db, delete_all_cache_options_stmt, 0, 0, 0);
+
+  if (truncate_cache_options_result != SQLITE_OK) {
+    const char *create_cache_options_ddl =
+        "CREATE TABLE CacheOptions (name TEXT PRIMARY KEY, "
+        "value TEXT NOT NULL);";
+
+    int create_cache_options_result =
+        sqlite3_exec(db, create_cache_options_ddl, 0, 0, 0);
+
+    if (create_cache_options_result) {
+      throw unable_to_create_table_error(
+          "Could not create the CacheOptions table.");
+    }
+  }
+
+  // Reset or create VerifiedGroups table.
+  const char *delete_all_verified_groups_stmt = "DELETE FROM VerifiedGroups;";
+  int truncate_verified_groups_result =
+      sqlite3_exec(db, delete_all_verified_groups_stmt, 0, 0, 0);
+
+  if (truncate_verified_groups_result != SQLITE_OK) {
+    const char *create_verified_groups_ddl =
+        "CREATE TABLE VerifiedGroups (key BLOB PRIMARY KEY);";
+
+    int create_verified_groups_result =
+        sqlite3_exec(db, create_verified_groups_ddl, 0, 0, 0);
+
+    if (create_verified_groups_result) {
+      throw unable_to_create_table_error(
+          "Could not create the VerifiedGroups table.");
+    }
+  }
+
+  // A new scan makes the plan of an earlier prune meaningless.
+  sqlite3_exec(db, "DROP TABLE IF EXISTS PruneJournal;", 0, 0, 0);
+
+  // Tables kept from an older cache still need the newer columns.
+  upgradeDB(db);
+}
+
+/**
+ * Adds the columns and tables newer versions store to caches built by older
+ * versions. Adding a column that already exists fails, which is ignored, so
+ * this is safe to run on any cache.
+ */
+void upgradeDB(sqlite3 *db) {
+  sqlite3_exec(db, "ALTER TABLE Directories ADD COLUMN hash BLOB;", 0, 0, 0);
+  sqlite3_exec(db,
+               "ALTER TABLE Directories ADD COLUMN size INTEGER NOT NULL "
+               "DEFAULT 0;",
+               0, 0, 0);
+  sqlite3_exec(db, "ALTER TABLE Hashes ADD COLUMN size INTEGER NOT NULL "
+                   "DEFAULT 0;",
+               0, 0, 0);
+  sqlite3_exec(db,
+               "ALTER TABLE Directories ADD COLUMN modified_ns INTEGER NOT "
+               "NULL DEFAULT 0;",
+               0, 0, 0);
+  sqlite3_exec(db,
+               "ALTER TABLE Hashes ADD COLUMN modified_ns INTEGER NOT NULL "
+               "DEFAULT 0;",
+               0, 0, 0);
+  sqlite3_exec(db, "ALTER TABLE Hashes ADD COLUMN extents BLOB;", 0, 0, 0);
+  sqlite3_exec(db,
+               "CREATE TABLE IF NOT EXISTS VerifiedGroups (key BLOB PRIMARY "
+               "KEY);",
+               0, 0, 0);
+  sqlite3_exec(db,
+               "CREATE TABLE IF NOT EXISTS PruneJournal (id INTEGER PRIMARY "
+               "KEY AUTOINCREMENT, hash_id INTEGER NOT NULL, path TEXT NOT "
+               "NULL, keeper_path TEXT NOT NULL, size INTEGER NOT NULL, "
+               "modified_ns INTEGER NOT NULL, outcome INTEGER NOT NULL "
+               "DEFAULT 0);",
+               0, 0, 0);
+  // A journal left by an older version has no keeper stamps, its files are
+  // kept since their keepers can not be checked.
+  sqlite3_exec(db,
+               "ALTER TABLE PruneJournal ADD COLUMN keeper_modified_ns "
+               "INTEGER NOT NULL DEFAULT 0;",
+               0, 0, 0);
+  sqlite3_exec(db,
+               "ALTER TABLE PruneJournal ADD COLUMN keeper_inode INTEGER NOT "
+               "NULL DEFAULT 0;",
+               0, 0, 0);
 }
 
 void freeDB(sqlite3 *db) { sqlite3_close(db); }
 
+/**
+ * Groups the single row inserts made until commitTransaction into one
+ * transaction. The batch gateways open their own, so none of them may be
+ * called in between.
+ */
+void beginTransaction(sqlite3 *db) {
+  if (sqlite3_exec(db, "BEGIN TRANSACTION;", 0, 0, 0) != SQLITE_OK) {
+    throw unable_to_insert_error("Could not begin a transaction.");
+  }
+}
+
+void commitTransaction(sqlite3 *db) {
+  if (sqlite3_exec(db, "COMMIT;", 0, 0, 0) != SQLITE_OK) {
+    sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+    throw unable_to_insert_error("Could not commit a transaction.");
+  }
+}
+
+/**
+ * Opens the transaction a batch gateway writes its rows in. When it can not
+ * be opened the gateway's statement is finalized and nothing was written.
+ */
+void beginBatchWrite(sqlite3 *db, sqlite3_stmt *statement, char const *message,
+                     char const *begin_stmt = "BEGIN TRANSACTION;") {
+  if (sqlite3_exec(db, begin_stmt, 0, 0, 0) != SQLITE_OK) {
+    sqlite3_finalize(statement);
+    throw unable_to_insert_error(message);
+  }
+}
+
+/**
+ * A batch which can not be committed is rolled back as a whole.
+ */
+void commitBatchWrite(sqlite3 *db, sqlite3_stmt *statement,
+                      char const *message) {
+  sqlite3_finalize(statement);
+  if (sqlite3_exec(db, "COMMIT;", 0, 0, 0) != SQLITE_OK) {
+    sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+    throw unable_to_insert_error(message);
+  }
+}
+
+/**
+ * The store is written by every build at once, WAL lets them read while one
+ * of them writes and the busy timeout has the others wait their turn.
+ */
+void initStoreDB(sqlite3 *db) {
+  sqlite3_busy_timeout(db, STORE_BUSY_TIMEOUT_MS);
+  if (sqlite3_exec(db, "PRAGMA journal_mode=WAL;", 0, 0, 0) != SQLITE_OK) {
+    throw unable_to_connect_error("Could not open the shared store in WAL "
+                                  "mode.");
+  }
+
+  int create_result = sqlite3_exec(
+      db,
+      "CREATE TABLE IF NOT EXISTS StoredDigests (device INTEGER NOT NULL, "
+      "inode INTEGER NOT NULL, size INTEGER NOT NULL, modified_ns INTEGER NOT "
+      "NULL, hash BLOB NOT NULL, used INTEGER NOT NULL, PRIMARY KEY (device, "
+      "inode, size, modified_ns));"
+      "CREATE INDEX IF NOT EXISTS StoredDigestsUsed ON StoredDigests (used);",
+      0, 0, 0);
+
+  if (create_result != SQLITE_OK) {
+    throw unable_to_create_table_error(
+        "Could not create the StoredDigests table.");
+  }
+}
+
 /* -------------------------------------------------------------------------- */
 /*                               Table Gateways                               */
 /* -------------------------------------------------------------------------- */
-int fetchLastDirectoryId(sqlite3 *db) {
+row_id fetchLastDirectoryId(sqlite3 *db) {
   sqlite3_stmt *statement;
   // Select last order by id.
   int rc = sqlite3_prepare_v2(
@@ -103,7 +264,7 @@ int fetchLastDirectoryId(sqlite3 *db) {
   int step = sqlite3_step(statement);
 
   if (step == SQLITE_ROW) {
-    int id = sqlite3_column_int(statement, 0);
+    row_id id = sqlite3_column_int64(statement, 0);
     sqlite3_finalize(statement);
     return id;
   }
@@ -117,7 +278,7 @@ int fetchLastDirectoryId(sqlite3 *db) {
   return -1;
 }
 
-directory_table_row::rows fetchAllDirectories(sqlite3 *db) {
+directory_table_row::rows fetchAllDirectories(sqlite3 *db, arena *arena) {
   directory_table_row::rows results{};
 
   sqlite3_stmt *statement;
@@ -129,26 +290,44 @@ directory_table_row::rows fetchAllDirectories(sqlite3 *db) {
         "Could not build the select statement in 'fetchAllDirectories'");
   }
 
+  // Caches from before digests were stored only have the first three
+  // columns.
+  bool has_digests = sqlite3_column_count(statement) > 4;
+  bool has_stamps = sqlite3_column_count(statement) > 5;
   while (sqlite3_step(statement) != SQLITE_DONE) {
+    hash_const directory_hash =
+        has_digests && sqlite3_column_type(statement, 3) != SQLITE_NULL
+            ? arenaHashDup(arena,
+                           (uint8_t *)sqlite3_column_blob(statement, 3))
+            : nullptr;
+
     results.push_back(directory_table_row{
-        .id = sqlite3_column_int(statement, 0),
-        .name = stringDup((const char *)sqlite3_column_text(statement, 1)),
-        .parent_id = sqlite3_column_int(statement, 2)});
+        .id = sqlite3_column_int64(statement, 0),
+        .name = arenaStringDup(arena,
+                               (const char *)sqlite3_column_text(statement, 1)),
+        .parent_id = sqlite3_column_int64(statement, 2),
+        .hash = directory_hash,
+        .size = has_digests ? sqlite3_column_int64(statement, 4) : 0,
+        .modified_ns = has_stamps ? sqlite3_column_int64(statement, 5) : 0});
   }
 
   sqlite3_finalize(statement);
   return results;
 }
 
-int createDirectory(sqlite3 *db, directory_input const &directory_table_input) {
+row_id createDirectory(sqlite3 *db,
+                       directory_input const &directory_table_input) {
   sqlite3_stmt *statement;
   int rc = sqlite3_prepare_v2(
-      db, "INSERT INTO Directories (name, parent_id) VALUES(?, ?);", -1,
-      &statement, 0);
+      db,
+      "INSERT INTO Directories (name, parent_id, modified_ns) VALUES(?, ?, "
+      "?);",
+      -1, &statement, 0);
 
   if (rc == SQLITE_OK) {
     sqlite3_bind_text(statement, 1, directory_table_input.name, -1, 0);
-    sqlite3_bind_int(statement, 2, directory_table_input.parent_id);
+    sqlite3_bind_int64(statement, 2, directory_table_input.parent_id);
+    sqlite3_bind_int64(statement, 3, directory_table_input.modified_ns);
   } else {
     throw unable_to_build_statement_error(
         "Could not build the insert statement in 'createDirectory'.");
@@ -164,7 +343,121 @@ int createDirectory(sqlite3 *db, directory_input const &directory_table_input) {
   throw unable_to_insert_error("Could not insert in 'createDirectory'");
 }
 
-int fetchLastHashId(sqlite3 *db) {
+/**
+ * Stores the digests in a single transaction, reusing one prepared statement
+ * for every row.
+ */
+void updateDirectoryDigests(
+    sqlite3 *db, std::vector<directory_digest_input> const &digest_inputs) {
+  if (digest_inputs.size() == 0) {
+    return;
+  }
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db, "UPDATE Directories SET hash = ?, size = ? WHERE id = ?;", -1,
+      &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the update statement in 'updateDirectoryDigests'.");
+  }
+
+  beginBatchWrite(db, statement, "Could not begin in 'updateDirectoryDigests'");
+  for (directory_digest_input const &digest_input : digest_inputs) {
+    sqlite3_bind_blob(statement, 1, digest_input.hash, MD5_DIGEST_LENGTH, 0);
+    sqlite3_bind_int64(statement, 2, digest_input.size);
+    sqlite3_bind_int64(statement, 3, digest_input.id);
+
+    int step = sqlite3_step(statement);
+    sqlite3_reset(statement);
+
+    if (step != SQLITE_DONE) {
+      sqlite3_finalize(statement);
+      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+      throw unable_to_insert_error(
+          "Could not update in 'updateDirectoryDigests'");
+    }
+  }
+  commitBatchWrite(db, statement,
+                   "Could not commit in 'updateDirectoryDigests'");
+}
+
+/**
+ * Marks the directories as dirty so their digests are recomputed.
+ */
+void clearDirectoryDigests(sqlite3 *db, std::vector<row_id> const &ids) {
+  if (ids.size() == 0) {
+    return;
+  }
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db, "UPDATE Directories SET hash = NULL WHERE id = ?;", -1, &statement,
+      0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the update statement in 'clearDirectoryDigests'.");
+  }
+
+  beginBatchWrite(db, statement, "Could not begin in 'clearDirectoryDigests'");
+  for (row_id id : ids) {
+    sqlite3_bind_int64(statement, 1, id);
+
+    int step = sqlite3_step(statement);
+    sqlite3_reset(statement);
+
+    if (step != SQLITE_DONE) {
+      sqlite3_finalize(statement);
+      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+      throw unable_to_insert_error(
+          "Could not update in 'clearDirectoryDigests'");
+    }
+  }
+  commitBatchWrite(db, statement,
+                   "Could not commit in 'clearDirectoryDigests'");
+}
+
+/**
+ * Records the times the directories were read at in a single transaction.
+ */
+void updateDirectoryStamps(
+    sqlite3 *db, std::vector<directory_stamp_input> const &stamp_inputs) {
+  if (stamp_inputs.size() == 0) {
+    return;
+  }
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db, "UPDATE Directories SET modified_ns = ? WHERE id = ?;", -1,
+      &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the update statement in 'updateDirectoryStamps'.");
+  }
+
+  beginBatchWrite(db, statement, "Could not begin in 'updateDirectoryStamps'");
+  for (directory_stamp_input const &stamp_input : stamp_inputs) {
+    sqlite3_bind_int64(statement, 1, stamp_input.modified_ns);
+    sqlite3_bind_int64(statement, 2, stamp_input.id);
+
+    int step = sqlite3_step(statement);
+    sqlite3_reset(statement);
+
+    if (step != SQLITE_DONE) {
+      sqlite3_finalize(statement);
+      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+      throw unable_to_insert_error(
+          "Could not update in 'updateDirectoryStamps'");
+    }
+  }
+  commitBatchWrite(db, statement,
+                   "Could not commit in 'updateDirectoryStamps'");
+}
+
+row_id fetchLastHashId(sqlite3 *db) {
   sqlite3_stmt *statement;
   // Select last order by id.
   int rc = sqlite3_prepare_v2(
@@ -178,7 +471,7 @@ int fetchLastHashId(sqlite3 *db) {
   int step = sqlite3_step(statement);
 
   if (step == SQLITE_ROW) {
-    int id = sqlite3_column_int(statement, 0);
+    row_id id = sqlite3_column_int64(statement, 0);
     sqlite3_finalize(statement);
     return id;
   }
@@ -192,7 +485,7 @@ int fetchLastHashId(sqlite3 *db) {
   return -1;
 }
 
-hash_table_row::rows fetchAllHashes(sqlite3 *db) {
+hash_table_row::rows fetchAllHashes(sqlite3 *db, arena *arena) {
   hash_table_row::rows results{};
 
   sqlite3_stmt *statement;
@@ -203,32 +496,56 @@ hash_table_row::rows fetchAllHashes(sqlite3 *db) {
         "Could not build the select statement in 'fetchAllHashes'");
   }
 
+  bool has_sizes = sqlite3_column_count(statement) > 4;
+  bool has_stamps = sqlite3_column_count(statement) > 5;
+  bool has_extents = sqlite3_column_count(statement) > 6;
   while (sqlite3_step(statement) != SQLITE_DONE) {
     uint8_t *hash_blob = (uint8_t *)sqlite3_column_blob(statement, 3);
-    uint8_t *hash_buffer = new uint8_t[MD5_DIGEST_LENGTH];
-    std::memcpy(hash_buffer, hash_blob, MD5_DIGEST_LENGTH);
+    hash_const extents_blob =
+        has_extents && sqlite3_column_type(statement, 6) != SQLITE_NULL
+            ? arenaHashDup(arena,
+                           (uint8_t *)sqlite3_column_blob(statement, 6))
+            : nullptr;
 
     results.push_back(hash_table_row{
-        sqlite3_column_int(statement, 0), sqlite3_column_int(statement, 1),
-        stringDup((const char *)sqlite3_column_text(statement, 2)),
-        hash_buffer});
+        sqlite3_column_int64(statement, 0), sqlite3_column_int64(statement, 1),
+        arenaStringDup(arena, (const char *)sqlite3_column_text(statement, 2)),
+        arenaHashDup(arena, hash_blob),
+        has_sizes ? sqlite3_column_int64(statement, 4) : 0,
+        has_stamps ? sqlite3_column_int64(statement, 5) : 0, extents_blob});
   }
 
   sqlite3_finalize(statement);
   return results;
 }
 
-int createHash(sqlite3 *db, hash_input const &hash_table_input) {
+/**
+ * Files whose extents are not known store NULL.
+ */
+void bindExtents(sqlite3_stmt *statement, int index, hash_const extents) {
+  if (extents == nullptr) {
+    sqlite3_bind_null(statement, index);
+    return;
+  }
+  sqlite3_bind_blob(statement, index, extents, MD5_DIGEST_LENGTH, 0);
+}
+
+row_id createHash(sqlite3 *db, hash_input const &hash_table_input) {
   sqlite3_stmt *statement;
   int rc = sqlite3_prepare_v2(
-      db, "INSERT INTO Hashes (directory_id, name, hash) VALUES(?, ?, ?);", -1,
-      &statement, 0);
+      db,
+      "INSERT INTO Hashes (directory_id, name, hash, size, modified_ns, "
+      "extents) VALUES(?, ?, ?, ?, ?, ?);",
+      -1, &statement, 0);
 
   if (rc == SQLITE_OK) {
-    sqlite3_bind_int(statement, 1, hash_table_input.directory_id);
+    sqlite3_bind_int64(statement, 1, hash_table_input.directory_id);
     sqlite3_bind_text(statement, 2, hash_table_input.name, -1, 0);
     sqlite3_bind_blob(statement, 3, hash_table_input.hash, MD5_DIGEST_LENGTH,
                       0);
+    sqlite3_bind_int64(statement, 4, hash_table_input.size);
+    sqlite3_bind_int64(statement, 5, hash_table_input.modified_ns);
+    bindExtents(statement, 6, hash_table_input.extents);
   } else {
     throw unable_to_build_statement_error(
         "Could not build the insert statement in 'createHashes'.");
@@ -244,13 +561,55 @@ int createHash(sqlite3 *db, hash_input const &hash_table_input) {
   throw unable_to_insert_error("Could not insert in 'createHashes'");
 }
 
-void deleteHash(sqlite3 *db, int id) {
+/**
+ * Replaces the digests, sizes, times and extents of files which changed in a
+ * single transaction.
+ */
+void updateHashes(sqlite3 *db,
+                  std::vector<hash_update_input> const &update_inputs) {
+  if (update_inputs.size() == 0) {
+    return;
+  }
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db,
+      "UPDATE Hashes SET hash = ?, size = ?, modified_ns = ?, extents = ? "
+      "WHERE id = ?;",
+      -1, &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the update statement in 'updateHashes'.");
+  }
+
+  beginBatchWrite(db, statement, "Could not begin in 'updateHashes'");
+  for (hash_update_input const &update_input : update_inputs) {
+    sqlite3_bind_blob(statement, 1, update_input.hash, MD5_DIGEST_LENGTH, 0);
+    sqlite3_bind_int64(statement, 2, update_input.size);
+    sqlite3_bind_int64(statement, 3, update_input.modified_ns);
+    bindExtents(statement, 4, update_input.extents);
+    sqlite3_bind_int64(statement, 5, update_input.id);
+
+    int step = sqlite3_step(statement);
+    sqlite3_reset(statement);
+
+    if (step != SQLITE_DONE) {
+      sqlite3_finalize(statement);
+      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+      throw unable_to_insert_error("Could not update in 'updateHashes'");
+    }
+  }
+  commitBatchWrite(db, statement, "Could not commit in 'updateHashes'");
+}
+
+void deleteHash(sqlite3 *db, row_id id) {
   sqlite3_stmt *statement;
   int rc = sqlite3_prepare_v2(db, "DELETE FROM Hashes WHERE id = ?;", -1,
                               &statement, 0);
 
   if (rc == SQLITE_OK) {
-    sqlite3_bind_int(statement, 1, id);
+    sqlite3_bind_int64(statement, 1, id);
   } else {
     throw unable_to_build_statement_error(
         "Could not build the delete statement in 'deleteHash'.");
@@ -326,4 +685,434 @@ void createScanMetaData(sqlite3 *db,
   }
 
   throw unable_to_insert_error("Could not insert in 'createScanMetaData'");
-}
\ No newline at end of file
+}
+verified_group_table_row::rows fetchAllVerifiedGroups(sqlite3 *db,
+                                                      arena *arena) {
+  verified_group_table_row::rows results{};
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(db, "SELECT key FROM VerifiedGroups;", -1,
+                              &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the select statement in 'fetchAllVerifiedGroups'");
+  }
+
+  while (sqlite3_step(statement) == SQLITE_ROW) {
+    results.push_back(verified_group_table_row{
+        .key = arenaHashDup(arena,
+                            (uint8_t *)sqlite3_column_blob(statement, 0))});
+  }
+
+  sqlite3_finalize(statement);
+  return results;
+}
+
+/**
+ * Keys which are already stored are skipped. All of the keys are written in
+ * a single transaction.
+ */
+void createVerifiedGroups(
+    sqlite3 *db, std::vector<verified_group_input> const &verified_inputs) {
+  if (verified_inputs.size() == 0) {
+    return;
+  }
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db, "INSERT OR IGNORE INTO VerifiedGroups (key) VALUES(?);", -1,
+      &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the insert statement in 'createVerifiedGroups'.");
+  }
+
+  beginBatchWrite(db, statement, "Could not begin in 'createVerifiedGroups'");
+  for (verified_group_input const &verified_input : verified_inputs) {
+    sqlite3_bind_blob(statement, 1, verified_input.key, MD5_DIGEST_LENGTH, 0);
+
+    int step = sqlite3_step(statement);
+    sqlite3_reset(statement);
+
+    if (step != SQLITE_DONE) {
+      sqlite3_finalize(statement);
+      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+      throw unable_to_insert_error(
+          "Could not insert in 'createVerifiedGroups'");
+    }
+  }
+  commitBatchWrite(db, statement, "Could not commit in 'createVerifiedGroups'");
+}
+
+prune_journal_table_row::rows fetchPendingPruneJournal(sqlite3 *db,
+                                                       arena *arena) {
+  prune_journal_table_row::rows results{};
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db,
+      "SELECT id, hash_id, path, keeper_path, size, modified_ns, "
+      "keeper_modified_ns, keeper_inode FROM PruneJournal WHERE outcome = 0 "
+      "ORDER BY id;",
+      -1, &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the select statement in 'fetchPendingPruneJournal'");
+  }
+
+  while (sqlite3_step(statement) == SQLITE_ROW) {
+    results.push_back(prune_journal_table_row{
+        .id = sqlite3_column_int64(statement, 0),
+        .hash_id = sqlite3_column_int64(statement, 1),
+        .path = arenaStringDup(arena,
+                               (const char *)sqlite3_column_text(statement, 2)),
+        .keeper_path = arenaStringDup(
+            arena, (const char *)sqlite3_column_text(statement, 3)),
+        .size = sqlite3_column_int64(statement, 4),
+        .modified_ns = sqlite3_column_int64(statement, 5),
+        .keeper_modified_ns = sqlite3_column_int64(statement, 6),
+        .keeper_inode = sqlite3_column_int64(statement, 7)});
+  }
+
+  sqlite3_finalize(statement);
+  return results;
+}
+
+/**
+ * The whole plan is written in a single transaction, an interrupted plan
+ * leaves no journal behind.
+ */
+void createPruneJournal(
+    sqlite3 *db, std::vector<prune_journal_input> const &journal_inputs) {
+  if (journal_inputs.size() == 0) {
+    return;
+  }
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db,
+      "INSERT INTO PruneJournal (hash_id, path, keeper_path, size, "
+      "modified_ns, keeper_modified_ns, keeper_inode) VALUES(?, ?, ?, ?, ?, "
+      "?, ?);",
+      -1, &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the insert statement in 'createPruneJournal'.");
+  }
+
+  beginBatchWrite(db, statement, "Could not begin in 'createPruneJournal'");
+  for (prune_journal_input const &journal_input : journal_inputs) {
+    sqlite3_bind_int64(statement, 1, journal_input.hash_id);
+    sqlite3_bind_text(statement, 2, journal_input.path, -1, 0);
+    sqlite3_bind_text(statement, 3, journal_input.keeper_path, -1, 0);
+    sqlite3_bind_int64(statement, 4, journal_input.size);
+    sqlite3_bind_int64(statement, 5, journal_input.modified_ns);
+    sqlite3_bind_int64(statement, 6, journal_input.keeper_modified_ns);
+    sqlite3_bind_int64(statement, 7, journal_input.keeper_inode);
+
+    int step = sqlite3_step(statement);
+    sqlite3_reset(statement);
+
+    if (step != SQLITE_DONE) {
+      sqlite3_finalize(statement);
+      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+      throw unable_to_insert_error("Could not insert in 'createPruneJournal'");
+    }
+  }
+  commitBatchWrite(db, statement,
+                   "Could not commit in 'createPruneJournal'");
+}
+
+/**
+ * Records the outcomes and then applies them with set based statements, all
+ * in one transaction. The digests of the directories above deleted files are
+ * cleared, the deleted files' hashes are removed and the handled entries
+ * leave the journal.
+ */
+void finishPruneJournal(
+    sqlite3 *db, std::vector<prune_outcome_input> const &outcome_inputs) {
+  if (outcome_inputs.size() == 0) {
+    return;
+  }
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db, "UPDATE PruneJournal SET outcome = ? WHERE id = ?;", -1, &statement,
+      0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the update statement in 'finishPruneJournal'.");
+  }
+
+  beginBatchWrite(db, statement, "Could not begin in 'finishPruneJournal'");
+  for (prune_outcome_input const &outcome_input : outcome_inputs) {
+    sqlite3_bind_int(statement, 1, outcome_input.outcome);
+    sqlite3_bind_int64(statement, 2, outcome_input.id);
+
+    int step = sqlite3_step(statement);
+    sqlite3_reset(statement);
+
+    if (step != SQLITE_DONE) {
+      sqlite3_finalize(statement);
+      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+      throw unable_to_insert_error("Could not update in 'finishPruneJournal'");
+    }
+  }
+  sqlite3_finalize(statement);
+
+  char const *apply_outcomes_stmt =
+      "WITH RECURSIVE Above(id) AS (SELECT directory_id FROM Hashes WHERE id "
+      "IN (SELECT hash_id FROM PruneJournal WHERE outcome = 1) UNION SELECT "
+      "Directories.parent_id FROM Directories JOIN Above ON Directories.id = "
+      "Above.id WHERE Directories.parent_id != -1) UPDATE Directories SET "
+      "hash = NULL WHERE id IN Above;"
+      "DELETE FROM Hashes WHERE id IN (SELECT hash_id FROM PruneJournal WHERE "
+      "outcome = 1);"
+      "DELETE FROM PruneJournal WHERE outcome != 0;";
+  if (sqlite3_exec(db, apply_outcomes_stmt, 0, 0, 0) != SQLITE_OK) {
+    sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+    throw unable_to_delete_error("Could not delete in 'finishPruneJournal'");
+  }
+  commitBatchWrite(db, nullptr, "Could not commit in 'finishPruneJournal'");
+}
+
+/**
+ * Caches built before options were recorded do not have the CacheOptions
+ * table. Those are treated the same as a missing option.
+ */
+cache_option_table_row fetchCacheOption(sqlite3 *db, str_const name) {
+  sqlite3_stmt *statement;
+
+  int rc = sqlite3_prepare_v2(
+      db, "SELECT name, value FROM CacheOptions WHERE name = ? LIMIT 1", -1,
+      &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw not_found_error("Could not find the CacheOptions table in "
+                          "'fetchCacheOption'.");
+  }
+
+  sqlite3_bind_text(statement, 1, name, -1, 0);
+  int step = sqlite3_step(statement);
+
+  if (step == SQLITE_ROW) {
+    cache_option_table_row row{
+        .name = stringDup((const char *)sqlite3_column_text(statement, 0)),
+        .value = stringDup((const char *)sqlite3_column_text(statement, 1))};
+
+    sqlite3_finalize(statement);
+    return row;
+  }
+
+  sqlite3_finalize(statement);
+  if (step == SQLITE_ERROR) {
+    throw unable_to_step_error(
+        "Could not step while building the select statement in "
+        "'fetchCacheOption'.");
+  }
+  throw not_found_error("Could not find a row in 'fetchCacheOption'.");
+}
+
+void createCacheOption(sqlite3 *db,
+                       cache_option_input const &cache_option_input) {
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db, "INSERT OR REPLACE INTO CacheOptions (name, value) VALUES(?, ?);",
+      -1, &statement, 0);
+
+  if (rc == SQLITE_OK) {
+    sqlite3_bind_text(statement, 1, cache_option_input.name, -1, 0);
+    sqlite3_bind_text(statement, 2, cache_option_input.value, -1, 0);
+  } else {
+    throw unable_to_build_statement_error(
+        "Could not build the insert statement in 'createCacheOption'.");
+  }
+
+  int step = sqlite3_step(statement);
+  sqlite3_finalize(statement);
+
+  if (step == SQLITE_DONE) {
+    return;
+  }
+
+  throw unable_to_insert_error("Could not insert in 'createCacheOption'");
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                Digest Store                                */
+/* -------------------------------------------------------------------------- */
+int64_t fetchStoreClock(sqlite3 *db) {
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db, "SELECT COALESCE(MAX(used), 0) FROM StoredDigests;", -1, &statement,
+      0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the select statement in 'fetchStoreClock'.");
+  }
+
+  int step = sqlite3_step(statement);
+  int64_t clock = step == SQLITE_ROW ? sqlite3_column_int64(statement, 0) : 0;
+  sqlite3_finalize(statement);
+
+  if (step != SQLITE_ROW) {
+    throw unable_to_step_error("Could not step in 'fetchStoreClock'.");
+  }
+  return clock;
+}
+
+bool fetchStoredDigest(sqlite3 *db, stored_digest_key const &key,
+                       uint8_t *hash) {
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db,
+      "SELECT hash FROM StoredDigests WHERE device = ? AND inode = ? AND "
+      "size = ? AND modified_ns = ?;",
+      -1, &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the select statement in 'fetchStoredDigest'.");
+  }
+
+  sqlite3_bind_int64(statement, 1, key.device);
+  sqlite3_bind_int64(statement, 2, key.inode);
+  sqlite3_bind_int64(statement, 3, key.size);
+  sqlite3_bind_int64(statement, 4, key.modified_ns);
+  int step = sqlite3_step(statement);
+
+  bool found = step == SQLITE_ROW &&
+               sqlite3_column_bytes(statement, 0) == MD5_DIGEST_LENGTH;
+  if (found) {
+    memcpy(hash, sqlite3_column_blob(statement, 0), MD5_DIGEST_LENGTH);
+  }
+  sqlite3_finalize(statement);
+  return found;
+}
+
+/**
+ * Takes the store's write lock up front so a batch never runs outside its
+ * transaction. BEGIN waits out another run's batch for the busy timeout, a
+ * lock still held after that is an error like any other.
+ */
+void beginStoreWrite(sqlite3 *db, sqlite3_stmt *statement,
+                     char const *message) {
+  beginBatchWrite(db, statement, message, "BEGIN IMMEDIATE TRANSACTION;");
+}
+
+/**
+ * Inserts or replaces the digests in a single transaction.
+ */
+void createStoredDigests(sqlite3 *db,
+                         std::vector<stored_digest_input> const &inputs) {
+  if (inputs.size() == 0) {
+    return;
+  }
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db,
+      "INSERT OR REPLACE INTO StoredDigests (device, inode, size, "
+      "modified_ns, hash, used) VALUES(?, ?, ?, ?, ?, ?);",
+      -1, &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the insert statement in 'createStoredDigests'.");
+  }
+
+  beginStoreWrite(db, statement,
+                  "Could not lock the shared store in 'createStoredDigests'");
+  for (stored_digest_input const &input : inputs) {
+    sqlite3_bind_int64(statement, 1, input.key.device);
+    sqlite3_bind_int64(statement, 2, input.key.inode);
+    sqlite3_bind_int64(statement, 3, input.key.size);
+    sqlite3_bind_int64(statement, 4, input.key.modified_ns);
+    sqlite3_bind_blob(statement, 5, input.hash, MD5_DIGEST_LENGTH, 0);
+    sqlite3_bind_int64(statement, 6, input.used);
+
+    int step = sqlite3_step(statement);
+    sqlite3_reset(statement);
+
+    if (step != SQLITE_DONE) {
+      sqlite3_finalize(statement);
+      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+      throw unable_to_insert_error(
+          "Could not insert in 'createStoredDigests'");
+    }
+  }
+  commitBatchWrite(db, statement,
+                   "Could not commit in 'createStoredDigests'");
+}
+
+void touchStoredDigests(sqlite3 *db, std::vector<stored_digest_key> const &keys,
+                        int64_t used) {
+  if (keys.size() == 0) {
+    return;
+  }
+
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db,
+      "UPDATE StoredDigests SET used = ? WHERE device = ? AND inode = ? AND "
+      "size = ? AND modified_ns = ?;",
+      -1, &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the update statement in 'touchStoredDigests'.");
+  }
+
+  beginStoreWrite(db, statement,
+                  "Could not lock the shared store in 'touchStoredDigests'");
+  for (stored_digest_key const &key : keys) {
+    sqlite3_bind_int64(statement, 1, used);
+    sqlite3_bind_int64(statement, 2, key.device);
+    sqlite3_bind_int64(statement, 3, key.inode);
+    sqlite3_bind_int64(statement, 4, key.size);
+    sqlite3_bind_int64(statement, 5, key.modified_ns);
+
+    int step = sqlite3_step(statement);
+    sqlite3_reset(statement);
+
+    if (step != SQLITE_DONE) {
+      sqlite3_finalize(statement);
+      sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+      throw unable_to_insert_error("Could not update in 'touchStoredDigests'");
+    }
+  }
+  commitBatchWrite(db, statement, "Could not commit in 'touchStoredDigests'");
+}
+
+/**
+ * Deletes the least recently used digests until at most max_entries are
+ * left.
+ */
+void evictStoredDigests(sqlite3 *db, std::size_t max_entries) {
+  sqlite3_stmt *statement;
+  int rc = sqlite3_prepare_v2(
+      db,
+      "DELETE FROM StoredDigests WHERE rowid IN (SELECT rowid FROM "
+      "StoredDigests ORDER BY used LIMIT MAX((SELECT COUNT(*) FROM "
+      "StoredDigests) - ?, 0));",
+      -1, &statement, 0);
+
+  if (rc != SQLITE_OK) {
+    throw unable_to_build_statement_error(
+        "Could not build the delete statement in 'evictStoredDigests'.");
+  }
+
+  sqlite3_bind_int64(statement, 1, static_cast<int64_t>(max_entries));
+  int step = sqlite3_step(statement);
+  sqlite3_finalize(statement);
+
+  if (step != SQLITE_DONE) {
+    throw unable_to_delete_error("Could not delete in 'evictStoredDigests'");
+  }
+}
@@ -2,9 +2,11 @@
 
 #include <sqlite3.h>
 
+#include <cstdint>
 #include <stdexcept>
 #include <vector>
 
+#include "../arena/arena.h"
 #include "../lib.h"
 
 /* -------------------------------------------------------------------------- */
@@ -12,17 +14,26 @@
 /* -------------------------------------------------------------------------- */
 sqlite3 *initDB(char const *const file_name);
 void resetDB(sqlite3 *db);
+void upgradeDB(sqlite3 *db);
 void freeDB(sqlite3 *db_handle);
+void initStoreDB(sqlite3 *db);
+void beginTransaction(sqlite3 *db);
+void commitTransaction(sqlite3 *db);
 
 /* -------------------------------------------------------------------------- */
 /*                               Table Gateways                               */
 /* -------------------------------------------------------------------------- */
+typedef int64_t row_id; // SQLite rowids are 64-bit.
+
 struct directory_table_row {
   typedef std::vector<directory_table_row> rows;
 
-  int id;
+  row_id id;
   str_const name;
-  int parent_id;
+  row_id parent_id;
+  hash_const hash;     // Digest of the directory, nullptr when it is dirty.
+  int64_t size;        // Bytes of all the files under the directory.
+  int64_t modified_ns; // See NOT_SCANNED_MODIFIED_NS below.
 
   bool operator==(const directory_table_row &rhs) const;
 };
@@ -31,10 +42,13 @@ typedef directory_table_row const directory_table_row_const;
 
 struct hash_table_row {
   typedef std::vector<hash_table_row> rows;
-  int id;
-  int const directory_id;
+  row_id id;
+  row_id const directory_id;
   str_const name;
   hash_const hash;
+  int64_t size;
+  int64_t modified_ns; // Zero when the cache is older than the column.
+  hash_const extents;  // See fingerprintExtents, nullptr when unknown.
 
   bool operator==(hash_table_row const &rhs) const;
 };
@@ -47,38 +61,210 @@ struct scan_meta_data_table_row {
   bool operator==(scan_meta_data_table_row const &rhs) const;
 };
 
+struct verified_group_table_row {
+  typedef std::vector<verified_group_table_row> rows;
+
+  hash_const key;
+
+  bool operator==(verified_group_table_row const &rhs) const;
+};
+
+struct cache_option_table_row {
+  str_const name;
+  str_const value;
+
+  bool operator==(cache_option_table_row const &rhs) const;
+};
+
+/**
+ * A file prune planned to delete, with the size and modification time it had
+ * when it was planned and the path of the file which is kept in its place.
+ * Outcome is pending until the file has been handled.
+ */
+enum prune_outcome {
+  PRUNE_OUTCOME_PENDING,
+  PRUNE_OUTCOME_DELETED,
+  PRUNE_OUTCOME_KEPT
+};
+
+struct prune_journal_table_row {
+  typedef std::vector<prune_journal_table_row> rows;
+
+  row_id id;
+  row_id hash_id;
+  str_const path;
+  str_const keeper_path;
+  int64_t size;
+  int64_t modified_ns;
+  int64_t keeper_modified_ns;
+  int64_t keeper_inode;
+
+  bool operator==(prune_journal_table_row const &rhs) const;
+};
+
 struct directory_input {
-  int const parent_id;
+  row_id const parent_id;
   str_const name;
+  int64_t modified_ns;
 
   bool operator==(directory_input const &rhs) const;
 };
 
 struct hash_input {
-  int const directory_id;
+  row_id const directory_id;
   str_const name;
   hash_const hash;
+  int64_t size;
+  int64_t modified_ns;
+  hash_const extents;
 
   bool operator==(hash_input const &rhs) const;
 };
 
+struct directory_digest_input {
+  row_id id;
+  hash_const hash;
+  int64_t size;
+
+  bool operator==(directory_digest_input const &rhs) const;
+};
+
+struct hash_update_input {
+  row_id id;
+  hash_const hash;
+  int64_t size;
+  int64_t modified_ns;
+  hash_const extents;
+
+  bool operator==(hash_update_input const &rhs) const;
+};
+
+struct directory_stamp_input {
+  row_id id;
+  int64_t modified_ns;
+
+  bool operator==(directory_stamp_input const &rhs) const;
+};
+
 struct scan_meta_data_input {
   str_const root_dir;
 
   bool operator==(scan_meta_data_input const &rhs) const;
 };
 
-directory_table_row::rows fetchAllDirectories(sqlite3 *db);
-int createDirectory(sqlite3 *db, directory_input const &directory_table_input);
+struct verified_group_input {
+  hash_const key;
 
-hash_table_row::rows fetchAllHashes(sqlite3 *db);
-int createHash(sqlite3 *db, hash_input const &hash_table_input);
-void deleteHash(sqlite3 *db, int id);
+  bool operator==(verified_group_input const &rhs) const;
+};
+
+struct cache_option_input {
+  str_const name;
+  str_const value;
+
+  bool operator==(cache_option_input const &rhs) const;
+};
+
+struct prune_journal_input {
+  row_id hash_id;
+  str_const path;
+  str_const keeper_path;
+  int64_t size;
+  int64_t modified_ns;
+  int64_t keeper_modified_ns;
+  int64_t keeper_inode;
+
+  bool operator==(prune_journal_input const &rhs) const;
+};
+
+struct prune_outcome_input {
+  row_id id;
+  prune_outcome outcome;
+
+  bool operator==(prune_outcome_input const &rhs) const;
+};
+
+/**
+ * A digest in the store shared by every cache, keyed by where the file lives
+ * and what it looked like when it was hashed. Used is the clock of the last
+ * run which read or wrote the digest, the lowest go first when evicting.
+ */
+struct stored_digest_key {
+  int64_t device;
+  int64_t inode;
+  int64_t size;
+  int64_t modified_ns;
+
+  bool operator==(stored_digest_key const &rhs) const;
+};
+
+struct stored_digest_input {
+  stored_digest_key key;
+  hash_const hash;
+  int64_t used;
+
+  bool operator==(stored_digest_input const &rhs) const;
+};
+
+/**
+ * The modification time of a directory as it was when its entries were last
+ * read. Directories above the scanned paths were never read in full so they
+ * are marked as not scanned, zero means the cache is older than the column.
+ */
+constexpr int64_t NOT_SCANNED_MODIFIED_NS = -1;
+
+// Options the cache was built with which change how it has to be read.
+constexpr char DIGEST_NAMES_OPTION[] = "digest_names";
+// Set while files of the cache may hold lockstep placeholders, see lib.h.
+constexpr char LOCKSTEP_PLACEHOLDERS_OPTION[] = "lockstep_placeholders";
+
+// How long a run waits for another one writing to the shared store.
+constexpr int STORE_BUSY_TIMEOUT_MS = 30000;
+
+directory_table_row::rows fetchAllDirectories(sqlite3 *db, arena *arena);
+row_id createDirectory(sqlite3 *db,
+                       directory_input const &directory_table_input);
+void updateDirectoryDigests(
+    sqlite3 *db, std::vector<directory_digest_input> const &digest_inputs);
+void clearDirectoryDigests(sqlite3 *db, std::vector<row_id> const &ids);
+void updateDirectoryStamps(
+    sqlite3 *db, std::vector<directory_stamp_input> const &stamp_inputs);
+
+hash_table_row::rows fetchAllHashes(sqlite3 *db, arena *arena);
+row_id createHash(sqlite3 *db, hash_input const &hash_table_input);
+void updateHashes(sqlite3 *db,
+                  std::vector<hash_update_input> const &update_inputs);
+void deleteHash(sqlite3 *db, row_id id);
 
 scan_meta_data_table_row fetchScanMetaData(sqlite3 *db);
 void createScanMetaData(sqlite3 *db,
                         scan_meta_data_input const &scan_meta_data_input);
 
+verified_group_table_row::rows fetchAllVerifiedGroups(sqlite3 *db,
+                                                      arena *arena);
+void createVerifiedGroups(
+    sqlite3 *db, std::vector<verified_group_input> const &verified_inputs);
+
+prune_journal_table_row::rows fetchPendingPruneJournal(sqlite3 *db,
+                                                       arena *arena);
+void createPruneJournal(sqlite3 *db,
+                        std::vector<prune_journal_input> const &journal_inputs);
+void finishPruneJournal(
+    sqlite3 *db, std::vector<prune_outcome_input> const &outcome_inputs);
+
+cache_option_table_row fetchCacheOption(sqlite3 *db, str_const name);
+void createCacheOption(sqlite3 *db,
+                       cache_option_input const &cache_option_input);
+
+int64_t fetchStoreClock(sqlite3 *db);
+bool fetchStoredDigest(sqlite3 *db, stored_digest_key const &key,
+                       uint8_t *hash);
+void createStoredDigests(sqlite3 *db,
+                         std::vector<stored_digest_input> const &inputs);
+void touchStoredDigests(sqlite3 *db, std::vector<stored_digest_key> const &keys,
+                        int64_t used);
+void evictStoredDigests(sqlite3 *db, std::size_t max_entries);
+
 /* -------------------------------------------------------------------------- */
 /*                                   Errors                                   */
 /* -------------------------------------------------------------------------- */
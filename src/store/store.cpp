@@ -0,0 +1,217 @@
+#include "./store.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+stored_digest_key storedDigestKey(file_stamp const &stamp) {
+  return {.device = stamp.device,
+          .inode = stamp.inode,
+          .size = stamp.size,
+          .modified_ns = stamp.modified_ns};
+}
+
+/**
+ * "md5:<size>:<modified_ns>:<hex digest>", text so it reads well in
+ * getfattr.
+ */
+std::string formatDigestAttribute(uint8_t const *hash,
+                                  file_stamp const &stamp) {
+  std::string value = std::string(DIGEST_ATTRIBUTE_ENGINE) + ":" +
+                      std::to_string(stamp.size) + ":" +
+                      std::to_string(stamp.modified_ns) + ":";
+  for (std::size_t i = 0; i < MD5_DIGEST_LENGTH; ++i) {
+    value += HEX_DIGITS[hash[i] >> 4];
+    value += HEX_DIGITS[hash[i] & 0x0f];
+  }
+  return value;
+}
+
+int hexValue(char character) {
+  if (character >= '0' && character <= '9') {
+    return character - '0';
+  }
+  if (character >= 'a' && character <= 'f') {
+    return character - 'a' + 10;
+  }
+  return -1;
+}
+
+/**
+ * False for another engine, a malformed value, or a file which changed since
+ * the attribute was written.
+ */
+bool parseDigestAttribute(std::string const &value, file_stamp const &stamp,
+                          uint8_t *hash) {
+  char engine[8];
+  int64_t size = 0;
+  int64_t modified_ns = 0;
+  int hex_start = 0;
+  if (sscanf(value.c_str(), "%7[^:]:%" SCNd64 ":%" SCNd64 ":%n", engine, &size,
+             &modified_ns, &hex_start) != 3 ||
+      hex_start == 0 || !compareStrings(engine, DIGEST_ATTRIBUTE_ENGINE) ||
+      size != stamp.size || modified_ns != stamp.modified_ns ||
+      value.size() !=
+          static_cast<std::size_t>(hex_start) + MD5_DIGEST_LENGTH * 2) {
+    return false;
+  }
+
+  uint8_t parsed[MD5_DIGEST_LENGTH];
+  for (std::size_t i = 0; i < MD5_DIGEST_LENGTH; ++i) {
+    int high = hexValue(value[hex_start + i * 2]);
+    int low = hexValue(value[hex_start + i * 2 + 1]);
+    if (high == -1 || low == -1) {
+      return false;
+    }
+    parsed[i] = static_cast<uint8_t>(high << 4 | low);
+  }
+  std::copy(parsed, parsed + MD5_DIGEST_LENGTH, hash);
+  return true;
+}
+
+/**
+ * Nothing to reuse digests from without the shared store or attributes, the
+ * store is nullptr then. Zero max entries keeps the default.
+ */
+digest_store *initDigestStore(std::string const &store_path, bool attributes,
+                              std::size_t max_entries) {
+  if (store_path.empty() && !attributes) {
+    return nullptr;
+  }
+
+  sqlite3 *db = nullptr;
+  int64_t clock = 0;
+  if (!store_path.empty()) {
+    db = initDB(store_path.c_str());
+    initStoreDB(db);
+    clock = fetchStoreClock(db) + 1;
+  }
+  return new digest_store{.db = db,
+                          .attributes = attributes,
+                          .max_entries = max_entries == 0
+                                             ? STORE_DEFAULT_MAX_ENTRIES
+                                             : max_entries,
+                          .clock = clock,
+                          .read_keys = {},
+                          .pending_digests = {},
+                          .digests_read = 0,
+                          .digests_written = 0,
+                          .attributes_read = 0,
+                          .attributes_written = 0};
+}
+
+bool readStoredAttribute(digest_store *store, uint8_t *hash,
+                         std::string const &path, file_stamp const &stamp) {
+  std::string value{};
+  if (!store->attributes ||
+      !readAttribute(path, DIGEST_ATTRIBUTE_NAME, value) ||
+      !parseDigestAttribute(value, stamp, hash)) {
+    return false;
+  }
+
+  ++store->attributes_read;
+  return true;
+}
+
+// Files which can not be written to keep being looked up and hashed.
+void writeStoredAttribute(digest_store *store, uint8_t const *hash,
+                          std::string const &path, file_stamp const &stamp) {
+  if (store->attributes &&
+      writeAttribute(path, DIGEST_ATTRIBUTE_NAME,
+                     formatDigestAttribute(hash, stamp))) {
+    ++store->attributes_written;
+  }
+}
+
+/**
+ * Same as extractHash, but the digest comes from the file's attribute or the
+ * store when the file has not changed since it was kept there. Without a
+ * store the file is always read. True when the file was read for its digest.
+ */
+bool extractStoredHash(digest_store *store, uint8_t *hash,
+                       std::string const &path, file_stamp const &stamp) {
+  if (store == nullptr) {
+    extractHash(hash, path);
+    return true;
+  }
+
+  if (readStoredAttribute(store, hash, path, stamp)) {
+    return false;
+  }
+
+  bool read_file = false;
+  stored_digest_key key = storedDigestKey(stamp);
+  if (store->db != nullptr && fetchStoredDigest(store->db, key, hash)) {
+    store->read_keys.push_back(key);
+    ++store->digests_read;
+  } else {
+    extractHash(hash, path);
+    read_file = true;
+    if (store->db != nullptr) {
+      pending_digest pending{.key = key, .hash = {}};
+      std::copy(hash, hash + MD5_DIGEST_LENGTH, pending.hash.bytes);
+      store->pending_digests.push_back(pending);
+      ++store->digests_written;
+    }
+  }
+  writeStoredAttribute(store, hash, path, stamp);
+
+  if (store->read_keys.size() + store->pending_digests.size() >=
+      STORE_BATCH_SIZE) {
+    flushDigestStore(store);
+  }
+  return read_file;
+}
+
+/**
+ * Writes what was hashed and marks what was read, each in one transaction so
+ * other runs only wait on the store once a batch.
+ */
+void flushDigestStore(digest_store *store) {
+  if (store->db == nullptr) {
+    return;
+  }
+
+  std::vector<stored_digest_input> inputs{};
+  inputs.reserve(store->pending_digests.size());
+  for (pending_digest const &pending : store->pending_digests) {
+    inputs.push_back(
+        {.key = pending.key, .hash = pending.hash.bytes, .used = store->clock});
+  }
+  createStoredDigests(store->db, inputs);
+  touchStoredDigests(store->db, store->read_keys, store->clock);
+  store->pending_digests.clear();
+  store->read_keys.clear();
+}
+
+void printDigestStoreStats(digest_store const *store, std::ostream &console) {
+  if (store == nullptr) {
+    return;
+  }
+
+  if (store->db != nullptr) {
+    console << "Read " << store->digests_read
+            << " digests from the shared store and wrote "
+            << store->digests_written << " to it.\n";
+  }
+  if (store->attributes) {
+    console << "Read " << store->attributes_read
+            << " digests from extended attributes and wrote "
+            << store->attributes_written << ".\n";
+  }
+}
+
+void freeDigestStore(digest_store *store) {
+  if (store == nullptr) {
+    return;
+  }
+
+  if (store->db != nullptr) {
+    flushDigestStore(store);
+    evictStoredDigests(store->db, store->max_entries);
+    freeDB(store->db);
+  }
+  delete store;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../fs/file_system.h"
+#include "../sqlite/sqlite.h"
+
+/**
+ * A store of file digests shared by every cache, so a file which is in more
+ * than one cache is only hashed once. Digests are keyed by the device and
+ * inode of the file along with its size and modification time, a file which
+ * changes gets a new key. The store is its own SQLite file in WAL mode so
+ * builds of different caches can use it at the same time.
+ *
+ * Runs read the store as they go and write what they hashed a batch at a
+ * time. Every run has a clock one past the last run's, digests read or
+ * written are marked with it and the ones with the oldest mark are evicted
+ * once the store holds more than max_entries, STORE_DEFAULT_MAX_ENTRIES
+ * unless --store-max-entries says otherwise. At about 100 bytes an entry the
+ * default keeps the store near 200 MiB.
+ *
+ * Digests can also be kept on the files themselves in the user.ddupes.digest
+ * extended attribute, along with the engine and the size and modification
+ * time the file had when it was hashed. The attribute is read before the
+ * store and only trusted while the file still has that size and time. Since
+ * it travels with the file it survives copies which keep attributes and
+ * times, rsync -X -t for one, and caches being wiped.
+ */
+constexpr std::size_t STORE_DEFAULT_MAX_ENTRIES = 1 << 21;
+constexpr std::size_t STORE_BATCH_SIZE = 4096;
+constexpr char DIGEST_ATTRIBUTE_NAME[] = "user.ddupes.digest";
+constexpr char DIGEST_ATTRIBUTE_ENGINE[] = "md5";
+
+struct pending_digest {
+  stored_digest_key key;
+  digest hash;
+};
+
+struct digest_store {
+  sqlite3 *db; // nullptr without the shared store.
+  bool attributes;
+  std::size_t max_entries;
+  int64_t clock;
+  std::vector<stored_digest_key> read_keys;
+  std::vector<pending_digest> pending_digests;
+  std::size_t digests_read;
+  std::size_t digests_written;
+  std::size_t attributes_read;
+  std::size_t attributes_written;
+};
+
+std::string formatDigestAttribute(uint8_t const *hash,
+                                  file_stamp const &stamp);
+bool parseDigestAttribute(std::string const &value, file_stamp const &stamp,
+                          uint8_t *hash);
+digest_store *initDigestStore(std::string const &store_path, bool attributes,
+                              std::size_t max_entries);
+bool extractStoredHash(digest_store *store, uint8_t *hash,
+                       std::string const &path, file_stamp const &stamp);
+void flushDigestStore(digest_store *store);
+void printDigestStoreStats(digest_store const *store, std::ostream &console);
+void freeDigestStore(digest_store *store);
@@ -0,0 +1,50 @@
+#include "./parallel.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+std::size_t thread_count_override = 0;
+
+void setThreadCount(std::size_t threads) { thread_count_override = threads; }
+
+std::size_t threadCount() {
+  if (thread_count_override != 0) {
+    return thread_count_override;
+  }
+
+  std::size_t hardware_threads = std::thread::hardware_concurrency();
+  return hardware_threads == 0 ? 1 : hardware_threads;
+}
+
+void parallelFor(std::size_t begin, std::size_t end, parallel_body body,
+                 void *context, std::size_t min_chunk) {
+  if (begin >= end) {
+    return;
+  }
+
+  std::size_t length = end - begin;
+  std::size_t max_chunks = length / std::max<std::size_t>(min_chunk, 1);
+  std::size_t chunks = std::min(threadCount(), max_chunks);
+  if (chunks <= 1) {
+    // Not worth the cost of starting a thread.
+    body(begin, end, context);
+    return;
+  }
+
+  std::size_t chunk_size = (length + chunks - 1) / chunks;
+  std::vector<std::thread> workers{};
+  workers.reserve(chunks - 1);
+
+  for (std::size_t chunk_begin = begin + chunk_size; chunk_begin < end;
+       chunk_begin += chunk_size) {
+    std::size_t chunk_end = std::min(chunk_begin + chunk_size, end);
+    workers.emplace_back(body, chunk_begin, chunk_end, context);
+  }
+
+  body(begin, std::min(begin + chunk_size, end), context);
+
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
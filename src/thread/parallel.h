@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Minimal fork/join helper. The range [begin, end) is split into one
+ * contiguous chunk per thread and the calling thread works on the first
+ * chunk. The body must not throw.
+ */
+constexpr std::size_t PARALLEL_MIN_CHUNK = 4096;
+
+typedef void (*parallel_body)(std::size_t begin, std::size_t end,
+                              void *context);
+
+// Zero uses one thread per hardware thread.
+void setThreadCount(std::size_t threads);
+std::size_t threadCount();
+void parallelFor(std::size_t begin, std::size_t end, parallel_body body,
+                 void *context, std::size_t min_chunk = PARALLEL_MIN_CHUNK);
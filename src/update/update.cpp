@@ -1,19 +1,25 @@
 #include "./update.h"
 
+#include <algorithm>
+#include <string_view>
+
+#include "../thread/parallel.h"
+
 /**
  * - Extract from the cache.
  * - Build hash map from directories id's to the directory_row (same as dupes
  * command)
- * - Loop over all the files. Build the path and tack on the meta data path root
- * thing.
- * - Check if the file exists. If it does not remove it from the cache using the
- * id.
+ * - Build the path of every directory once and group the files by directory.
+ * - List every directory once, across threads, and look the files up in the
+ * listing. Files which are not in it are removed from the cache using the id.
  * - Loop over all the directories. Build the path.
  * - Check if the directory exists. If it does not remove it from the cache
  * using the id. This does not need to be in order. If any child directory is
  * checked after a parent directory it would automatically be removed.
  * - Record the amount of directories and hashes were removed. Print these to
  * the console.
+ * - Clear the persisted digest of every directory above a removed file so the
+ * next dupes run folds those directories again.
  */
 
 typedef directory_table_row_const **parent_directory_map;
@@ -32,59 +38,656 @@ buildDirectoryRowMap(directory_table_row::rows const &directory_table_rows) {
   return map;
 }
 
-std::string buildRelativePath(hash_table_row const &hash_row,
-                              parent_directory_map_const directory_map) {
+/**
+ * The path of every directory by its id, each built once from its parent's.
+ * Index zero is the root directory, which holds the rows without a parent.
+ */
+std::vector<std::string>
+buildDirectoryPaths(directory_table_row::rows const &directory_table_rows,
+                    parent_directory_map_const directory_map,
+                    str_const root_dir) {
+  std::vector<std::string> directory_paths(directory_table_rows.size() + 1);
+  std::vector<bool> resolved(directory_table_rows.size() + 1, false);
+  directory_paths[0] = root_dir;
+  resolved[0] = true;
+
+  std::vector<row_id> unresolved{};
+  for (directory_table_row const &row : directory_table_rows) {
+    for (row_id id = row.id; !resolved[id];
+         id = std::max<row_id>(directory_map[id]->parent_id, 0)) {
+      unresolved.push_back(id);
+    }
+
+    // Parents are resolved before their children.
+    for (; unresolved.size() != 0; unresolved.pop_back()) {
+      directory_table_row_const &directory = *directory_map[unresolved.back()];
+      directory_paths[directory.id] = joinPath(
+          {directory_paths[std::max<row_id>(directory.parent_id, 0)],
+           directory.name});
+      resolved[directory.id] = true;
+    }
+  }
+
+  return directory_paths;
+}
+
+/**
+ * Rows grouped by the directory they are in as a run of indices into the
+ * rows, indices[offsets[d]] .. indices[offsets[d + 1]]. Runs keep the order
+ * of the rows.
+ */
+struct directory_buckets {
+  std::vector<std::size_t> offsets;
+  std::vector<std::size_t> indices;
+};
 
-  std::vector<std::string> path_segments{hash_row.name};
+directory_buckets groupByDirectory(std::vector<row_id> const &directory_ids,
+                                   std::size_t num_of_directories) {
+  directory_buckets buckets{};
+  buckets.offsets.resize(num_of_directories + 2, 0);
+  buckets.indices.resize(directory_ids.size());
+  for (row_id directory_id : directory_ids) {
+    ++buckets.offsets[std::max<row_id>(directory_id, 0) + 1];
+  }
+  for (std::size_t i = 1; i < buckets.offsets.size(); ++i) {
+    buckets.offsets[i] += buckets.offsets[i - 1];
+  }
 
-  int parent_directory_id = hash_row.directory_id;
-  while (parent_directory_id != -1) {
-    directory_table_row_const &parent_row = *directory_map[parent_directory_id];
-    path_segments.insert(path_segments.begin(), parent_row.name);
-    parent_directory_id = parent_row.parent_id;
+  std::vector<std::size_t> next(buckets.offsets.begin(),
+                                buckets.offsets.end() - 1);
+  for (std::size_t i = 0; i < directory_ids.size(); ++i) {
+    buckets.indices[next[std::max<row_id>(directory_ids[i], 0)]++] = i;
   }
+  return buckets;
+}
 
-  return joinPath(path_segments);
+directory_buckets groupFilesByDirectory(hash_table_row::rows const &hashes,
+                                        std::size_t num_of_directories) {
+  std::vector<row_id> directory_ids{};
+  directory_ids.reserve(hashes.size());
+  for (hash_table_row const &hash_row : hashes) {
+    directory_ids.push_back(hash_row.directory_id);
+  }
+  return groupByDirectory(directory_ids, num_of_directories);
 }
 
-std::vector<int>
+directory_buckets groupDirectoriesByParent(
+    directory_table_row::rows const &directory_table_rows) {
+  std::vector<row_id> parent_ids{};
+  parent_ids.reserve(directory_table_rows.size());
+  for (directory_table_row const &row : directory_table_rows) {
+    parent_ids.push_back(row.parent_id);
+  }
+  return groupByDirectory(parent_ids, directory_table_rows.size());
+}
+
+struct existence_context {
+  hash_table_row::rows const *hashes;
+  directory_buckets const *files;
+  std::vector<std::string> const *directory_paths;
+  std::vector<char> *missing;
+};
+
+/**
+ * A directory which is gone takes all of its files with it. The files of a
+ * directory which can not be read are kept since there is no telling.
+ */
+void checkDirectories(std::size_t begin, std::size_t end, void *context) {
+  existence_context *existence = static_cast<existence_context *>(context);
+  directory_buckets const &files = *existence->files;
+  std::vector<std::string> names{};
+
+  for (std::size_t directory = begin; directory < end; ++directory) {
+    if (files.offsets[directory] == files.offsets[directory + 1]) {
+      continue;
+    }
+
+    names.clear();
+    directory_listing listing =
+        listDirectory((*existence->directory_paths)[directory], names);
+    if (listing == DIRECTORY_LISTING_UNREADABLE) {
+      continue;
+    }
+    std::sort(names.begin(), names.end());
+
+    for (std::size_t i = files.offsets[directory];
+         i < files.offsets[directory + 1]; ++i) {
+      std::size_t hash_index = files.indices[i];
+      (*existence->missing)[hash_index] =
+          listing == DIRECTORY_LISTING_MISSING ||
+          !std::binary_search(
+              names.begin(), names.end(),
+              std::string_view((*existence->hashes)[hash_index].name));
+    }
+  }
+}
+
+/**
+ * Files are checked a directory at a time against a single listing of it,
+ * with the directories spread across threads. The ids come back in the
+ * order of the hashes.
+ */
+std::vector<row_id>
 determineHashesToDelete(hash_table_row::rows const &hashes,
+                        directory_table_row::rows const &directory_table_rows,
                         parent_directory_map_const &directory_map,
                         str_const root_dir) {
-  std::vector<int> hash_ids_to_remove{};
-  std::string absolute_path{root_dir};
+  std::vector<std::string> directory_paths =
+      buildDirectoryPaths(directory_table_rows, directory_map, root_dir);
+  directory_buckets files =
+      groupFilesByDirectory(hashes, directory_table_rows.size());
+  std::vector<char> missing(hashes.size(), false);
+
+  existence_context context{&hashes, &files, &directory_paths, &missing};
+  parallelFor(0, directory_paths.size(), checkDirectories, &context, 1);
+
+  std::vector<row_id> hash_ids_to_remove{};
+  for (std::size_t i = 0; i < hashes.size(); ++i) {
+    if (missing[i]) {
+      hash_ids_to_remove.push_back(hashes[i].id);
+    }
+  }
+  return hash_ids_to_remove;
+}
+
+/**
+ * What a rescan found for a cached file. Files of an older cache have no
+ * time yet, they only get one stored unless their size changed.
+ */
+enum rescan_file {
+  RESCAN_FILE_UNCHANGED,
+  RESCAN_FILE_MISSING,
+  RESCAN_FILE_MODIFIED,
+  RESCAN_FILE_RESTAMPED
+};
+
+/**
+ * A directory is listed when its time changed, the stamp is taken before
+ * the listing so a change made while it is read is found by the next rescan.
+ */
+struct directory_rescan {
+  bool listed;
+  file_stamp stamp;
+  std::vector<std::string> new_names;
+};
+
+struct rescan_stats {
+  std::size_t directories_listed;
+  std::size_t directories_added;
+  std::size_t files_added;
+  std::size_t files_hashed;
+
+  bool operator==(rescan_stats const &rhs) const;
+};
+
+struct rescan_context {
+  hash_table_row::rows const *hashes;
+  directory_table_row::rows const *directory_table_rows;
+  parent_directory_map_const directory_map;
+  directory_buckets const *files;
+  directory_buckets const *children;
+  std::vector<std::string> const *directory_paths;
+  std::vector<directory_rescan> *rescans;
+  std::vector<rescan_file> *file_results;
+  std::vector<file_stamp> *file_stamps;
+};
+
+bool rescan_stats::operator==(rescan_stats const &rhs) const {
+  return rhs.directories_listed == directories_listed &&
+         rhs.directories_added == directories_added &&
+         rhs.files_added == files_added && rhs.files_hashed == files_hashed;
+}
+
+void markFiles(rescan_context *rescan, std::size_t directory,
+               rescan_file result) {
+  directory_buckets const &files = *rescan->files;
+  for (std::size_t i = files.offsets[directory];
+       i < files.offsets[directory + 1]; ++i) {
+    (*rescan->file_results)[files.indices[i]] = result;
+  }
+}
+
+rescan_file rescanFile(hash_table_row const &hash_row,
+                       std::string const &file_path, file_stamp &stamp) {
+  if (!stampFile(file_path, stamp)) {
+    return RESCAN_FILE_MISSING;
+  }
+
+  bool time_changed =
+      hash_row.modified_ns != 0 && stamp.modified_ns != hash_row.modified_ns;
+  if (stamp.size != hash_row.size || time_changed) {
+    return RESCAN_FILE_MODIFIED;
+  }
+
+  return hash_row.modified_ns == 0 ? RESCAN_FILE_RESTAMPED
+                                   : RESCAN_FILE_UNCHANGED;
+}
+
+/**
+ * The names in the listing which are neither a cached file nor a cached
+ * directory. Both lists are sorted.
+ */
+std::vector<std::string> findNewNames(rescan_context *rescan,
+                                      std::size_t directory,
+                                      std::vector<std::string> const &names) {
+  directory_buckets const &files = *rescan->files;
+  directory_buckets const &children = *rescan->children;
+  std::vector<std::string_view> known_names{};
+  for (std::size_t i = files.offsets[directory];
+       i < files.offsets[directory + 1]; ++i) {
+    known_names.push_back((*rescan->hashes)[files.indices[i]].name);
+  }
+  for (std::size_t i = children.offsets[directory];
+       i < children.offsets[directory + 1]; ++i) {
+    known_names.push_back(
+        (*rescan->directory_table_rows)[children.indices[i]].name);
+  }
+  std::sort(known_names.begin(), known_names.end());
+
+  std::vector<std::string> new_names{};
+  std::size_t known = 0;
+  for (std::string const &name : names) {
+    while (known < known_names.size() && known_names[known] < name) {
+      ++known;
+    }
+    if (known == known_names.size() || known_names[known] != name) {
+      new_names.push_back(name);
+    }
+  }
+  return new_names;
+}
+
+/**
+ * Lists the directory and stamps each of its files which is still in it.
+ * False when the directory could not be read, its files are kept then unless
+ * it is gone.
+ */
+bool rescanFiles(rescan_context *rescan, std::size_t directory,
+                 std::vector<std::string> &names) {
+  directory_buckets const &files = *rescan->files;
+  std::string const &directory_path = (*rescan->directory_paths)[directory];
+  directory_listing listing = listDirectory(directory_path, names);
+  if (listing == DIRECTORY_LISTING_MISSING) {
+    markFiles(rescan, directory, RESCAN_FILE_MISSING);
+  }
+  if (listing != DIRECTORY_LISTING_READ) {
+    return false;
+  }
+  std::sort(names.begin(), names.end());
+
+  for (std::size_t i = files.offsets[directory];
+       i < files.offsets[directory + 1]; ++i) {
+    std::size_t hash_index = files.indices[i];
+    hash_table_row const &hash_row = (*rescan->hashes)[hash_index];
+    (*rescan->file_results)[hash_index] =
+        std::binary_search(names.begin(), names.end(),
+                           std::string_view(hash_row.name))
+            ? rescanFile(hash_row, joinPath({directory_path, hash_row.name}),
+                         (*rescan->file_stamps)[hash_index])
+            : RESCAN_FILE_MISSING;
+  }
+  return true;
+}
+
+/**
+ * Stamps each file of a directory which was not listed. A file edited in
+ * place leaves the time of its directory alone.
+ */
+void stampFiles(rescan_context *rescan, std::size_t directory) {
+  directory_buckets const &files = *rescan->files;
+  std::string const &directory_path = (*rescan->directory_paths)[directory];
+  for (std::size_t i = files.offsets[directory];
+       i < files.offsets[directory + 1]; ++i) {
+    std::size_t hash_index = files.indices[i];
+    hash_table_row const &hash_row = (*rescan->hashes)[hash_index];
+    (*rescan->file_results)[hash_index] =
+        rescanFile(hash_row, joinPath({directory_path, hash_row.name}),
+                   (*rescan->file_stamps)[hash_index]);
+  }
+}
+
+/**
+ * Every cached file under the scanned paths is stat'ed. Directories whose
+ * time did not change have not had entries added or removed, so only the
+ * ones which did are listed. Directories above the scanned paths are never
+ * listed. The root directory has no row to keep a time in, it was only
+ * scanned when the cache holds files directly in it and is then listed as
+ * if it always changed.
+ */
+void rescanDirectories(std::size_t begin, std::size_t end, void *context) {
+  rescan_context *rescan = static_cast<rescan_context *>(context);
+  directory_buckets const &files = *rescan->files;
+  std::vector<std::string> names{};
+
+  for (std::size_t directory = begin; directory < end; ++directory) {
+    names.clear();
+    file_stamp stamp{};
+    bool timed = true;
+    if (directory == 0) {
+      if (files.offsets[0] == files.offsets[1]) {
+        continue;
+      }
+    } else {
+      directory_table_row_const &row = *rescan->directory_map[directory];
+      if (row.modified_ns == NOT_SCANNED_MODIFIED_NS) {
+        continue;
+      }
+
+      if (stampFile((*rescan->directory_paths)[directory], stamp) &&
+          stamp.modified_ns == row.modified_ns) {
+        stampFiles(rescan, directory);
+        continue;
+      }
+
+      // An older cache has no time to tell what was there when it was built.
+      timed = row.modified_ns != 0;
+    }
+
+    if (!rescanFiles(rescan, directory, names)) {
+      continue;
+    }
+
+    directory_rescan &directory_result = (*rescan->rescans)[directory];
+    directory_result.listed = true;
+    directory_result.stamp = stamp;
+    if (timed) {
+      directory_result.new_names = findNewNames(rescan, directory, names);
+    }
+  }
+}
+
+/**
+ * False when the file could not be read. A file read for its digest, rather
+ * than found in the store, gets its extents fingerprinted as well and
+ * extents points at the fingerprint, nullptr otherwise.
+ */
+bool hashFile(digest_store *store, std::string const &file_path,
+              file_stamp const &stamp, digest &file_digest,
+              digest &fingerprint, uint8_t const *&extents) {
+  try {
+    bool read_file =
+        extractStoredHash(store, file_digest.bytes, file_path, stamp);
+    extents = read_file && fingerprintExtents(file_path, fingerprint.bytes)
+                  ? fingerprint.bytes
+                  : nullptr;
+    return true;
+  } catch (file_open_error &error) {
+    return false;
+  }
+}
+
+/**
+ * Adds a file, or a directory with everything under it. False when nothing
+ * could be added.
+ */
+bool addEntry(sqlite3 *db, digest_store *store, row_id parent_id,
+              std::string const &path, std::string const &name,
+              rescan_stats &stats) {
+  file_stamp stamp{};
+  file_type type = FILE_TYPE_FILE;
+  if (!stampEntry(path, stamp, type)) {
+    return false;
+  }
+
+  if (type == FILE_TYPE_FILE) {
+    digest file_digest{};
+    digest fingerprint{};
+    uint8_t const *extents = nullptr;
+    if (!hashFile(store, path, stamp, file_digest, fingerprint, extents)) {
+      return false;
+    }
+    createHash(db, {.directory_id = parent_id,
+                    .name = name.c_str(),
+                    .hash = file_digest.bytes,
+                    .size = stamp.size,
+                    .modified_ns = stamp.modified_ns,
+                    .extents = extents});
+    ++stats.files_added;
+    return true;
+  }
+
+  // A directory which can not be listed is left for the next rescan rather
+  // than stored without its entries.
+  std::vector<std::string> names{};
+  if (listDirectory(path, names) != DIRECTORY_LISTING_READ) {
+    return false;
+  }
+  std::sort(names.begin(), names.end());
+
+  row_id directory_id = createDirectory(db, {.parent_id = parent_id,
+                                             .name = name.c_str(),
+                                             .modified_ns = stamp.modified_ns});
+  ++stats.directories_added;
+  for (std::string const &child_name : names) {
+    addEntry(db, store, directory_id, joinPath({path, child_name}),
+             child_name, stats);
+  }
+  return true;
+}
 
-  for (hash_table_row hash_row : hashes) {
+/**
+ * Files which are gone, or which changed and can no longer be read, are
+ * added to hash_ids_to_delete in the order of the hashes. The directories
+ * which had files added or hashed again are added to changed_directory_ids.
+ * With placeholders every file still holding a lockstep placeholder is hashed
+ * again, or dropped when it can no longer be read.
+ */
+rescan_stats rescanCache(sqlite3 *db, digest_store *store, bool placeholders,
+                         hash_table_row::rows const &hashes,
+                         directory_table_row::rows const &directory_table_rows,
+                         parent_directory_map_const &directory_map,
+                         str_const root_dir,
+                         std::vector<row_id> &hash_ids_to_delete,
+                         std::vector<row_id> &changed_directory_ids) {
+  std::vector<std::string> directory_paths =
+      buildDirectoryPaths(directory_table_rows, directory_map, root_dir);
+  directory_buckets files =
+      groupFilesByDirectory(hashes, directory_table_rows.size());
+  directory_buckets children = groupDirectoriesByParent(directory_table_rows);
+  std::vector<directory_rescan> rescans(directory_paths.size());
+  std::vector<rescan_file> file_results(hashes.size(), RESCAN_FILE_UNCHANGED);
+  std::vector<file_stamp> file_stamps(hashes.size());
+
+  rescan_context context{&hashes,          &directory_table_rows,
+                         directory_map,    &files,
+                         &children,        &directory_paths,
+                         &rescans,         &file_results,
+                         &file_stamps};
+  parallelFor(0, directory_paths.size(), rescanDirectories, &context, 1);
+
+  rescan_stats stats{0, 0, 0, 0};
+  std::vector<digest> digests(hashes.size());
+  std::vector<digest> extents(hashes.size());
+  std::vector<hash_update_input> update_inputs{};
+  for (std::size_t i = 0; i < hashes.size(); ++i) {
+    bool placeholder = placeholders && isPlaceholderDigest(hashes[i].hash);
+    if (file_results[i] == RESCAN_FILE_UNCHANGED && !placeholder) {
+      continue;
+    }
+
+    row_id directory_id = std::max<row_id>(hashes[i].directory_id, 0);
     std::string file_path =
-        joinPath({absolute_path, buildRelativePath(hash_row, directory_map)});
-    if (!fileExists(file_path)) {
-      hash_ids_to_remove.push_back(hash_row.id);
+        joinPath({directory_paths[directory_id], hashes[i].name});
+    // A placeholder only says no file of the same size matched when the cache
+    // was built, files added since may match it.
+    if (placeholder && file_results[i] == RESCAN_FILE_UNCHANGED) {
+      file_results[i] = stampFile(file_path, file_stamps[i])
+                            ? RESCAN_FILE_MODIFIED
+                            : RESCAN_FILE_MISSING;
+    } else if (placeholder && file_results[i] == RESCAN_FILE_RESTAMPED) {
+      file_results[i] = RESCAN_FILE_MODIFIED;
+    }
+
+    uint8_t const *file_extents = nullptr;
+    if (file_results[i] == RESCAN_FILE_MODIFIED &&
+        !hashFile(store, file_path, file_stamps[i], digests[i], extents[i],
+                  file_extents)) {
+      file_results[i] = RESCAN_FILE_MISSING;
+    }
+
+    if (file_results[i] == RESCAN_FILE_MISSING) {
+      hash_ids_to_delete.push_back(hashes[i].id);
+      continue;
+    }
+
+    if (file_results[i] == RESCAN_FILE_MODIFIED) {
+      ++stats.files_hashed;
+      changed_directory_ids.push_back(hashes[i].directory_id);
+      update_inputs.push_back({.id = hashes[i].id,
+                               .hash = digests[i].bytes,
+                               .size = file_stamps[i].size,
+                               .modified_ns = file_stamps[i].modified_ns,
+                               .extents = file_extents});
+    } else if (file_results[i] == RESCAN_FILE_RESTAMPED) {
+      update_inputs.push_back({.id = hashes[i].id,
+                               .hash = hashes[i].hash,
+                               .size = hashes[i].size,
+                               .modified_ns = file_stamps[i].modified_ns,
+                               .extents = hashes[i].extents});
     }
   }
+  updateHashes(db, update_inputs);
 
-  return hash_ids_to_remove;
+  // The root holds the rows without a parent and has no time to store.
+  std::vector<directory_stamp_input> stamp_inputs{};
+  beginTransaction(db);
+  for (std::size_t directory = 0; directory < rescans.size(); ++directory) {
+    if (!rescans[directory].listed) {
+      continue;
+    }
+
+    ++stats.directories_listed;
+    row_id directory_id = directory == 0 ? -1 : directory;
+    if (directory != 0) {
+      stamp_inputs.push_back(
+          {.id = directory_id,
+           .modified_ns = rescans[directory].stamp.modified_ns});
+    }
+    bool added = false;
+    for (std::string const &name : rescans[directory].new_names) {
+      added = addEntry(db, store, directory_id,
+                       joinPath({directory_paths[directory], name}), name,
+                       stats) ||
+              added;
+    }
+    if (added) {
+      changed_directory_ids.push_back(directory_id);
+    }
+  }
+  commitTransaction(db);
+  updateDirectoryStamps(db, stamp_inputs);
+
+  return stats;
 }
 
-void update(std::string cache_path, std::ostream &console) {
+/**
+ * Every directory on the path from a removed file, or from a changed
+ * directory, up to the root. Each directory is only listed once, walking up
+ * stops at the first directory another removed file has already cleared since
+ * its ancestors are cleared as well.
+ */
+std::vector<row_id> determineDirectoriesToClear(
+    hash_table_row::rows const &hashes,
+    std::vector<row_id> const &hash_ids_to_delete,
+    parent_directory_map_const &directory_map, std::size_t num_of_directories,
+    std::vector<row_id> const &changed_directory_ids = {}) {
+  std::vector<row_id> directory_ids_to_clear{};
+  std::vector<bool> cleared(num_of_directories + 1, false);
+  std::size_t delete_index = 0;
+  auto clearAbove = [&](row_id directory_id) {
+    while (directory_id != -1 && !cleared[directory_id]) {
+      cleared[directory_id] = true;
+      directory_ids_to_clear.push_back(directory_id);
+      directory_id = directory_map[directory_id]->parent_id;
+    }
+  };
+
+  // The ids to delete come from a single pass over the hashes so both lists
+  // are in the same order.
+  for (hash_table_row const &hash_row : hashes) {
+    if (delete_index == hash_ids_to_delete.size()) {
+      break;
+    }
+    if (hash_row.id != hash_ids_to_delete[delete_index]) {
+      continue;
+    }
+    ++delete_index;
+    clearAbove(hash_row.directory_id);
+  }
+
+  for (row_id directory_id : changed_directory_ids) {
+    clearAbove(directory_id);
+  }
+  return directory_ids_to_clear;
+}
+
+/**
+ * Caches built before the option existed were never built in lockstep.
+ */
+bool fetchPlaceholdersOption(sqlite3 *db) {
+  try {
+    cache_option_table_row row =
+        fetchCacheOption(db, LOCKSTEP_PLACEHOLDERS_OPTION);
+    return compareStrings(row.value, "1");
+  } catch (not_found_error &error) {
+    return false;
+  }
+}
+
+void update(std::string cache_path, update_options const &options,
+            std::ostream &console) {
   sqlite3 *db = initDB(cache_path.c_str());
+  upgradeDB(db);
+  arena *update_arena = initArena();
   scan_meta_data_table_row meta_data_row = fetchScanMetaData(db);
-  directory_table_row::rows directory_table_rows = fetchAllDirectories(db);
-  hash_table_row::rows hash_table_rows = fetchAllHashes(db);
+  directory_table_row::rows directory_table_rows =
+      fetchAllDirectories(db, update_arena);
+  hash_table_row::rows hash_table_rows = fetchAllHashes(db, update_arena);
 
   parent_directory_map_const directory_map =
       buildDirectoryRowMap(directory_table_rows);
 
-  std::vector<int> hash_ids_to_delete = determineHashesToDelete(
-      hash_table_rows, directory_map, meta_data_row.root_dir);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+  if (options.rescan) {
+    bool placeholders = fetchPlaceholdersOption(db);
+    digest_store *store =
+        initDigestStore(options.store_path, options.attributes,
+                        options.store_max_entries);
+    rescan_stats stats = rescanCache(
+        db, store, placeholders, hash_table_rows, directory_table_rows,
+        directory_map, meta_data_row.root_dir, hash_ids_to_delete,
+        changed_directory_ids);
+    if (placeholders) {
+      createCacheOption(db,
+                        {.name = LOCKSTEP_PLACEHOLDERS_OPTION, .value = "0"});
+    }
+    console << "Rescanned " << stats.directories_listed
+            << " directories which changed, added " << stats.files_added
+            << " files in " << stats.directories_added
+            << " new directories and hashed " << stats.files_hashed
+            << " changed files again.\n";
+    printDigestStoreStats(store, console);
+    freeDigestStore(store);
+  } else {
+    hash_ids_to_delete =
+        determineHashesToDelete(hash_table_rows, directory_table_rows,
+                                directory_map, meta_data_row.root_dir);
+  }
 
-  for (int hash_id_to_delete : hash_ids_to_delete) {
+  for (row_id hash_id_to_delete : hash_ids_to_delete) {
     deleteHash(db, hash_id_to_delete);
   }
+  clearDirectoryDigests(
+      db, determineDirectoriesToClear(
+              hash_table_rows, hash_ids_to_delete, directory_map,
+              directory_table_rows.size(), changed_directory_ids));
 
   console << "Deleted a total of " << hash_ids_to_delete.size()
           << " hashes from the cache. These represent files hashed on the file "
              "system. Empty directories are automatically filtered when "
              "running the dupes "
              "command.\n";
+  freeArena(update_arena);
   freeDB(db);
 }
\ No newline at end of file
@@ -1,6 +1,37 @@
+#pragma once
+
 #include "../fs/file_system.h"
 #include "../sqlite/sqlite.h"
+#include "../store/store.h"
 #include <ostream>
 #include <string>
 
-void update(std::string cache_path, std::ostream &console);
+/**
+ * Without rescan update only removes the files which are gone. With rescan
+ * every cached file is stat'ed and files whose size or time changed are
+ * hashed again. Only the directories whose modification time changed since
+ * they were last read are listed again, files added to them are hashed and
+ * added.
+ *
+ * With a store path, or attributes, the files a rescan hashes are looked up
+ * in the shared store or their extended attributes first, see store.h. Store
+ * max entries bounds the shared store, zero keeps its default.
+ *
+ * The files a rescan reads for their digest have their extents fingerprinted
+ * again, files found in the store or their attributes are left without one.
+ * Extents which change without the time changing, a reflink which keeps the
+ * times or an offline dedupe, are only picked up by the next build.
+ *
+ * A cache built in lockstep holds placeholders for the files which matched no
+ * other file, see lib.h. The first rescan hashes those files for real since
+ * the files added to the cache from then on may match them.
+ */
+struct update_options {
+  bool rescan;
+  std::string store_path;
+  bool attributes;
+  std::size_t store_max_entries;
+};
+
+void update(std::string cache_path, update_options const &options,
+            std::ostream &console);
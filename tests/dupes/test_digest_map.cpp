@@ -0,0 +1,119 @@
+#include <cassert>
+
+#include "../../src/dupes/digest_map.cpp"
+#include "../../src/lib.cpp"
+#include "../data.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+digest uniqueTestDigest(uint8_t byte) {
+  return toDigest(uniqueTestHash(byte));
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ------------------------------ initDigestMap ----------------------------- */
+void testInitDigestMapKeepsLoadUnderHalf() {
+  // Act
+  digest_map actual_map = initDigestMap(100);
+
+  // Assert
+  assert(actual_map.slots.size() == 256);
+  assert(actual_map.group_digests.size() == 0);
+}
+
+/* ------------------------------ insertDigest ------------------------------ */
+void testInsertingDigestsHandsOutGroupsInOrder() {
+  // Arrange
+  digest_map test_map = initDigestMap(2);
+
+  // Act
+  std::size_t first_group = insertDigest(test_map, uniqueTestDigest(1));
+  std::size_t second_group = insertDigest(test_map, uniqueTestDigest(2));
+  std::size_t repeat_group = insertDigest(test_map, uniqueTestDigest(1));
+
+  // Assert
+  assert(first_group == 0);
+  assert(second_group == 1);
+  assert(repeat_group == 0);
+  assert(test_map.group_digests.size() == 2);
+}
+
+void testInsertingDigestsGrowsTheMap() {
+  // Arrange
+  digest_map test_map = initDigestMap(0);
+  std::size_t initial_slots = test_map.slots.size();
+
+  // Act
+  for (int i = 0; i < 256; ++i) {
+    insertDigest(test_map, uniqueTestDigest(i));
+  }
+
+  // Assert
+  assert(test_map.slots.size() > initial_slots);
+  assert(test_map.group_digests.size() * 2 <= test_map.slots.size());
+  for (int i = 0; i < 256; ++i) {
+    assert(findDigest(test_map, uniqueTestDigest(i)) ==
+           static_cast<std::size_t>(i));
+  }
+}
+
+/* ------------------------------- findDigest ------------------------------- */
+void testFindingMissingDigest() {
+  // Arrange
+  digest_map test_map = initDigestMap(1);
+  insertDigest(test_map, uniqueTestDigest(1));
+
+  // Act
+  std::size_t actual_group = findDigest(test_map, uniqueTestDigest(2));
+
+  // Assert
+  assert(actual_group == NO_GROUP);
+}
+
+/* ------------------------------ groupDigests ------------------------------ */
+void testGroupingDigests() {
+  // Arrange
+  std::vector<digest> test_digests{uniqueTestDigest(1), uniqueTestDigest(2),
+                                   uniqueTestDigest(1), uniqueTestDigest(3),
+                                   uniqueTestDigest(2)};
+
+  // Act
+  digest_groups actual_groups =
+      groupDigests(test_digests, {4, 3, 2, 1, 0});
+
+  // Assert
+  std::vector<std::size_t> expected_node_groups{2, 0, 2, 1, 0};
+  std::vector<std::size_t> expected_group_offsets{0, 2, 3, 5};
+  std::vector<std::size_t> expected_members{4, 1, 3, 2, 0};
+
+  assert(actual_groups.size() == 3);
+  assert(actual_groups.node_groups == expected_node_groups);
+  assert(actual_groups.group_offsets == expected_group_offsets);
+  assert(actual_groups.members == expected_members);
+  assert(actual_groups.groupSize(0) == 2);
+  assert(actual_groups.groupMembers(2)[1] == 0);
+}
+
+void testGroupingNoDigests() {
+  // Act
+  digest_groups actual_groups = groupDigests({}, {});
+
+  // Assert
+  assert(actual_groups.size() == 0);
+  assert(actual_groups.members.size() == 0);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testInitDigestMapKeepsLoadUnderHalf();
+  testInsertingDigestsHandsOutGroupsInOrder();
+  testInsertingDigestsGrowsTheMap();
+  testFindingMissingDigest();
+  testGroupingDigests();
+  testGroupingNoDigests();
+}
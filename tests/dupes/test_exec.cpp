@@ -0,0 +1,339 @@
+#include <cassert>
+#include <sstream>
+
+#include "../../src/dupes/exec.cpp"
+#include "../../src/lib.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+std::ostringstream OUTPUT_MOCK{};
+
+const char *SHELL_PATH = "/bin/sh";
+
+/*
+- Root Path: /r
+
+- Groups:
+t/a, t/b
+t/c, t/d, t/e
+*/
+duplicate_node_set createTestSet() {
+  duplicate_node_set test_set{};
+  test_set.tree.parents = {NO_PARENT, 0, 0, 0, 0, 0};
+  test_set.tree.path_segments = {"t", "a", "b", "c", "d", "e"};
+  test_set.tree.sizes = {10, 2, 2, 2, 2, 2};
+  test_set.members = {1, 2, 3, 4, 5};
+  test_set.group_offsets = {0, 2, 5};
+  return test_set;
+}
+
+// Every test path is "/r/t/x", 7 bytes with its null.
+std::size_t const TEST_PATH_COST = 7 + sizeof(char *);
+
+std::vector<std::vector<std::string>> last_spawn_arguments{};
+std::string last_spawn_script{};
+std::size_t spawn_fail_after = SIZE_MAX;
+std::size_t running_children = 0;
+std::size_t most_running_children = 0;
+std::size_t failing_children = 0;
+std::size_t argument_bytes_limit_return = 1 << 20;
+std::vector<pid_t> last_waited_pids{};
+
+void resetMocks() {
+  OUTPUT_MOCK.str("");
+  last_spawn_arguments = {};
+  last_spawn_script = {};
+  spawn_fail_after = SIZE_MAX;
+  running_children = 0;
+  most_running_children = 0;
+  failing_children = 0;
+  argument_bytes_limit_return = 1 << 20;
+  last_waited_pids = {};
+}
+
+void renderPath(inode_tree const &tree, std::size_t node,
+                std::vector<char const *> &segment_stack, std::string &path) {
+  path = tree.path_segments[node];
+  for (std::size_t parent = tree.parents[node]; parent != NO_PARENT;
+       parent = tree.parents[parent]) {
+    path = std::string(tree.path_segments[parent]) + "/" + path;
+  }
+}
+
+std::string joinPath(std::vector<std::string> const &path_segments) {
+  return path_segments[0] + "/" + path_segments[1];
+}
+
+std::size_t argumentBytesLimit() { return argument_bytes_limit_return; }
+
+pid_t spawnShell(std::string const &script,
+                 std::vector<std::string> const &arguments) {
+  if (last_spawn_arguments.size() == spawn_fail_after) {
+    return -1;
+  }
+
+  last_spawn_script = script;
+  last_spawn_arguments.push_back(arguments);
+  ++running_children;
+  most_running_children = std::max(most_running_children, running_children);
+  return static_cast<pid_t>(last_spawn_arguments.size());
+}
+
+pid_t waitForChild(pid_t pid, bool &succeeded) {
+  if (running_children == 0) {
+    succeeded = false;
+    return -1;
+  }
+
+  last_waited_pids.push_back(pid);
+  --running_children;
+  succeeded = failing_children == 0;
+  if (failing_children != 0) {
+    --failing_children;
+  }
+  return pid;
+}
+
+std::vector<std::vector<std::string>>
+collectBatches(duplicate_node_set const &duplicate_nodes_set,
+               exec_options const &options, std::size_t argument_bytes) {
+  std::string root_dir = "/r";
+  exec_batcher batcher =
+      initExecBatcher(duplicate_nodes_set, root_dir, options, argument_bytes);
+  std::vector<std::vector<std::string>> batches{};
+  std::vector<std::string> batch{};
+  while (nextExecBatch(batcher, batch)) {
+    batches.push_back(batch);
+  }
+  return batches;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ----------------------------- buildExecScript ---------------------------- */
+void testBuildingAScriptReplacesThePlaceholders() {
+  // Act
+  std::string actual_script = buildExecScript("tar -cf a.tar {} && ls {}");
+
+  // Assert
+  assert(actual_script == "tar -cf a.tar \"$@\" && ls \"$@\"");
+}
+
+void testBuildingAScriptAppendsThePaths() {
+  // Act
+  std::string actual_script = buildExecScript("sha1sum");
+
+  // Assert
+  assert(actual_script == "sha1sum \"$@\"");
+}
+
+/* ------------------------------ nextExecBatch ----------------------------- */
+void testBatchingPathsKeepsGroupsTogether() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet();
+
+  // Act
+  std::vector<std::vector<std::string>> actual_batches = collectBatches(
+      test_set, {.command = "ls", .jobs = 1, .batch = EXEC_BATCH_PATHS},
+      TEST_PATH_COST * 4);
+
+  // Assert
+  assert(actual_batches == (std::vector<std::vector<std::string>>{
+                               {"/r/t/a", "/r/t/b"},
+                               {"/r/t/c", "/r/t/d", "/r/t/e"}}));
+}
+
+void testBatchingPathsFillsBatchesUpToTheLimit() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet();
+
+  // Act
+  std::vector<std::vector<std::string>> actual_batches = collectBatches(
+      test_set, {.command = "ls", .jobs = 1, .batch = EXEC_BATCH_PATHS},
+      TEST_PATH_COST * 5);
+
+  // Assert
+  assert(actual_batches.size() == 1);
+  assert(actual_batches[0].size() == 5);
+}
+
+void testBatchingPathsSplitsGroupsLargerThanTheLimit() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet();
+
+  // Act
+  std::vector<std::vector<std::string>> actual_batches = collectBatches(
+      test_set, {.command = "ls", .jobs = 1, .batch = EXEC_BATCH_PATHS},
+      TEST_PATH_COST * 2);
+
+  // Assert
+  assert(actual_batches ==
+         (std::vector<std::vector<std::string>>{
+             {"/r/t/a", "/r/t/b"}, {"/r/t/c", "/r/t/d"}, {"/r/t/e"}}));
+}
+
+void testBatchingPathsSpreadsThemAcrossJobs() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet();
+
+  // Act
+  std::vector<std::vector<std::string>> actual_batches = collectBatches(
+      test_set, {.command = "ls", .jobs = 2, .batch = EXEC_BATCH_PATHS},
+      TEST_PATH_COST * 5);
+
+  // Assert
+  assert(actual_batches ==
+         (std::vector<std::vector<std::string>>{
+             {"/r/t/a", "/r/t/b"}, {"/r/t/c", "/r/t/d"}, {"/r/t/e"}}));
+}
+
+void testBatchingByGroupGivesEveryGroupACommand() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet();
+
+  // Act
+  std::vector<std::vector<std::string>> actual_batches = collectBatches(
+      test_set, {.command = "ls", .jobs = 1, .batch = EXEC_BATCH_GROUP},
+      TEST_PATH_COST * 5);
+
+  // Assert
+  assert(actual_batches == (std::vector<std::vector<std::string>>{
+                               {"/r/t/a", "/r/t/b"},
+                               {"/r/t/c", "/r/t/d", "/r/t/e"}}));
+}
+
+/* ----------------------------- runExecBatches ----------------------------- */
+void testRunningBatchesKeepsToTheJobs() {
+  // Arrange
+  resetMocks();
+  duplicate_node_set test_set = createTestSet();
+  std::string root_dir = "/r";
+  exec_batcher test_batcher = initExecBatcher(
+      test_set, root_dir,
+      {.command = "ls", .jobs = 1, .batch = EXEC_BATCH_PATHS},
+      TEST_PATH_COST * 2);
+
+  // Act
+  exec_stats actual_stats = runExecBatches("ls \"$@\"", test_batcher, 2);
+
+  // Assert
+  assert(actual_stats == (exec_stats{3, 0, 5}));
+  assert(last_spawn_arguments ==
+         (std::vector<std::vector<std::string>>{
+             {"/r/t/a", "/r/t/b"}, {"/r/t/c", "/r/t/d"}, {"/r/t/e"}}));
+  assert(most_running_children == 2);
+  assert(running_children == 0);
+}
+
+void testRunningBatchesWaitsForTheCommandsItStarted() {
+  // Arrange
+  resetMocks();
+  duplicate_node_set test_set = createTestSet();
+  std::string root_dir = "/r";
+  exec_batcher test_batcher = initExecBatcher(
+      test_set, root_dir,
+      {.command = "ls", .jobs = 1, .batch = EXEC_BATCH_PATHS},
+      TEST_PATH_COST * 2);
+
+  // Act
+  runExecBatches("ls", test_batcher, 2);
+
+  // Assert
+  assert(last_waited_pids == (std::vector<pid_t>{1, 2, 3}));
+}
+
+void testRunningBatchesCountsFailedCommands() {
+  // Arrange
+  resetMocks();
+  failing_children = 2;
+  duplicate_node_set test_set = createTestSet();
+  std::string root_dir = "/r";
+  exec_batcher test_batcher = initExecBatcher(
+      test_set, root_dir,
+      {.command = "false", .jobs = 1, .batch = EXEC_BATCH_PATHS},
+      TEST_PATH_COST * 2);
+
+  // Act
+  exec_stats actual_stats = runExecBatches("false", test_batcher, 1);
+
+  // Assert
+  assert(actual_stats == (exec_stats{3, 2, 5}));
+}
+
+void testRunningBatchesThrowsWhenACommandCanNotStart() {
+  // Arrange
+  resetMocks();
+  spawn_fail_after = 1;
+  duplicate_node_set test_set = createTestSet();
+  std::string root_dir = "/r";
+  exec_batcher test_batcher = initExecBatcher(
+      test_set, root_dir,
+      {.command = "ls", .jobs = 2, .batch = EXEC_BATCH_GROUP},
+      TEST_PATH_COST * 5);
+
+  try {
+    // Act
+    runExecBatches("ls", test_batcher, 2);
+    assert(false);
+  } catch (exec_error &error) {
+    // Assert
+    assert(last_spawn_arguments.size() == 1);
+    assert(running_children == 0);
+  }
+}
+
+/* ----------------------------- execDuplicates ----------------------------- */
+void testExecutingDuplicatesRunsTheScript() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  exec_stats actual_stats = execDuplicates(
+      createTestSet(), "/r",
+      {.command = "echo {}", .jobs = 1, .batch = EXEC_BATCH_GROUP},
+      OUTPUT_MOCK);
+
+  // Assert
+  assert(actual_stats == (exec_stats{2, 0, 5}));
+  assert(last_spawn_script == "echo \"$@\"");
+  assert(OUTPUT_MOCK.str() ==
+         "Ran 2 commands over 5 paths, 0 commands failed.\n\n");
+}
+
+void testExecutingDuplicatesThrowsWithoutRoomForPaths() {
+  // Arrange
+  resetMocks();
+  argument_bytes_limit_return = 16;
+
+  try {
+    // Act
+    execDuplicates(createTestSet(), "/r",
+                   {.command = "echo", .jobs = 1, .batch = EXEC_BATCH_PATHS},
+                   OUTPUT_MOCK);
+    assert(false);
+  } catch (exec_error &error) {
+    // Assert
+    assert(last_spawn_arguments.size() == 0);
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testBuildingAScriptReplacesThePlaceholders();
+  testBuildingAScriptAppendsThePaths();
+  testBatchingPathsKeepsGroupsTogether();
+  testBatchingPathsFillsBatchesUpToTheLimit();
+  testBatchingPathsSplitsGroupsLargerThanTheLimit();
+  testBatchingPathsSpreadsThemAcrossJobs();
+  testBatchingByGroupGivesEveryGroupACommand();
+  testRunningBatchesKeepsToTheJobs();
+  testRunningBatchesWaitsForTheCommandsItStarted();
+  testRunningBatchesCountsFailedCommands();
+  testRunningBatchesThrowsWhenACommandCanNotStart();
+  testExecutingDuplicatesRunsTheScript();
+  testExecutingDuplicatesThrowsWithoutRoomForPaths();
+}
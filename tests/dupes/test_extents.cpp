@@ -0,0 +1,130 @@
+#include <cassert>
+
+#include "../../src/dupes/extents.cpp"
+#include "../../src/lib.cpp"
+#include "../data.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+// A directory's files are its children, the tests nest no deeper.
+std::vector<std::size_t> collectFileNodes(inode_tree const &tree,
+                                          std::size_t node) {
+  if (tree.directory_ids[node] == -1) {
+    return {node};
+  }
+
+  std::vector<std::size_t> file_nodes{};
+  for (std::size_t i = 0; i < tree.child_counts[node]; ++i) {
+    file_nodes.push_back(tree.first_children[node] + i);
+  }
+  return file_nodes;
+}
+
+/*
+- Groups:
+d1, d2 (holding x.txt and y.txt)
+a.txt, b.txt
+c.txt, e.txt
+*/
+hash_table_row::rows createTestRows(hash_const y_extents,
+                                    hash_const a_extents,
+                                    hash_const b_extents) {
+  return {{1, 1, "x.txt", uniqueTestHash(), 5, 10, uniqueTestHash(3)},
+          {2, 2, "y.txt", uniqueTestHash(), 5, 10, y_extents},
+          {3, -1, "a.txt", uniqueTestHash(), 5, 10, a_extents},
+          {4, -1, "b.txt", uniqueTestHash(), 5, 10, b_extents},
+          {5, -1, "c.txt", uniqueTestHash(), 5, 10, uniqueTestHash(5)},
+          {6, -1, "e.txt", uniqueTestHash(), 5, 10, uniqueTestHash(6)}};
+}
+
+duplicate_node_set createTestSet(hash_table_row::rows const &hash_rows) {
+  duplicate_node_set test_set{};
+  test_set.tree.parents = {NO_PARENT, NO_PARENT, 0, 1,
+                           NO_PARENT, NO_PARENT, NO_PARENT, NO_PARENT};
+  test_set.tree.first_children = {2, 3, 0, 0, 0, 0, 0, 0};
+  test_set.tree.child_counts = {1, 1, 0, 0, 0, 0, 0, 0};
+  test_set.tree.path_segments = {"d1", "d2"};
+  for (hash_table_row const &hash_row : hash_rows) {
+    test_set.tree.path_segments.push_back(hash_row.name);
+  }
+  test_set.tree.directory_ids = {1, 2, -1, -1, -1, -1, -1, -1};
+  test_set.members = {0, 1, 4, 5, 6, 7};
+  test_set.group_offsets = {0, 2, 4, 6};
+  return test_set;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ---------------------------- markSharedExtents --------------------------- */
+void testMarkingGroupsWhoseMembersShareTheirExtents() {
+  // Arrange
+  hash_table_row::rows test_rows =
+      createTestRows(uniqueTestHash(3), uniqueTestHash(4), uniqueTestHash(4));
+  duplicate_node_set test_set = createTestSet(test_rows);
+
+  // Act
+  std::size_t shared_groups = markSharedExtents(test_set, test_rows);
+
+  // Assert
+  assert(shared_groups == 2);
+  assert(test_set.shared_extents == (std::vector<bool>{true, true, false}));
+  assert(test_set.sharesExtents(0));
+  assert(!test_set.sharesExtents(2));
+}
+
+void testMarkingAGroupWithAnUnmappedMember() {
+  // Arrange
+  hash_table_row::rows test_rows =
+      createTestRows(uniqueTestHash(3), uniqueTestHash(4), nullptr);
+  duplicate_node_set test_set = createTestSet(test_rows);
+
+  // Act
+  std::size_t shared_groups = markSharedExtents(test_set, test_rows);
+
+  // Assert
+  assert(shared_groups == 1);
+  assert(test_set.shared_extents == (std::vector<bool>{true, false, false}));
+}
+
+void testMarkingDirectoriesWithDifferentFiles() {
+  // Arrange
+  hash_table_row::rows test_rows =
+      createTestRows(uniqueTestHash(7), uniqueTestHash(4), uniqueTestHash(4));
+  duplicate_node_set test_set = createTestSet(test_rows);
+
+  // Act
+  std::size_t shared_groups = markSharedExtents(test_set, test_rows);
+
+  // Assert
+  assert(shared_groups == 1);
+  assert(test_set.shared_extents == (std::vector<bool>{false, true, false}));
+}
+
+void testMarkingACacheWithoutFingerprintsLeavesItUnmarked() {
+  // Arrange
+  hash_table_row::rows test_rows{
+      {1, 1, "x.txt", uniqueTestHash()},  {2, 2, "y.txt", uniqueTestHash()},
+      {3, -1, "a.txt", uniqueTestHash()}, {4, -1, "b.txt", uniqueTestHash()},
+      {5, -1, "c.txt", uniqueTestHash()}, {6, -1, "e.txt", uniqueTestHash()}};
+  duplicate_node_set test_set = createTestSet(test_rows);
+
+  // Act
+  std::size_t shared_groups = markSharedExtents(test_set, test_rows);
+
+  // Assert
+  assert(shared_groups == 0);
+  assert(test_set.shared_extents.empty());
+  assert(!test_set.sharesExtents(1));
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testMarkingGroupsWhoseMembersShareTheirExtents();
+  testMarkingAGroupWithAnUnmappedMember();
+  testMarkingDirectoriesWithDifferentFiles();
+  testMarkingACacheWithoutFingerprintsLeavesItUnmarked();
+}
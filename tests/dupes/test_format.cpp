@@ -0,0 +1,274 @@
+#include <cassert>
+#include <sstream>
+
+#include "../../src/dupes/format.cpp"
+#include "../../src/dupes/load.cpp"
+#include "../../src/dupes/sink.cpp"
+#include "../../src/thread/parallel.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+void writeFileDescriptor(int file_descriptor, char const *data,
+                         std::size_t length) {}
+
+std::string writeToString(void (*writer)(output_sink &, std::string const &),
+                          std::string const &value) {
+  std::ostringstream mock_cout{};
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+  writer(test_sink, value);
+  flushSink(test_sink);
+  return mock_cout.str();
+}
+
+/**
+ * A root directory "test" holding one group of two files, "a.txt" and the
+ * name passed in.
+ */
+duplicate_node_set createTestSet(char const *second_name) {
+  duplicate_node_set test_set{};
+  test_set.tree.parents = {NO_PARENT, 0, 0};
+  test_set.tree.depths = {1, 2, 2};
+  test_set.tree.path_segments = {"test", "a.txt", second_name};
+  test_set.tree.sizes = {24, 12, 12};
+  test_set.tree.node_digests = {EMPTY_DIGEST, {{0xab, 0x01}}, {{0xab, 0x01}}};
+  test_set.members = {1, 2};
+  test_set.group_offsets = {0, 2};
+  return test_set;
+}
+
+std::string writeTestGroups(output_format format,
+                            duplicate_node_set const &test_set) {
+  std::ostringstream mock_cout{};
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+  format_writer test_writer = initFormatWriter(format);
+  writeFormatHeader(test_sink, test_writer, test_set.size());
+  for (std::size_t group = 0; group < test_set.size(); ++group) {
+    writeGroupRecord(test_sink, test_writer, test_set, group);
+  }
+  flushSink(test_sink);
+  return mock_cout.str();
+}
+
+std::string const TEST_DIGEST_HEX = "ab010000000000000000000000000000";
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ----------------------------- writeHexDigest ----------------------------- */
+void testWritingHexDigest() {
+  // Arrange
+  std::ostringstream mock_cout{};
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+
+  // Act
+  writeHexDigest(test_sink, {{0x00, 0x0f, 0xf0, 0xff}});
+  flushSink(test_sink);
+
+  // Assert
+  assert(mock_cout.str() == "000ff0ff000000000000000000000000");
+}
+
+/* ---------------------------- writeJsonString ----------------------------- */
+void testWritingPlainJsonString() {
+  // Act
+  std::string actual_output = writeToString(writeJsonString, "dir/a.txt");
+
+  // Assert
+  assert(actual_output == "\"dir/a.txt\"");
+}
+
+void testWritingJsonStringEscapesSpecialBytes() {
+  // Act
+  std::string actual_output = writeToString(
+      writeJsonString, std::string("a\"b\\c\nd\te\x01" "f\0g", 13));
+
+  // Assert
+  assert(actual_output == "\"a\\\"b\\\\c\\nd\\te\\u0001f\\u0000g\"");
+}
+
+void testWritingJsonStringKeepsValidUtf8() {
+  // Act
+  std::string actual_output = writeToString(
+      writeJsonString, "caf\xc3\xa9/\xe2\x82\xac/\xf0\x9f\x98\x80");
+
+  // Assert
+  assert(actual_output == "\"caf\xc3\xa9/\xe2\x82\xac/\xf0\x9f\x98\x80\"");
+}
+
+void testWritingJsonStringEscapesInvalidUtf8() {
+  // Act
+  std::string actual_output = writeToString(
+      writeJsonString, "a\xff" "b\xc0\xaf" "c\xed\xa0\x80" "d\xe2\x82" "e\xc3");
+
+  // Assert
+  assert(actual_output ==
+         "\"a\\u00ffb\\u00c0\\u00afc\\u00ed\\u00a0\\u0080d\\u00e2\\u0082e"
+         "\\u00c3\"");
+}
+
+/* ------------------------------ writeCsvField ----------------------------- */
+void testWritingPlainCsvField() {
+  // Act
+  std::string actual_output = writeToString(writeCsvField, "dir/a.txt");
+
+  // Assert
+  assert(actual_output == "dir/a.txt");
+}
+
+void testWritingCsvFieldQuotesSpecialBytes() {
+  // Act
+  std::string actual_output = writeToString(writeCsvField, "a,b \"c\"\nd");
+
+  // Assert
+  assert(actual_output == "\"a,b \"\"c\"\"\nd\"");
+}
+
+/* ---------------------------- writeGroupRecord ---------------------------- */
+void testWritingGroupAsJsonl() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet("b\n.txt");
+
+  // Act
+  std::string actual_output = writeTestGroups(OUTPUT_FORMAT_JSONL, test_set);
+
+  // Assert
+  assert(actual_output == "{\"group\":0,\"size\":12,\"digest\":\"" +
+                              TEST_DIGEST_HEX +
+                              "\",\"members\":[\"test/a.txt\","
+                              "\"test/b\\n.txt\"]}\n");
+}
+
+void testWritingGroupSharingItsExtentsAsJsonl() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet("b.txt");
+  test_set.shared_extents = {true};
+
+  // Act
+  std::string actual_output = writeTestGroups(OUTPUT_FORMAT_JSONL, test_set);
+
+  // Assert
+  assert(actual_output == "{\"group\":0,\"size\":12,\"digest\":\"" +
+                              TEST_DIGEST_HEX +
+                              "\",\"shared_extents\":true,\"members\":["
+                              "\"test/a.txt\",\"test/b.txt\"]}\n");
+}
+
+void testWritingGroupAsNullDelimited() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet("b\n.txt");
+
+  // Act
+  std::string actual_output = writeTestGroups(OUTPUT_FORMAT_NULL, test_set);
+
+  // Assert
+  std::string expected_output = "0\t12\t" + TEST_DIGEST_HEX + "\ttest/a.txt";
+  expected_output += '\0';
+  expected_output += "0\t12\t" + TEST_DIGEST_HEX + "\ttest/b\n.txt";
+  expected_output += '\0';
+  assert(actual_output == expected_output);
+}
+
+void testWritingGroupAsCsv() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet("b,c.txt");
+
+  // Act
+  std::string actual_output = writeTestGroups(OUTPUT_FORMAT_CSV, test_set);
+
+  // Assert
+  assert(actual_output == "group,size,digest,path\n"
+                          "0,12," +
+                              TEST_DIGEST_HEX +
+                              ",test/a.txt\n"
+                              "0,12," +
+                              TEST_DIGEST_HEX + ",\"test/b,c.txt\"\n");
+}
+
+void testWritingAnEmptyGroupWritesNothing() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet("b.txt");
+  test_set.members = {};
+  test_set.group_offsets = {0, 0};
+
+  // Act
+  std::string actual_output = writeTestGroups(OUTPUT_FORMAT_JSONL, test_set);
+
+  // Assert
+  assert(actual_output == "");
+}
+
+void testWritingGroupsAgainstAPrefixTable() {
+  // Arrange
+  duplicate_node_set test_set{};
+  test_set.tree.parents = {NO_PARENT, 0, 0, 1, 1, 2, 2};
+  test_set.tree.depths = {1, 2, 2, 3, 3, 3, 3};
+  test_set.tree.path_segments = {"test", "x", "y", "a.txt",
+                                 "b.txt", "a.txt", "b.txt"};
+  test_set.tree.sizes = {0, 0, 0, 1, 2, 1, 2};
+  test_set.tree.node_digests = std::vector<digest>(7, EMPTY_DIGEST);
+  test_set.members = {3, 5, 4, 6};
+  test_set.group_offsets = {0, 2, 4};
+
+  // Act
+  std::string actual_output = writeTestGroups(OUTPUT_FORMAT_PREFIX, test_set);
+
+  // Assert
+  std::string zero_hex(MD5_DIGEST_LENGTH * 2, '0');
+  std::string expected_output = "ddupes-prefix 1 2\n";
+  for (std::string const &record :
+       {std::string("d0\t-1\ttest"), std::string("d1\t0\tx"),
+        std::string("d2\t0\ty"), "g0\t1\t" + zero_hex,
+        std::string("m1\ta.txt"), std::string("m2\ta.txt"),
+        "g1\t2\t" + zero_hex, std::string("m1\tb.txt"),
+        std::string("m2\tb.txt")}) {
+    expected_output += record;
+    expected_output += '\0';
+  }
+  assert(actual_output == expected_output);
+}
+
+void testWritingARootMemberAgainstAPrefixTable() {
+  // Arrange
+  duplicate_node_set test_set{};
+  test_set.tree.parents = {NO_PARENT, NO_PARENT};
+  test_set.tree.depths = {1, 1};
+  test_set.tree.path_segments = {"one", "two"};
+  test_set.tree.sizes = {3, 3};
+  test_set.tree.node_digests = std::vector<digest>(2, EMPTY_DIGEST);
+  test_set.members = {0, 1};
+  test_set.group_offsets = {0, 2};
+
+  // Act
+  std::string actual_output = writeTestGroups(OUTPUT_FORMAT_PREFIX, test_set);
+
+  // Assert
+  std::string expected_output = "ddupes-prefix 1 1\n";
+  for (std::string const &record :
+       {"g0\t3\t" + std::string(MD5_DIGEST_LENGTH * 2, '0'),
+        std::string("m-1\tone"), std::string("m-1\ttwo")}) {
+    expected_output += record;
+    expected_output += '\0';
+  }
+  assert(actual_output == expected_output);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testWritingHexDigest();
+  testWritingPlainJsonString();
+  testWritingJsonStringEscapesSpecialBytes();
+  testWritingJsonStringKeepsValidUtf8();
+  testWritingJsonStringEscapesInvalidUtf8();
+  testWritingPlainCsvField();
+  testWritingCsvFieldQuotesSpecialBytes();
+  testWritingGroupAsJsonl();
+  testWritingGroupSharingItsExtentsAsJsonl();
+  testWritingGroupAsNullDelimited();
+  testWritingGroupAsCsv();
+  testWritingAnEmptyGroupWritesNothing();
+  testWritingGroupsAgainstAPrefixTable();
+  testWritingARootMemberAgainstAPrefixTable();
+}
@@ -1,83 +1,154 @@
 #include <cassert>
+#include <cstring>
 #include <sstream>
 
+#include "../../src/dupes/format.cpp"
 #include "../../src/dupes/load.cpp"
+#include "../../src/dupes/sink.cpp"
+#include "../../src/thread/parallel.cpp"
 
 /* -------------------------------------------------------------------------- */
-/*                                    Tests                                   */
+/*                                    Mocks                                   */
 /* -------------------------------------------------------------------------- */
-/* ---------------------------- convertToStrings ---------------------------- */
-void testConvertingToStrings() {
-  // Arrange
-  duplicate_path_seg_set test_sorted_duplicate_inodes_set = {
-      {{"test", "example_one.txt"}, {"test", "sub-dir", "example_one.txt"}},
-      {{"test", "dir1"}, {"test", "dir2"}},
-      {{"test", "sub-dir", "example_four.txt"},
-       {"test", "sub-dir", "example_three.txt"}},
-      {{"test", "dir1", "dir2", "dir3", "example_two.txt"},
-       {"testing", "dir1", "dir2", "dir3", "dir4", "example_two.txt"},
-       {"testing", "dir1", "dir2", "dir3", "dir4", "dir5", "example_two.txt"}}};
+void writeFileDescriptor(int file_descriptor, char const *data,
+                         std::size_t length) {}
 
-  // Act
-  str_duplicate_path_seg_set actual_sorted_duplicate_inodes_set_string =
-      convertToStrings(test_sorted_duplicate_inodes_set);
+std::vector<std::string> last_flushes{};
 
-  // Assert
-  str_duplicate_path_seg_set expected_sorted_duplicate_inodes_set_string = {
-      {{"test", "example_one.txt"}, {"test", "sub-dir", "example_one.txt"}},
-      {{"test", "dir1"}, {"test", "dir2"}},
-      {{"test", "sub-dir", "example_four.txt"},
-       {"test", "sub-dir", "example_three.txt"}},
-      {{"test", "dir1", "dir2", "dir3", "example_two.txt"},
-       {"testing", "dir1", "dir2", "dir3", "dir4", "example_two.txt"},
-       {"testing", "dir1", "dir2", "dir3", "dir4", "dir5", "example_two.txt"}}};
-  assert(actual_sorted_duplicate_inodes_set_string ==
-         expected_sorted_duplicate_inodes_set_string);
+void recordFlush(char const *data, std::size_t length, void *context) {
+  last_flushes.push_back(std::string(data, length));
+}
+
+typedef std::vector<char const *> test_path;
+typedef std::vector<std::vector<test_path>> test_path_groups;
+typedef std::vector<std::vector<std::string>> test_rendered_groups;
+
+std::size_t insertTestPath(inode_tree &tree, test_path const &path) {
+  std::size_t parent = NO_PARENT;
+
+  for (std::size_t i = 0; i < path.size(); ++i) {
+    std::size_t node = NO_PARENT;
+    for (std::size_t j = 0; j < tree.parents.size(); ++j) {
+      if (tree.parents[j] == parent &&
+          std::strcmp(tree.path_segments[j], path[i]) == 0) {
+        node = j;
+        break;
+      }
+    }
+
+    if (node == NO_PARENT) {
+      node = tree.parents.size();
+      tree.parents.push_back(parent);
+      tree.depths.push_back(i + 1);
+      tree.path_segments.push_back(path[i]);
+    }
+
+    parent = node;
+  }
+
+  return parent;
+}
+
+/**
+ * Builds the tree and groups for the paths. Paths sharing a prefix share the
+ * nodes of that prefix.
+ */
+duplicate_node_set createTestSet(test_path_groups const &path_groups) {
+  duplicate_node_set test_set{};
+
+  for (std::vector<test_path> const &paths : path_groups) {
+    for (test_path const &path : paths) {
+      test_set.members.push_back(insertTestPath(test_set.tree, path));
+    }
+    test_set.group_offsets.push_back(test_set.members.size());
+  }
+
+  return test_set;
+}
+
+/**
+ * Every member of a group gets the group's size.
+ */
+duplicate_node_set createSizedTestSet(test_path_groups const &path_groups,
+                                      std::vector<int64_t> const &sizes) {
+  duplicate_node_set test_set = createTestSet(path_groups);
+  test_set.tree.sizes.resize(test_set.tree.parents.size(), 0);
+  for (std::size_t group = 0; group < test_set.size(); ++group) {
+    for (std::size_t i = 0; i < test_set.groupSize(group); ++i) {
+      test_set.tree.sizes[test_set.groupMembers(group)[i]] = sizes[group];
+    }
+  }
+
+  return test_set;
 }
 
-/* ---------------------------- joinVectorString ---------------------------- */
-void testJoiningAVectorString() {
+load_options const TEST_PATH_OPTIONS{
+    .sort = GROUP_SORT_PATH, .top = 0, .window = 0};
+
+test_rendered_groups renderTestSet(duplicate_node_set const &test_set) {
+  test_rendered_groups rendered_groups{};
+  std::vector<char const *> segment_stack{};
+
+  for (std::size_t group = 0; group < test_set.size(); ++group) {
+    std::vector<std::string> rendered_paths{};
+    for (std::size_t i = 0; i < test_set.groupSize(group); ++i) {
+      std::string path{};
+      renderPath(test_set.tree, test_set.groupMembers(group)[i], segment_stack,
+                 path);
+      rendered_paths.push_back(path);
+    }
+    rendered_groups.push_back(rendered_paths);
+  }
+
+  return rendered_groups;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ------------------------------- renderPath ------------------------------- */
+void testRenderingAPath() {
   // Arrange
-  str_path_segments test_vector_string = {"test", "test_two", "test_three",
-                                          "example_one.txt"};
+  duplicate_node_set test_set = createTestSet(
+      {{{"test", "test_two", "test_three", "example_one.txt"}}});
+  std::vector<char const *> test_segment_stack{};
+  std::string actual_path = "left over";
 
   // Act
-  std::string actual_joined_string = joinVectorString(test_vector_string, '/');
+  renderPath(test_set.tree, test_set.members[0], test_segment_stack,
+             actual_path);
 
   // Assert
-  std::string expected_joined_string =
-      "test/test_two/test_three/example_one.txt";
-  assert(actual_joined_string == expected_joined_string);
+  std::string expected_path = "test/test_two/test_three/example_one.txt";
+  assert(actual_path == expected_path);
 }
 
-/* ------------------------- joinDuplicateINodePaths ------------------------ */
-void testJoiningPathsWithDelimiter() {
+void testRenderingTheRoot() {
   // Arrange
-  str_duplicate_path_seg_set test_duplicate_i_nodes_set = {
-      {{"test", "example_one.txt"}, {"test", "sub-dir", "example_one.txt"}},
-      {{"test", "dir1"}, {"test", "dir2"}}};
+  duplicate_node_set test_set = createTestSet({{{"test"}}});
+  std::vector<char const *> test_segment_stack{};
+  std::string actual_path{};
 
   // Act
-  duplicate_inode_output actual_join_output =
-      joinDuplicateINodePaths(test_duplicate_i_nodes_set, '/');
+  renderPath(test_set.tree, test_set.members[0], test_segment_stack,
+             actual_path);
 
   // Assert
-  duplicate_inode_output expected_join_output = {
-      {"test/example_one.txt", "test/sub-dir/example_one.txt"},
-      {"test/dir1", "test/dir2"}};
-  assert(expected_join_output == actual_join_output);
+  assert(actual_path == "test");
 }
 
-/* ------------------------- printDuplicateINodeSet ------------------------- */
+/* -------------------------- printDuplicateNodeSet ------------------------- */
 void testPrintingDuplicateToScreen() {
   // Arrange
   std::ostringstream mock_cout{};
-  duplicate_inode_output test_duplicate_i_node_output = {
-      {"test/example_one.txt", "test/sub-dir/example_one.txt"},
-      {"test/dir1", "test/dir2"}};
+  duplicate_node_set test_set = createTestSet(
+      {{{"test", "example_one.txt"}, {"test", "sub-dir", "example_one.txt"}},
+       {{"test", "dir1"}, {"test", "dir2"}}});
 
   // Act
-  printDuplicateINodeSet(mock_cout, test_duplicate_i_node_output);
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+  printDuplicateNodeSet(test_sink, test_set, TEST_PATH_OPTIONS);
+  flushSink(test_sink);
   std::string actual_output = mock_cout.str();
 
   // Assert
@@ -92,15 +163,55 @@ void testPrintingDuplicateToScreen() {
   assert(actual_output == expected_output);
 }
 
+void testPrintingGroupsSharingTheirExtents() {
+  // Arrange
+  std::ostringstream mock_cout{};
+  duplicate_node_set test_set = createTestSet(
+      {{{"test", "a.txt"}, {"test", "b.txt"}},
+       {{"test", "c.txt"}, {"test", "d.txt"}}});
+  test_set.shared_extents = {false, true};
+
+  // Act
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+  printDuplicateNodeSet(test_sink, test_set, TEST_PATH_OPTIONS);
+  flushSink(test_sink);
+
+  // Assert
+  assert(mock_cout.str() == "2 Sets of Duplicates Found:\n"
+                            "\n"
+                            "test/a.txt\n"
+                            "test/b.txt\n"
+                            "\n"
+                            "Members share all their extents already:\n"
+                            "test/c.txt\n"
+                            "test/d.txt\n");
+}
+
+void testPrintingNoDuplicates() {
+  // Arrange
+  std::ostringstream mock_cout{};
+  duplicate_node_set test_set{};
+
+  // Act
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+  printDuplicateNodeSet(test_sink, test_set, TEST_PATH_OPTIONS);
+  flushSink(test_sink);
+
+  // Assert
+  assert(mock_cout.str() == "0 Sets of Duplicates Found:\n\n");
+}
+
 /* ------------------------------- comparePath ------------------------------ */
 void testComparingPathReturnsBefore() {
   // Arrange
-  str_path_segments path_one = {"testing", "apples", "apple",          "dir3",
-                                "dir4",    "dir5",   "example_two.txt"};
-  str_path_segments path_two = {"testing", "apples", "test", "example_two.txt"};
+  duplicate_node_set test_set = createTestSet(
+      {{{"testing", "apples", "apple", "dir3", "dir4", "dir5",
+         "example_two.txt"},
+        {"testing", "apples", "test", "example_two.txt"}}});
 
   // Act
-  bool actual_sort_result = comparePath(path_one, path_two);
+  bool actual_sort_result =
+      comparePath(test_set.tree, test_set.members[0], test_set.members[1]);
 
   // Assert
   assert(actual_sort_result == true);
@@ -108,12 +219,42 @@ void testComparingPathReturnsBefore() {
 
 void testComparingSizeWhenBothPathsHaveEqualParts() {
   // Arrange
-  str_path_segments path_one = {"testing", "apples", "example_two",    "dir3",
-                                "dir4",    "dir5",   "example_two.txt"};
-  str_path_segments path_two = {"testing", "apples", "example_two"};
+  duplicate_node_set test_set = createTestSet(
+      {{{"testing", "apples", "example_two", "dir3", "dir4", "dir5",
+         "example_two.txt"},
+        {"testing", "apples", "example_two"}}});
+
+  // Act
+  bool actual_sort_result =
+      comparePath(test_set.tree, test_set.members[0], test_set.members[1]);
+
+  // Assert
+  assert(actual_sort_result == false);
+}
+
+void testComparingPathsWithDifferentRoots() {
+  // Arrange
+  duplicate_node_set test_set =
+      createTestSet({{{"testing", "dir1", "example_two.txt"},
+                      {"test", "dir1", "dir2", "example_two.txt"}}});
+
+  // Act
+  bool actual_sort_result =
+      comparePath(test_set.tree, test_set.members[0], test_set.members[1]);
+
+  // Assert
+  assert(actual_sort_result == false);
+}
+
+void testComparingLastSegmentWhenSameLength() {
+  // Arrange
+  duplicate_node_set test_set =
+      createTestSet({{{"test", "sub-dir", "example_three.txt"},
+                      {"test", "sub-dir", "example_four.txt"}}});
 
   // Act
-  bool actual_sort_result = comparePath(path_one, path_two);
+  bool actual_sort_result =
+      comparePath(test_set.tree, test_set.members[0], test_set.members[1]);
 
   // Assert
   assert(actual_sort_result == false);
@@ -122,17 +263,16 @@ void testComparingSizeWhenBothPathsHaveEqualParts() {
 /* ------------------------ shortestPathAndLeastCount ----------------------- */
 void testComparingPathsReturnsBefore() {
   // Arrange
-  str_duplicate_path_segments paths_one = {
-      {"testing", "apples", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
-      {"test", "oranges", "dir2", "example_one.txt"},
-  };
-  str_duplicate_path_segments paths_two = {
-      {"testing", "apples", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
-      {"test", "oranges", "dir2", "dir3", "example_two.txt"},
-  };
+  duplicate_node_set test_set = createTestSet(
+      {{{"testing", "apples", "dir2", "dir3", "dir4", "dir5",
+         "example_two.txt"},
+        {"test", "oranges", "dir2", "example_one.txt"}},
+       {{"testing", "apples", "dir2", "dir3", "dir4", "dir5",
+         "example_two.txt"},
+        {"test", "oranges", "dir2", "dir3", "example_two.txt"}}});
 
   // Act
-  bool actual_sort_result = shortestPathAndLeastCount(paths_one, paths_two);
+  bool actual_sort_result = shortestPathAndLeastCount(test_set, 0, 1);
 
   // Assert
   assert(actual_sort_result == true);
@@ -140,20 +280,19 @@ void testComparingPathsReturnsBefore() {
 
 void testComparingPathCountReturnsBefore() {
   // Arrange
-  str_duplicate_path_segments paths_one = {
-      {"testing", "apples", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
-      {"test", "oranges", "dir2", "example_one.txt"},
-      {"test", "oranges", "dir2", "example_one.txt"},
-  };
-  str_duplicate_path_segments paths_two = {
-      {"testing", "apples", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
-      {"test", "oranges", "dir2", "example_one.txt"},
-      {"test", "oranges", "dir2", "example_one.txt"},
-      {"test", "oranges", "dir2", "example_one.txt"},
-  };
+  duplicate_node_set test_set = createTestSet(
+      {{{"testing", "apples", "dir2", "dir3", "dir4", "dir5",
+         "example_two.txt"},
+        {"test", "oranges", "dir2", "example_one.txt"},
+        {"test", "oranges", "dir2", "example_one.txt"}},
+       {{"testing", "apples", "dir2", "dir3", "dir4", "dir5",
+         "example_two.txt"},
+        {"test", "oranges", "dir2", "example_one.txt"},
+        {"test", "oranges", "dir2", "example_one.txt"},
+        {"test", "oranges", "dir2", "example_one.txt"}}});
 
   // Act
-  bool actual_sort_result = shortestPathAndLeastCount(paths_one, paths_two);
+  bool actual_sort_result = shortestPathAndLeastCount(test_set, 0, 1);
 
   // Assert
   assert(actual_sort_result == true);
@@ -161,18 +300,17 @@ void testComparingPathCountReturnsBefore() {
 
 void testComparingLessPathsButLonger() {
   // Arrange
-  str_duplicate_path_segments paths_one = {
-      {"testing", "apples", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
-      {"test", "oranges", "dir2", "example_one.txt"},
-  };
-  str_duplicate_path_segments paths_two = {
-      {"testing", "apples", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
-      {"test", "example_one.txt"},
-      {"test", "example_one.txt"},
-  };
+  duplicate_node_set test_set = createTestSet(
+      {{{"testing", "apples", "dir2", "dir3", "dir4", "dir5",
+         "example_two.txt"},
+        {"test", "oranges", "dir2", "example_one.txt"}},
+       {{"testing", "apples", "dir2", "dir3", "dir4", "dir5",
+         "example_two.txt"},
+        {"test", "example_one.txt"},
+        {"test", "example_one.txt"}}});
 
   // Act
-  bool actual_sort_result = shortestPathAndLeastCount(paths_one, paths_two);
+  bool actual_sort_result = shortestPathAndLeastCount(test_set, 0, 1);
 
   // Assert
   assert(actual_sort_result == false);
@@ -181,68 +319,392 @@ void testComparingLessPathsButLonger() {
 /* -------------------------------- sortPaths ------------------------------- */
 void testSortingPaths() {
   // Arrange
-  str_duplicate_path_segments test_duplicate_paths = {
-      {"testing", "apples", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
-      {"test", "oranges", "dir2", "dir3", "example_two.txt"},
-      {"test", "oranges", "apples", "dir3", "example_two.txt"},
-      {"test", "oranges", "potatoe", "dir3", "example_two.txt"},
-      {"testing", "cats", "dir2", "dir3", "dir4", "example_two.txt"}};
+  duplicate_node_set test_set = createTestSet(
+      {{{"testing", "apples", "dir2", "dir3", "dir4", "dir5",
+         "example_two.txt"},
+        {"test", "oranges", "dir2", "dir3", "example_two.txt"},
+        {"test", "oranges", "apples", "dir3", "example_two.txt"},
+        {"test", "oranges", "potatoe", "dir3", "example_two.txt"},
+        {"testing", "cats", "dir2", "dir3", "dir4", "example_two.txt"}}});
+
+  // Act
+  sortPaths(test_set, 0);
+
+  // Assert
+  test_rendered_groups expected_paths = {
+      {"test/oranges/apples/dir3/example_two.txt",
+       "test/oranges/dir2/dir3/example_two.txt",
+       "test/oranges/potatoe/dir3/example_two.txt",
+       "testing/apples/dir2/dir3/dir4/dir5/example_two.txt",
+       "testing/cats/dir2/dir3/dir4/example_two.txt"}};
+
+  assert(renderTestSet(test_set) == expected_paths);
+}
+
+/* -------------------------- sortDuplicateNodeSet -------------------------- */
+void testSortingDuplicateNodeSet() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet(
+      {{{"test", "sub-dir", "example_three.txt"},
+        {"test", "sub-dir", "example_four.txt"}},
+       {{"test", "example_one.txt"}, {"test", "sub-dir", "example_one.txt"}},
+       {{"test", "dir1"}, {"test", "dir2"}},
+       {{"testing", "dir1", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
+        {"test", "dir1", "dir2", "dir3", "example_two.txt"},
+        {"testing", "dir1", "dir2", "dir3", "dir4", "example_two.txt"}}});
 
   // Act
-  sortPaths(test_duplicate_paths);
+  sortDuplicateNodeSet(test_set, TEST_PATH_OPTIONS);
 
   // Assert
-  str_duplicate_path_segments expected_duplicate_paths = {
-      {"test", "oranges", "apples", "dir3", "example_two.txt"},
-      {"test", "oranges", "dir2", "dir3", "example_two.txt"},
-      {"test", "oranges", "potatoe", "dir3", "example_two.txt"},
-      {"testing", "apples", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
-      {"testing", "cats", "dir2", "dir3", "dir4", "example_two.txt"}};
+  test_rendered_groups expected_sorted_groups = {
+      {"test/example_one.txt", "test/sub-dir/example_one.txt"},
+      {"test/dir1", "test/dir2"},
+      {"test/sub-dir/example_four.txt", "test/sub-dir/example_three.txt"},
+      {"test/dir1/dir2/dir3/example_two.txt",
+       "testing/dir1/dir2/dir3/dir4/example_two.txt",
+       "testing/dir1/dir2/dir3/dir4/dir5/example_two.txt"}};
+
+  assert(renderTestSet(test_set) == expected_sorted_groups);
+}
+
+void testSortingDuplicateNodeSetByBytes() {
+  // Arrange
+  duplicate_node_set test_set = createSizedTestSet(
+      {{{"test", "a.txt"}, {"test", "b.txt"}},
+       {{"test", "c.txt"}, {"test", "d.txt"}, {"test", "e.txt"}},
+       {{"test", "dir1"}, {"test", "dir2"}},
+       {{"test", "f.txt"}, {"test", "g.txt"}}},
+      {100, 60, 500, 100});
+
+  // Act
+  sortDuplicateNodeSet(test_set,
+                       {.sort = GROUP_SORT_BYTES, .top = 0, .window = 0});
 
-  assert(test_duplicate_paths == expected_duplicate_paths);
+  // Assert
+  test_rendered_groups expected_sorted_groups = {
+      {"test/dir1", "test/dir2"},
+      {"test/c.txt", "test/d.txt", "test/e.txt"},
+      {"test/a.txt", "test/b.txt"},
+      {"test/f.txt", "test/g.txt"}};
+  assert(renderTestSet(test_set) == expected_sorted_groups);
 }
 
-/* ------------------------- sortDuplicateINodesSet ------------------------- */
-void testSortingDuplicateINodesSet() {
+void testSortingDuplicateNodeSetMovesSharedExtentsWithTheirGroups() {
   // Arrange
-  str_duplicate_path_seg_set test_duplicate_i_nodes_set = {
-      {{"test", "sub-dir", "example_three.txt"},
-       {"test", "sub-dir", "example_four.txt"}},
-      {{"test", "example_one.txt"}, {"test", "sub-dir", "example_one.txt"}},
-      {{"test", "dir1"}, {"test", "dir2"}},
-      {{"testing", "dir1", "dir2", "dir3", "dir4", "dir5", "example_two.txt"},
-       {"test", "dir1", "dir2", "dir3", "example_two.txt"},
-       {"testing", "dir1", "dir2", "dir3", "dir4", "example_two.txt"}}};
+  duplicate_node_set test_set = createSizedTestSet(
+      {{{"test", "a.txt"}, {"test", "b.txt"}},
+       {{"test", "c.txt"}, {"test", "d.txt"}},
+       {{"test", "e.txt"}, {"test", "f.txt"}}},
+      {100, 500, 300});
+  test_set.shared_extents = {false, true, false};
 
   // Act
-  sortDuplicateINodesSet(test_duplicate_i_nodes_set);
+  sortDuplicateNodeSet(test_set,
+                       {.sort = GROUP_SORT_BYTES, .top = 0, .window = 0});
 
   // Assert
-  str_duplicate_path_seg_set expected_sorted_duplicate_i_nodes_set = {
-      {{"test", "example_one.txt"}, {"test", "sub-dir", "example_one.txt"}},
-      {{"test", "dir1"}, {"test", "dir2"}},
-      {{"test", "sub-dir", "example_four.txt"},
-       {"test", "sub-dir", "example_three.txt"}},
-      {{"test", "dir1", "dir2", "dir3", "example_two.txt"},
-       {"testing", "dir1", "dir2", "dir3", "dir4", "example_two.txt"},
-       {"testing", "dir1", "dir2", "dir3", "dir4", "dir5", "example_two.txt"}}};
+  test_rendered_groups expected_sorted_groups = {
+      {"test/e.txt", "test/f.txt"},
+      {"test/a.txt", "test/b.txt"},
+      {"test/c.txt", "test/d.txt"}};
+  assert(renderTestSet(test_set) == expected_sorted_groups);
+  assert(test_set.shared_extents == (std::vector<bool>{false, false, true}));
+}
+
+void testSortingDuplicateNodeSetKeepsTheTopGroups() {
+  // Arrange
+  test_path_groups test_groups{};
+  std::vector<int64_t> test_sizes{};
+  std::vector<std::string> test_names{};
+  for (int i = 0; i < 20; ++i) {
+    test_names.push_back("file_" + std::to_string(i) + ".txt");
+    test_names.push_back("copy_" + std::to_string(i) + ".txt");
+    test_sizes.push_back((i * 7) % 20);
+  }
+  for (int i = 0; i < 20; ++i) {
+    test_groups.push_back({{"test", test_names[2 * i].c_str()},
+                           {"test", test_names[2 * i + 1].c_str()}});
+  }
+  duplicate_node_set test_set = createSizedTestSet(test_groups, test_sizes);
+
+  // Act
+  sortDuplicateNodeSet(test_set,
+                       {.sort = GROUP_SORT_BYTES, .top = 3, .window = 0});
 
-  assert(test_duplicate_i_nodes_set == expected_sorted_duplicate_i_nodes_set);
+  // Assert
+  assert(test_set.size() == 3);
+  assert(reclaimableBytes(test_set, 0) == 19);
+  assert(reclaimableBytes(test_set, 1) == 18);
+  assert(reclaimableBytes(test_set, 2) == 17);
+  assert(test_set.members.size() == 6);
+}
+
+void testSortingDuplicateNodeSetKeepsTheTopGroupsByPath() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet(
+      {{{"test", "sub-dir", "example_three.txt"},
+        {"test", "sub-dir", "example_four.txt"}},
+       {{"test", "example_one.txt"}, {"test", "sub-dir", "example_one.txt"}},
+       {{"test", "dir1"}, {"test", "dir2"}}});
+
+  // Act
+  sortDuplicateNodeSet(test_set,
+                       {.sort = GROUP_SORT_PATH, .top = 2, .window = 0});
+
+  // Assert
+  test_rendered_groups expected_sorted_groups = {
+      {"test/example_one.txt", "test/sub-dir/example_one.txt"},
+      {"test/dir1", "test/dir2"}};
+  assert(renderTestSet(test_set) == expected_sorted_groups);
+}
+
+/* ------------------------------ buildSortKeys ----------------------------- */
+void testBuildingSortKeys() {
+  // Arrange
+  duplicate_node_set test_set = createSizedTestSet(
+      {{{"test", "a.txt"}, {"test", "b.txt"}},
+       {{"test", "dir", "c.txt"}, {"test", "d.txt"}, {"test", "e.txt"}}},
+      {10, 20});
+
+  // Act
+  std::vector<group_sort_key> actual_keys =
+      buildSortKeys(test_set, GROUP_SORT_BYTES, 0, test_set.size());
+
+  // Assert
+  assert(actual_keys.size() == 2);
+  assert(actual_keys[0].bytes == 10);
+  assert(actual_keys[0].shortest_path == 2);
+  assert(actual_keys[0].member_count == 2);
+  assert(actual_keys[0].group == 0);
+  assert(actual_keys[1].bytes == 40);
+  assert(actual_keys[1].shortest_path == 2);
+  assert(actual_keys[1].member_count == 3);
+  assert(actual_keys[1].group == 1);
+}
+
+void testBuildingSortKeysByPathLeavesOutBytes() {
+  // Arrange
+  duplicate_node_set test_set =
+      createSizedTestSet({{{"test", "a.txt"}, {"test", "b.txt"}}}, {10});
+
+  // Act
+  std::vector<group_sort_key> actual_keys =
+      buildSortKeys(test_set, GROUP_SORT_PATH, 0, test_set.size());
+
+  // Assert
+  assert(actual_keys[0].bytes == 0);
+}
+
+/* -------------------------------- sortKeys -------------------------------- */
+void testSortingKeysAcrossThreadsMatchesOneThread() {
+  // Arrange
+  std::vector<group_sort_key> test_keys{};
+  for (std::size_t i = 0; i < 50000; ++i) {
+    test_keys.push_back({.bytes = static_cast<int64_t>((i * 7919) % 97),
+                         .shortest_path = static_cast<int>((i * 31) % 5),
+                         .member_count = (i * 13) % 4 + 2,
+                         .group = i});
+  }
+  std::vector<group_sort_key> expected_keys = test_keys;
+  std::sort(expected_keys.begin(), expected_keys.end(), keyBefore);
+  setThreadCount(4);
+
+  // Act
+  sortKeys(test_keys);
+
+  // Assert
+  assert(keyGroups(test_keys) == keyGroups(expected_keys));
+
+  // Cleanup
+  setThreadCount(0);
+}
+
+/* ---------------------------- reclaimableBytes ---------------------------- */
+void testReclaimableBytesCountsAllButOneMember() {
+  // Arrange
+  duplicate_node_set test_set = createSizedTestSet(
+      {{{"test", "a.txt"}, {"test", "b.txt"}, {"test", "c.txt"}}}, {40});
+
+  // Act
+  int64_t actual_bytes = reclaimableBytes(test_set, 0);
+
+  // Assert
+  assert(actual_bytes == 80);
+}
+
+void testReclaimableBytesOfSharedExtentsIsZero() {
+  // Arrange
+  duplicate_node_set test_set = createSizedTestSet(
+      {{{"test", "a.txt"}, {"test", "b.txt"}},
+       {{"test", "c.txt"}, {"test", "d.txt"}}},
+      {40, 40});
+  test_set.shared_extents = {true, false};
+
+  // Act & Assert
+  assert(reclaimableBytes(test_set, 0) == 0);
+  assert(reclaimableBytes(test_set, 1) == 40);
+}
+
+/* ---------------------------------- load ---------------------------------- */
+void testLoadingSortsAndPrints() {
+  // Arrange
+  std::ostringstream mock_cout{};
+  duplicate_node_set test_set =
+      createTestSet({{{"test", "dir2"}, {"test", "dir1"}},
+                     {{"test", "b.txt"}, {"test", "a.txt"}, {"test", "c.txt"}},
+                     {{"test", "e.txt"}, {"test", "d.txt"}}});
+
+  // Act
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+  load(test_sink, test_set, TEST_PATH_OPTIONS);
+
+  // Assert
+  std::string expected_output = "3 Sets of Duplicates Found:\n"
+                                "\n"
+                                "test/dir1\n"
+                                "test/dir2\n"
+                                "\n"
+                                "test/d.txt\n"
+                                "test/e.txt\n"
+                                "\n"
+                                "test/a.txt\n"
+                                "test/b.txt\n"
+                                "test/c.txt\n";
+  assert(mock_cout.str() == expected_output);
+}
+
+void testLoadingTheTopGroupsByBytes() {
+  // Arrange
+  std::ostringstream mock_cout{};
+  duplicate_node_set test_set = createSizedTestSet(
+      {{{"test", "b.txt"}, {"test", "a.txt"}},
+       {{"test", "dir2"}, {"test", "dir1"}},
+       {{"test", "d.txt"}, {"test", "c.txt"}, {"test", "e.txt"}}},
+      {10, 300, 50});
+
+  // Act
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+  load(test_sink, test_set, {.sort = GROUP_SORT_BYTES, .top = 2, .window = 0});
+
+  // Assert
+  std::string expected_output = "Showing the top 2 of 3 Sets of Duplicates.\n"
+                                "2 Sets of Duplicates Found:\n"
+                                "\n"
+                                "300 bytes reclaimable:\n"
+                                "test/dir1\n"
+                                "test/dir2\n"
+                                "\n"
+                                "100 bytes reclaimable:\n"
+                                "test/c.txt\n"
+                                "test/d.txt\n"
+                                "test/e.txt\n";
+  assert(mock_cout.str() == expected_output);
+}
+
+void testLoadingInWindowsFlushesEachWindow() {
+  // Arrange
+  last_flushes.clear();
+  duplicate_node_set test_set =
+      createTestSet({{{"test", "dir", "d.txt"}, {"test", "dir", "c.txt"}},
+                     {{"test", "b.txt"}, {"test", "a.txt"}},
+                     {{"test", "f.txt"}, {"test", "e.txt"}}});
+  output_sink test_sink = initOutputSink(recordFlush, nullptr);
+
+  // Act
+  load(test_sink, test_set, {.sort = GROUP_SORT_PATH, .top = 0, .window = 2});
+
+  // Assert
+  std::vector<std::string> expected_flushes{"3 Sets of Duplicates Found:\n"
+                                            "\n"
+                                            "test/a.txt\n"
+                                            "test/b.txt\n"
+                                            "\n"
+                                            "test/dir/c.txt\n"
+                                            "test/dir/d.txt\n",
+                                            "\n"
+                                            "test/e.txt\n"
+                                            "test/f.txt\n"};
+  assert(last_flushes == expected_flushes);
+}
+
+void testLoadingWithTopIgnoresTheWindow() {
+  // Arrange
+  last_flushes.clear();
+  duplicate_node_set test_set =
+      createTestSet({{{"test", "dir", "d.txt"}, {"test", "dir", "c.txt"}},
+                     {{"test", "b.txt"}, {"test", "a.txt"}},
+                     {{"test", "f.txt"}, {"test", "e.txt"}}});
+  output_sink test_sink = initOutputSink(recordFlush, nullptr);
+
+  // Act
+  load(test_sink, test_set, {.sort = GROUP_SORT_PATH, .top = 1, .window = 1});
+
+  // Assert
+  std::vector<std::string> expected_flushes{
+      "Showing the top 1 of 3 Sets of Duplicates.\n"
+      "1 Sets of Duplicates Found:\n"
+      "\n"
+      "test/a.txt\n"
+      "test/b.txt\n"};
+  assert(last_flushes == expected_flushes);
+}
+
+void testLoadingAsJsonlWritesNoHeaders() {
+  // Arrange
+  std::ostringstream mock_cout{};
+  duplicate_node_set test_set = createSizedTestSet(
+      {{{"test", "b.txt"}, {"test", "a.txt"}},
+       {{"test", "d.txt"}, {"test", "c.txt"}}},
+      {10, 30});
+  test_set.tree.node_digests.resize(test_set.tree.parents.size(), EMPTY_DIGEST);
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+
+  // Act
+  load(test_sink, test_set,
+       {.sort = GROUP_SORT_BYTES,
+        .top = 1,
+        .window = 0,
+        .format = OUTPUT_FORMAT_JSONL});
+
+  // Assert
+  std::string expected_output =
+      "{\"group\":0,\"size\":30,\"digest\":"
+      "\"00000000000000000000000000000000\",\"members\":[\"test/c.txt\","
+      "\"test/d.txt\"]}\n";
+  assert(mock_cout.str() == expected_output);
 }
 
 /* -------------------------------------------------------------------------- */
 /*                                    Main                                    */
 /* -------------------------------------------------------------------------- */
 int main() {
-  testConvertingToStrings();
-  testJoiningAVectorString();
-  testJoiningPathsWithDelimiter();
+  testRenderingAPath();
+  testRenderingTheRoot();
   testPrintingDuplicateToScreen();
+  testPrintingGroupsSharingTheirExtents();
+  testPrintingNoDuplicates();
   testComparingPathReturnsBefore();
   testComparingSizeWhenBothPathsHaveEqualParts();
+  testComparingPathsWithDifferentRoots();
+  testComparingLastSegmentWhenSameLength();
   testComparingPathsReturnsBefore();
   testComparingPathCountReturnsBefore();
   testComparingLessPathsButLonger();
   testSortingPaths();
-  testSortingDuplicateINodesSet();
-}
\ No newline at end of file
+  testSortingDuplicateNodeSet();
+  testSortingDuplicateNodeSetByBytes();
+  testSortingDuplicateNodeSetMovesSharedExtentsWithTheirGroups();
+  testSortingDuplicateNodeSetKeepsTheTopGroups();
+  testSortingDuplicateNodeSetKeepsTheTopGroupsByPath();
+  testBuildingSortKeys();
+  testBuildingSortKeysByPathLeavesOutBytes();
+  testSortingKeysAcrossThreadsMatchesOneThread();
+  testReclaimableBytesCountsAllButOneMember();
+  testReclaimableBytesOfSharedExtentsIsZero();
+  testLoadingSortsAndPrints();
+  testLoadingTheTopGroupsByBytes();
+  testLoadingInWindowsFlushesEachWindow();
+  testLoadingWithTopIgnoresTheWindow();
+  testLoadingAsJsonlWritesNoHeaders();
+}
@@ -0,0 +1,154 @@
+#include <cassert>
+#include <sstream>
+
+#include "../../src/dupes/sink.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+int last_write_file_descriptor = -1;
+std::string last_write_file_descriptor_data{};
+
+void writeFileDescriptor(int file_descriptor, char const *data,
+                         std::size_t length) {
+  last_write_file_descriptor = file_descriptor;
+  last_write_file_descriptor_data.append(data, length);
+}
+
+std::vector<std::string> last_flushes{};
+
+void recordFlush(char const *data, std::size_t length, void *context) {
+  last_flushes.push_back(std::string(data, length));
+}
+
+void resetMockStates() {
+  last_write_file_descriptor = -1;
+  last_write_file_descriptor_data.clear();
+  last_flushes.clear();
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ----------------------------- writeSinkBytes ----------------------------- */
+void testWritingBuffersUntilFlushed() {
+  // Arrange
+  resetMockStates();
+  output_sink test_sink = initOutputSink(recordFlush, nullptr, 16);
+
+  // Act
+  writeSinkString(test_sink, "one ");
+  writeSinkString(test_sink, "two");
+  std::size_t flushes_before = last_flushes.size();
+  flushSink(test_sink);
+
+  // Assert
+  assert(flushes_before == 0);
+  std::vector<std::string> expected_flushes{"one two"};
+  assert(last_flushes == expected_flushes);
+}
+
+void testWritingFlushesWhenTheBufferFills() {
+  // Arrange
+  resetMockStates();
+  output_sink test_sink = initOutputSink(recordFlush, nullptr, 8);
+
+  // Act
+  writeSinkString(test_sink, "abcde");
+  writeSinkString(test_sink, "fghij");
+  flushSink(test_sink);
+
+  // Assert
+  std::vector<std::string> expected_flushes{"abcde", "fghij"};
+  assert(last_flushes == expected_flushes);
+}
+
+void testWritingMoreThanTheBufferSkipsIt() {
+  // Arrange
+  resetMockStates();
+  output_sink test_sink = initOutputSink(recordFlush, nullptr, 4);
+
+  // Act
+  writeSinkString(test_sink, "ab");
+  writeSinkString(test_sink, "longer than four");
+  flushSink(test_sink);
+
+  // Assert
+  std::vector<std::string> expected_flushes{"ab", "longer than four"};
+  assert(last_flushes == expected_flushes);
+}
+
+/* ---------------------------- writeSinkNumber ----------------------------- */
+void testWritingNumbers() {
+  // Arrange
+  resetMockStates();
+  output_sink test_sink = initOutputSink(recordFlush, nullptr, 64);
+
+  // Act
+  writeSinkNumber(test_sink, 0);
+  writeSinkString(test_sink, " ");
+  writeSinkNumber(test_sink, -42);
+  writeSinkString(test_sink, " ");
+  writeSinkNumber(test_sink, INT64_MAX);
+  flushSink(test_sink);
+
+  // Assert
+  std::vector<std::string> expected_flushes{"0 -42 9223372036854775807"};
+  assert(last_flushes == expected_flushes);
+}
+
+/* -------------------------------- flushSink ------------------------------- */
+void testFlushingAnEmptySinkDoesNothing() {
+  // Arrange
+  resetMockStates();
+  output_sink test_sink = initOutputSink(recordFlush, nullptr, 8);
+
+  // Act
+  flushSink(test_sink);
+
+  // Assert
+  assert(last_flushes.size() == 0);
+}
+
+void testFlushingToAFileDescriptor() {
+  // Arrange
+  resetMockStates();
+  int test_file_descriptor = 7;
+  output_sink test_sink =
+      initOutputSink(flushToFileDescriptor, &test_file_descriptor);
+
+  // Act
+  writeSinkString(test_sink, "written\n");
+  flushSink(test_sink);
+
+  // Assert
+  assert(last_write_file_descriptor == 7);
+  assert(last_write_file_descriptor_data == "written\n");
+}
+
+void testFlushingToAStream() {
+  // Arrange
+  resetMockStates();
+  std::ostringstream mock_cout{};
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+
+  // Act
+  writeSinkString(test_sink, "streamed\n");
+  flushSink(test_sink);
+
+  // Assert
+  assert(mock_cout.str() == "streamed\n");
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testWritingBuffersUntilFlushed();
+  testWritingFlushesWhenTheBufferFills();
+  testWritingMoreThanTheBufferSkipsIt();
+  testWritingNumbers();
+  testFlushingAnEmptySinkDoesNothing();
+  testFlushingToAFileDescriptor();
+  testFlushingToAStream();
+}
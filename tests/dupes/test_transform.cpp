@@ -1,19 +1,48 @@
 #include <cassert>
 #include <cstdint>
 
+#include "../../src/dupes/digest_map.cpp"
 #include "../../src/dupes/transform.cpp"
 #include "../../src/lib.cpp"
 #include "../../src/sqlite/operators.cpp"
+#include "../../src/thread/parallel.cpp"
 #include "../data.cpp"
 
 /* -------------------------------------------------------------------------- */
 /*                                    Mocks                                   */
 /* -------------------------------------------------------------------------- */
+digest_options const TEST_DIGEST_OPTIONS{.include_names = false};
+
 hash emptyTestHash() {
   return new uint8_t[MD5_DIGEST_LENGTH]{0, 0, 0, 0, 0, 0, 0, 0,
                                         0, 0, 0, 0, 0, 0, 0, 0};
 }
 
+typedef std::vector<char const *> path_segments;
+typedef std::vector<path_segments> duplicate_path_segments;
+typedef std::vector<duplicate_path_segments> duplicate_path_seg_set;
+
+duplicate_path_seg_set
+buildTestPathSegments(inode_tree const &tree,
+                      duplicate_node_set const &duplicate_nodes_set) {
+  duplicate_path_seg_set path_segments_set{};
+
+  for (std::size_t group = 0; group < duplicate_nodes_set.size(); ++group) {
+    duplicate_path_segments group_paths{};
+    for (std::size_t i = 0; i < duplicate_nodes_set.groupSize(group); ++i) {
+      std::size_t node = duplicate_nodes_set.groupMembers(group)[i];
+      path_segments path(tree.depths[node]);
+      for (std::size_t j = path.size(); j-- > 0; node = tree.parents[node]) {
+        path[j] = tree.path_segments[node];
+      }
+      group_paths.push_back(path);
+    }
+    path_segments_set.push_back(group_paths);
+  }
+
+  return path_segments_set;
+}
+
 void assertDuplicatePathSegments(duplicate_path_segments &segment_one,
                                  duplicate_path_segments &segment_two) {
   for (int i = 0; i < segment_one.size(); ++i) {
@@ -25,27 +54,22 @@ void assertDuplicatePathSegments(duplicate_path_segments &segment_one,
 
 void assertDuplicatePathSegmentsSet(duplicate_path_seg_set &segment_set_one,
                                     duplicate_path_seg_set &segment_set_two) {
+  assert(segment_set_one.size() == segment_set_two.size());
   for (int i = 0; i < segment_set_one.size(); ++i) {
     assertDuplicatePathSegments(segment_set_one[i], segment_set_two[i]);
   }
 }
 
-bool compareHashToInodes(hash_inode_map *one, hash_inode_map *two) {
-  hash_inode_map &one_reference = *one;
-  hash_inode_map &two_reference = *one;
-
-  for (auto iter = one_reference.begin(); iter != one_reference.end(); ++iter) {
-    if (one_reference[iter->first] != two_reference[iter->first]) {
-      return false;
-    }
-  }
+digest uniqueTestDigest(uint8_t byte) {
+  return toDigest(uniqueTestHash(byte));
+}
 
-  for (auto iter = two_reference.begin(); iter != two_reference.end(); ++iter) {
-    if (two_reference[iter->first] != one_reference[iter->first]) {
-      return false;
-    }
-  }
-  return true;
+std::vector<std::size_t> groupOfNode(duplicate_groups const &duplicates,
+                                     std::size_t node) {
+  std::size_t group = duplicates.groups.node_groups[node];
+  std::size_t const *members = duplicates.groups.groupMembers(group);
+  return std::vector<std::size_t>(members,
+                                  members + duplicates.groups.groupSize(group));
 }
 
 bool compareParentDirectoryMap(parent_directory_map_const map_one,
@@ -88,34 +112,27 @@ bool compareParentHashMap(parent_hash_map_const map_one,
   return true;
 }
 
-inode *createTestBranch(std::vector<char const *> path) {
-  // Create the branch.
-  inode cur_node = {static_cast<int>(path.size()),
-                    path[path.size() - 1],
-                    uniqueTestHash(),
-                    {}};
-  path.pop_back();
-
-  while (path.size() != 0) {
-    inode next_node = {static_cast<int>(path.size()),
-                       path[path.size() - 1],
-                       uniqueTestHash(),
-                       {cur_node}};
-    path.pop_back();
-    cur_node = next_node;
-  }
-
-  // Link the parent pointer.
-  inode *node_to_return = new inode{cur_node};
-  while (node_to_return->inodes.size() != 0) {
-    inode const *parent_pointer = node_to_return;
+inode_tree createTestTree(directory_table_row::rows const &directory_rows,
+                          hash_table_row::rows const &hash_rows) {
+  parent_directory_map directory_map = buildParentDirectoryMap(directory_rows);
+  parent_hash_map hash_map =
+      buildParentHashMap(hash_rows, directory_rows.size());
+  return buildINodeTree(directory_map, hash_map, &directory_rows[0]);
+}
 
-    node_to_return = &node_to_return->inodes[0];
-    node_to_return->parent_node = parent_pointer;
-  }
+/**
+ * apple
+ *  |- orange
+ *  |  |- pineapple
+ *  |- cherry
+ *  |  |- cocounut
+ *  |  |  |- testing
+ */
+directory_table_row::rows const test_branch_rows{
+    {1, "apple", -1}, {2, "orange", 1},   {3, "pineapple", 2},
+    {4, "cherry", 1}, {5, "cocounut", 4}, {6, "testing", 5}};
 
-  return node_to_return;
-}
+inode_tree createTestBranches() { return createTestTree(test_branch_rows, {}); }
 
 /* -------------------------------------------------------------------------- */
 /*                                    Tests                                   */
@@ -286,17 +303,18 @@ void testBuildingParentHashMapWithDirectoryIdEqualToSize() {
 
 void testBuildINodeTree() {
   // Arrange
-  directory_table_row::rows test_directory_rows{{1, "/", -1},
-                                                {2, "home", 1},
-                                                {3, "dir1", 2},
-                                                {4, "dir2", 2},
-                                                {5, "sub_dir", 4}};
+  directory_table_row::rows test_directory_rows{
+      {1, "/", -1},
+      {2, "home", 1},
+      {3, "dir1", 2},
+      {4, "dir2", 2},
+      {5, "sub_dir", 4, uniqueTestHash(7), 12}};
 
   hash_table_row::rows test_hash_rows = {
-      {1, 5, "testing1.txt", uniqueTestHash(128)},
-      {2, 4, "testing2.txt", uniqueTestHash(196)},
-      {3, 4, "testing3.txt", uniqueTestHash(200)},
-      {4, 3, "testing4.txt", uniqueTestHash(255)}};
+      {1, 5, "testing1.txt", uniqueTestHash(128), 12},
+      {2, 4, "testing2.txt", uniqueTestHash(196), 5},
+      {3, 4, "testing3.txt", uniqueTestHash(200), 7},
+      {4, 3, "testing4.txt", uniqueTestHash(255), 3}};
 
   parent_directory_map test_directory_maps =
       new std::vector<directory_table_row const *>[6]{
@@ -316,89 +334,101 @@ void testBuildINodeTree() {
       {&test_hash_rows[0]}};
 
   // Act
-  inode actual_directory_tree = buildINodeTree(
+  inode_tree actual_directory_tree = buildINodeTree(
       test_directory_maps, test_hash_maps, &test_directory_rows[0]);
 
   // Assert
-  std::vector<inode> dir2_inode;
-
-  inode expected_directory_tree{
-      1,
-      "/",
-      nullptr,
-      {inode{
-          2,
-          "home",
-          nullptr,
-          {
-              inode{3,
-                    "dir1",
-                    nullptr,
-                    {inode{4, "testing4.txt", uniqueTestHash(255)}}},
-              inode{3,
-                    "dir2",
-                    nullptr,
-                    {
-                        inode{4, "testing2.txt", uniqueTestHash(196)},
-                        inode{4, "testing3.txt", uniqueTestHash(200)},
-                        inode{4,
-                              "sub_dir",
-                              nullptr,
-                              {inode{5, "testing1.txt", uniqueTestHash(128)}}},
-                    }},
-          }}}};
+  inode_tree expected_directory_tree{
+      .parents = {NO_PARENT, 0, 1, 1, 2, 3, 3, 3, 7},
+      .first_children = {1, 2, 4, 5, 8, 8, 8, 8, 9},
+      .child_counts = {1, 2, 1, 3, 0, 0, 0, 1, 0},
+      .depths = {1, 2, 3, 3, 4, 4, 4, 4, 5},
+      .path_segments = {"/", "home", "dir1", "dir2", "testing4.txt",
+                        "testing2.txt", "testing3.txt", "sub_dir",
+                        "testing1.txt"},
+      .node_digests = {EMPTY_DIGEST, EMPTY_DIGEST, EMPTY_DIGEST, EMPTY_DIGEST,
+                       uniqueTestDigest(255), uniqueTestDigest(196),
+                       uniqueTestDigest(200), uniqueTestDigest(7),
+                       uniqueTestDigest(128)},
+      .sizes = {0, 0, 0, 0, 3, 5, 7, 12, 12},
+      .directory_ids = {1, 2, 3, 4, -1, -1, -1, 5, -1},
+      .dirty = {true, true, true, true, false, false, false, false, false}};
 
   assert(actual_directory_tree == expected_directory_tree);
 }
 
+/* -------------------------------- postOrder ------------------------------- */
+void testPostOrderVisitsChildrenBeforeParents() {
+  // Arrange
+  inode_tree test_tree = createTestBranches();
+
+  // Act
+  std::vector<std::size_t> actual_order = postOrder(test_tree);
+
+  // Assert
+  std::vector<std::size_t> expected_order{3, 1, 5, 4, 2, 0};
+  assert(actual_order == expected_order);
+}
+
+void testPostOrderOfEmptyTree() {
+  // Act
+  std::vector<std::size_t> actual_order = postOrder(inode_tree{});
+
+  // Assert
+  assert(actual_order.size() == 0);
+}
+
 /* ---------------------------- removeEmptyInodes --------------------------- */
 void testRemovingEmptyInodes() {
   // Arrange
-  inode test_directory_tree{
-      1,
-      "/",
-      nullptr,
-      {inode{2,
-             "home",
-             nullptr,
-             {
-                 inode{3,
-                       "dir1",
-                       nullptr,
-                       {inode{4, "testing4.txt", emptyTestHash()}}},
-                 inode{3,
-                       "dir2",
-                       nullptr,
-                       {
-                           inode{4, "testing2.txt", uniqueTestHash(196)},
-                           inode{4, "testing3.txt", emptyTestHash()},
-                           inode{4,
-                                 "sub_dir",
-                                 nullptr,
-                                 {inode{5, "testing1.txt", emptyTestHash()}}},
-                       }},
-             }}}};
+  inode_tree test_directory_tree =
+      createTestTree({{1, "/", -1},
+                      {2, "home", 1},
+                      {3, "dir1", 2},
+                      {4, "dir2", 2},
+                      {5, "sub_dir", 4}},
+                     {{1, 3, "testing4.txt", emptyTestHash()},
+                      {2, 4, "testing2.txt", uniqueTestHash(196)},
+                      {3, 4, "testing3.txt", emptyTestHash()},
+                      {4, 5, "testing1.txt", emptyTestHash()}});
+
+  // Act
+  removeEmptyINodes(test_directory_tree);
+
+  // Assert
+  inode_tree expected_directory_tree{
+      .parents = {NO_PARENT, 0, 1, 2},
+      .first_children = {1, 2, 3, 4},
+      .child_counts = {1, 1, 1, 0},
+      .depths = {1, 2, 3, 4},
+      .path_segments = {"/", "home", "dir2", "testing2.txt"},
+      .node_digests = {EMPTY_DIGEST, EMPTY_DIGEST, EMPTY_DIGEST,
+                       uniqueTestDigest(196)},
+      .sizes = {0, 0, 0, 0},
+      .directory_ids = {1, 2, 4, -1},
+      .dirty = {true, true, true, false}};
+
+  assert(test_directory_tree == expected_directory_tree);
+}
+
+void testRemovingEmptyInodesKeepsRoot() {
+  // Arrange
+  inode_tree test_directory_tree = createTestTree(
+      {{1, "/", -1}, {2, "home", 1}}, {{1, 2, "empty.txt", emptyTestHash()}});
+
   // Act
   removeEmptyINodes(test_directory_tree);
 
   // Assert
-  std::vector<inode> dir2_inode;
-
-  inode expected_directory_tree{
-      1,
-      "/",
-      nullptr,
-      {inode{2,
-             "home",
-             nullptr,
-             {
-                 inode{3,
-                       "dir2",
-                       nullptr,
-                       {
-                           inode{4, "testing2.txt", uniqueTestHash(196)},
-                       }},
-             }}}};
+  inode_tree expected_directory_tree{.parents = {NO_PARENT},
+                                     .first_children = {1},
+                                     .child_counts = {0},
+                                     .depths = {1},
+                                     .path_segments = {"/"},
+                                     .node_digests = {EMPTY_DIGEST},
+                                     .sizes = {0},
+                                     .directory_ids = {1},
+                                     .dirty = {true}};
 
   assert(test_directory_tree == expected_directory_tree);
 }
@@ -406,552 +436,459 @@ void testRemovingEmptyInodes() {
 /* ----------------------------- calculateHashes ---------------------------- */
 void testCalculateHashes() {
   // Arrange
-  hash testing1_hash = uniqueTestHash(128);
-  hash testing2_hash = uniqueTestHash(255);
-  hash testing3_hash = uniqueTestHash(255);
-  hash testing4_hash = uniqueTestHash(255);
-
-  inode test_inode_tree = {
-      1,
-      "/",
-      nullptr,
-      {inode{2,
-             "home",
-             nullptr,
-             {
-                 inode{3,
-                       "dir1",
-                       nullptr,
-                       {inode{4, "testing4.txt", testing4_hash}}},
-                 inode{3,
-                       "dir2",
-                       nullptr,
-                       {
-                           inode{4, "testing2.txt", testing2_hash},
-                           inode{4, "testing3.txt", testing3_hash},
-                           inode{4,
-                                 "sub_dir",
-                                 nullptr,
-                                 {inode{5, "testing1.txt", testing1_hash}}},
-                       }},
-             }}}};
+  inode_tree test_inode_tree =
+      createTestTree({{1, "/", -1},
+                      {2, "home", 1},
+                      {3, "dir1", 2},
+                      {4, "dir2", 2},
+                      {5, "sub_dir", 4}},
+                     {{1, 5, "testing1.txt", uniqueTestHash(128)},
+                      {2, 4, "testing2.txt", uniqueTestHash(255)},
+                      {3, 4, "testing3.txt", uniqueTestHash(255)},
+                      {4, 3, "testing4.txt", uniqueTestHash(255)}});
 
   // Act
-  hash_inode_map *actual_hash_inode_map = calculateHashes(test_inode_tree);
+  duplicate_groups actual_duplicates =
+      calculateHashes(test_inode_tree, TEST_DIGEST_OPTIONS);
 
   // Assert
-  inode *root = &test_inode_tree;
-  inode *home = &root->inodes[0];
-  inode *dir1 = &home->inodes[0];
-  inode *dir2 = &home->inodes[1];
-  inode *sub_dir = &dir2->inodes[2];
-  inode *testing1 = &sub_dir->inodes[0];
-  inode *testing2 = &dir2->inodes[0];
-  inode *testing3 = &dir2->inodes[1];
-  inode *testing4 = &dir1->inodes[0];
-
-  hash root_hash = new uint8_t[MD5_DIGEST_LENGTH]{
-      139, 187, 250, 74, 123, 89, 161, 14, 121, 7, 151, 95, 141, 249, 141, 0};
-  hash home_hash = new uint8_t[MD5_DIGEST_LENGTH]{
-      82, 85, 237, 207, 252, 9, 108, 132, 58, 114, 118, 2, 226, 6, 116, 158};
-  hash dir1_hash =
-      new uint8_t[MD5_DIGEST_LENGTH]{141, 121, 203, 201, 164, 236, 221, 225,
-                                     18,  252, 145, 186, 98,  91,  19,  194};
-  hash dir2_hash =
-      new uint8_t[MD5_DIGEST_LENGTH]{101, 127, 58, 62,  169, 162, 34, 100,
-                                     174, 254, 42, 142, 217, 195, 33, 252};
-  hash sub_dir_hash = new uint8_t[MD5_DIGEST_LENGTH]{
+  digest root_digest{65,  175, 128, 147, 48, 177, 29,  159,
+                     168, 71,  45,  209, 209, 57, 125, 65};
+  digest home_digest{187, 170, 65,  132, 243, 227, 117, 172,
+                     152, 43,  228, 121, 0,   23,  164, 187};
+  digest dir1_digest{141, 121, 203, 201, 164, 236, 221, 225,
+                     18,  252, 145, 186, 98,  91,  19,  194};
+  digest dir2_digest{252, 18, 81, 177, 168, 118, 3,   85,
+                     154, 188, 65, 6,  110, 45, 230, 248};
+  digest sub_dir_digest{
       87, 173, 90, 229, 249, 51, 197, 41, 238, 239, 72, 163, 217, 145, 137, 37};
-
-  inode expected_transformed_inode_tree = {
-      1,
-      "/",
-      root_hash,
-      {inode{
-          2,
-          "home",
-          home_hash,
-          {
-              inode{3,
-                    "dir1",
-                    dir1_hash,
-                    {inode{4, "testing4.txt", testing4_hash, {}, dir1}},
-                    home},
-              inode{
-                  3,
-                  "dir2",
-                  dir2_hash,
-                  {
-                      inode{4, "testing2.txt", testing2_hash, {}, dir2},
-                      inode{4, "testing3.txt", testing3_hash, {}, dir2},
-                      inode{4,
-                            "sub_dir",
-                            sub_dir_hash,
-                            {inode{
-                                5, "testing1.txt", testing1_hash, {}, sub_dir}},
-                            dir2},
-                  },
-                  home},
-          },
-          root}},
-      nullptr};
-
-  hash_inode_map *expected_hash_inode_map =
-      new hash_inode_map{{dir1_hash, {dir1}},
-                         {testing2_hash, {testing2, testing3, testing4}},
-                         {sub_dir_hash, {sub_dir}},
-                         {testing1_hash, {testing1}},
-                         {dir2_hash, {dir2}},
-                         {home_hash, {home}},
-                         {root_hash, {root}}};
-
-  assert(expected_transformed_inode_tree == test_inode_tree);
-  assert(compareHashToInodes(expected_hash_inode_map, actual_hash_inode_map));
+  digest testing1_digest = uniqueTestDigest(128);
+  digest testing_digest = uniqueTestDigest(255);
+
+  // 0 "/", 1 home, 2 dir1, 3 dir2, 4 testing4.txt, 5 testing2.txt,
+  // 6 testing3.txt, 7 sub_dir, 8 testing1.txt
+  std::vector<digest> expected_node_digests{
+      root_digest,    home_digest,    dir1_digest,
+      dir2_digest,    testing_digest, testing_digest,
+      testing_digest, sub_dir_digest, testing1_digest};
+
+  assert(test_inode_tree.node_digests == expected_node_digests);
+  assert(actual_duplicates.groups.size() == 7);
+  assert(actual_duplicates.active ==
+         std::vector<bool>(actual_duplicates.groups.size(), true));
+  assert((groupOfNode(actual_duplicates, 4) ==
+          std::vector<std::size_t>{4, 5, 6}));
+  assert(groupOfNode(actual_duplicates, 0) == std::vector<std::size_t>{0});
+  assert(groupOfNode(actual_duplicates, 3) == std::vector<std::size_t>{3});
+  assert(groupOfNode(actual_duplicates, 8) == std::vector<std::size_t>{8});
 }
 
 void testCalculateHashesErrorWhenLeafNodeDoesNotHaveHash() {
   // Arrange
-  inode test_inode_tree = {1, "/", nullptr, {}};
+  inode_tree test_inode_tree = createTestTree({{1, "/", -1}}, {});
+
+  // Act
+  duplicate_groups actual_duplicates =
+      calculateHashes(test_inode_tree, TEST_DIGEST_OPTIONS);
+
+  // Assert
+  assert(test_inode_tree.node_digests[0] == EMPTY_DIGEST);
+  assert(actual_duplicates.groups.size() == 1);
+  assert(groupOfNode(actual_duplicates, 0) == std::vector<std::size_t>{0});
+}
+
+void testCalculateHashesAcrossThreads() {
+  // Arrange
+  // Wide enough that the level of files is split across threads.
+  setThreadCount(4);
+  hash_table_row::rows test_hash_rows{};
+  for (std::size_t i = 0; i < PARALLEL_MIN_CHUNK * 4; ++i) {
+    test_hash_rows.push_back({static_cast<row_id>(i + 1), 2, "file.txt",
+                              uniqueTestHash(i % 251)});
+  }
+  inode_tree test_inode_tree =
+      createTestTree({{1, "/", -1}, {2, "wide", 1}, {3, "narrow", 1}},
+                     test_hash_rows);
 
   // Act
-  hash_inode_map *actual_hash_inode_map = calculateHashes(test_inode_tree);
+  calculateHashes(test_inode_tree, TEST_DIGEST_OPTIONS);
 
   // Assert
-  hash empty_hash = new uint8_t[MD5_DIGEST_LENGTH]{};
-  inode expected_transformed_inode_tree = {1, "/", empty_hash, {}, nullptr};
-  hash_inode_map *expected_hash_inode_map =
-      new hash_inode_map{{empty_hash, {&test_inode_tree}}};
+  std::vector<digest> file_digests{};
+  for (hash_table_row const &test_hash_row : test_hash_rows) {
+    file_digests.push_back(toDigest(test_hash_row.hash));
+  }
+  std::sort(file_digests.begin(), file_digests.end());
+  digest expected_wide_digest{};
+  computeDigest(expected_wide_digest, file_digests.data(),
+                file_digests.size());
+
+  assert(test_inode_tree.node_digests[1] == expected_wide_digest);
+  assert(test_inode_tree.node_digests[2] == EMPTY_DIGEST);
 
-  assert(expected_transformed_inode_tree == test_inode_tree);
-  assert(compareHashToInodes(expected_hash_inode_map, actual_hash_inode_map));
+  // Cleanup
+  setThreadCount(0);
 }
 
-/* --------------------------- countShortestDepth --------------------------- */
-void testCountShortestDepth() {
+void testCalculateHashesIgnoresChildOrder() {
   // Arrange
-  inode *test_path_one =
-      createTestBranch({"apple", "orange", "pineapple"}); // Returns tail.
-  inode *test_path_two =
-      createTestBranch({"apple", "cherry", "cocounut", "testing"});
+  inode_tree test_inode_tree = createTestTree(
+      {{1, "/", -1}, {2, "one", 1}, {3, "two", 1}},
+      {{1, 2, "a.txt", uniqueTestHash(1)},
+       {2, 2, "b.txt", uniqueTestHash(2)},
+       {3, 3, "b.txt", uniqueTestHash(2)},
+       {4, 3, "a.txt", uniqueTestHash(1)}});
 
   // Act
-  int actual_path_count = countShortestDepth({test_path_one, test_path_two});
+  duplicate_groups actual_duplicates =
+      calculateHashes(test_inode_tree, TEST_DIGEST_OPTIONS);
 
   // Assert
-  assert(actual_path_count == 3);
+  assert(test_inode_tree.node_digests[1] == test_inode_tree.node_digests[2]);
+  assert((groupOfNode(actual_duplicates, 1) == std::vector<std::size_t>{1, 2}));
 }
 
-void testCountShortestDepthWithLengthZeroReturnsZero() {
+void testCalculateHashesWithNames() {
   // Arrange
-  std::vector<inode const *> test_duplicate_inodes = {};
+  hash_table_row::rows test_hash_rows{{1, 2, "a.txt", uniqueTestHash(1)},
+                                      {2, 3, "b.txt", uniqueTestHash(1)},
+                                      {3, 4, "a.txt", uniqueTestHash(1)}};
+  inode_tree test_inode_tree = createTestTree(
+      {{1, "/", -1}, {2, "one", 1}, {3, "two", 1}, {4, "three", 1}},
+      test_hash_rows);
 
   // Act
-  int actual_path_count = countShortestDepth(test_duplicate_inodes);
+  calculateHashes(test_inode_tree, {.include_names = true});
 
   // Assert
-  assert(actual_path_count == 0);
+  digest named_digest{};
+  computeNamedDigest(named_digest, "a.txt", uniqueTestDigest(1));
+  digest expected_digest{};
+  computeDigest(expected_digest, &named_digest, 1);
+
+  assert(test_inode_tree.node_digests[1] == expected_digest);
+  assert(test_inode_tree.node_digests[1] != test_inode_tree.node_digests[2]);
+  assert(test_inode_tree.node_digests[1] == test_inode_tree.node_digests[3]);
+  assert(test_inode_tree.node_digests[4] == uniqueTestDigest(1));
 }
 
-/* ----------------------- fastForwardINodeReferences ----------------------- */
+/* ---------------------- filterNonDupsAndNestedHashes ---------------------- */
+/**
+ * apple
+ *  |- one.txt {1}
+ *  |- banana
+ *  |  |- two.txt {1}
+ *  |  |- three.txt {5}
+ *  |  |- four.txt {5}
+ *  |- cherry
+ *  |  |- coconut
+ *  |  |  | - five.txt {2}
+ *  |  |  | - six.txt {3}
+ *  |  |- pear
+ *  |  |  | - seven.txt {4}
+ *  |- orange
+ *  |  |- coconut
+ *  |  |  |- eight.txt {2}
+ *  |  |  |- nine.txt {3}
+ *  |  |- pear
+ *  |  |  |- ten.txt {4}
+ *  |- pineapple
+ *  |  |- dragonfruit
+ *  |  |  |- eleven.txt {4}
+ *  |  |  |- grapefruit
+ *  |  |  |  |- twelve.txt {4}
+ */
+directory_table_row::rows const test_fruit_directory_rows = {
+    {1, "apple", -1},       {2, "banana", 1},      {3, "cherry", 1},
+    {4, "orange", 1},       {5, "pineapple", 1},   {6, "coconut", 3},
+    {7, "pear", 3},         {8, "coconut", 4},     {9, "pear", 4},
+    {10, "dragonfruit", 5}, {11, "grapefruit", 10}};
+
+hash_table_row::rows const test_fruit_hash_rows = {
+    {1, 1, "one.txt", uniqueTestHash(1)},
+    {2, 2, "two.txt", uniqueTestHash(1)},
+    {3, 2, "three.txt", uniqueTestHash(5)},
+    {4, 2, "four.txt", uniqueTestHash(5)},
+    {5, 6, "five.txt", uniqueTestHash(2)},
+    {6, 6, "six.txt", uniqueTestHash(3)},
+    {7, 7, "seven.txt", uniqueTestHash(4)},
+    {8, 8, "eight.txt", uniqueTestHash(2)},
+    {9, 8, "nine.txt", uniqueTestHash(3)},
+    {10, 9, "ten.txt", uniqueTestHash(4)},
+    {11, 10, "eleven.txt", uniqueTestHash(4)},
+    {12, 11, "twelve.txt", uniqueTestHash(4)}};
+
+duplicate_path_seg_set const expected_fruit_duplicates = {
+    {{"apple", "one.txt"}, {"apple", "banana", "two.txt"}},
+    {{"apple", "banana", "three.txt"}, {"apple", "banana", "four.txt"}},
+    {{"apple", "cherry", "pear", "seven.txt"},
+     {"apple", "orange", "pear", "ten.txt"},
+     {"apple", "pineapple", "dragonfruit", "eleven.txt"},
+     {"apple", "pineapple", "dragonfruit", "grapefruit", "twelve.txt"}},
+    {{"apple", "cherry", "pear"},
+     {"apple", "orange", "pear"},
+     {"apple", "pineapple", "dragonfruit", "grapefruit"}},
+    {{"apple", "cherry"}, {"apple", "orange"}},
+};
 
-void testFastForwardingINodeReferencesToShallowestDepth() {
+void testFilteringNonDuplicatesAndNestedHashes() {
   // Arrange
-  inode *test_path_one =
-      createTestBranch({"apple", "orange", "pineapple"}); // Returns tail.
-  inode *test_path_two =
-      createTestBranch({"apple", "cherry", "cocounut", "testing"});
-  inode *test_path_three = createTestBranch({"apple", "cherry"});
+  inode_tree test_tree =
+      createTestTree(test_fruit_directory_rows, test_fruit_hash_rows);
+  duplicate_groups test_duplicates =
+      calculateHashes(test_tree, TEST_DIGEST_OPTIONS);
 
   // Act
-  std::vector<inode const *> actual_fast_forwarded_refs =
-      fastForwardINodeReferences(
-          {test_path_one, test_path_two, test_path_three});
+  duplicate_node_set actual_duplicate_nodes =
+      filterNonDupsAndNestedHashes(test_tree, test_duplicates);
 
   // Assert
-  std::vector<inode const *> expected_fast_forwarded_refs{
-      test_path_one->parent_node->parent_node,
-      test_path_two->parent_node->parent_node->parent_node,
-      test_path_three->parent_node};
+  duplicate_path_seg_set actual_duplicate_inodes =
+      buildTestPathSegments(test_tree, actual_duplicate_nodes);
+  duplicate_path_seg_set expected_duplicate_inodes = expected_fruit_duplicates;
+  assertDuplicatePathSegmentsSet(actual_duplicate_inodes,
+                                 expected_duplicate_inodes);
+}
+
+void testFilteringRemovesSingleNodeHashes() {
+  // Arrange
+  inode_tree test_tree =
+      createTestTree(test_fruit_directory_rows, test_fruit_hash_rows);
+  duplicate_groups test_duplicates =
+      calculateHashes(test_tree, TEST_DIGEST_OPTIONS);
 
-  assert(actual_fast_forwarded_refs == expected_fast_forwarded_refs);
+  // Act
+  filterNonDupes(test_duplicates);
+
+  // Assert
+  for (std::size_t group = 0; group < test_duplicates.groups.size(); ++group) {
+    assert(test_duplicates.active[group] ==
+           (test_duplicates.groups.groupSize(group) > 1));
+  }
+  assert(!test_duplicates.active[test_duplicates.groups.node_groups[0]]);
 }
 
-void testFastForwardingINodeReferencesToRoot() {
+/* ---------------------- findNearestDuplicateAncestors --------------------- */
+void testFindingNearestDuplicateAncestors() {
   // Arrange
-  inode *test_path_one = createTestBranch({"apple"}); // Returns tail.
-  inode *test_path_two =
-      createTestBranch({"apple", "cherry", "cocounut", "testing"});
-  inode *test_path_three = createTestBranch({"apple", "cherry"});
+  inode_tree test_tree =
+      createTestTree(test_fruit_directory_rows, test_fruit_hash_rows);
+  duplicate_groups test_duplicates =
+      calculateHashes(test_tree, TEST_DIGEST_OPTIONS);
 
   // Act
-  std::vector<inode const *> actual_fast_forwarded_refs =
-      fastForwardINodeReferences(
-          {test_path_one, test_path_two, test_path_three});
+  std::vector<std::size_t> actual_ancestors =
+      findNearestDuplicateAncestors(test_tree, test_duplicates);
 
   // Assert
-  std::vector<inode const *> expected_fast_forwarded_refs{nullptr, nullptr,
-                                                          nullptr};
+  // 0 apple, 1 one.txt, 2 banana, 3 cherry, 4 orange, 5 pineapple,
+  // 6 two.txt, 7 three.txt, 8 four.txt, 9 coconut, 10 pear, 11 coconut,
+  // 12 pear, 13 dragonfruit, 14 five.txt, 15 six.txt, 16 seven.txt,
+  // 17 eight.txt, 18 nine.txt, 19 ten.txt, 20 eleven.txt, 21 grapefruit,
+  // 22 twelve.txt
+  std::vector<std::size_t> expected_ancestors{
+      NO_PARENT, NO_PARENT, NO_PARENT, NO_PARENT, NO_PARENT, NO_PARENT,
+      NO_PARENT, NO_PARENT, NO_PARENT, 3,         3,         4,
+      4,         NO_PARENT, 9,         9,         10,        11,
+      11,        12,        NO_PARENT, NO_PARENT, 21};
+  assert(actual_ancestors == expected_ancestors);
+}
+
+/* ----------------------------- hasSharedParent ---------------------------- */
+/**
+ * root
+ *  |- one
+ *  |  |- a.txt {1}
+ *  |  |- b.txt {1}
+ *  |- two
+ *  |  |- a.txt {1}
+ *  |  |- b.txt {1}
+ *  |- three
+ *  |  |- c.txt {2}
+ *  |- four
+ *  |  |- c.txt {2}
+ *  |  |- d.txt {3}
+ */
+inode_tree createNestedTestTree() {
+  return createTestTree({{1, "root", -1},
+                         {2, "one", 1},
+                         {3, "two", 1},
+                         {4, "three", 1},
+                         {5, "four", 1}},
+                        {{1, 2, "a.txt", uniqueTestHash(1)},
+                         {2, 2, "b.txt", uniqueTestHash(1)},
+                         {3, 3, "a.txt", uniqueTestHash(1)},
+                         {4, 3, "b.txt", uniqueTestHash(1)},
+                         {5, 4, "c.txt", uniqueTestHash(2)},
+                         {6, 5, "c.txt", uniqueTestHash(2)},
+                         {7, 5, "d.txt", uniqueTestHash(3)}});
+}
+
+bool testHasSharedParent(inode_tree const &tree,
+                         duplicate_groups const &duplicates,
+                         std::size_t node) {
+  std::vector<std::size_t> nearest_ancestors =
+      findNearestDuplicateAncestors(tree, duplicates);
+  std::vector<std::size_t> claimed_ancestors(tree.size(), NO_GROUP);
+  return hasSharedParent(duplicates, duplicates.groups.node_groups[node],
+                         nearest_ancestors, claimed_ancestors);
+}
+
+void testHasSharedParentInsideDuplicatedDirectories() {
+  // Arrange
+  inode_tree test_tree =
+      createTestTree(test_fruit_directory_rows, test_fruit_hash_rows);
+  duplicate_groups test_duplicates =
+      calculateHashes(test_tree, TEST_DIGEST_OPTIONS);
+
+  // Act
+  // The coconut directories only live inside cherry and orange.
+  bool actual_shared = testHasSharedParent(test_tree, test_duplicates, 9);
 
-  assert(actual_fast_forwarded_refs == expected_fast_forwarded_refs);
+  // Assert
+  assert(actual_shared);
 }
 
-void testFastForwardingINodeReferencesWithZeroDepth() {
+void testHasSharedParentWithMemberOutsideDuplicatedDirectories() {
+  // Arrange
+  inode_tree test_tree =
+      createTestTree(test_fruit_directory_rows, test_fruit_hash_rows);
+  duplicate_groups test_duplicates =
+      calculateHashes(test_tree, TEST_DIGEST_OPTIONS);
+
   // Act
-  std::vector<inode const *> actual_fast_forwarded_refs =
-      fastForwardINodeReferences({});
+  // grapefruit is a copy of pear outside of cherry and orange.
+  bool actual_shared = testHasSharedParent(test_tree, test_duplicates, 10);
 
   // Assert
-  std::vector<inode const *> expected_fast_forwarded_refs{};
-  assert(actual_fast_forwarded_refs == expected_fast_forwarded_refs);
+  assert(!actual_shared);
 }
 
-/* ---------------------- filterNonDupsAndNestedHashes ---------------------- */
-void testFilteringNonDuplicatesAndNestedHashes() {
-  /**
-   * apple
-   *  |- one.txt {1}
-   *  |- banana
-   *  |  |- two.txt {1}
-   *  |  |- three.txt {5}
-   *  |  |- four.txt {5}
-   *  |- cherry
-   *  |  |- coconut
-   *  |  |  | - five.txt {2}
-   *  |  |  | - six.txt {3}
-   *  |  |- pear
-   *  |  |  | - seven.txt {4}
-   *  |- orange
-   *  |  |- coconut
-   *  |  |  |- eight.txt {2}
-   *  |  |  |- nine.txt {3}
-   *  |  |- pear
-   *  |  |  |- ten.txt {4}
-   *  |- pineapple
-   *  |  |- dragonfruit
-   *  |  |  |- eleven.txt {4}
-   *  |  |  |- grapefruit
-   *  |  |  |  |- twelve.txt {4}
-   */
-
-  /* *Arrange* */
-  // Create Inode Tree.
-  hash one_hash = uniqueTestHash(1);
-  hash two_hash = uniqueTestHash(1);
-  hash three_hash = uniqueTestHash(5);
-  hash four_hash = uniqueTestHash(5);
-  hash five_hash = uniqueTestHash(2);
-  hash six_hash = uniqueTestHash(3);
-  hash seven_hash = uniqueTestHash(4);
-  hash eight_hash = uniqueTestHash(2);
-  hash nine_hash = uniqueTestHash(3);
-  hash ten_hash = uniqueTestHash(4);
-  hash eleven_hash = uniqueTestHash(4);
-  hash twelve_hash = uniqueTestHash(4);
-
-  hash apple_hash = new uint8_t[MD5_DIGEST_LENGTH]{
-      10, 112, 89, 243, 242, 28, 192, 154, 125, 20, 255, 3, 116, 155, 29, 63};
-  hash banana_hash = new uint8_t[MD5_DIGEST_LENGTH]{
-      21, 103, 17, 55, 215, 245, 250, 8, 180, 101, 65, 34, 0, 74, 83, 207};
-  hash cherry_hash = new uint8_t[MD5_DIGEST_LENGTH]{
-      213, 94, 197, 224, 217, 186, 123, 63, 63, 225, 242, 197, 2, 203, 182, 31};
-  hash c_cocounut_hash =
-      new uint8_t[MD5_DIGEST_LENGTH]{211, 102, 18,  105, 210, 207, 45,  254,
-                                     155, 243, 217, 116, 128, 9,   213, 160};
-  hash c_pear_hash =
-      new uint8_t[MD5_DIGEST_LENGTH]{20,  75, 166, 96,  112, 230, 220, 200,
-                                     172, 35, 249, 245, 255, 131, 78,  138};
-  hash orange_hash = new uint8_t[MD5_DIGEST_LENGTH]{
-      213, 94, 197, 224, 217, 186, 123, 63, 63, 225, 242, 197, 2, 203, 182, 31};
-  hash o_cocounut_hash =
-      new uint8_t[MD5_DIGEST_LENGTH]{211, 102, 18,  105, 210, 207, 45,  254,
-                                     155, 243, 217, 116, 128, 9,   213, 160};
-  hash o_pear_hash =
-      new uint8_t[MD5_DIGEST_LENGTH]{20,  75, 166, 96,  112, 230, 220, 200,
-                                     172, 35, 249, 245, 255, 131, 78,  138};
-  hash pineapple_hash = new uint8_t[MD5_DIGEST_LENGTH]{
-      184, 59, 189, 15, 41, 100, 155, 8, 143, 48, 98, 241, 166, 52, 125, 220};
-  hash dragonfruit_hash = new uint8_t[MD5_DIGEST_LENGTH]{
-      128, 198, 29, 30, 68, 74, 125, 69, 86, 148, 229, 167, 3, 33, 59, 170};
-  hash grapefruit_hash =
-      new uint8_t[MD5_DIGEST_LENGTH]{20,  75, 166, 96,  112, 230, 220, 200,
-                                     172, 35, 249, 245, 255, 131, 78,  138};
-
-  inode one{2, "one.txt", one_hash, {}};
-  inode two{3, "two.txt", two_hash, {}};
-  inode three{3, "three.txt", three_hash, {}};
-  inode four{3, "four.txt", four_hash, {}};
-  inode five{4, "five.txt", five_hash, {}};
-  inode six{4, "six.txt", six_hash, {}};
-  inode seven{4, "seven.txt", seven_hash, {}};
-  inode eight{4, "eight.txt", eight_hash, {}};
-  inode nine{4, "nine.txt", nine_hash, {}};
-  inode ten{4, "ten.txt", ten_hash, {}};
-  inode eleven{4, "eleven.txt", eleven_hash, {}};
-  inode twelve{5, "twelve.txt", twelve_hash, {}};
-
-  inode banana{2, "banana", banana_hash, {two, three, four}};
-  inode cocounut{3, "coconut", c_cocounut_hash, {five, six}};
-  inode pear{3, "pear", c_pear_hash, {seven}};
-  inode cherry{2, "cherry", cherry_hash, {cocounut, pear}};
-  cocounut = {3, "cocounut", o_cocounut_hash, {eight, nine}};
-  pear = {3, "pear", o_pear_hash, {ten}};
-  inode orange{2, "orange", orange_hash, {cocounut, pear}};
-  inode grapefruit{4, "grapefruit", grapefruit_hash, {twelve}};
-  inode dragonfruit{3, "dragonfruit", dragonfruit_hash, {eleven, grapefruit}};
-  inode pineapple{2, "pineapple", pineapple_hash, {dragonfruit}};
-  inode apple{1, "apple", apple_hash, {one, banana, cherry, orange, pineapple}};
-
-  // Assign Parent Pointer.
-  inode *apple_r = &apple;
-  inode *one_r = &apple_r->inodes[0];
-  inode *banana_r = &apple.inodes[1];
-  inode *two_r = &banana_r->inodes[0];
-  inode *three_r = &banana_r->inodes[1];
-  inode *four_r = &banana_r->inodes[2];
-  inode *cherry_r = &apple.inodes[2];
-  inode *c_cocounut_r = &cherry_r->inodes[0];
-  inode *five_r = &c_cocounut_r->inodes[0];
-  inode *six_r = &c_cocounut_r->inodes[1];
-  inode *c_pear_r = &cherry_r->inodes[1];
-  inode *seven_r = &c_pear_r->inodes[0];
-  inode *orange_r = &apple.inodes[3];
-  inode *o_cocounut_r = &orange_r->inodes[0];
-  inode *eight_r = &o_cocounut_r->inodes[0];
-  inode *nine_r = &o_cocounut_r->inodes[1];
-  inode *o_pear_r = &orange_r->inodes[1];
-  inode *ten_r = &o_pear_r->inodes[0];
-  inode *pineapple_r = &apple.inodes[4];
-  inode *dragonfruit_r = &pineapple_r->inodes[0];
-  inode *eleven_r = &dragonfruit_r->inodes[0];
-  inode *grapefruit_r = &dragonfruit_r->inodes[1];
-  inode *twelve_r = &grapefruit_r->inodes[0];
-
-  one_r->parent_node = apple_r;
-  banana_r->parent_node = apple_r;
-  two_r->parent_node = banana_r;
-  three_r->parent_node = banana_r;
-  four_r->parent_node = banana_r;
-  cherry_r->parent_node = apple_r;
-  c_cocounut_r->parent_node = cherry_r;
-  five_r->parent_node = c_cocounut_r;
-  six_r->parent_node = c_cocounut_r;
-  c_pear_r->parent_node = cherry_r;
-  seven_r->parent_node = c_pear_r;
-  orange_r->parent_node = apple_r;
-  o_cocounut_r->parent_node = orange_r;
-  eight_r->parent_node = o_cocounut_r;
-  nine_r->parent_node = o_cocounut_r;
-  o_pear_r->parent_node = orange_r;
-  ten_r->parent_node = o_pear_r;
-  pineapple_r->parent_node = apple_r;
-  dragonfruit_r->parent_node = pineapple_r;
-  eleven_r->parent_node = dragonfruit_r;
-  grapefruit_r->parent_node = dragonfruit_r;
-  twelve_r->parent_node = grapefruit_r;
-
-  // Setup the Hash Map.
-  hash_inode_map *test_hash_inode_map = new hash_inode_map{
-      {one_hash, {one_r, two_r}},
-      {three_hash, {three_r, four_r}},
-      {five_hash, {five_r, eight_r}},
-      {six_hash, {six_r, nine_r}},
-      {seven_hash, {seven_r, ten_r, eleven_r, twelve_r}},
-      {banana_hash, {banana_r}},
-      {c_cocounut_hash, {c_cocounut_r, o_cocounut_r}},
-      {c_pear_hash, {c_pear_r, o_pear_r, grapefruit_r}},
-      {cherry_hash, {cherry_r, orange_r}},
-      {pineapple_hash, {pineapple_r}},
-      {dragonfruit_hash, {dragonfruit_r}},
-      {dragonfruit_hash, {apple_r}},
-  };
+void testHasSharedParentWithMembersInSameDirectory() {
+  // Arrange
+  inode_tree test_tree = createNestedTestTree();
+  duplicate_groups test_duplicates =
+      calculateHashes(test_tree, TEST_DIGEST_OPTIONS);
 
-  /* *Act* */
-  duplicate_path_seg_set actual_duplicate_inodes =
-      filterNonDupsAndNestedHashes(apple, test_hash_inode_map);
+  // Act
+  // a.txt and b.txt are duplicates within one and within two.
+  bool actual_shared = testHasSharedParent(test_tree, test_duplicates, 5);
 
-  /* *Assert* */
-  duplicate_path_seg_set expected_duplicate_inodes = {
-      {{"apple", "one.txt"}, {"apple", "banana", "two.txt"}},
-      {{"apple", "banana", "three.txt"}, {"apple", "banana", "four.txt"}},
-      {{"apple", "cherry", "pear", "seven.txt"},
-       {"apple", "orange", "pear", "ten.txt"},
-       {"apple", "pineapple", "dragonfruit", "eleven.txt"},
-       {"apple", "pineapple", "dragonfruit", "grapefruit", "twelve.txt"}},
-      {{"apple", "cherry", "pear"},
-       {"apple", "orange", "pear"},
-       {"apple", "pineapple", "dragonfruit", "grapefruit"}},
-      {{"apple", "cherry"}, {"apple", "orange"}},
-  };
+  // Assert
+  assert(!actual_shared);
+}
 
-  assertDuplicatePathSegmentsSet(actual_duplicate_inodes,
-                                 expected_duplicate_inodes);
+void testHasSharedParentWithDifferentParents() {
+  // Arrange
+  inode_tree test_tree = createNestedTestTree();
+  duplicate_groups test_duplicates =
+      calculateHashes(test_tree, TEST_DIGEST_OPTIONS);
+
+  // Act
+  // three and four differ so the copies of c.txt are reported.
+  bool actual_shared = testHasSharedParent(test_tree, test_duplicates, 9);
+
+  // Assert
+  assert(!actual_shared);
 }
 
-/* ----------------------- buildDuplicatePathSegments ----------------------- */
-void testBuildDuplicatePathSegments() {
+/* --------------------------- Persisted digests ---------------------------- */
+void testRemovingEmptyInodesDropsDirectoriesWithDigests() {
   // Arrange
-  inode *test_path_one =
-      createTestBranch({"apple", "cherry", "cocounut", "testing"});
-  inode *test_path_two = createTestBranch({"apple"});
-  inode *test_path_three = createTestBranch({"apple", "cherry", "cocounut"});
+  inode_tree test_directory_tree = createTestTree(
+      {{1, "/", -1}, {2, "stale", 1, uniqueTestHash(9), 4}, {3, "kept", 1}},
+      {{1, 3, "a.txt", uniqueTestHash(1)}});
 
   // Act
-  duplicate_path_segments actual_path_segments = buildDuplicatePathSegments(
-      {test_path_one, test_path_two, test_path_three});
+  removeEmptyINodes(test_directory_tree);
 
   // Assert
-  duplicate_path_segments expected_path_segments{
-      {"apple", "cherry", "cocounut", "testing"},
-      {"apple"},
-      {"apple", "cherry", "cocounut"}};
-  assertDuplicatePathSegments(actual_path_segments, expected_path_segments);
+  assert(test_directory_tree.size() == 3);
+  assert(compareStrings(test_directory_tree.path_segments[1], "kept"));
 }
 
-/* -------------------------------- inode_== -------------------------------- */
-void testINodeEquality() {
+void testCalculateHashesSumsSizes() {
   // Arrange
-  inode test_inode_one{
-      1,
-      "/",
-      nullptr,
-      {inode{2,
-             "home",
-             nullptr,
-             {inode{3,
-                    "dir2",
-                    nullptr,
-                    {
-                        inode{4, "testing3.txt", uniqueTestHash(200)},
-                        inode{4, "testing2.txt", uniqueTestHash(196)},
-                        inode{4,
-                              "sub_dir",
-                              nullptr,
-                              {inode{5, "testing1.txt", uniqueTestHash(128)}}},
-                    }},
-              inode{3,
-                    "dir1",
-                    nullptr,
-                    {inode{4, "testing4.txt", uniqueTestHash(255)}}}}}}};
-
-  inode test_inode_two{
-      1,
-      "/",
-      nullptr,
-      {inode{2,
-             "home",
-             nullptr,
-             {inode{3,
-                    "dir2",
-                    nullptr,
-                    {
-                        inode{4, "testing3.txt", uniqueTestHash(200)},
-                        inode{4, "testing2.txt", uniqueTestHash(196)},
-                        inode{4,
-                              "sub_dir",
-                              nullptr,
-                              {inode{5, "testing1.txt", uniqueTestHash(128)}}},
-                    }},
-              inode{3,
-                    "dir1",
-                    nullptr,
-                    {inode{4, "testing4.txt", uniqueTestHash(255)}}}}}}};
+  inode_tree test_inode_tree =
+      createTestTree({{1, "/", -1}, {2, "one", 1}, {3, "two", 2}},
+                     {{1, 1, "a.txt", uniqueTestHash(1), 3},
+                      {2, 2, "b.txt", uniqueTestHash(2), 5},
+                      {3, 3, "c.txt", uniqueTestHash(3), 7}});
 
   // Act
-  bool equality_check = test_inode_one == test_inode_two;
+  calculateHashes(test_inode_tree, TEST_DIGEST_OPTIONS);
 
   // Assert
-  assert(equality_check);
+  // 0 "/", 1 a.txt, 2 one, 3 b.txt, 4 two, 5 c.txt
+  std::vector<int64_t> expected_sizes{15, 3, 12, 5, 7, 7};
+  assert(test_inode_tree.sizes == expected_sizes);
 }
 
-void testINodeEqualityNotEqual() {
+void testCalculateHashesKeepsCleanDirectories() {
   // Arrange
-  inode test_inode_one{
-      1,
-      "/",
-      nullptr,
-      {inode{2,
-             "home",
-             nullptr,
-             {inode{3,
-                    "dir2",
-                    nullptr,
-                    {
-                        inode{4, "testing3.txt", uniqueTestHash(200)},
-                        inode{4, "testing2.txt", uniqueTestHash(196)},
-                        inode{4,
-                              "sub_dir",
-                              nullptr,
-                              {inode{5, "testing1.txt", uniqueTestHash(128)}}},
-                    }},
-              inode{3,
-                    "dir1",
-                    nullptr,
-                    {inode{4, "testing4.txt", uniqueTestHash(255)}}}}}}};
-
-  inode test_inode_two{
-      1,
-      "/",
-      nullptr,
-      {inode{2,
-             "home",
-             nullptr,
-             {inode{3,
-                    "dir2",
-                    nullptr,
-                    {
-                        inode{4, "testing3.txt", uniqueTestHash(200)},
-                        inode{4, "testing2.txt", uniqueTestHash(196)},
-                        inode{4,
-                              "sub_dir",
-                              nullptr,
-                              {inode{5, "testing1.txt", uniqueTestHash(128)}}},
-                    }},
-              inode{3,
-                    "dir1",
-                    nullptr,
-                    {inode{4, "testing4.txt", uniqueTestHash(254)}}}}}}};
+  inode_tree test_inode_tree = createTestTree(
+      {{1, "/", -1}, {2, "clean", 1, uniqueTestHash(9), 40}, {3, "dirty", 1}},
+      {{1, 2, "a.txt", uniqueTestHash(1), 3},
+       {2, 3, "a.txt", uniqueTestHash(1), 3}});
 
   // Act
-  bool equality_check = test_inode_one == test_inode_two;
+  calculateHashes(test_inode_tree, TEST_DIGEST_OPTIONS);
 
   // Assert
-  assert(equality_check == false);
+  digest file_digest = uniqueTestDigest(1);
+  digest expected_dirty_digest{};
+  computeDigest(expected_dirty_digest, &file_digest, 1);
+
+  assert(test_inode_tree.node_digests[1] == uniqueTestDigest(9));
+  assert(test_inode_tree.sizes[1] == 40);
+  assert(test_inode_tree.node_digests[2] == expected_dirty_digest);
+  assert(test_inode_tree.sizes[2] == 3);
+  assert(test_inode_tree.sizes[0] == 43);
 }
 
-/* ----------------------------- inode_hasher_() ---------------------------- */
-void testINodeHashes() {
+void testCollectingDirtyDigests() {
   // Arrange
-  inode_hasher inode_hashing_function{};
+  inode_tree test_inode_tree =
+      createTestTree({{1, "/", -1},
+                      {2, "clean", 1, uniqueTestHash(9), 40},
+                      {3, "dirty", 1},
+                      {4, "empty", 1}},
+                     {{1, 2, "a.txt", uniqueTestHash(1), 3},
+                      {2, 3, "a.txt", uniqueTestHash(1), 3}});
+  calculateHashes(test_inode_tree, TEST_DIGEST_OPTIONS);
 
   // Act
-  std::size_t actual_hash = inode_hashing_function(uniqueTestHash(200));
+  std::vector<directory_digest_input> actual_digest_inputs =
+      collectDirtyDigests(test_inode_tree);
 
   // Assert
-  std::size_t expected_hash = 0xC8FFFFFFFFFFFFFF;
-  assert(actual_hash == expected_hash);
+  std::vector<directory_digest_input> expected_digest_inputs{
+      {1, test_inode_tree.node_digests[0].bytes, 43},
+      {3, test_inode_tree.node_digests[2].bytes, 3}};
+  assert(actual_digest_inputs == expected_digest_inputs);
 }
 
-/* ----------------------------- inode_key_equal_() ----------------------------
- */
-void testINodeHashesEqual() {
+/* ----------------------------- inode_tree_== ------------------------------ */
+void testINodeTreeEquality() {
   // Arrange
-  inode_key_equal inode_key_equal_function{};
+  inode_tree test_tree_one = createTestBranches();
+  inode_tree test_tree_two = createTestBranches();
 
   // Act
-  bool equality_check =
-      inode_key_equal_function(uniqueTestHash(200), uniqueTestHash(200));
+  bool equality_check = test_tree_one == test_tree_two;
 
   // Assert
-  assert(equality_check == true);
+  assert(equality_check);
 }
 
-void testINodeHashesNotEqual() {
+void testINodeTreeEqualityNotEqual() {
   // Arrange
-  inode_key_equal inode_key_equal_function{};
+  inode_tree test_tree_one = createTestBranches();
+  inode_tree test_tree_two = createTestBranches();
+  test_tree_two.path_segments[3] = "banana";
 
   // Act
-  bool equality_check =
-      inode_key_equal_function(uniqueTestHash(200), uniqueTestHash(212));
+  bool equality_check = test_tree_one == test_tree_two;
 
   // Assert
   assert(equality_check == false);
@@ -1009,8 +946,8 @@ void testTransforming() {
       .directory_rows = test_directory_results, .hash_rows = test_hash_results};
 
   // Act
-  duplicate_path_seg_set actual_duplicate_inodes_set =
-      transform(test_file_hash_rows);
+  duplicate_node_set actual_duplicate_nodes =
+      transform(test_file_hash_rows, TEST_DIGEST_OPTIONS);
 
   // Assert
   duplicate_path_seg_set expected_duplicate_inodes_set = {
@@ -1026,6 +963,9 @@ void testTransforming() {
       {{"apple", "cherry"}, {"apple", "orange"}},
   };
 
+  duplicate_path_seg_set actual_duplicate_inodes_set = buildTestPathSegments(
+      actual_duplicate_nodes.tree, actual_duplicate_nodes);
+  assert(actual_duplicate_nodes.tree.size() == 23);
   assertDuplicatePathSegmentsSet(actual_duplicate_inodes_set,
                                  expected_duplicate_inodes_set);
 }
@@ -1042,20 +982,27 @@ int main() {
   testBuildingParentHashMapWithDirectoryIdOverflow();
   testBuildingParentHashMapWithDirectoryIdEqualToSize();
   testBuildINodeTree();
+  testPostOrderVisitsChildrenBeforeParents();
+  testPostOrderOfEmptyTree();
   testRemovingEmptyInodes();
+  testRemovingEmptyInodesKeepsRoot();
   testCalculateHashes();
   testCalculateHashesErrorWhenLeafNodeDoesNotHaveHash();
-  testCountShortestDepth();
-  testCountShortestDepthWithLengthZeroReturnsZero();
-  testFastForwardingINodeReferencesToShallowestDepth();
-  testFastForwardingINodeReferencesToRoot();
-  testFastForwardingINodeReferencesWithZeroDepth();
+  testCalculateHashesAcrossThreads();
+  testCalculateHashesIgnoresChildOrder();
+  testCalculateHashesWithNames();
+  testRemovingEmptyInodesDropsDirectoriesWithDigests();
+  testCalculateHashesSumsSizes();
+  testCalculateHashesKeepsCleanDirectories();
+  testCollectingDirtyDigests();
   testFilteringNonDuplicatesAndNestedHashes();
-  testBuildDuplicatePathSegments();
-  testINodeEquality();
-  testINodeEqualityNotEqual();
-  testINodeHashes();
-  testINodeHashesEqual();
-  testINodeHashesNotEqual();
+  testFilteringRemovesSingleNodeHashes();
+  testFindingNearestDuplicateAncestors();
+  testHasSharedParentInsideDuplicatedDirectories();
+  testHasSharedParentWithMemberOutsideDuplicatedDirectories();
+  testHasSharedParentWithMembersInSameDirectory();
+  testHasSharedParentWithDifferentParents();
+  testINodeTreeEquality();
+  testINodeTreeEqualityNotEqual();
   testTransforming();
 }
@@ -0,0 +1,335 @@
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+
+#include "../../src/dupes/digest_map.cpp"
+#include "../../src/dupes/format.cpp"
+#include "../../src/dupes/load.cpp"
+#include "../../src/dupes/sink.cpp"
+#include "../../src/dupes/transform.cpp"
+#include "../../src/dupes/verify.cpp"
+#include "../../src/fs/file_system.cpp"
+#include "../../src/lib.cpp"
+#include "../../src/sqlite/operators.cpp"
+#include "../../src/thread/parallel.cpp"
+#include "../data.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+std::string const TEST_ROOT_DIR = "tests";
+std::string const TEST_VERIFY_DIR = "tests/verify_root";
+digest_map const NO_VERIFIED_KEYS = initDigestMap(0);
+
+typedef std::vector<std::vector<std::string>> test_rendered_groups;
+
+void writeTestFile(std::string const &relative_path,
+                   std::string const &content) {
+  std::filesystem::path path = TEST_VERIFY_DIR + "/" + relative_path;
+  std::filesystem::create_directories(path.parent_path());
+  std::ofstream file(path, std::ios::binary);
+  file << content;
+}
+
+/**
+ * Every file claims the same digest so the transform groups them together
+ * no matter what is on disk.
+ */
+duplicate_node_set
+createTestSet(directory_table_row::rows const &directory_rows,
+              hash_table_row::rows const &hash_rows) {
+  return transform({.directory_rows = directory_rows, .hash_rows = hash_rows},
+                   {.include_names = false});
+}
+
+test_rendered_groups renderTestSet(duplicate_node_set const &test_set) {
+  test_rendered_groups rendered_groups{};
+  std::vector<char const *> segment_stack{};
+
+  for (std::size_t group = 0; group < test_set.size(); ++group) {
+    std::vector<std::string> rendered_paths{};
+    for (std::size_t i = 0; i < test_set.groupSize(group); ++i) {
+      std::string path{};
+      renderPath(test_set.tree, test_set.groupMembers(group)[i], segment_stack,
+                 path);
+      rendered_paths.push_back(path);
+    }
+    rendered_groups.push_back(rendered_paths);
+  }
+
+  return rendered_groups;
+}
+
+directory_table_row::rows const test_flat_rows{{1, "verify_root", -1}};
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ------------------------- verifyDuplicateNodeSet ------------------------- */
+void testVerifyingIdenticalFiles() {
+  // Arrange
+  writeTestFile("x.txt", "same contents");
+  writeTestFile("y.txt", "same contents");
+  duplicate_node_set test_set =
+      createTestSet(test_flat_rows, {{1, 1, "x.txt", uniqueTestHash(1), 13},
+                                     {2, 1, "y.txt", uniqueTestHash(1), 13}});
+
+  // Act
+  verify_result actual_result =
+      verifyDuplicateNodeSet(test_set, TEST_ROOT_DIR, NO_VERIFIED_KEYS);
+
+  // Assert
+  test_rendered_groups expected_groups{
+      {"verify_root/x.txt", "verify_root/y.txt"}};
+  verify_stats expected_stats{.groups_read = 1,
+                              .groups_cached = 0,
+                              .groups_split = 0,
+                              .bytes_read = 26};
+  assert(renderTestSet(test_set) == expected_groups);
+  assert(actual_result.stats == expected_stats);
+  assert(actual_result.verified_keys.size() == 1);
+
+  // Cleanup
+  std::filesystem::remove_all(TEST_VERIFY_DIR);
+}
+
+void testVerifyingSplitsMismatchedFiles() {
+  // Arrange
+  writeTestFile("x.txt", "same contents");
+  writeTestFile("y.txt", "diff contents");
+  writeTestFile("z.txt", "same contents");
+  duplicate_node_set test_set =
+      createTestSet(test_flat_rows, {{1, 1, "x.txt", uniqueTestHash(1), 13},
+                                     {2, 1, "y.txt", uniqueTestHash(1), 13},
+                                     {3, 1, "z.txt", uniqueTestHash(1), 13}});
+
+  // Act
+  verify_result actual_result =
+      verifyDuplicateNodeSet(test_set, TEST_ROOT_DIR, NO_VERIFIED_KEYS);
+
+  // Assert
+  test_rendered_groups expected_groups{
+      {"verify_root/x.txt", "verify_root/z.txt"}};
+  assert(renderTestSet(test_set) == expected_groups);
+  assert(actual_result.stats.groups_split == 1);
+  assert(actual_result.file_stamps.size() == 2);
+  assert(actual_result.file_stamps[0].node == test_set.members[0]);
+  assert(actual_result.file_stamps[1].node == test_set.members[1]);
+  assert(actual_result.file_stamps[1].stamp.size == 13);
+
+  // Cleanup
+  std::filesystem::remove_all(TEST_VERIFY_DIR);
+}
+
+void testVerifyingSplitsIntoSeveralGroups() {
+  // Arrange
+  std::string test_chunk(VERIFY_CHUNK_SIZE, 'a');
+  writeTestFile("w.txt", test_chunk + "one");
+  writeTestFile("x.txt", test_chunk + "two");
+  writeTestFile("y.txt", test_chunk + "one");
+  writeTestFile("z.txt", test_chunk + "two");
+  duplicate_node_set test_set = createTestSet(
+      test_flat_rows, {{1, 1, "w.txt", uniqueTestHash(1)},
+                       {2, 1, "x.txt", uniqueTestHash(1)},
+                       {3, 1, "y.txt", uniqueTestHash(1)},
+                       {4, 1, "z.txt", uniqueTestHash(1)}});
+
+  // Act
+  verify_result actual_result =
+      verifyDuplicateNodeSet(test_set, TEST_ROOT_DIR, NO_VERIFIED_KEYS);
+
+  // Assert
+  test_rendered_groups expected_groups{
+      {"verify_root/w.txt", "verify_root/y.txt"},
+      {"verify_root/x.txt", "verify_root/z.txt"}};
+  assert(renderTestSet(test_set) == expected_groups);
+  assert(actual_result.stats.groups_split == 1);
+  assert(actual_result.stats.bytes_read ==
+         static_cast<int64_t>(4 * (VERIFY_CHUNK_SIZE + 3)));
+  assert(actual_result.verified_keys.size() == 2);
+
+  // Cleanup
+  std::filesystem::remove_all(TEST_VERIFY_DIR);
+}
+
+void testVerifyingAMissingFileThrows() {
+  // Arrange
+  writeTestFile("x.txt", "same contents");
+  writeTestFile("y.txt", "same contents");
+  duplicate_node_set test_set = createTestSet(
+      test_flat_rows, {{1, 1, "missing.txt", uniqueTestHash(1)},
+                       {2, 1, "x.txt", uniqueTestHash(1)},
+                       {3, 1, "y.txt", uniqueTestHash(1)}});
+
+  try {
+    // Act
+    verifyDuplicateNodeSet(test_set, TEST_ROOT_DIR, NO_VERIFIED_KEYS);
+    assert(false);
+  } catch (verify_error &error) {
+    // Assert
+    assert(std::string(error.what()).find("verify_root/missing.txt") !=
+           std::string::npos);
+  }
+
+  // Cleanup
+  std::filesystem::remove_all(TEST_VERIFY_DIR);
+}
+
+void testVerifyingAGroupLargerThanTheOpenFilePool() {
+  // Arrange
+  std::string test_contents(VERIFY_CHUNK_SIZE * 2 + 1, 'a');
+  hash_table_row::rows test_rows{};
+  for (std::size_t i = 0; i < OPEN_FILE_POOL_SIZE + 2; ++i) {
+    std::string name = "file_" + std::to_string(i) + ".txt";
+    writeTestFile(name, test_contents);
+    test_rows.push_back({static_cast<row_id>(i + 1), 1, stringDup(name.c_str()),
+                         uniqueTestHash(1),
+                         static_cast<int64_t>(test_contents.size())});
+  }
+  duplicate_node_set test_set = createTestSet(test_flat_rows, test_rows);
+
+  // Act
+  verify_result actual_result =
+      verifyDuplicateNodeSet(test_set, TEST_ROOT_DIR, NO_VERIFIED_KEYS);
+
+  // Assert
+  assert(actual_result.stats.groups_split == 0);
+  assert(test_set.size() == 1);
+  assert(test_set.groupSize(0) == OPEN_FILE_POOL_SIZE + 2);
+
+  // Cleanup
+  std::filesystem::remove_all(TEST_VERIFY_DIR);
+}
+
+void testVerifyingDirectoriesPairsFilesByDigest() {
+  // Arrange
+  writeTestFile("one/a.txt", "first");
+  writeTestFile("one/b.txt", "second");
+  writeTestFile("two/c.txt", "second");
+  writeTestFile("two/d.txt", "first");
+  writeTestFile("three/e.txt", "first");
+  writeTestFile("three/f.txt", "wrong!");
+  duplicate_node_set test_set = createTestSet(
+      {{1, "verify_root", -1}, {2, "one", 1}, {3, "two", 1}, {4, "three", 1}},
+      {{1, 2, "a.txt", uniqueTestHash(1)},
+       {2, 2, "b.txt", uniqueTestHash(2)},
+       {3, 3, "c.txt", uniqueTestHash(2)},
+       {4, 3, "d.txt", uniqueTestHash(1)},
+       {5, 4, "e.txt", uniqueTestHash(1)},
+       {6, 4, "f.txt", uniqueTestHash(2)}});
+
+  // Act
+  verify_result actual_result =
+      verifyDuplicateNodeSet(test_set, TEST_ROOT_DIR, NO_VERIFIED_KEYS);
+
+  // Assert
+  test_rendered_groups expected_groups{
+      {"verify_root/one", "verify_root/two"}};
+  assert(renderTestSet(test_set) == expected_groups);
+  assert(actual_result.stats.groups_split == 1);
+
+  // Cleanup
+  std::filesystem::remove_all(TEST_VERIFY_DIR);
+}
+
+void testVerifyingSkipsCachedGroups() {
+  // Arrange
+  writeTestFile("x.txt", "same contents");
+  writeTestFile("y.txt", "same contents");
+  hash_table_row::rows test_hash_rows{{1, 1, "x.txt", uniqueTestHash(1)},
+                                      {2, 1, "y.txt", uniqueTestHash(1)}};
+  duplicate_node_set first_set = createTestSet(test_flat_rows, test_hash_rows);
+  verify_result first_result =
+      verifyDuplicateNodeSet(first_set, TEST_ROOT_DIR, NO_VERIFIED_KEYS);
+
+  digest_map test_verified_keys = initDigestMap(1);
+  insertDigest(test_verified_keys, first_result.verified_keys[0]);
+  duplicate_node_set test_set = createTestSet(test_flat_rows, test_hash_rows);
+
+  // Act
+  verify_result actual_result =
+      verifyDuplicateNodeSet(test_set, TEST_ROOT_DIR, test_verified_keys);
+
+  // Assert
+  verify_stats expected_stats{.groups_read = 0,
+                              .groups_cached = 1,
+                              .groups_split = 0,
+                              .bytes_read = 0};
+  assert(actual_result.stats == expected_stats);
+  assert(actual_result.verified_keys.size() == 0);
+  assert(renderTestSet(test_set) == renderTestSet(first_set));
+
+  // Cleanup
+  std::filesystem::remove_all(TEST_VERIFY_DIR);
+}
+
+void testVerifyingRereadsChangedFiles() {
+  // Arrange
+  writeTestFile("x.txt", "same contents");
+  writeTestFile("y.txt", "same contents");
+  hash_table_row::rows test_hash_rows{{1, 1, "x.txt", uniqueTestHash(1)},
+                                      {2, 1, "y.txt", uniqueTestHash(1)}};
+  duplicate_node_set first_set = createTestSet(test_flat_rows, test_hash_rows);
+  verify_result first_result =
+      verifyDuplicateNodeSet(first_set, TEST_ROOT_DIR, NO_VERIFIED_KEYS);
+
+  digest_map test_verified_keys = initDigestMap(1);
+  insertDigest(test_verified_keys, first_result.verified_keys[0]);
+  writeTestFile("y.txt", "changed");
+  duplicate_node_set test_set = createTestSet(test_flat_rows, test_hash_rows);
+
+  // Act
+  verify_result actual_result =
+      verifyDuplicateNodeSet(test_set, TEST_ROOT_DIR, test_verified_keys);
+
+  // Assert
+  assert(actual_result.stats.groups_read == 1);
+  assert(test_set.size() == 0);
+
+  // Cleanup
+  std::filesystem::remove_all(TEST_VERIFY_DIR);
+}
+
+void testVerifyingGroupsAcrossThreads() {
+  // Arrange
+  setThreadCount(4);
+  hash_table_row::rows test_hash_rows{};
+  std::vector<std::string> test_names{};
+  for (int i = 0; i < 16; ++i) {
+    test_names.push_back("file_" + std::to_string(i) + ".txt");
+    writeTestFile(test_names.back(), "contents " + std::to_string(i / 2));
+  }
+  for (int i = 0; i < 16; ++i) {
+    test_hash_rows.push_back({i + 1, 1, test_names[i].c_str(),
+                              uniqueTestHash(static_cast<uint8_t>(i / 2))});
+  }
+  duplicate_node_set test_set = createTestSet(test_flat_rows, test_hash_rows);
+
+  // Act
+  verify_result actual_result =
+      verifyDuplicateNodeSet(test_set, TEST_ROOT_DIR, NO_VERIFIED_KEYS);
+
+  // Assert
+  assert(test_set.size() == 8);
+  assert(actual_result.stats.groups_read == 8);
+  assert(actual_result.stats.groups_split == 0);
+
+  // Cleanup
+  setThreadCount(0);
+  std::filesystem::remove_all(TEST_VERIFY_DIR);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testVerifyingIdenticalFiles();
+  testVerifyingSplitsMismatchedFiles();
+  testVerifyingSplitsIntoSeveralGroups();
+  testVerifyingAMissingFileThrows();
+  testVerifyingAGroupLargerThanTheOpenFilePool();
+  testVerifyingDirectoriesPairsFilesByDigest();
+  testVerifyingSkipsCachedGroups();
+  testVerifyingRereadsChangedFiles();
+  testVerifyingGroupsAcrossThreads();
+}
@@ -95,6 +95,31 @@ void testScanMetaDataInputEquals() {
   assert(equality_test);
 }
 
+/* --------------------------- cache_option_input --------------------------- */
+void testCacheOptionInputEquals() {
+  // Arrange
+  cache_option_input test_cache_option_one = {"digest_names", "1"};
+  cache_option_input test_cache_option_two = {"digest_names", "1"};
+
+  // Act
+  bool equality_test = test_cache_option_one == test_cache_option_two;
+
+  // Assert
+  assert(equality_test);
+}
+
+void testCacheOptionRowNotEquals() {
+  // Arrange
+  cache_option_table_row test_cache_option_one = {"digest_names", "1"};
+  cache_option_table_row test_cache_option_two = {"digest_names", "0"};
+
+  // Act
+  bool equality_test = test_cache_option_one == test_cache_option_two;
+
+  // Assert
+  assert(!equality_test);
+}
+
 int main() {
   testDirectoryTableRowEqualOperator();
   testHashTableRowEqualOperator();
@@ -103,4 +128,6 @@ int main() {
   testHashInputNotEquals();
   testDirectoryInputEquals();
   testScanMetaDataInputEquals();
+  testCacheOptionInputEquals();
+  testCacheOptionRowNotEquals();
 }
\ No newline at end of file
@@ -2,11 +2,14 @@
 #include <cassert>
 #include <filesystem>
 
+#include "../../src/arena/arena.cpp"
 #include "../../src/lib.cpp"
 #include "../../src/sqlite/operators.cpp"
 #include "../../src/sqlite/sqlite.cpp"
 #include "../data.cpp"
 
+arena *TEST_ARENA = initArena();
+
 // TODO: Test with spaces.
 /* ----------------------------- SQLiteDatabase ----------------------------- */
 void testConnectingToDb() {
@@ -38,9 +41,11 @@ void testResetingDatabase() {
   int hashes_code = sqlite3_exec(db, "SELECT * FROM Hashes;", 0, 0, 0);
   int scan_meta_data_code =
       sqlite3_exec(db, "SELECT * FROM ScanMetaData;", 0, 0, 0);
+  int cache_options_code =
+      sqlite3_exec(db, "SELECT * FROM CacheOptions;", 0, 0, 0);
 
   assert(directories_code == SQLITE_OK && hashes_code == SQLITE_OK &&
-         scan_meta_data_code == SQLITE_OK);
+         scan_meta_data_code == SQLITE_OK && cache_options_code == SQLITE_OK);
 
   // Cleanup
   freeDB(db);
@@ -152,7 +157,7 @@ void testFetchingLastDirectoryId() {
   sqlite3 *db = initDB("tests/test_hash.db");
 
   // Act
-  int actual_directory_id = fetchLastDirectoryId(db);
+  row_id actual_directory_id = fetchLastDirectoryId(db);
 
   // Assert
   assert(actual_directory_id == 10);
@@ -168,7 +173,7 @@ void testFetchingLastDirectoryIdReturnsNegative() {
   resetDB(db);
 
   // Act
-  int actual_directory_id = fetchLastDirectoryId(db);
+  row_id actual_directory_id = fetchLastDirectoryId(db);
 
   // Assert
   assert(actual_directory_id == -1);
@@ -186,7 +191,7 @@ void testLoadingDirectoriesFromTestDB() {
 
   // Act
   directory_table_row::rows actual_directory_table_rows =
-      fetchAllDirectories(db);
+      fetchAllDirectories(db, TEST_ARENA);
 
   // Assert
   assert(actual_directory_table_rows == expected_directory_table_rows);
@@ -204,7 +209,7 @@ void testCreatingANewDirectory() {
   directory_input test_directory{.parent_id = 8, .name = "testing_create"};
 
   // Act
-  int id = createDirectory(db, test_directory);
+  row_id id = createDirectory(db, test_directory);
 
   // Assert
   assert(id == 1);
@@ -214,6 +219,30 @@ void testCreatingANewDirectory() {
   freeDB(db);
 }
 
+void testCreatingDirectoriesInOneTransaction() {
+  // Arrange
+  str_const test_db = "tests/test_create_transaction.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+
+  // Act
+  beginTransaction(db);
+  createDirectory(db, {.parent_id = -1, .name = "first"});
+  row_id id = createDirectory(db, {.parent_id = 1, .name = "second"});
+  bool grouped = !sqlite3_get_autocommit(db);
+  commitTransaction(db);
+
+  // Assert
+  assert(id == 2);
+  assert(grouped);
+  assert(sqlite3_get_autocommit(db));
+  assert(fetchLastDirectoryId(db) == 2);
+
+  // Cleanup
+  std::filesystem::remove(test_db);
+  freeDB(db);
+}
+
 /* ----------------------------- fetchAllHashes ----------------------------- */
 const hash_table_row::rows expected_hash_table_rows = {
     {1, 8, "example1.txt",
@@ -244,7 +273,7 @@ void testFetchingLastHashId() {
   sqlite3 *db = initDB("tests/test_hash.db");
 
   // Act
-  int actual_hash_id = fetchLastHashId(db);
+  row_id actual_hash_id = fetchLastHashId(db);
 
   // Assert
   assert(actual_hash_id == 7);
@@ -260,7 +289,7 @@ void testFetchingLastHashIdReturnsNegative() {
   resetDB(db);
 
   // Act
-  int actual_hash_id = fetchLastHashId(db);
+  row_id actual_hash_id = fetchLastHashId(db);
 
   // Assert
   assert(actual_hash_id == -1);
@@ -276,7 +305,7 @@ void testLoadingHashesFromTestDB() {
   sqlite3 *db = initDB("tests/test_hash.db");
 
   // Act
-  hash_table_row::rows actual_hash_table_rows = fetchAllHashes(db);
+  hash_table_row::rows actual_hash_table_rows = fetchAllHashes(db, TEST_ARENA);
 
   // Assert
   assert(actual_hash_table_rows == expected_hash_table_rows);
@@ -295,7 +324,7 @@ void testCreatingANewHash() {
       .directory_id = 10, .name = "testing.txt", .hash = uniqueTestHash()};
 
   // Act
-  int id = createHash(db, test_hash);
+  row_id id = createHash(db, test_hash);
 
   // Assert
   assert(id == 1);
@@ -305,6 +334,55 @@ void testCreatingANewHash() {
   freeDB(db);
 }
 
+void testCreatingANewHashStoresSize() {
+  // Arrange
+  str_const test_db = "tests/test_create_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  hash_input test_hash{.directory_id = 10,
+                       .name = "testing.txt",
+                       .hash = uniqueTestHash(),
+                       .size = INT64_C(1) << 33};
+
+  // Act
+  createHash(db, test_hash);
+
+  // Assert
+  hash_table_row::rows actual_rows = fetchAllHashes(db, TEST_ARENA);
+  assert(actual_rows.size() == 1);
+  assert(actual_rows[0].size == INT64_C(1) << 33);
+
+  // Cleanup
+  std::filesystem::remove(test_db);
+  freeDB(db);
+}
+
+void testCreatingANewHashStoresExtents() {
+  // Arrange
+  str_const test_db = "tests/test_create_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+
+  // Act
+  createHash(db, {.directory_id = 10,
+                  .name = "mapped.txt",
+                  .hash = uniqueTestHash(),
+                  .extents = uniqueTestHash(3)});
+  createHash(db, {.directory_id = 10,
+                  .name = "unmapped.txt",
+                  .hash = uniqueTestHash()});
+
+  // Assert
+  hash_table_row::rows actual_rows = fetchAllHashes(db, TEST_ARENA);
+  assert(actual_rows.size() == 2);
+  assert(compareHashes(actual_rows[0].extents, uniqueTestHash(3)));
+  assert(actual_rows[1].extents == nullptr);
+
+  // Cleanup
+  std::filesystem::remove(test_db);
+  freeDB(db);
+}
+
 /* ------------------------------- deleteHash ------------------------------- */
 void testDeletingAHash() {
   // Arrange
@@ -313,7 +391,7 @@ void testDeletingAHash() {
   resetDB(db);
   hash_input test_hash{
       .directory_id = 10, .name = "testing.txt", .hash = uniqueTestHash()};
-  int id = createHash(db, test_hash);
+  row_id id = createHash(db, test_hash);
 
   // Act
   deleteHash(db, id);
@@ -326,6 +404,403 @@ void testDeletingAHash() {
   freeDB(db);
 }
 
+/* ----------------------------- 64-bit row ids ----------------------------- */
+void testRowIdsPastThirtyTwoBits() {
+  // Arrange
+  str_const test_db = "tests/test_large_id_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  row_id const large_id = INT64_C(1) << 32;
+  sqlite3_stmt *seed_stmt;
+  sqlite3_prepare_v2(db,
+                     "INSERT INTO Directories (id, name, parent_id) "
+                     "VALUES(?, 'seed', -1);",
+                     -1, &seed_stmt, 0);
+  sqlite3_bind_int64(seed_stmt, 1, large_id);
+  sqlite3_step(seed_stmt);
+  sqlite3_finalize(seed_stmt);
+
+  // Act
+  row_id directory_id =
+      createDirectory(db, {.parent_id = large_id, .name = "child"});
+  row_id hash_id = createHash(db, {.directory_id = directory_id,
+                                   .name = "testing.txt",
+                                   .hash = uniqueTestHash()});
+
+  // Assert
+  assert(directory_id == large_id + 1);
+  assert(fetchLastDirectoryId(db) == large_id + 1);
+  assert(hash_id == 1);
+
+  directory_table_row::rows directory_rows =
+      fetchAllDirectories(db, TEST_ARENA);
+  directory_table_row::rows expected_directory_rows = {
+      {large_id, "seed", -1}, {large_id + 1, "child", large_id}};
+  assert(directory_rows == expected_directory_rows);
+
+  hash_table_row::rows hash_rows = fetchAllHashes(db, TEST_ARENA);
+  assert(hash_rows.size() == 1 && hash_rows[0].directory_id == large_id + 1);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+/* ------------------------- updateDirectoryDigests ------------------------- */
+void testUpdatingDirectoryDigests() {
+  // Arrange
+  str_const test_db = "tests/test_digest_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  row_id root_id = createDirectory(db, {.parent_id = -1, .name = "root"});
+  row_id child_id = createDirectory(db, {.parent_id = root_id, .name = "a"});
+
+  // Act
+  updateDirectoryDigests(db, {{root_id, uniqueTestHash(1), 20},
+                              {child_id, uniqueTestHash(2), 10}});
+
+  // Assert
+  directory_table_row::rows actual_rows = fetchAllDirectories(db, TEST_ARENA);
+  directory_table_row::rows expected_rows = {
+      {root_id, "root", -1, uniqueTestHash(1), 20},
+      {child_id, "a", root_id, uniqueTestHash(2), 10}};
+  assert(actual_rows == expected_rows);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+void testUpdatingDirectoryDigestsThrowsWhenItCanNotBegin() {
+  // Arrange
+  str_const test_db = "tests/test_digest_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  row_id root_id = createDirectory(db, {.parent_id = -1, .name = "root"});
+  beginTransaction(db);
+
+  // Act
+  bool thrown = false;
+  try {
+    updateDirectoryDigests(db, {{root_id, uniqueTestHash(1), 20}});
+  } catch (unable_to_insert_error &error) {
+    thrown = true;
+  }
+
+  // Assert
+  assert(thrown);
+
+  // Cleanup
+  commitTransaction(db);
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+void testNewDirectoriesAreDirty() {
+  // Arrange
+  str_const test_db = "tests/test_digest_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+
+  // Act
+  createDirectory(db, {.parent_id = -1, .name = "root"});
+
+  // Assert
+  directory_table_row::rows actual_rows = fetchAllDirectories(db, TEST_ARENA);
+  assert(actual_rows.size() == 1);
+  assert(actual_rows[0].hash == nullptr);
+  assert(actual_rows[0].size == 0);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+/* -------------------------- clearDirectoryDigests ------------------------- */
+void testClearingDirectoryDigests() {
+  // Arrange
+  str_const test_db = "tests/test_digest_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  row_id root_id = createDirectory(db, {.parent_id = -1, .name = "root"});
+  row_id child_id = createDirectory(db, {.parent_id = root_id, .name = "a"});
+  updateDirectoryDigests(db, {{root_id, uniqueTestHash(1), 20},
+                              {child_id, uniqueTestHash(2), 10}});
+
+  // Act
+  clearDirectoryDigests(db, {root_id});
+
+  // Assert
+  directory_table_row::rows actual_rows = fetchAllDirectories(db, TEST_ARENA);
+  assert(actual_rows[0].hash == nullptr);
+  assert(compareHashes(actual_rows[1].hash, uniqueTestHash(2)));
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+void testUpdatingDirectoryStamps() {
+  // Arrange
+  str_const test_db = "tests/test_digest_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  row_id root_id = createDirectory(
+      db, {.parent_id = -1, .name = "root", .modified_ns = 5});
+  row_id child_id = createDirectory(db, {.parent_id = root_id, .name = "a"});
+
+  // Act
+  updateDirectoryStamps(db, {{child_id, 42}});
+
+  // Assert
+  directory_table_row::rows actual_rows = fetchAllDirectories(db, TEST_ARENA);
+  assert(actual_rows[0].modified_ns == 5);
+  assert(actual_rows[1].modified_ns == 42);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+void testUpdatingHashes() {
+  // Arrange
+  str_const test_db = "tests/test_digest_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  row_id root_id = createDirectory(db, {.parent_id = -1, .name = "root"});
+  row_id hash_id = createHash(db, {.directory_id = root_id,
+                                   .name = "a.txt",
+                                   .hash = uniqueTestHash(1),
+                                   .size = 10,
+                                   .modified_ns = 7});
+
+  // Act
+  updateHashes(db, {{hash_id, uniqueTestHash(2), 12, 9}});
+
+  // Assert
+  hash_table_row::rows actual_rows = fetchAllHashes(db, TEST_ARENA);
+  hash_table_row::rows expected_rows = {
+      {hash_id, root_id, "a.txt", uniqueTestHash(2), 12, 9}};
+  assert(actual_rows == expected_rows);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+void testUpdatingHashesReplacesTheirExtents() {
+  // Arrange
+  str_const test_db = "tests/test_digest_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  row_id root_id = createDirectory(db, {.parent_id = -1, .name = "root"});
+  row_id mapped_id = createHash(db, {.directory_id = root_id,
+                                     .name = "a.txt",
+                                     .hash = uniqueTestHash(1),
+                                     .extents = uniqueTestHash(3)});
+  row_id unmapped_id = createHash(db, {.directory_id = root_id,
+                                       .name = "b.txt",
+                                       .hash = uniqueTestHash(1)});
+
+  // Act
+  updateHashes(db,
+               {{mapped_id, uniqueTestHash(2), 12, 9, nullptr},
+                {unmapped_id, uniqueTestHash(2), 12, 9, uniqueTestHash(4)}});
+
+  // Assert
+  hash_table_row::rows actual_rows = fetchAllHashes(db, TEST_ARENA);
+  assert(actual_rows[0].extents == nullptr);
+  assert(compareHashes(actual_rows[1].extents, uniqueTestHash(4)));
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+/* -------------------------------- upgradeDB ------------------------------- */
+void testUpgradingAnOldCache() {
+  // Arrange
+  str_const test_db = "tests/test_upgrade_hash.db";
+  std::filesystem::copy_file("tests/test_hash.db", test_db,
+                             std::filesystem::copy_options::overwrite_existing);
+  sqlite3 *db = initDB(test_db);
+
+  // Act
+  upgradeDB(db);
+  upgradeDB(db);
+
+  // Assert
+  updateDirectoryDigests(db, {{1, uniqueTestHash(1), 20}});
+  directory_table_row::rows actual_rows = fetchAllDirectories(db, TEST_ARENA);
+  assert(compareHashes(actual_rows[0].hash, uniqueTestHash(1)));
+  assert(actual_rows[1].hash == nullptr);
+  assert(fetchAllHashes(db, TEST_ARENA) == expected_hash_table_rows);
+  assert(fetchAllVerifiedGroups(db, TEST_ARENA).size() == 0);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+/* -------------------------- createVerifiedGroups -------------------------- */
+void testCreatingVerifiedGroups() {
+  // Arrange
+  str_const test_db = "tests/test_verified_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+
+  // Act
+  createVerifiedGroups(db, {{uniqueTestHash(1)}, {uniqueTestHash(2)}});
+  createVerifiedGroups(db, {{uniqueTestHash(1)}});
+
+  // Assert
+  verified_group_table_row::rows actual_rows =
+      fetchAllVerifiedGroups(db, TEST_ARENA);
+  verified_group_table_row::rows expected_rows{{uniqueTestHash(1)},
+                                               {uniqueTestHash(2)}};
+  assert(actual_rows == expected_rows);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+void testResettingClearsVerifiedGroups() {
+  // Arrange
+  str_const test_db = "tests/test_verified_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  createVerifiedGroups(db, {{uniqueTestHash(1)}});
+
+  // Act
+  resetDB(db);
+
+  // Assert
+  assert(fetchAllVerifiedGroups(db, TEST_ARENA).size() == 0);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+/* --------------------------- createPruneJournal --------------------------- */
+void testCreatingAPruneJournal() {
+  // Arrange
+  str_const test_db = "tests/test_prune_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+
+  // Act
+  createPruneJournal(db, {{3, "/a/copy.txt", "/a/file.txt", 10, 100, 90, 7},
+                          {4, "/b/copy.txt", "/b/file.txt", 20, 200, 190, 8}});
+
+  // Assert
+  prune_journal_table_row::rows actual_rows =
+      fetchPendingPruneJournal(db, TEST_ARENA);
+  prune_journal_table_row::rows expected_rows{
+      {1, 3, "/a/copy.txt", "/a/file.txt", 10, 100, 90, 7},
+      {2, 4, "/b/copy.txt", "/b/file.txt", 20, 200, 190, 8}};
+  assert(actual_rows == expected_rows);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+void testCreatingAPruneJournalThrowsWhenItCanNotBegin() {
+  // Arrange
+  str_const test_db = "tests/test_prune_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  beginTransaction(db);
+
+  // Act
+  bool thrown = false;
+  try {
+    createPruneJournal(db, {{3, "/a/copy.txt", "/a/file.txt", 10, 100, 90, 7}});
+  } catch (unable_to_insert_error &error) {
+    thrown = true;
+  }
+
+  // Assert
+  assert(thrown);
+
+  // Cleanup
+  commitTransaction(db);
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+void testResettingDropsThePruneJournal() {
+  // Arrange
+  str_const test_db = "tests/test_prune_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  createPruneJournal(db, {{3, "/a/copy.txt", "/a/file.txt", 10, 100, 90, 7}});
+
+  // Act
+  resetDB(db);
+
+  // Assert
+  assert(fetchPendingPruneJournal(db, TEST_ARENA).size() == 0);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+/* --------------------------- finishPruneJournal --------------------------- */
+void testFinishingAPruneJournal() {
+  // Arrange
+  str_const test_db = "tests/test_prune_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  row_id root_id = createDirectory(db, {.parent_id = -1, .name = "root"});
+  row_id child_id = createDirectory(db, {.parent_id = root_id, .name = "a"});
+  row_id other_id = createDirectory(db, {.parent_id = root_id, .name = "b"});
+  updateDirectoryDigests(db, {{root_id, uniqueTestHash(1), 30},
+                              {child_id, uniqueTestHash(2), 20},
+                              {other_id, uniqueTestHash(3), 10}});
+  row_id kept_id = createHash(db, {.directory_id = child_id,
+                                   .name = "file.txt",
+                                   .hash = uniqueTestHash(4)});
+  row_id deleted_id = createHash(db, {.directory_id = child_id,
+                                      .name = "copy.txt",
+                                      .hash = uniqueTestHash(4)});
+  row_id changed_id = createHash(db, {.directory_id = other_id,
+                                      .name = "copy.txt",
+                                      .hash = uniqueTestHash(4)});
+  createPruneJournal(
+      db,
+      {{deleted_id, "/root/a/copy.txt", "/root/a/file.txt", 10, 100, 90, 7},
+       {changed_id, "/root/b/copy.txt", "/root/a/file.txt", 10, 100, 90, 7},
+       {changed_id, "/root/b/copy.txt", "/root/a/file.txt", 10, 100, 90, 7}});
+
+  // Act
+  finishPruneJournal(db, {{1, PRUNE_OUTCOME_DELETED}, {2, PRUNE_OUTCOME_KEPT}});
+
+  // Assert
+  hash_table_row::rows actual_hashes = fetchAllHashes(db, TEST_ARENA);
+  assert(actual_hashes.size() == 2);
+  assert(actual_hashes[0].id == kept_id);
+  assert(actual_hashes[1].id == changed_id);
+
+  directory_table_row::rows actual_directories =
+      fetchAllDirectories(db, TEST_ARENA);
+  assert(actual_directories[0].hash == nullptr);
+  assert(actual_directories[1].hash == nullptr);
+  assert(compareHashes(actual_directories[2].hash, uniqueTestHash(3)));
+
+  prune_journal_table_row::rows actual_journal =
+      fetchPendingPruneJournal(db, TEST_ARENA);
+  assert(actual_journal.size() == 1);
+  assert(actual_journal[0].id == 3);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
 /* ---------------------------- fetchScanMetaData --------------------------- */
 void testFetchScanMetaData() {
   // Arrange
@@ -407,6 +882,159 @@ void testCreatingScanMetaDataOverwritesPrevious() {
   freeDB(db);
 }
 
+/* ---------------------------- fetchCacheOption ---------------------------- */
+void testFetchCacheOptionReturnsErrorWhenMissing() {
+  // Arrange
+  str_const test_db = "tests/test_empty_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+
+  try {
+    // Act
+    fetchCacheOption(db, DIGEST_NAMES_OPTION);
+
+    assert(false);
+  } catch (not_found_error &e) {
+    // Assert
+    assert(true);
+  }
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+void testFetchCacheOptionWithoutTableReturnsError() {
+  // Arrange
+  str_const test_db = "tests/test_empty_hash.db";
+  sqlite3 *db = initDB(test_db);
+
+  try {
+    // Act
+    fetchCacheOption(db, DIGEST_NAMES_OPTION);
+
+    assert(false);
+  } catch (not_found_error &e) {
+    // Assert
+    assert(true);
+  }
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+}
+
+/* ---------------------------- createCacheOption --------------------------- */
+void testCreatingCacheOptionOverwritesPrevious() {
+  // Arrange
+  str_const test_db = "tests/test_create_hash.db";
+  sqlite3 *db = initDB(test_db);
+  resetDB(db);
+  createCacheOption(db, {.name = DIGEST_NAMES_OPTION, .value = "0"});
+
+  // Act
+  createCacheOption(db, {.name = DIGEST_NAMES_OPTION, .value = "1"});
+
+  // Assert
+  cache_option_table_row row = fetchCacheOption(db, DIGEST_NAMES_OPTION);
+  cache_option_table_row expected_row{.name = DIGEST_NAMES_OPTION,
+                                      .value = "1"};
+  assert(row == expected_row);
+
+  // Cleanup
+  std::filesystem::remove(test_db);
+  freeDB(db);
+}
+
+/* ------------------------------ Digest Store ------------------------------ */
+void testStoringDigestsInWalMode() {
+  // Arrange
+  str_const test_db = "tests/test_shared.store";
+  sqlite3 *db = initDB(test_db);
+
+  // Act
+  initStoreDB(db);
+  initStoreDB(db);
+  createStoredDigests(db, {{{1, 2, 3, 4}, uniqueTestHash(1), 5}});
+
+  // Assert
+  sqlite3_stmt *statement;
+  sqlite3_prepare_v2(db, "PRAGMA journal_mode;", -1, &statement, 0);
+  sqlite3_step(statement);
+  assert(compareStrings("wal",
+                        (char const *)sqlite3_column_text(statement, 0)));
+  sqlite3_finalize(statement);
+
+  digest actual_digest{};
+  assert(fetchStoredDigest(db, {1, 2, 3, 4}, actual_digest.bytes));
+  assert(actual_digest == toDigest(uniqueTestHash(1)));
+  assert(!fetchStoredDigest(db, {1, 2, 3, 5}, actual_digest.bytes));
+  assert(fetchStoreClock(db) == 5);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+  std::filesystem::remove("tests/test_shared.store-wal");
+  std::filesystem::remove("tests/test_shared.store-shm");
+}
+
+void testStoringDigestsWhileAnotherRunHoldsTheLockThrows() {
+  // Arrange
+  str_const test_db = "tests/test_locked_shared.store";
+  sqlite3 *db = initDB(test_db);
+  sqlite3 *other_db = initDB(test_db);
+  initStoreDB(db);
+  initStoreDB(other_db);
+  sqlite3_busy_timeout(db, 1);
+  sqlite3_exec(other_db, "BEGIN IMMEDIATE TRANSACTION;", 0, 0, 0);
+
+  try {
+    // Act
+    createStoredDigests(db, {{{1, 2, 3, 4}, uniqueTestHash(1), 5}});
+    assert(false);
+  } catch (unable_to_insert_error &error) {
+    // Assert
+    sqlite3_exec(other_db, "ROLLBACK;", 0, 0, 0);
+    digest actual_digest{};
+    assert(!fetchStoredDigest(db, {1, 2, 3, 4}, actual_digest.bytes));
+    assert(sqlite3_get_autocommit(db));
+  }
+
+  // Cleanup
+  freeDB(other_db);
+  freeDB(db);
+  std::filesystem::remove(test_db);
+  std::filesystem::remove("tests/test_locked_shared.store-wal");
+  std::filesystem::remove("tests/test_locked_shared.store-shm");
+}
+
+void testEvictingTheLeastRecentlyUsedDigests() {
+  // Arrange
+  str_const test_db = "tests/test_shared.store";
+  sqlite3 *db = initDB(test_db);
+  initStoreDB(db);
+  createStoredDigests(db, {{{1, 1, 1, 1}, uniqueTestHash(1), 1},
+                           {{1, 2, 1, 1}, uniqueTestHash(2), 2},
+                           {{1, 3, 1, 1}, uniqueTestHash(3), 3}});
+  touchStoredDigests(db, {{1, 1, 1, 1}}, 4);
+
+  // Act
+  evictStoredDigests(db, 2);
+
+  // Assert
+  digest actual_digest{};
+  assert(fetchStoredDigest(db, {1, 1, 1, 1}, actual_digest.bytes));
+  assert(!fetchStoredDigest(db, {1, 2, 1, 1}, actual_digest.bytes));
+  assert(fetchStoredDigest(db, {1, 3, 1, 1}, actual_digest.bytes));
+  assert(fetchStoreClock(db) == 4);
+
+  // Cleanup
+  freeDB(db);
+  std::filesystem::remove(test_db);
+  std::filesystem::remove("tests/test_shared.store-wal");
+  std::filesystem::remove("tests/test_shared.store-shm");
+}
+
 int main() {
   testConnectingToDb();
   testResetingDatabase();
@@ -417,13 +1045,37 @@ int main() {
   testFetchingLastDirectoryIdReturnsNegative();
   testLoadingDirectoriesFromTestDB();
   testCreatingANewDirectory();
+  testCreatingDirectoriesInOneTransaction();
   testFetchingLastHashId();
   testFetchingLastHashIdReturnsNegative();
   testLoadingHashesFromTestDB();
   testCreatingANewHash();
+  testCreatingANewHashStoresSize();
+  testCreatingANewHashStoresExtents();
   testDeletingAHash();
+  testRowIdsPastThirtyTwoBits();
+  testUpdatingDirectoryDigests();
+  testUpdatingDirectoryDigestsThrowsWhenItCanNotBegin();
+  testNewDirectoriesAreDirty();
+  testClearingDirectoryDigests();
+  testUpdatingDirectoryStamps();
+  testUpdatingHashes();
+  testUpdatingHashesReplacesTheirExtents();
+  testUpgradingAnOldCache();
+  testCreatingVerifiedGroups();
+  testResettingClearsVerifiedGroups();
+  testCreatingAPruneJournal();
+  testCreatingAPruneJournalThrowsWhenItCanNotBegin();
+  testResettingDropsThePruneJournal();
+  testFinishingAPruneJournal();
   testFetchScanMetaData();
   testFetchScanMetaDataReturnsErrorWhenMissing();
   testCreatingScanMetaData();
   testCreatingScanMetaDataOverwritesPrevious();
+  testFetchCacheOptionReturnsErrorWhenMissing();
+  testFetchCacheOptionWithoutTableReturnsError();
+  testCreatingCacheOptionOverwritesPrevious();
+  testStoringDigestsInWalMode();
+  testStoringDigestsWhileAnotherRunHoldsTheLockThrows();
+  testEvictingTheLeastRecentlyUsedDigests();
 }
@@ -0,0 +1,122 @@
+#include <cassert>
+#include <cstdint>
+
+#include "../src/arena/arena.cpp"
+#include "../src/lib.cpp"
+#include "./data.cpp"
+
+/* -------------------------------- arenaAlloc ------------------------------ */
+void testAllocatingFromTheSameBlock() {
+  // Arrange
+  arena *test_arena = initArena(64);
+
+  // Act
+  char *first = static_cast<char *>(arenaAlloc(test_arena, 10));
+  char *second = static_cast<char *>(arenaAlloc(test_arena, 10));
+
+  // Assert
+  assert(second == first + 10);
+  assert(arenaStats(test_arena).blocks == 1);
+
+  // Cleanup
+  freeArena(test_arena);
+}
+
+void testAllocatingAligned() {
+  // Arrange
+  arena *test_arena = initArena(64);
+  arenaAlloc(test_arena, 3);
+
+  // Act
+  void *aligned = arenaAlloc(test_arena, 8, alignof(uint64_t));
+
+  // Assert
+  assert(reinterpret_cast<std::uintptr_t>(aligned) % alignof(uint64_t) == 0);
+
+  // Cleanup
+  freeArena(test_arena);
+}
+
+void testAllocatingPastTheBlockStartsANewBlock() {
+  // Arrange
+  arena *test_arena = initArena(16);
+  arenaAlloc(test_arena, 12);
+
+  // Act
+  arenaAlloc(test_arena, 12);
+
+  // Assert
+  arena_stats expected_stats{.allocations = 2,
+                             .bytes_allocated = 24,
+                             .bytes_reserved = 32,
+                             .blocks = 2};
+  assert(arenaStats(test_arena) == expected_stats);
+
+  // Cleanup
+  freeArena(test_arena);
+}
+
+void testOversizedAllocationKeepsTheCurrentBlock() {
+  // Arrange
+  arena *test_arena = initArena(16);
+  char *first = static_cast<char *>(arenaAlloc(test_arena, 4));
+
+  // Act
+  arenaAlloc(test_arena, 100);
+  char *second = static_cast<char *>(arenaAlloc(test_arena, 4));
+
+  // Assert
+  assert(second == first + 4);
+  arena_stats expected_stats{.allocations = 3,
+                             .bytes_allocated = 108,
+                             .bytes_reserved = 116,
+                             .blocks = 2};
+  assert(arenaStats(test_arena) == expected_stats);
+
+  // Cleanup
+  freeArena(test_arena);
+}
+
+/* ------------------------------ arenaStringDup ---------------------------- */
+void testArenaStringDup() {
+  // Arrange
+  arena *test_arena = initArena();
+  str_const test_string = "hello!";
+
+  // Act
+  char *actual_string = arenaStringDup(test_arena, test_string);
+
+  // Assert
+  assert(compareStrings(test_string, actual_string));
+  assert(actual_string != test_string);
+  assert(arenaStats(test_arena).bytes_allocated == 7);
+
+  // Cleanup
+  freeArena(test_arena);
+}
+
+/* ------------------------------- arenaHashDup ----------------------------- */
+void testArenaHashDup() {
+  // Arrange
+  arena *test_arena = initArena();
+  hash test_hash = uniqueTestHash(12);
+
+  // Act
+  hash actual_hash = arenaHashDup(test_arena, test_hash);
+
+  // Assert
+  assert(compareHashes(test_hash, actual_hash));
+  assert(arenaStats(test_arena).bytes_allocated == MD5_DIGEST_LENGTH);
+
+  // Cleanup
+  freeArena(test_arena);
+}
+
+int main() {
+  testAllocatingFromTheSameBlock();
+  testAllocatingAligned();
+  testAllocatingPastTheBlockStartsANewBlock();
+  testOversizedAllocationKeepsTheCurrentBlock();
+  testArenaStringDup();
+  testArenaHashDup();
+}
@@ -1,5 +1,6 @@
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <sstream>
@@ -15,6 +16,7 @@
 
 /* ------------------------------ Output Mocks ------------------------------ */
 std::ostringstream OUTPUT_MOCK{};
+build_options const TEST_BUILD_OPTIONS{.digest_names = false};
 
 /* ---------------------------- File System Mocks --------------------------- */
 
@@ -129,10 +131,100 @@ void visitFiles(const std::string &directory_path,
   }
 }
 
-void extractHash(uint8_t *hash, std::string path) {
+/* ---------------------------- Digest Store Mock --------------------------- */
+digest_store MOCK_STORE{};
+std::string last_init_digest_store_path{};
+std::vector<digest_store *> last_extract_stored_hash_stores{};
+bool last_free_digest_store = false;
+
+bool last_init_digest_store_attributes = false;
+
+digest_store *initDigestStore(std::string const &store_path, bool attributes,
+                              std::size_t max_entries) {
+  last_init_digest_store_path = store_path;
+  last_init_digest_store_attributes = attributes;
+  return store_path.empty() && !attributes ? nullptr : &MOCK_STORE;
+}
+
+void printDigestStoreStats(digest_store const *store, std::ostream &console) {}
+
+// Every file is found in the store, files are only read without one.
+bool extractStoredHash(digest_store *store, uint8_t *hash,
+                       std::string const &path, file_stamp const &stamp) {
+  last_extract_stored_hash_stores.push_back(store);
   for (int i = 0; i < MD5_DIGEST_LENGTH; ++i) {
     hash[i] = 255;
   }
+  return store == nullptr;
+}
+
+void freeDigestStore(digest_store *store) {
+  last_free_digest_store = store == &MOCK_STORE;
+}
+
+// Sizes are the length of the path and times ten times that.
+bool stampFile(std::string const &file_path, file_stamp &stamp) {
+  stamp.size = static_cast<int64_t>(file_path.size());
+  stamp.modified_ns = static_cast<int64_t>(file_path.size()) * 10;
+  return true;
+}
+
+// Only the example_one files are mapped, their fingerprints are all 3s.
+std::vector<std::string> last_fingerprint_extents_paths{};
+
+bool fingerprintExtents(std::string const &path, uint8_t *fingerprint) {
+  last_fingerprint_extents_paths.push_back(path);
+  if (path.find("example_one") == std::string::npos) {
+    return false;
+  }
+  std::fill(fingerprint, fingerprint + MD5_DIGEST_LENGTH, 3);
+  return true;
+}
+
+/* ------------------------------ Manifest Mock ----------------------------- */
+std::vector<std::string> file_exists_paths{};
+std::vector<std::string> trusted_manifest_paths{};
+std::vector<std::pair<std::string, std::string>> last_load_manifest{};
+std::vector<std::string> last_trust_manifest_digest{};
+
+bool fileExists(std::string const &path) {
+  return std::find(file_exists_paths.begin(), file_exists_paths.end(),
+                   path) != file_exists_paths.end();
+}
+
+std::size_t loadManifest(manifest_index &index,
+                         std::string const &manifest_path,
+                         std::string const &absolute_directory) {
+  last_load_manifest.push_back({manifest_path, absolute_directory});
+  index.trusted.push_back(true);
+  ++index.stats.manifests_loaded;
+  return 1;
+}
+
+bool trustManifestDigest(manifest_index &index,
+                         std::string const &absolute_path,
+                         std::string const &path, uint8_t *hash) {
+  last_trust_manifest_digest.push_back(absolute_path);
+  if (std::find(trusted_manifest_paths.begin(), trusted_manifest_paths.end(),
+                absolute_path) == trusted_manifest_paths.end()) {
+    return false;
+  }
+
+  ++index.stats.files_trusted;
+  for (int i = 0; i < MD5_DIGEST_LENGTH; ++i) {
+    hash[i] = 7;
+  }
+  return true;
+}
+
+/* ------------------------------ Lockstep Mock ----------------------------- */
+std::vector<lockstep_file> last_hash_in_lockstep{};
+
+lockstep_stats hashInLockstep(std::vector<lockstep_file> const &files,
+                              std::vector<digest> &digests) {
+  last_hash_in_lockstep = files;
+  digests.assign(files.size(), toDigest(uniqueTestHash(7)));
+  return {.files_hashed = files.size()};
 }
 
 /* ------------------------------ Database Mock ----------------------------- */
@@ -152,37 +244,48 @@ bool last_reset_db = false;
 std::vector<directory_input> last_create_directory{};
 std::vector<hash_input> last_create_hash{};
 std::vector<scan_meta_data_input> last_create_scan_meta_data{};
-int last_create_directory_id = 0;
-int last_create_hash_id = 0;
+std::vector<cache_option_input> last_create_cache_option{};
+row_id last_create_directory_id = 0;
+row_id last_create_hash_id = 0;
 
 sqlite3 *initDB(char const *const file_name) { return nullptr; }
 void resetDB(sqlite3 *db) { last_reset_db = true; }
 void freeDB(sqlite3 *db) { return; }
 
-directory_table_row::rows fetchAllDirectories(sqlite3 *db) {
+directory_table_row::rows fetchAllDirectories(sqlite3 *db, arena *arena) {
   return fetch_all_directories_return;
 }
 
-int createDirectory(sqlite3 *db, directory_input const &directory_table_input) {
+row_id createDirectory(sqlite3 *db,
+                       directory_input const &directory_table_input) {
   last_create_directory.push_back(
       directory_input{.parent_id = directory_table_input.parent_id,
-                      .name = stringDup(directory_table_input.name)});
+                      .name = stringDup(directory_table_input.name),
+                      .modified_ns = directory_table_input.modified_ns});
   ++last_create_directory_id;
   return last_create_directory_id;
 }
 
-hash_table_row::rows fetchAllHashes(sqlite3 *db) {
+hash_table_row::rows fetchAllHashes(sqlite3 *db, arena *arena) {
   return fetch_all_hashes_return;
 }
 
-int createHash(sqlite3 *db, hash_input const &hash_table_input) {
+row_id createHash(sqlite3 *db, hash_input const &hash_table_input) {
   uint8_t *hash_buffer = new uint8_t[MD5_DIGEST_LENGTH];
   std::memcpy(hash_buffer, hash_table_input.hash, MD5_DIGEST_LENGTH);
+  uint8_t *extents_buffer = nullptr;
+  if (hash_table_input.extents != nullptr) {
+    extents_buffer = new uint8_t[MD5_DIGEST_LENGTH];
+    std::memcpy(extents_buffer, hash_table_input.extents, MD5_DIGEST_LENGTH);
+  }
 
   last_create_hash.push_back(
       hash_input{.directory_id = hash_table_input.directory_id,
                  .name = stringDup(hash_table_input.name),
-                 .hash = hash_buffer});
+                 .hash = hash_buffer,
+                 .size = hash_table_input.size,
+                 .modified_ns = hash_table_input.modified_ns,
+                 .extents = extents_buffer});
 
   ++last_create_hash_id;
   return last_create_hash_id;
@@ -194,13 +297,31 @@ void createScanMetaData(
       .root_dir = stringDup(scan_meta_data_table_input.root_dir)});
 }
 
+void createCacheOption(sqlite3 *db,
+                       cache_option_input const &cache_option_table_input) {
+  last_create_cache_option.push_back(
+      cache_option_input{.name = stringDup(cache_option_table_input.name),
+                         .value = stringDup(cache_option_table_input.value)});
+}
+
 void resetMockStates() {
+  file_exists_paths.clear();
+  trusted_manifest_paths.clear();
+  last_load_manifest.clear();
+  last_trust_manifest_digest.clear();
+  last_init_digest_store_path = {};
+  last_init_digest_store_attributes = false;
+  last_extract_stored_hash_stores.clear();
+  last_free_digest_store = false;
+  last_hash_in_lockstep.clear();
+  last_fingerprint_extents_paths.clear();
   last_create_directory_id = 0;
   last_create_hash_id = 0;
   last_reset_db = false;
   last_create_directory.clear();
   last_create_hash.clear();
   last_create_scan_meta_data.clear();
+  last_create_cache_option.clear();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -213,7 +334,7 @@ void testBuildCacheResetsDB() {
   std::vector<std::string> test_paths = {"./dir1/", "../documents/dir2/"};
 
   // Act
-  build(test_paths, "testing", OUTPUT_MOCK);
+  build(test_paths, "testing", TEST_BUILD_OPTIONS, OUTPUT_MOCK);
 
   // Assert
   assert(last_reset_db);
@@ -244,7 +365,7 @@ void testBuildCacheCreatesDirectories() {
   std::vector<std::string> test_paths = {"./dir1/", "../documents/dir2/"};
 
   // Act
-  build(test_paths, "testing", OUTPUT_MOCK);
+  build(test_paths, "testing", TEST_BUILD_OPTIONS, OUTPUT_MOCK);
 
   // Assert
   std::vector<directory_input> expected_created_directories{
@@ -270,7 +391,7 @@ void testBuildCacheCreatesHashes() {
   std::vector<std::string> test_paths = {"./dir1/", "../documents/dir2/"};
 
   // Act
-  build(test_paths, "testing", OUTPUT_MOCK);
+  build(test_paths, "testing", TEST_BUILD_OPTIONS, OUTPUT_MOCK);
 
   // Assert
   std::vector<hash_input> expected_created_hashes{
@@ -296,13 +417,253 @@ void testBuildCacheCreatesHashes() {
   }
 }
 
+void testBuildCacheRecordsFileSizes() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing", TEST_BUILD_OPTIONS, OUTPUT_MOCK);
+
+  // Assert
+  std::vector<int64_t> expected_sizes{33, 41, 43, 52};
+  assert(expected_sizes.size() == last_create_hash.size());
+  for (int i = 0; i < expected_sizes.size(); ++i) {
+    assert(expected_sizes[i] == last_create_hash[i].size);
+  }
+}
+
+void testBuildCacheRecordsModificationTimes() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"./dir1/", "../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing", TEST_BUILD_OPTIONS, OUTPUT_MOCK);
+
+  // Assert
+  assert(last_create_directory[0].modified_ns == NOT_SCANNED_MODIFIED_NS);
+  assert(last_create_directory[1].modified_ns == NOT_SCANNED_MODIFIED_NS);
+  assert(last_create_directory[2].modified_ns == 70);
+  assert(last_create_directory[9].modified_ns == NOT_SCANNED_MODIFIED_NS);
+  assert(last_create_directory[10].modified_ns == 180);
+  for (hash_input const &created_hash : last_create_hash) {
+    assert(created_hash.modified_ns == created_hash.size * 10);
+  }
+}
+
+void testBuildCacheInLockstepHashesAfterScanning() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing", {.digest_names = false, .lockstep = true},
+        OUTPUT_MOCK);
+
+  // Assert
+  std::vector<std::string> expected_paths{
+      "../documents/dir2/example_one.txt",
+      "../documents/dir2/testing/example_two.txt",
+      "../documents/dir2/testing/example_three.txt",
+      "../documents/dir2/dir3/testing/test/example_four.txt"};
+  assert(expected_paths.size() == last_hash_in_lockstep.size());
+  for (int i = 0; i < expected_paths.size(); ++i) {
+    assert(expected_paths[i] == last_hash_in_lockstep[i].path);
+    assert(static_cast<int64_t>(expected_paths[i].size()) ==
+           last_hash_in_lockstep[i].size);
+  }
+
+  std::vector<hash_input> expected_created_hashes{
+      {1, "example_one.txt", uniqueTestHash(7), 33},
+      {2, "example_two.txt", uniqueTestHash(7), 41},
+      {2, "example_three.txt", uniqueTestHash(7), 43},
+      {5, "example_four.txt", uniqueTestHash(7), 52},
+  };
+  assert(expected_created_hashes.size() == last_create_hash.size());
+  for (int i = 0; i < expected_created_hashes.size(); ++i) {
+    assert(expected_created_hashes[i].directory_id ==
+           last_create_hash[i].directory_id);
+    assert(compareStrings(expected_created_hashes[i].name,
+                          last_create_hash[i].name));
+    assert(compareHashes(expected_created_hashes[i].hash,
+                         last_create_hash[i].hash));
+    assert(expected_created_hashes[i].size == last_create_hash[i].size);
+  }
+}
+
+void testBuildCacheRecordsExtentFingerprints() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"./dir1/"};
+
+  // Act
+  build(test_paths, "testing", TEST_BUILD_OPTIONS, OUTPUT_MOCK);
+
+  // Assert
+  assert(last_fingerprint_extents_paths.size() == last_create_hash.size());
+  for (hash_input const &created_hash : last_create_hash) {
+    if (compareStrings(created_hash.name, "example_one.txt")) {
+      assert(created_hash.extents[0] == 3 && created_hash.extents[15] == 3);
+    } else {
+      assert(created_hash.extents == nullptr);
+    }
+  }
+}
+
+void testBuildCacheInLockstepRecordsExtentFingerprints() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing", {.digest_names = false, .lockstep = true},
+        OUTPUT_MOCK);
+
+  // Assert
+  assert(last_fingerprint_extents_paths[0] ==
+         "../documents/dir2/example_one.txt");
+  assert(last_create_hash[0].extents[0] == 3);
+  assert(last_create_hash[1].extents == nullptr);
+}
+
+void testBuildCacheLooksFilesUpInTheStore() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing",
+        {.digest_names = false,
+         .lockstep = false,
+         .store_path = "/home/test/.cache/ddupes/shared.store"},
+        OUTPUT_MOCK);
+
+  // Assert
+  assert(last_init_digest_store_path ==
+         "/home/test/.cache/ddupes/shared.store");
+  assert(!last_init_digest_store_attributes);
+  assert(last_extract_stored_hash_stores.size() == 4);
+  for (digest_store *store : last_extract_stored_hash_stores) {
+    assert(store == &MOCK_STORE);
+  }
+  assert(last_fingerprint_extents_paths.size() == 0);
+  assert(last_free_digest_store);
+}
+
+void testBuildCachePassesExtendedAttributesToTheStore() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing",
+        {.digest_names = false,
+         .lockstep = false,
+         .store_path = "",
+         .attributes = true},
+        OUTPUT_MOCK);
+
+  // Assert
+  assert(last_init_digest_store_path.empty());
+  assert(last_init_digest_store_attributes);
+  assert(last_extract_stored_hash_stores.size() == 4);
+}
+
+void testBuildCacheInLockstepDoesNotUseTheStore() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing",
+        {.digest_names = false,
+         .lockstep = true,
+         .store_path = "/home/test/.cache/ddupes/shared.store"},
+        OUTPUT_MOCK);
+
+  // Assert
+  assert(last_init_digest_store_path.empty());
+  assert(!last_free_digest_store);
+}
+
+void testBuildCacheLoadsManifestsAsDirectoriesAreFound() {
+  // Arrange
+  resetMockStates();
+  file_exists_paths = {"../documents/dir2/MD5SUMS",
+                       "../documents/dir2/dir3/testing/MD5SUMS"};
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing",
+        {.digest_names = false,
+         .lockstep = false,
+         .store_path = "",
+         .attributes = false,
+         .trust_manifests = true,
+         .manifest_paths = {"./testing_one"},
+         .spot_check_every = 0},
+        OUTPUT_MOCK);
+
+  // Assert
+  std::vector<std::pair<std::string, std::string>> expected_loads{
+      {"./testing_one", "/home/data"},
+      {"../documents/dir2/MD5SUMS", "/home/testing/documents/dir2"},
+      {"../documents/dir2/dir3/testing/MD5SUMS",
+       "/home/testing/documents/dir2/dir3/testing"}};
+  assert(last_load_manifest == expected_loads);
+}
+
+void testBuildCacheTakesDigestsFromManifests() {
+  // Arrange
+  resetMockStates();
+  trusted_manifest_paths = {"/home/testing/documents/dir2/example_one.txt"};
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing",
+        {.digest_names = false,
+         .lockstep = false,
+         .store_path = "",
+         .attributes = false,
+         .trust_manifests = true,
+         .manifest_paths = {},
+         .spot_check_every = 0},
+        OUTPUT_MOCK);
+
+  // Assert
+  assert(last_trust_manifest_digest.size() == 4);
+  assert(last_trust_manifest_digest[1] ==
+         "/home/testing/documents/dir2/testing/example_two.txt");
+  assert(last_extract_stored_hash_stores.size() == 3);
+  assert(last_create_hash.size() == 4);
+  assert(last_create_hash[0].hash[0] == 7);
+  assert(last_create_hash[0].extents == nullptr);
+  assert(last_create_hash[1].hash[0] == 255);
+}
+
+void testBuildCacheWithoutTrustingManifestsDoesNotLoadThem() {
+  // Arrange
+  resetMockStates();
+  file_exists_paths = {"../documents/dir2/MD5SUMS"};
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing", TEST_BUILD_OPTIONS, OUTPUT_MOCK);
+
+  // Assert
+  assert(last_load_manifest.empty());
+  assert(last_trust_manifest_digest.empty());
+  assert(last_extract_stored_hash_stores.size() == 4);
+}
+
 void testBuildCacheBuildsScanMetaData() {
   // Arrange
   resetMockStates();
   std::vector<std::string> test_paths = {"./dir1/", "../documents/dir2/"};
 
   // Act
-  build(test_paths, "testing", OUTPUT_MOCK);
+  build(test_paths, "testing", TEST_BUILD_OPTIONS, OUTPUT_MOCK);
 
   // Assert
   std::vector<scan_meta_data_input> expected_scan_meta_data{
@@ -315,6 +676,35 @@ void testBuildCacheBuildsScanMetaData() {
   }
 }
 
+void testBuildCacheRecordsDigestNamesOption() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"./dir1/", "../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing", {.digest_names = true}, OUTPUT_MOCK);
+
+  // Assert
+  std::vector<cache_option_input> expected_cache_options{
+      {DIGEST_NAMES_OPTION, "1"}, {LOCKSTEP_PLACEHOLDERS_OPTION, "0"}};
+  assert(expected_cache_options == last_create_cache_option);
+}
+
+void testBuildCacheRecordsLockstepPlaceholders() {
+  // Arrange
+  resetMockStates();
+  std::vector<std::string> test_paths = {"../documents/dir2/"};
+
+  // Act
+  build(test_paths, "testing", {.digest_names = false, .lockstep = true},
+        OUTPUT_MOCK);
+
+  // Assert
+  std::vector<cache_option_input> expected_cache_options{
+      {DIGEST_NAMES_OPTION, "0"}, {LOCKSTEP_PLACEHOLDERS_OPTION, "1"}};
+  assert(expected_cache_options == last_create_cache_option);
+}
+
 void testBuildPrintsHashesFound() {}
 
 void testBuildSkipsFileSystemErrors() {}
@@ -598,7 +988,20 @@ int main() {
   testBuildCacheResetsDB();
   testBuildCacheCreatesDirectories();
   testBuildCacheCreatesHashes();
+  testBuildCacheRecordsFileSizes();
+  testBuildCacheRecordsModificationTimes();
+  testBuildCacheInLockstepHashesAfterScanning();
+  testBuildCacheRecordsExtentFingerprints();
+  testBuildCacheInLockstepRecordsExtentFingerprints();
+  testBuildCacheLooksFilesUpInTheStore();
+  testBuildCachePassesExtendedAttributesToTheStore();
+  testBuildCacheInLockstepDoesNotUseTheStore();
+  testBuildCacheLoadsManifestsAsDirectoriesAreFound();
+  testBuildCacheTakesDigestsFromManifests();
+  testBuildCacheWithoutTrustingManifestsDoesNotLoadThem();
   testBuildCacheBuildsScanMetaData();
+  testBuildCacheRecordsDigestNamesOption();
+  testBuildCacheRecordsLockstepPlaceholders();
   testTokenizingPathWithRoot();
   testTokenizingPathWithRootFolder();
   testTokenizingPathWithFile();
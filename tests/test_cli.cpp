@@ -4,6 +4,8 @@
 #include "../src/dupes/dupes.h"
 #include "../src/env/env.h"
 #include "../src/lib.cpp"
+#include "../src/prune/prune.h"
+#include "../src/reclaim/reclaim.h"
 #include "../src/update/update.h"
 #include <cassert>
 
@@ -39,31 +41,74 @@ void createDirectory(std::string const &path) {
 }
 /* ---------------------------- Command Services ---------------------------- */
 std::string last_dupes_cache_path{};
+dupes_options last_dupes_options{};
+std::ostream *last_dupes_console = nullptr;
 std::vector<std::string> last_build_paths;
 std::string last_build_cache_path{};
+build_options last_build_options{};
 std::string last_update_cache_path{};
-
-void dupes(std::string cache_path, std::ostream &console) {
+update_options last_update_options{};
+std::string last_decode_input_path{};
+int last_decode_output_fd = -1;
+std::string last_reclaim_cache_path{};
+reclaim_options last_reclaim_options{};
+std::string last_prune_cache_path{};
+prune_options last_prune_options{};
+
+void dupes(std::string cache_path, dupes_options const &options,
+           std::ostream &console) {
   last_dupes_cache_path = cache_path;
+  last_dupes_options = options;
+  last_dupes_console = &console;
 }
 
 void build(std::vector<std::string> paths, std::string cache_path,
-           std::ostream &console) {
+           build_options const &options, std::ostream &console) {
   last_build_paths = paths;
   last_build_cache_path = cache_path;
+  last_build_options = options;
 }
 
-void update(std::string cache_path, std::ostream &console) {
+void update(std::string cache_path, update_options const &options,
+            std::ostream &console) {
   last_update_cache_path = cache_path;
+  last_update_options = options;
+}
+
+void decode(std::string const &input_path, int output_fd) {
+  last_decode_input_path = input_path;
+  last_decode_output_fd = output_fd;
+}
+
+void reclaim(std::string cache_path, reclaim_options const &options,
+             std::ostream &console) {
+  last_reclaim_cache_path = cache_path;
+  last_reclaim_options = options;
+}
+
+void prune(std::string cache_path, prune_options const &options,
+           std::ostream &console) {
+  last_prune_cache_path = cache_path;
+  last_prune_options = options;
 }
 
 void resetMocks() {
   fetch_home_directory_return = "/home/test";
   last_join_path_path_segments = {};
   last_dupes_cache_path = {};
+  last_dupes_options = {};
+  last_dupes_console = nullptr;
   last_build_paths = {};
   last_build_cache_path = {};
+  last_build_options = {};
   last_update_cache_path = {};
+  last_update_options = {};
+  last_decode_input_path = {};
+  last_decode_output_fd = -1;
+  last_reclaim_cache_path = {};
+  last_reclaim_options = {};
+  last_prune_cache_path = {};
+  last_prune_options = {};
   last_create_directory_path = {};
 }
 
@@ -83,6 +128,249 @@ void testProcessCallsDupesWithCorrectArgs() {
 
   // Assert
   assert(last_dupes_cache_path == "/home/test/.cache/ddupes/testing.db");
+  assert(!last_dupes_options.verify);
+}
+
+void testProcessCallsDupesWithVerify() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char test_verify_option[] = "--verify";
+  char *args[5] = {test_file_name, test_command_name, test_cache_option,
+                   test_cache_value, test_verify_option};
+
+  // Act
+  process(5, args);
+
+  // Assert
+  assert(last_dupes_cache_path == "/home/test/.cache/ddupes/testing.db");
+  assert(last_dupes_options.verify);
+}
+
+void testProcessCallsDupesWithTopAndSort() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_top_option[] = "--top";
+  char test_top_value[] = "10";
+  char test_sort_option[] = "--sort";
+  char test_sort_value[] = "bytes";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[8] = {test_file_name,    test_command_name, test_top_option,
+                   test_top_value,    test_sort_option,  test_sort_value,
+                   test_cache_option, test_cache_value};
+
+  // Act
+  process(8, args);
+
+  // Assert
+  assert(last_dupes_cache_path == "/home/test/.cache/ddupes/testing.db");
+  assert(last_dupes_options.top == 10);
+  assert(last_dupes_options.sort == GROUP_SORT_BYTES);
+  assert(!last_dupes_options.verify);
+}
+
+void testProcessCallsDupesSortedByPathByDefault() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[4] = {test_file_name, test_command_name, test_cache_option,
+                   test_cache_value};
+
+  // Act
+  process(4, args);
+
+  // Assert
+  assert(last_dupes_options.top == 0);
+  assert(last_dupes_options.window == 0);
+  assert(last_dupes_options.sort == GROUP_SORT_PATH);
+  assert(last_dupes_options.output_fd == STDOUT_FILENO);
+  assert(last_dupes_options.exec.command == nullptr);
+  assert(last_dupes_options.format == OUTPUT_FORMAT_TEXT);
+  assert(last_dupes_console == &std::cout);
+}
+
+void testProcessCallsDupesWithExec() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_exec_option[] = "--exec";
+  char test_exec_value[] = "ls {}";
+  char test_jobs_option[] = "--jobs";
+  char test_jobs_value[] = "4";
+  char test_batch_option[] = "--batch";
+  char test_batch_value[] = "group";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[10] = {test_file_name,    test_command_name, test_exec_option,
+                    test_exec_value,   test_jobs_option,  test_jobs_value,
+                    test_batch_option, test_batch_value,  test_cache_option,
+                    test_cache_value};
+
+  // Act
+  process(10, args);
+
+  // Assert
+  assert(compareStrings(last_dupes_options.exec.command, "ls {}"));
+  assert(last_dupes_options.exec.jobs == 4);
+  assert(last_dupes_options.exec.batch == EXEC_BATCH_GROUP);
+}
+
+void testProcessCallsDupesWithOneJobByDefault() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_exec_option[] = "--exec";
+  char test_exec_value[] = "ls";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,  test_command_name, test_exec_option,
+                   test_exec_value, test_cache_option, test_cache_value};
+
+  // Act
+  process(6, args);
+
+  // Assert
+  assert(last_dupes_options.exec.jobs == 1);
+  assert(last_dupes_options.exec.batch == EXEC_BATCH_PATHS);
+}
+
+void testProcessErrorsWithInvalidBatch() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_batch_option[] = "--batch";
+  char test_batch_value[] = "file";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,   test_command_name, test_batch_option,
+                   test_batch_value, test_cache_option, test_cache_value};
+
+  try {
+    // Act
+    process(6, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(true);
+  }
+}
+
+void testProcessCallsDupesWithFormat() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_format_option[] = "--format";
+  char test_format_value[] = "jsonl";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,    test_command_name, test_format_option,
+                   test_format_value, test_cache_option, test_cache_value};
+
+  // Act
+  process(6, args);
+
+  // Assert
+  assert(last_dupes_options.format == OUTPUT_FORMAT_JSONL);
+  assert(last_dupes_console == &std::cerr);
+}
+
+void testProcessErrorsWithInvalidFormat() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_format_option[] = "--format";
+  char test_format_value[] = "xml";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,    test_command_name, test_format_option,
+                   test_format_value, test_cache_option, test_cache_value};
+
+  try {
+    // Act
+    process(6, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(true);
+  }
+}
+
+void testProcessCallsDupesWithWindow() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_window_option[] = "--window";
+  char test_window_value[] = "100";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,    test_command_name, test_window_option,
+                   test_window_value, test_cache_option, test_cache_value};
+
+  // Act
+  process(6, args);
+
+  // Assert
+  assert(last_dupes_options.window == 100);
+  assert(last_dupes_options.top == 0);
+}
+
+void testProcessErrorsWithInvalidTop() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_top_option[] = "--top";
+  char test_top_value[] = "ten";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name, test_command_name, test_top_option,
+                   test_top_value, test_cache_option, test_cache_value};
+
+  try {
+    // Act
+    process(6, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(true);
+  }
+}
+
+void testProcessErrorsWithInvalidSort() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "dupes";
+  char test_sort_option[] = "--sort";
+  char test_sort_value[] = "size";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,  test_command_name, test_sort_option,
+                   test_sort_value, test_cache_option, test_cache_value};
+
+  try {
+    // Act
+    process(6, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(true);
+  }
 }
 
 void testProcessCallsBuildWithCorrectArgs() {
@@ -104,6 +392,7 @@ void testProcessCallsBuildWithCorrectArgs() {
   std::vector<std::string> expected_build_paths{"path_one", "path_two"};
   assert(last_build_paths == expected_build_paths);
   assert(last_build_cache_path == "/home/test/.cache/ddupes/testing.db");
+  assert(!last_build_options.digest_names);
 }
 
 void testProcessCallsBuildWithCorrectArgsWhenBeforeCache() {
@@ -127,6 +416,52 @@ void testProcessCallsBuildWithCorrectArgsWhenBeforeCache() {
   assert(last_build_cache_path == "/home/test/.cache/ddupes/testing.db");
 }
 
+void testProcessCallsBuildWithDigestNames() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "build";
+  char test_digest_names_option[] = "--digest-names";
+  char test_path_one[] = "path_one";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,           test_command_name,
+                   test_digest_names_option, test_path_one,
+                   test_cache_option,        test_cache_value};
+
+  // Act
+  process(6, args);
+
+  // Assert
+  std::vector<std::string> expected_build_paths{"path_one"};
+  assert(last_build_paths == expected_build_paths);
+  assert(last_build_options.digest_names);
+}
+
+void testProcessCallsBuildWithLockstep() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "build";
+  char test_path_one[] = "path_one";
+  char test_lockstep_option[] = "--lockstep";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,    test_command_name,
+                   test_path_one,     test_lockstep_option,
+                   test_cache_option, test_cache_value};
+
+  // Act
+  process(6, args);
+
+  // Assert
+  std::vector<std::string> expected_build_paths{"path_one"};
+  assert(last_build_paths == expected_build_paths);
+  assert(last_build_options.lockstep);
+  assert(!last_build_options.digest_names);
+  assert(last_build_options.store_path.empty());
+}
+
 void testProcessCallsUpdateWithCorrectArgs() {
   // Arrange
   resetMocks();
@@ -142,6 +477,348 @@ void testProcessCallsUpdateWithCorrectArgs() {
 
   // Assert
   assert(last_update_cache_path == "/home/test/.cache/ddupes/testing.db");
+  assert(!last_update_options.rescan);
+}
+
+void testProcessCallsUpdateWithRescan() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "update";
+  char test_rescan_option[] = "--rescan";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[5] = {test_file_name, test_command_name, test_rescan_option,
+                   test_cache_option, test_cache_value};
+
+  // Act
+  process(5, args);
+
+  // Assert
+  assert(last_update_cache_path == "/home/test/.cache/ddupes/testing.db");
+  assert(last_update_options.rescan);
+  assert(last_update_options.store_path.empty());
+}
+
+void testProcessCallsBuildWithTheSharedStore() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "build";
+  char test_path_one[] = "path_one";
+  char test_store_option[] = "--shared-store";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,    test_command_name,
+                   test_path_one,     test_store_option,
+                   test_cache_option, test_cache_value};
+
+  // Act
+  process(6, args);
+
+  // Assert
+  std::vector<std::string> expected_build_paths{"path_one"};
+  std::vector<std::string> expected_join_path_segments = {
+      "/home/test/.cache/ddupes", "shared.store"};
+  assert(last_build_paths == expected_build_paths);
+  assert(last_join_path_path_segments == expected_join_path_segments);
+  assert(last_build_options.store_path ==
+         "/home/test/.cache/ddupes/testing.db");
+  assert(!last_build_options.attributes);
+  assert(last_build_options.store_max_entries == 0);
+}
+
+void testProcessCallsBuildWithTheStoreMaxEntries() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "build";
+  char test_path_one[] = "path_one";
+  char test_store_option[] = "--shared-store";
+  char test_max_entries_option[] = "--store-max-entries";
+  char test_max_entries_value[] = "1000";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[8] = {test_file_name,         test_command_name,
+                   test_path_one,          test_store_option,
+                   test_max_entries_option, test_max_entries_value,
+                   test_cache_option,      test_cache_value};
+
+  // Act
+  process(8, args);
+
+  // Assert
+  assert(last_build_paths == std::vector<std::string>{"path_one"});
+  assert(last_build_options.store_max_entries == 1000);
+}
+
+void testProcessCallsBuildTrustingManifests() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "build";
+  char test_path_one[] = "path_one";
+  char test_trust_option[] = "--trust-manifest";
+  char test_manifest_option[] = "--manifest";
+  char test_manifest_one[] = "one/MD5SUMS";
+  char test_manifest_two[] = "two/MD5SUMS";
+  char test_spot_check_option[] = "--spot-check";
+  char test_spot_check_value[] = "100";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[12] = {test_file_name,         test_command_name,
+                    test_path_one,          test_trust_option,
+                    test_manifest_option,   test_manifest_one,
+                    test_spot_check_option, test_spot_check_value,
+                    test_manifest_option,   test_manifest_two,
+                    test_cache_option,      test_cache_value};
+
+  // Act
+  process(12, args);
+
+  // Assert
+  std::vector<std::string> expected_build_paths{"path_one"};
+  std::vector<std::string> expected_manifest_paths{"one/MD5SUMS",
+                                                   "two/MD5SUMS"};
+  assert(last_build_paths == expected_build_paths);
+  assert(last_build_options.trust_manifests);
+  assert(last_build_options.manifest_paths == expected_manifest_paths);
+  assert(last_build_options.spot_check_every == 100);
+}
+
+void testProcessErrorsWithManifestsWhichAreNotTrusted() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "build";
+  char test_path_one[] = "path_one";
+  char test_manifest_option[] = "--manifest";
+  char test_manifest_one[] = "one/MD5SUMS";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[7] = {test_file_name,       test_command_name, test_path_one,
+                   test_manifest_option, test_manifest_one, test_cache_option,
+                   test_cache_value};
+
+  try {
+    // Act
+    process(7, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(last_build_paths.size() == 0);
+  }
+}
+
+void testProcessErrorsWhenTrustingManifestsInLockstep() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "build";
+  char test_path_one[] = "path_one";
+  char test_trust_option[] = "--trust-manifest";
+  char test_lockstep_option[] = "--lockstep";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[7] = {test_file_name,    test_command_name,    test_path_one,
+                   test_trust_option, test_lockstep_option, test_cache_option,
+                   test_cache_value};
+
+  try {
+    // Act
+    process(7, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(last_build_paths.size() == 0);
+  }
+}
+
+void testProcessErrorsWhenStoringLockstepDigests() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "build";
+  char test_path_one[] = "path_one";
+  char test_store_option[] = "--shared-store";
+  char test_lockstep_option[] = "--lockstep";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[7] = {test_file_name,    test_command_name,    test_path_one,
+                   test_store_option, test_lockstep_option, test_cache_option,
+                   test_cache_value};
+
+  try {
+    // Act
+    process(7, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(last_build_paths.size() == 0);
+  }
+}
+
+void testProcessCallsUpdateWithExtendedAttributes() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "update";
+  char test_rescan_option[] = "--rescan";
+  char test_xattrs_option[] = "--xattrs";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,     test_command_name,
+                   test_rescan_option, test_xattrs_option,
+                   test_cache_option,  test_cache_value};
+
+  // Act
+  process(6, args);
+
+  // Assert
+  assert(last_update_options.rescan);
+  assert(last_update_options.attributes);
+  assert(last_update_options.store_path.empty());
+}
+
+void testProcessErrorsWhenBoundingNoStore() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "update";
+  char test_rescan_option[] = "--rescan";
+  char test_max_entries_option[] = "--store-max-entries";
+  char test_max_entries_value[] = "1000";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[7] = {test_file_name,          test_command_name,
+                   test_rescan_option,      test_max_entries_option,
+                   test_max_entries_value,  test_cache_option,
+                   test_cache_value};
+
+  try {
+    // Act
+    process(7, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(!last_update_options.rescan);
+  }
+}
+
+void testProcessCallsReclaimWithMode() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "reclaim";
+  char test_mode_option[] = "--mode";
+  char test_mode_value[] = "hardlink";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[6] = {test_file_name,  test_command_name, test_mode_option,
+                   test_mode_value, test_cache_option, test_cache_value};
+
+  // Act
+  process(6, args);
+
+  // Assert
+  assert(last_reclaim_cache_path == "/home/test/.cache/ddupes/testing.db");
+  assert(last_reclaim_options.mode == RECLAIM_MODE_HARDLINK);
+}
+
+void testProcessErrorsWhenCallingReclaimWithNoMode() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "reclaim";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char *args[4] = {test_file_name, test_command_name, test_cache_option,
+                   test_cache_value};
+
+  try {
+    // Act
+    process(4, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(last_reclaim_cache_path.size() == 0);
+  }
+}
+
+void testProcessCallsPruneWithKeep() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "prune";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char test_keep_option[] = "--keep";
+  char test_keep_value[] = "oldest";
+  char *args[6] = {test_file_name,   test_command_name, test_cache_option,
+                   test_cache_value, test_keep_option,  test_keep_value};
+
+  // Act
+  process(6, args);
+
+  // Assert
+  assert(last_prune_cache_path == "/home/test/.cache/ddupes/testing.db");
+  assert(last_prune_options.keep == PRUNE_KEEP_OLDEST);
+}
+
+void testProcessErrorsWhenCallingPruneWithInvalidKeep() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "prune";
+  char test_cache_option[] = "--cache";
+  char test_cache_value[] = "testing";
+  char test_keep_option[] = "--keep";
+  char test_keep_value[] = "newest";
+  char *args[6] = {test_file_name,   test_command_name, test_cache_option,
+                   test_cache_value, test_keep_option,  test_keep_value};
+
+  try {
+    // Act
+    process(6, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(last_prune_cache_path.size() == 0);
+  }
+}
+
+void testProcessCallsDecodeWithoutACache() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "decode";
+  char test_report_path[] = "report.prefix";
+  char *args[3] = {test_file_name, test_command_name, test_report_path};
+
+  // Act
+  process(3, args);
+
+  // Assert
+  assert(last_decode_input_path == "report.prefix");
+  assert(last_decode_output_fd == STDOUT_FILENO);
+  assert(last_create_directory_path.size() == 0);
+}
+
+void testProcessErrorsWhenCallingDecodeWithNoReport() {
+  // Arrange
+  resetMocks();
+  char test_file_name[] = "ddupes";
+  char test_command_name[] = "decode";
+  char *args[2] = {test_file_name, test_command_name};
+
+  try {
+    // Act
+    process(2, args);
+    assert(false);
+  } catch (command_error &e) {
+    // Assert
+    assert(true);
+  }
 }
 
 void testProcessErrorsWithLessThanTwoArgs() {
@@ -259,12 +936,40 @@ void testProcessJoinsPathToLocateDBFile() {
 
 int main() {
   testProcessCallsDupesWithCorrectArgs();
+  testProcessCallsDupesWithVerify();
+  testProcessCallsDupesWithTopAndSort();
+  testProcessCallsDupesSortedByPathByDefault();
+  testProcessCallsDupesWithWindow();
+  testProcessCallsDupesWithExec();
+  testProcessCallsDupesWithOneJobByDefault();
+  testProcessErrorsWithInvalidBatch();
+  testProcessCallsDupesWithFormat();
   testProcessCallsBuildWithCorrectArgs();
   testProcessCallsBuildWithCorrectArgsWhenBeforeCache();
+  testProcessCallsBuildWithDigestNames();
+  testProcessCallsBuildWithLockstep();
   testProcessCallsUpdateWithCorrectArgs();
+  testProcessCallsUpdateWithRescan();
+  testProcessCallsBuildWithTheSharedStore();
+  testProcessCallsBuildWithTheStoreMaxEntries();
+  testProcessCallsBuildTrustingManifests();
+  testProcessErrorsWithManifestsWhichAreNotTrusted();
+  testProcessErrorsWhenTrustingManifestsInLockstep();
+  testProcessErrorsWhenStoringLockstepDigests();
+  testProcessCallsUpdateWithExtendedAttributes();
+  testProcessErrorsWhenBoundingNoStore();
+  testProcessCallsReclaimWithMode();
+  testProcessErrorsWhenCallingReclaimWithNoMode();
+  testProcessCallsPruneWithKeep();
+  testProcessErrorsWhenCallingPruneWithInvalidKeep();
+  testProcessCallsDecodeWithoutACache();
+  testProcessErrorsWhenCallingDecodeWithNoReport();
   testProcessErrorsWithLessThanTwoArgs();
   testProcessErrorsWhenCallingBuildWithNoPaths();
   testProcessErrorsWithMissingCacheCommand();
+  testProcessErrorsWithInvalidTop();
+  testProcessErrorsWithInvalidSort();
+  testProcessErrorsWithInvalidFormat();
   testProcessErrorsWithMissingHomeDirectory();
   testProcessCreatesCacheDirIfNotExists();
   testProcessJoinsPathToLocateDBFile();
@@ -0,0 +1,143 @@
+#include <cassert>
+#include <sstream>
+
+#include "../src/decode/decode.cpp"
+#include "../src/dupes/format.cpp"
+#include "../src/dupes/load.cpp"
+#include "../src/dupes/sink.cpp"
+#include "../src/thread/parallel.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+void writeFileDescriptor(int file_descriptor, char const *data,
+                         std::size_t length) {}
+
+std::string
+createTestReport(std::string const &header,
+                 std::vector<std::string> const &records) {
+  std::string report = header + "\n";
+  for (std::string const &record : records) {
+    report += record;
+    report += '\0';
+  }
+  return report;
+}
+
+std::string decodeTestReport(std::string const &report) {
+  std::istringstream mock_cin(report);
+  std::ostringstream mock_cout{};
+  output_sink test_sink = initOutputSink(flushToStream, &mock_cout);
+  decodeReport(mock_cin, test_sink);
+  return mock_cout.str();
+}
+
+bool decodingThrows(std::string const &report) {
+  try {
+    decodeTestReport(report);
+    return false;
+  } catch (decode_error &error) {
+    return true;
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ------------------------------ decodeReport ------------------------------ */
+void testDecodingAReport() {
+  // Arrange
+  std::string test_report =
+      createTestReport("ddupes-prefix 1 2", {"d0\t-1\ttest", "d1\t0\tx",
+                                             "g0\t1\tab", "m1\ta.txt",
+                                             "m0\ta.txt", "d2\t1\ty",
+                                             "g1\t2\tcd", "m2\tb\tc.txt",
+                                             "m0\tb.txt"});
+
+  // Act
+  std::string actual_output = decodeTestReport(test_report);
+
+  // Assert
+  std::string expected_output = "2 Sets of Duplicates Found:\n"
+                                "\n"
+                                "test/x/a.txt\n"
+                                "test/a.txt\n"
+                                "\n"
+                                "test/x/y/b\tc.txt\n"
+                                "test/b.txt\n";
+  assert(actual_output == expected_output);
+}
+
+void testDecodingRootMembers() {
+  // Arrange
+  std::string test_report = createTestReport(
+      "ddupes-prefix 1 1", {"g0\t3\tab", "m-1\tone", "m-1\ttwo"});
+
+  // Act
+  std::string actual_output = decodeTestReport(test_report);
+
+  // Assert
+  assert(actual_output == "1 Sets of Duplicates Found:\n\none\ntwo\n");
+}
+
+void testDecodingWhatTheTextFormatWouldPrint() {
+  // Arrange
+  duplicate_node_set test_set{};
+  test_set.tree.parents = {NO_PARENT, 0, 0, 1, 2, 1, 2, 0};
+  test_set.tree.depths = {1, 2, 2, 3, 3, 3, 3, 2};
+  test_set.tree.path_segments = {"test",  "x",     "y",     "a.txt",
+                                 "a.txt", "b.txt", "b.txt", "c\nd.txt"};
+  test_set.tree.sizes = std::vector<int64_t>(8, 0);
+  test_set.tree.node_digests = std::vector<digest>(8, EMPTY_DIGEST);
+  test_set.members = {3, 4, 5, 6, 7};
+  test_set.group_offsets = {0, 2, 5};
+
+  std::ostringstream mock_text_cout{};
+  output_sink text_sink = initOutputSink(flushToStream, &mock_text_cout);
+  duplicate_node_set text_set = test_set;
+  load(text_sink, text_set,
+       {.sort = GROUP_SORT_PATH,
+        .top = 0,
+        .window = 0,
+        .format = OUTPUT_FORMAT_TEXT});
+
+  std::ostringstream mock_prefix_cout{};
+  output_sink prefix_sink = initOutputSink(flushToStream, &mock_prefix_cout);
+  load(prefix_sink, test_set,
+       {.sort = GROUP_SORT_PATH,
+        .top = 0,
+        .window = 0,
+        .format = OUTPUT_FORMAT_PREFIX});
+
+  // Act
+  std::string actual_output = decodeTestReport(mock_prefix_cout.str());
+
+  // Assert
+  assert(actual_output == mock_text_cout.str());
+}
+
+void testDecodingRejectsOtherInput() {
+  // Assert
+  assert(decodingThrows("0 Sets of Duplicates Found:\n\n"));
+  assert(decodingThrows(createTestReport("ddupes-prefix 2 0", {})));
+}
+
+void testDecodingRejectsBrokenRecords() {
+  // Assert
+  assert(decodingThrows(createTestReport("ddupes-prefix 1 1", {"m0\ta.txt"})));
+  assert(decodingThrows(createTestReport("ddupes-prefix 1 1", {"d1\t-1\tx"})));
+  assert(decodingThrows(createTestReport("ddupes-prefix 1 1", {"d0\tx"})));
+  assert(decodingThrows(createTestReport("ddupes-prefix 1 1", {"x0"})));
+  assert(decodingThrows(createTestReport("ddupes-prefix 1 1", {""})));
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testDecodingAReport();
+  testDecodingRootMembers();
+  testDecodingWhatTheTextFormatWouldPrint();
+  testDecodingRejectsOtherInput();
+  testDecodingRejectsBrokenRecords();
+}
@@ -9,4 +9,62 @@ void testFetchingHomeDirectory() {
   assert(home_directory != nullptr);
 }
 
-int main() { testFetchingHomeDirectory(); }
+void testFetchingTheArgumentBytesLimit() {
+  // Act
+  std::size_t argument_bytes = argumentBytesLimit();
+
+  // Assert
+  assert(argument_bytes > 0);
+}
+
+void testSpawningAShellPassesTheArguments() {
+  // Arrange
+  bool succeeded = false;
+
+  // Act
+  pid_t pid =
+      spawnShell("test \"$#\" = 2 && test \"$2\" = 'b c'", {"a", "b c"});
+  pid_t waited_pid = waitForChild(pid, succeeded);
+
+  // Assert
+  assert(pid != -1);
+  assert(waited_pid == pid);
+  assert(succeeded);
+}
+
+void testWaitingForAFailedChild() {
+  // Arrange
+  bool succeeded = true;
+  pid_t pid = spawnShell("exit 3", {});
+
+  // Act
+  pid_t waited_pid = waitForChild(pid, succeeded);
+
+  // Assert
+  assert(waited_pid == pid);
+  assert(!succeeded);
+}
+
+void testWaitingLeavesOtherChildrenAlone() {
+  // Arrange
+  bool succeeded = false;
+  pid_t other_pid = spawnShell("exit 0", {});
+  pid_t pid = spawnShell("sleep 0.1; exit 3", {});
+
+  // Act
+  pid_t waited_pid = waitForChild(pid, succeeded);
+
+  // Assert
+  assert(waited_pid == pid);
+  assert(!succeeded);
+  assert(waitForChild(other_pid, succeeded) == other_pid);
+  assert(succeeded);
+}
+
+int main() {
+  testFetchingHomeDirectory();
+  testFetchingTheArgumentBytesLimit();
+  testSpawningAShellPassesTheArguments();
+  testWaitingForAFailedChild();
+  testWaitingLeavesOtherChildrenAlone();
+}
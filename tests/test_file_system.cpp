@@ -1,5 +1,6 @@
 
 #include <cassert>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -189,6 +190,43 @@ void testHashingAnEmptyFile() {
   }
 }
 
+/* ------------------------------ mapHoldsData ------------------------------ */
+void testDistrustingAMapWithoutDataForAFileWithBlocks() {
+  // Arrange
+  std::vector<file_extent> no_extents{};
+  std::vector<file_extent> unwritten_extents{
+      {.logical = 0, .physical = 4096, .length = 4096,
+       .flags = FIEMAP_EXTENT_UNWRITTEN}};
+  std::vector<file_extent> extents_past_the_end{
+      {.logical = 8192, .physical = 4096, .length = 4096, .flags = 0}};
+
+  // Act
+  bool no_extents_hold_data = mapHoldsData(no_extents, 10, 8);
+  bool unwritten_extents_hold_data = mapHoldsData(unwritten_extents, 10, 8);
+  bool extents_past_the_end_hold_data =
+      mapHoldsData(extents_past_the_end, 10, 8);
+
+  // Assert
+  assert(!no_extents_hold_data);
+  assert(!unwritten_extents_hold_data);
+  assert(!extents_past_the_end_hold_data);
+}
+
+void testTrustingAMapWithDataOrAFileWithoutBlocks() {
+  // Arrange
+  std::vector<file_extent> no_extents{};
+  std::vector<file_extent> data_extents{
+      {.logical = 0, .physical = 4096, .length = 4096, .flags = 0}};
+
+  // Act
+  bool sparse_file_holds_data = mapHoldsData(no_extents, 1 << 20, 0);
+  bool data_extents_hold_data = mapHoldsData(data_extents, 10, 8);
+
+  // Assert
+  assert(sparse_file_holds_data);
+  assert(data_extents_hold_data);
+}
+
 /* ------------------------------- fileExists ------------------------------- */
 void testFileExists() {
   // Arrange
@@ -279,6 +317,172 @@ void testCreateDirectoryPermissionsError() {
                                    std::filesystem::perms::others_exec);
 }
 
+/* ------------------------------ hardlinkFile ------------------------------ */
+void testHardlinkingKeepsATargetRewrittenSinceVerified() {
+  // Arrange
+  std::string keeper_path = "tests/testing_dirs/link_keeper.txt";
+  std::string target_path = "tests/testing_dirs/link_target.txt";
+  std::ofstream(keeper_path) << "same";
+  std::ofstream(target_path) << "same";
+  file_stamp keeper_stamp{};
+  file_stamp target_stamp{};
+  stampFile(keeper_path, keeper_stamp);
+  stampFile(target_path, target_stamp);
+  std::ofstream(target_path) << "diff";
+  struct timespec times[2] = {{.tv_sec = 0, .tv_nsec = UTIME_OMIT},
+                              {.tv_sec = 1, .tv_nsec = 0}};
+  utimensat(AT_FDCWD, target_path.c_str(), times, 0);
+
+  // Act
+  link_result actual_result =
+      hardlinkFile(keeper_path, target_path, keeper_stamp, target_stamp);
+
+  // Assert
+  std::string target_contents{};
+  std::ifstream(target_path) >> target_contents;
+  assert(actual_result == LINK_RESULT_CHANGED);
+  assert(target_contents == "diff");
+
+  // Cleanup
+  std::filesystem::remove(keeper_path);
+  std::filesystem::remove(target_path);
+}
+
+void testHardlinkingAnUnchangedTarget() {
+  // Arrange
+  std::string keeper_path = "tests/testing_dirs/link_keeper.txt";
+  std::string target_path = "tests/testing_dirs/link_target.txt";
+  std::ofstream(keeper_path) << "same";
+  std::ofstream(target_path) << "same";
+  file_stamp keeper_stamp{};
+  file_stamp target_stamp{};
+  stampFile(keeper_path, keeper_stamp);
+  stampFile(target_path, target_stamp);
+
+  // Act
+  link_result actual_result =
+      hardlinkFile(keeper_path, target_path, keeper_stamp, target_stamp);
+
+  // Assert
+  file_stamp linked_stamp{};
+  stampFile(target_path, linked_stamp);
+  assert(actual_result == LINK_RESULT_LINKED);
+  assert(linked_stamp.inode == keeper_stamp.inode);
+
+  // Cleanup
+  std::filesystem::remove(keeper_path);
+  std::filesystem::remove(target_path);
+}
+
+void testHardlinkingPastALeftoverTemporaryLink() {
+  // Arrange
+  std::string keeper_path = "tests/testing_dirs/link_keeper.txt";
+  std::string target_path = "tests/testing_dirs/link_target.txt";
+  std::string leftover_path = target_path + LINK_SUFFIX;
+  std::ofstream(keeper_path) << "same";
+  std::ofstream(target_path) << "same";
+  std::ofstream(leftover_path) << "same";
+  file_stamp keeper_stamp{};
+  file_stamp target_stamp{};
+  stampFile(keeper_path, keeper_stamp);
+  stampFile(target_path, target_stamp);
+
+  // Act
+  link_result actual_result =
+      hardlinkFile(keeper_path, target_path, keeper_stamp, target_stamp);
+
+  // Assert
+  file_stamp linked_stamp{};
+  stampFile(target_path, linked_stamp);
+  assert(actual_result == LINK_RESULT_LINKED);
+  assert(linked_stamp.inode == keeper_stamp.inode);
+  assert(!std::filesystem::exists(leftover_path));
+
+  // Cleanup
+  std::filesystem::remove(keeper_path);
+  std::filesystem::remove(target_path);
+}
+
+void testReflinkingKeepsTheTargetsPermissions() {
+  // Arrange
+  std::string keeper_path = "tests/testing_dirs/link_keeper.txt";
+  std::string target_path = "tests/testing_dirs/link_target.txt";
+  std::string leftover_path = target_path + LINK_SUFFIX;
+  std::ofstream(keeper_path) << "same";
+  std::ofstream(target_path) << "same";
+  std::ofstream(leftover_path) << "same";
+  chmod(target_path.c_str(), 0640);
+  file_stamp keeper_stamp{};
+  file_stamp target_stamp{};
+  stampFile(keeper_path, keeper_stamp);
+  stampFile(target_path, target_stamp);
+
+  // Act
+  link_result actual_result =
+      reflinkFile(keeper_path, target_path, keeper_stamp, target_stamp);
+
+  // Assert
+  struct stat target_stat;
+  stat(target_path.c_str(), &target_stat);
+  assert(actual_result == LINK_RESULT_LINKED ||
+         actual_result == LINK_RESULT_UNSUPPORTED);
+  assert((target_stat.st_mode & 07777) == 0640);
+  assert(!std::filesystem::exists(leftover_path));
+
+  // Cleanup
+  std::filesystem::remove(keeper_path);
+  std::filesystem::remove(target_path);
+}
+
+/* --------------------------- readPooledFileChunk -------------------------- */
+void testReadingPooledChunksClosesTheOldestFile() {
+  // Arrange
+  std::vector<std::string> test_paths{"tests/testing_dirs/pool_one.txt",
+                                      "tests/testing_dirs/pool_two.txt",
+                                      "tests/testing_dirs/pool_six.txt"};
+  for (std::string const &test_path : test_paths) {
+    std::ofstream(test_path) << test_path;
+  }
+  open_file_pool test_pool = initOpenFilePool(2);
+  char buffer[8]{};
+
+  // Act
+  for (std::string const &test_path : test_paths) {
+    readPooledFileChunk(test_pool, test_path, 19, buffer, sizeof(buffer));
+  }
+  std::size_t actual_count =
+      readPooledFileChunk(test_pool, test_paths[0], 19, buffer, sizeof(buffer));
+
+  // Assert
+  assert(actual_count == 8);
+  assert(std::string(buffer, actual_count) == "pool_one");
+  assert(test_pool.descriptors.size() == 2);
+  assert(test_pool.open_order ==
+         (std::deque<std::string>{test_paths[2], test_paths[0]}));
+
+  // Cleanup
+  closeOpenFilePool(test_pool);
+  for (std::string const &test_path : test_paths) {
+    std::filesystem::remove(test_path);
+  }
+}
+
+void testReadingAPooledFileThatDoesntExist() {
+  // Arrange
+  open_file_pool test_pool = initOpenFilePool(2);
+  char buffer[8]{};
+
+  try {
+    // Act
+    readPooledFileChunk(test_pool, "tests/testing_dirs/missing.txt", 0,
+                        buffer, sizeof(buffer));
+    assert(false);
+  } catch (file_open_error &error) {
+    // Assert
+    assert(test_pool.descriptors.size() == 0);
+  }
+}
+
 int main() {
   testAbsoluteFileResolution();
   testAbsoluteFileResolutionWithDirectoryLinks();
@@ -287,9 +491,17 @@ int main() {
   testHashingAFile();
   testHashingAFileThatDoesntExist();
   testHashingAnEmptyFile();
+  testDistrustingAMapWithoutDataForAFileWithBlocks();
+  testTrustingAMapWithDataOrAFileWithoutBlocks();
   testFileExists();
   testFileExistsMissing();
   testCreateDirectory();
   testCreateDirectorySetCorrectPerms();
   testCreateDirectoryPermissionsError();
+  testHardlinkingKeepsATargetRewrittenSinceVerified();
+  testHardlinkingAnUnchangedTarget();
+  testHardlinkingPastALeftoverTemporaryLink();
+  testReflinkingKeepsTheTargetsPermissions();
+  testReadingPooledChunksClosesTheOldestFile();
+  testReadingAPooledFileThatDoesntExist();
 }
@@ -126,7 +126,8 @@ void testHashingAListOfHashes() {
       new hash[3]{uniqueTestHash(), uniqueTestHash(), uniqueTestHash()};
 
   // Act
-  hash actual_hash = computeHash(test_hashes, 3);
+  hash actual_hash = new uint8_t[MD5_DIGEST_LENGTH];
+  computeHash(actual_hash, test_hashes, 3);
 
   // Assert
   hash expected_hash = new uint8_t[MD5_DIGEST_LENGTH]{
@@ -141,8 +142,10 @@ void testTwoHashesAreDifferent() {
   hashes test_two_hashes = new hash[2]{uniqueTestHash(), uniqueTestHash()};
 
   // Act
-  hash actual_hash_one = computeHash(test_one_hashes, 3);
-  hash actual_hash_two = computeHash(test_two_hashes, 2);
+  hash actual_hash_one = new uint8_t[MD5_DIGEST_LENGTH];
+  hash actual_hash_two = new uint8_t[MD5_DIGEST_LENGTH];
+  computeHash(actual_hash_one, test_one_hashes, 3);
+  computeHash(actual_hash_two, test_two_hashes, 2);
 
   // Assert
   assert(!compareHashes(actual_hash_one, actual_hash_two));
@@ -213,6 +216,147 @@ void testHashDup() {
   assert(compareHashes(test_hash, actual_hash));
 }
 
+/* -------------------------------- toDigest -------------------------------- */
+void testToDigest() {
+  // Arrange
+  hash test_hash = uniqueTestHash(200);
+
+  // Act
+  digest actual_digest = toDigest(test_hash);
+
+  // Assert
+  assert(compareHashes(actual_digest.bytes, test_hash));
+}
+
+/* ------------------------------- digest_== -------------------------------- */
+void testDigestsEqual() {
+  // Act
+  bool equality_test =
+      toDigest(uniqueTestHash(200)) == toDigest(uniqueTestHash(200));
+
+  // Assert
+  assert(equality_test == true);
+}
+
+void testDigestsNotEqual() {
+  // Arrange
+  digest test_one = toDigest(uniqueTestHash());
+  digest test_two = toDigest(uniqueTestHash());
+  test_two.bytes[15] = 0;
+
+  // Act
+  bool equality_test = test_one != test_two;
+
+  // Assert
+  assert(equality_test == true);
+}
+
+/* ------------------------------- hashDigest ------------------------------- */
+void testHashDigestUsesEveryByte() {
+  // Arrange
+  digest test_one = toDigest(uniqueTestHash());
+  digest test_two = toDigest(uniqueTestHash());
+  test_two.bytes[15] = 0;
+
+  // Act
+  std::size_t actual_hash_one = hashDigest(test_one);
+  std::size_t actual_hash_two = hashDigest(test_two);
+
+  // Assert
+  assert(actual_hash_one != actual_hash_two);
+  assert(hashDigest(test_one) == actual_hash_one);
+}
+
+/* ------------------------------ computeDigest ----------------------------- */
+void testComputeDigestMatchesComputeHash() {
+  // Arrange
+  digest test_digests[3] = {toDigest(uniqueTestHash()),
+                            toDigest(uniqueTestHash()),
+                            toDigest(uniqueTestHash())};
+
+  // Act
+  digest actual_digest{};
+  computeDigest(actual_digest, test_digests, 3);
+
+  // Assert
+  digest expected_digest{91,  83,  0,  15, 77, 131, 26, 67,
+                         48, 112, 248, 0,  4,  38,  41, 16};
+  assert(actual_digest == expected_digest);
+}
+
+/* --------------------------- computeNamedDigest --------------------------- */
+void testComputeNamedDigestDependsOnName() {
+  // Arrange
+  digest test_digest = toDigest(uniqueTestHash());
+
+  // Act
+  digest actual_digest_one{};
+  digest actual_digest_two{};
+  digest actual_digest_three{};
+  computeNamedDigest(actual_digest_one, "one.txt", test_digest);
+  computeNamedDigest(actual_digest_two, "two.txt", test_digest);
+  computeNamedDigest(actual_digest_three, "one.txt", test_digest);
+
+  // Assert
+  assert(actual_digest_one != actual_digest_two);
+  assert(actual_digest_one == actual_digest_three);
+}
+
+void testComputeNamedDigestHashesNameAndTerminator() {
+  // Arrange
+  digest test_digest = toDigest(uniqueTestHash());
+
+  // Act
+  digest actual_digest{};
+  computeNamedDigest(actual_digest, "a", test_digest);
+
+  // Assert
+  // MD5 of "a\0" followed by the digest bytes.
+  digest expected_digest{2,   126, 187, 167, 111, 103, 145, 54,
+                         38,  149, 141, 104, 60,  69,  41,  255};
+  assert(actual_digest == expected_digest);
+}
+
+/* ------------------------------- sortDigests ------------------------------ */
+void testSortingFewDigests() {
+  // Arrange
+  digest test_digests[3] = {toDigest(uniqueTestHash(3)),
+                            toDigest(uniqueTestHash(1)),
+                            toDigest(uniqueTestHash(2))};
+  digest test_scratch[3];
+
+  // Act
+  sortDigests(test_digests, 3, test_scratch);
+
+  // Assert
+  assert(test_digests[0] == toDigest(uniqueTestHash(1)));
+  assert(test_digests[1] == toDigest(uniqueTestHash(2)));
+  assert(test_digests[2] == toDigest(uniqueTestHash(3)));
+}
+
+void testSortingManyDigests() {
+  // Arrange
+  std::size_t const test_count = 1000;
+  digest *test_digests = new digest[test_count];
+  digest *test_scratch = new digest[test_count];
+  for (std::size_t i = 0; i < test_count; ++i) {
+    test_digests[i] = toDigest(uniqueTestHash((i * 7) % 256));
+    test_digests[i].bytes[15] = (i * 13) % 256;
+  }
+
+  // Act
+  sortDigests(test_digests, test_count, test_scratch);
+
+  // Assert
+  for (std::size_t i = 1; i < test_count; ++i) {
+    assert(!(test_digests[i] < test_digests[i - 1]));
+  }
+
+  // Cleanup
+  delete[] test_digests;
+  delete[] test_scratch;
+}
+
 int main() {
   testStringLength();
   testStringDup();
@@ -229,4 +373,13 @@ int main() {
   testCompareHashesNotEqual();
   testCompareHashesWithNullptr();
   testCompareHashesWithNullptrNotEqual();
+  testToDigest();
+  testDigestsEqual();
+  testDigestsNotEqual();
+  testHashDigestUsesEveryByte();
+  testComputeDigestMatchesComputeHash();
+  testComputeNamedDigestDependsOnName();
+  testComputeNamedDigestHashesNameAndTerminator();
+  testSortingFewDigests();
+  testSortingManyDigests();
 }
\ No newline at end of file
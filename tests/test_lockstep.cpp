@@ -0,0 +1,272 @@
+#include <openssl/evp.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <map>
+
+#include "../src/build/lockstep.cpp"
+#include "../src/lib.cpp"
+#include "../src/thread/parallel.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+std::map<std::string, std::string> mock_file_contents{};
+std::atomic<int> last_read_file_chunk_calls = 0;
+std::atomic<int> last_open_file_calls = 0;
+std::atomic<int> open_file_count = 0;
+
+open_file_pool initOpenFilePool(std::size_t max_open) {
+  return {.max_open = max_open, .descriptors = {}, .open_order = {}};
+}
+
+std::size_t readPooledFileChunk(open_file_pool &pool,
+                                std::string const &file_path, int64_t offset,
+                                char *buffer, std::size_t length) {
+  ++last_read_file_chunk_calls;
+  std::map<std::string, std::string>::const_iterator contents =
+      mock_file_contents.find(file_path);
+  if (contents == mock_file_contents.end()) {
+    throw file_open_error("Could not open file: " + file_path);
+  }
+  if (pool.descriptors.count(file_path) == 0) {
+    ++last_open_file_calls;
+    ++open_file_count;
+    pool.descriptors[file_path] = 0;
+  }
+
+  if (offset >= static_cast<int64_t>(contents->second.size())) {
+    return 0;
+  }
+  std::size_t count =
+      std::min(length, contents->second.size() - static_cast<size_t>(offset));
+  std::memcpy(buffer, contents->second.data() + offset, count);
+  return count;
+}
+
+void closePooledFile(open_file_pool &pool, std::string const &file_path) {
+  open_file_count -= pool.descriptors.erase(file_path);
+}
+
+void closeOpenFilePool(open_file_pool &pool) {
+  open_file_count -= pool.descriptors.size();
+  pool.descriptors.clear();
+}
+
+void resetMockStates() {
+  mock_file_contents.clear();
+  last_read_file_chunk_calls = 0;
+  last_open_file_calls = 0;
+  open_file_count = 0;
+}
+
+std::vector<lockstep_file>
+createTestFiles(std::map<std::string, std::string> const &contents) {
+  std::vector<lockstep_file> files{};
+  for (std::pair<std::string const, std::string> const &file : contents) {
+    mock_file_contents[file.first] = file.second;
+    files.push_back(
+        {.path = file.first, .size = static_cast<int64_t>(file.second.size())});
+  }
+  return files;
+}
+
+digest md5TestDigest(std::string const &contents) {
+  digest content_digest{};
+  unsigned int md5_digest_length = MD5_DIGEST_LENGTH;
+  EVP_Digest(contents.data(), contents.size(), content_digest.bytes,
+             &md5_digest_length, EVP_md5(), nullptr);
+  return content_digest;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ---------------------------- uniqueFileDigest ---------------------------- */
+void testUniqueFileDigestDiffersByPath() {
+  // Act
+  digest actual_one = uniqueFileDigest("a/one.txt", 10);
+  digest actual_two = uniqueFileDigest("a/two.txt", 10);
+
+  // Assert
+  assert(!(actual_one == actual_two));
+  assert(actual_one == uniqueFileDigest("a/one.txt", 10));
+  assert(isPlaceholderDigest(actual_one.bytes));
+}
+
+/* ----------------------------- hashInLockstep ----------------------------- */
+void testHashingIdenticalFilesGivesTheirMD5() {
+  // Arrange
+  resetMockStates();
+  std::vector<lockstep_file> test_files =
+      createTestFiles({{"a.txt", "same contents"}, {"b.txt", "same contents"}});
+  std::vector<digest> actual_digests{};
+
+  // Act
+  lockstep_stats actual_stats = hashInLockstep(test_files, actual_digests);
+
+  // Assert
+  lockstep_stats expected_stats{.files_hashed = 2,
+                                .files_unique = 0,
+                                .files_unreadable = 0,
+                                .bytes_read = 26,
+                                .bytes_skipped = 0};
+  assert(actual_stats == expected_stats);
+  assert(actual_digests[0] == md5TestDigest("same contents"));
+  assert(actual_digests[1] == md5TestDigest("same contents"));
+}
+
+void testHashingFilesOfUniqueSizeReadsNothing() {
+  // Arrange
+  resetMockStates();
+  std::vector<lockstep_file> test_files =
+      createTestFiles({{"a.txt", "short"}, {"b.txt", "much longer"}});
+  std::vector<digest> actual_digests{};
+
+  // Act
+  lockstep_stats actual_stats = hashInLockstep(test_files, actual_digests);
+
+  // Assert
+  assert(last_read_file_chunk_calls == 0);
+  assert(actual_stats.files_unique == 2);
+  assert(actual_stats.bytes_skipped == 16);
+  assert(actual_digests[0] == uniqueFileDigest("a.txt", 5));
+  assert(actual_digests[1] == uniqueFileDigest("b.txt", 11));
+}
+
+void testHashingStopsReadingFilesWhichDiffer() {
+  // Arrange
+  resetMockStates();
+  std::string test_tail(LOCKSTEP_FIRST_CHUNK * 4, 'a');
+  std::vector<lockstep_file> test_files = createTestFiles(
+      {{"a.txt", "x" + test_tail}, {"b.txt", "y" + test_tail}});
+  std::vector<digest> actual_digests{};
+
+  // Act
+  lockstep_stats actual_stats = hashInLockstep(test_files, actual_digests);
+
+  // Assert
+  assert(last_read_file_chunk_calls == 2);
+  assert(actual_stats.bytes_read ==
+         static_cast<int64_t>(2 * LOCKSTEP_FIRST_CHUNK));
+  assert(actual_stats.files_unique == 2);
+  assert(actual_digests[0] == uniqueFileDigest("a.txt", test_tail.size() + 1));
+}
+
+void testHashingSplitsGroupsAcrossChunks() {
+  // Arrange
+  resetMockStates();
+  std::string test_head(LOCKSTEP_FIRST_CHUNK * 3, 'a');
+  std::vector<lockstep_file> test_files =
+      createTestFiles({{"a.txt", test_head + "one"},
+                       {"b.txt", test_head + "two"},
+                       {"c.txt", test_head + "one"},
+                       {"d.txt", test_head + "six"}});
+  std::vector<digest> actual_digests{};
+
+  // Act
+  lockstep_stats actual_stats = hashInLockstep(test_files, actual_digests);
+
+  // Assert
+  assert(actual_stats.files_hashed == 2);
+  assert(actual_stats.files_unique == 2);
+  assert(actual_digests[0] == md5TestDigest(test_head + "one"));
+  assert(actual_digests[2] == md5TestDigest(test_head + "one"));
+  assert(actual_digests[1] == uniqueFileDigest("b.txt", test_head.size() + 3));
+  assert(actual_digests[3] == uniqueFileDigest("d.txt", test_head.size() + 3));
+}
+
+void testHashingKeepsFilesOpenAcrossChunks() {
+  // Arrange
+  resetMockStates();
+  std::string test_contents(LOCKSTEP_FIRST_CHUNK * 4, 'a');
+  std::vector<lockstep_file> test_files =
+      createTestFiles({{"a.txt", test_contents}, {"b.txt", test_contents}});
+  std::vector<digest> actual_digests{};
+
+  // Act
+  lockstep_stats actual_stats = hashInLockstep(test_files, actual_digests);
+
+  // Assert
+  assert(actual_stats.files_hashed == 2);
+  assert(last_read_file_chunk_calls == 6);
+  assert(last_open_file_calls == 2);
+  assert(open_file_count == 0);
+  assert(actual_digests[0] == md5TestDigest(test_contents));
+}
+
+void testHashingEmptyFilesGivesTheEmptyDigest() {
+  // Arrange
+  resetMockStates();
+  std::vector<lockstep_file> test_files =
+      createTestFiles({{"a.txt", ""}, {"b.txt", ""}});
+  std::vector<digest> actual_digests{};
+
+  // Act
+  hashInLockstep(test_files, actual_digests);
+
+  // Assert
+  assert(last_read_file_chunk_calls == 0);
+  assert(actual_digests[0] == EMPTY_DIGEST);
+  assert(actual_digests[1] == EMPTY_DIGEST);
+}
+
+void testHashingMarksUnreadableFilesUnique() {
+  // Arrange
+  resetMockStates();
+  std::vector<lockstep_file> test_files =
+      createTestFiles({{"a.txt", "same"}, {"b.txt", "same"}});
+  test_files.push_back({.path = "missing.txt", .size = 4});
+  std::vector<digest> actual_digests{};
+
+  // Act
+  lockstep_stats actual_stats = hashInLockstep(test_files, actual_digests);
+
+  // Assert
+  assert(actual_stats.files_unreadable == 1);
+  assert(actual_stats.files_hashed == 2);
+  assert(actual_digests[0] == md5TestDigest("same"));
+  assert(actual_digests[2] == uniqueFileDigest("missing.txt", 4));
+}
+
+void testHashingGroupsAcrossThreads() {
+  // Arrange
+  resetMockStates();
+  setThreadCount(4);
+  std::map<std::string, std::string> test_contents{};
+  for (int i = 0; i < 16; ++i) {
+    test_contents["file_" + std::to_string(i) + ".txt"] =
+        std::string(i / 2 + 1, 'a');
+  }
+  std::vector<lockstep_file> test_files = createTestFiles(test_contents);
+  std::vector<digest> actual_digests{};
+
+  // Act
+  lockstep_stats actual_stats = hashInLockstep(test_files, actual_digests);
+
+  // Assert
+  assert(actual_stats.files_hashed == 16);
+  for (std::size_t i = 0; i < test_files.size(); ++i) {
+    assert(actual_digests[i] ==
+           md5TestDigest(mock_file_contents[test_files[i].path]));
+  }
+
+  // Cleanup
+  setThreadCount(0);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testUniqueFileDigestDiffersByPath();
+  testHashingIdenticalFilesGivesTheirMD5();
+  testHashingFilesOfUniqueSizeReadsNothing();
+  testHashingStopsReadingFilesWhichDiffer();
+  testHashingSplitsGroupsAcrossChunks();
+  testHashingKeepsFilesOpenAcrossChunks();
+  testHashingEmptyFilesGivesTheEmptyDigest();
+  testHashingMarksUnreadableFilesUnique();
+  testHashingGroupsAcrossThreads();
+}
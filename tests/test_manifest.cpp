@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+
+#include "../src/build/manifest.cpp"
+#include "../src/lib.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+uint8_t const EXTRACTED_HASH_BYTE = 0x77;
+
+// md5sum of an empty file and of "a\n".
+char const EMPTY_MD5[] = "d41d8cd98f00b204e9800998ecf8427e";
+char const A_MD5[] = "60b725f10c9c85c70d97880dfe8191b3";
+
+std::unordered_map<std::string, std::string> file_contents{};
+std::vector<std::string> last_extract_hash_paths{};
+
+void resetMocks() {
+  file_contents = {};
+  last_extract_hash_paths = {};
+}
+
+std::size_t readFileChunk(std::string const &file_path, int64_t offset,
+                          char *buffer, std::size_t length) {
+  auto contents = file_contents.find(file_path);
+  if (contents == file_contents.end()) {
+    throw file_open_error("Could not open the file: " + file_path);
+  }
+
+  std::string const &file = contents->second;
+  if (offset >= static_cast<int64_t>(file.size())) {
+    return 0;
+  }
+  std::size_t read = std::min(length, file.size() - offset);
+  std::memcpy(buffer, file.data() + offset, read);
+  return read;
+}
+
+void extractHash(uint8_t *hash, std::string path) {
+  last_extract_hash_paths.push_back(path);
+  std::fill(hash, hash + MD5_DIGEST_LENGTH, EXTRACTED_HASH_BYTE);
+}
+
+std::string joinPath(std::vector<std::string> const &path_segments) {
+  return path_segments[0] + "/" + path_segments[1];
+}
+
+digest testDigest(uint8_t byte) {
+  digest test_digest{};
+  std::fill(test_digest.bytes, test_digest.bytes + MD5_DIGEST_LENGTH, byte);
+  return test_digest;
+}
+
+// A line whose digest is the hex character repeated.
+std::string testLine(char hex, std::string const &name) {
+  return std::string(MD5_DIGEST_LENGTH * 2, hex) + "  " + name + "\n";
+}
+
+manifest_index createTestIndex(std::size_t spot_check_every) {
+  return {.entries = {},
+          .trusted = {},
+          .spot_check_every = spot_check_every,
+          .stats = {0, 0, 0, 0}};
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ---------------------------- parseManifestLine --------------------------- */
+void testParsingALineInTextMode() {
+  // Arrange
+  std::string name{};
+  digest hash{};
+
+  // Act
+  bool parsed =
+      parseManifestLine(std::string(A_MD5) + "  dir/a.txt", name, hash);
+
+  // Assert
+  assert(parsed);
+  assert(name == "dir/a.txt");
+  assert(hash.bytes[0] == 0x60 && hash.bytes[15] == 0xb3);
+}
+
+void testParsingTheDigestOfAnEmptyFileGivesZeros() {
+  // Arrange
+  std::string name{};
+  digest hash{};
+
+  // Act
+  bool parsed =
+      parseManifestLine(std::string(EMPTY_MD5) + "  empty.txt", name, hash);
+
+  // Assert
+  assert(parsed);
+  assert(hash == testDigest(0));
+}
+
+void testParsingALineInBinaryMode() {
+  // Arrange
+  std::string name{};
+  digest hash{};
+
+  // Act
+  bool parsed =
+      parseManifestLine(std::string(A_MD5) + " *a file.txt", name, hash);
+
+  // Assert
+  assert(parsed);
+  assert(name == "a file.txt");
+  assert(hash.bytes[0] == 0x60 && hash.bytes[15] == 0xb3);
+}
+
+void testParsingAnEscapedLine() {
+  // Arrange
+  std::string name{};
+  digest hash{};
+
+  // Act
+  bool parsed = parseManifestLine(
+      "\\" + std::string(A_MD5) + "  new\\nline\\\\slash", name, hash);
+
+  // Assert
+  assert(parsed);
+  assert(name == "new\nline\\slash");
+}
+
+void testParsingALineDropsTheLeadingDot() {
+  // Arrange
+  std::string name{};
+  digest hash{};
+
+  // Act
+  bool parsed =
+      parseManifestLine(std::string(A_MD5) + "  ./dir/a.txt", name, hash);
+
+  // Assert
+  assert(parsed);
+  assert(name == "dir/a.txt");
+}
+
+void testParsingSkipsMalformedLines() {
+  // Arrange
+  std::string name{};
+  digest hash{};
+
+  // Act & Assert
+  assert(!parseManifestLine("", name, hash));
+  assert(!parseManifestLine("MD5 (a.txt) = " + std::string(A_MD5), name,
+                            hash));
+  assert(!parseManifestLine(std::string(A_MD5) + "  ", name, hash));
+  assert(!parseManifestLine(std::string(A_MD5) + " -a.txt", name, hash));
+  assert(!parseManifestLine(std::string(A_MD5) + "  /etc/a.txt", name,
+                            hash));
+  assert(!parseManifestLine(
+      "zz" + std::string(A_MD5).substr(2) + "  a.txt", name, hash));
+  assert(!parseManifestLine("\\" + std::string(A_MD5) + "  bad\\t", name,
+                            hash));
+}
+
+/* ------------------------------ loadManifest ------------------------------ */
+void testLoadingAManifestKeysFilesByTheirAbsolutePath() {
+  // Arrange
+  resetMocks();
+  file_contents["./dir/MD5SUMS"] =
+      testLine('7', "a.txt") + "not a line\n" + testLine('f', "sub/b.txt");
+  manifest_index index = createTestIndex(0);
+
+  // Act
+  std::size_t entries = loadManifest(index, "./dir/MD5SUMS", "/home/dir");
+
+  // Assert
+  assert(entries == 2);
+  assert(index.entries.size() == 2);
+  assert(index.entries["/home/dir/a.txt"].hash == testDigest(0x77));
+  assert(index.entries["/home/dir/sub/b.txt"].hash == testDigest(0xff));
+  assert(index.trusted == std::vector<bool>{true});
+  assert(index.stats == (manifest_stats{1, 0, 0, 0}));
+}
+
+void testLoadingAManifestLargerThanARead() {
+  // Arrange
+  resetMocks();
+  std::string contents{};
+  std::size_t lines = MANIFEST_READ_SIZE / testLine('7', "a.txt").size() + 2;
+  for (std::size_t i = 0; i < lines; ++i) {
+    contents += testLine('7', std::to_string(i) + ".txt");
+  }
+  file_contents["MD5SUMS"] = contents;
+  manifest_index index = createTestIndex(0);
+
+  // Act
+  std::size_t entries = loadManifest(index, "MD5SUMS", "/d");
+
+  // Assert
+  assert(entries == lines);
+  assert(index.entries.count("/d/" + std::to_string(lines - 1) + ".txt"));
+}
+
+void testLoadingAManifestWhichCanNotBeReadThrows() {
+  // Arrange
+  resetMocks();
+  manifest_index index = createTestIndex(0);
+
+  try {
+    // Act
+    loadManifest(index, "MD5SUMS", "/d");
+    assert(false);
+  } catch (file_open_error &error) {
+    // Assert
+    assert(index.trusted.empty());
+  }
+}
+
+/* --------------------------- trustManifestDigest -------------------------- */
+void testTrustingADigestWithoutSpotChecks() {
+  // Arrange
+  resetMocks();
+  file_contents["MD5SUMS"] = testLine('f', "a.txt");
+  manifest_index index = createTestIndex(0);
+  loadManifest(index, "MD5SUMS", "/d");
+  digest hash{};
+
+  // Act
+  bool trusted = trustManifestDigest(index, "/d/a.txt", "./a.txt", hash.bytes);
+
+  // Assert
+  assert(trusted);
+  assert(hash == testDigest(0xff));
+  assert(last_extract_hash_paths.empty());
+  assert(index.stats == (manifest_stats{1, 1, 0, 0}));
+}
+
+void testTrustingADigestOfAFileNotInAManifest() {
+  // Arrange
+  resetMocks();
+  file_contents["MD5SUMS"] = testLine('f', "a.txt");
+  manifest_index index = createTestIndex(0);
+  loadManifest(index, "MD5SUMS", "/d");
+  digest hash{};
+
+  // Act
+  bool trusted = trustManifestDigest(index, "/d/b.txt", "./b.txt", hash.bytes);
+
+  // Assert
+  assert(!trusted);
+  assert(index.stats == (manifest_stats{1, 0, 0, 0}));
+}
+
+void testSpotChecksReadOneInEveryFile() {
+  // Arrange
+  resetMocks();
+  file_contents["MD5SUMS"] = testLine('7', "a.txt") + testLine('7', "b.txt") +
+                             testLine('7', "c.txt");
+  manifest_index index = createTestIndex(2);
+  loadManifest(index, "MD5SUMS", "/d");
+  digest hash{};
+
+  // Act
+  trustManifestDigest(index, "/d/a.txt", "./a.txt", hash.bytes);
+  trustManifestDigest(index, "/d/b.txt", "./b.txt", hash.bytes);
+  trustManifestDigest(index, "/d/c.txt", "./c.txt", hash.bytes);
+
+  // Assert
+  assert(last_extract_hash_paths ==
+         (std::vector<std::string>{"./a.txt", "./c.txt"}));
+  assert(index.stats == (manifest_stats{1, 3, 2, 0}));
+}
+
+void testAFailedSpotCheckStopsTrustingTheManifest() {
+  // Arrange
+  resetMocks();
+  file_contents["MD5SUMS"] = testLine('f', "a.txt") + testLine('f', "b.txt");
+  file_contents["other/MD5SUMS"] = testLine('f', "c.txt");
+  manifest_index index = createTestIndex(1);
+  loadManifest(index, "MD5SUMS", "/d");
+  loadManifest(index, "other/MD5SUMS", "/d/other");
+  digest a_hash{};
+  digest b_hash{};
+  digest c_hash{};
+
+  // Act
+  bool a_trusted =
+      trustManifestDigest(index, "/d/a.txt", "./a.txt", a_hash.bytes);
+  bool b_trusted =
+      trustManifestDigest(index, "/d/b.txt", "./b.txt", b_hash.bytes);
+  bool c_trusted = trustManifestDigest(index, "/d/other/c.txt",
+                                       "./other/c.txt", c_hash.bytes);
+
+  // Assert
+  assert(a_trusted && a_hash == testDigest(EXTRACTED_HASH_BYTE));
+  assert(!b_trusted);
+  assert(c_trusted && c_hash == testDigest(EXTRACTED_HASH_BYTE));
+  assert(index.trusted == (std::vector<bool>{false, false}));
+  assert(index.stats == (manifest_stats{2, 0, 2, 2}));
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testParsingALineInTextMode();
+  testParsingTheDigestOfAnEmptyFileGivesZeros();
+  testParsingALineInBinaryMode();
+  testParsingAnEscapedLine();
+  testParsingALineDropsTheLeadingDot();
+  testParsingSkipsMalformedLines();
+  testLoadingAManifestKeysFilesByTheirAbsolutePath();
+  testLoadingAManifestLargerThanARead();
+  testLoadingAManifestWhichCanNotBeReadThrows();
+  testTrustingADigestWithoutSpotChecks();
+  testTrustingADigestOfAFileNotInAManifest();
+  testSpotChecksReadOneInEveryFile();
+  testAFailedSpotCheckStopsTrustingTheManifest();
+}
@@ -0,0 +1,114 @@
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+#include "../src/thread/parallel.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+void markVisited(std::size_t begin, std::size_t end, void *context) {
+  std::vector<int> &visits = *static_cast<std::vector<int> *>(context);
+  for (std::size_t i = begin; i < end; ++i) {
+    ++visits[i];
+  }
+}
+
+void countCalls(std::size_t begin, std::size_t end, void *context) {
+  ++*static_cast<std::atomic<int> *>(context);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ------------------------------- threadCount ------------------------------ */
+void testThreadCountIsAtLeastOne() {
+  // Act
+  std::size_t actual_thread_count = threadCount();
+
+  // Assert
+  assert(actual_thread_count >= 1);
+}
+
+/* ----------------------------- setThreadCount ----------------------------- */
+void testSettingThreadCount() {
+  // Act
+  setThreadCount(3);
+  std::size_t actual_thread_count = threadCount();
+
+  // Assert
+  assert(actual_thread_count == 3);
+
+  // Cleanup
+  setThreadCount(0);
+}
+
+/* ------------------------------- parallelFor ------------------------------ */
+void testParallelForVisitsEveryIndexOnce() {
+  // Arrange
+  setThreadCount(4);
+  std::vector<int> test_visits(10007, 0);
+  std::atomic<int> test_calls{0};
+
+  // Act
+  parallelFor(0, test_visits.size(), markVisited, &test_visits, 16);
+  parallelFor(0, test_visits.size(), countCalls, &test_calls, 16);
+
+  // Assert
+  assert(std::vector<int>(10007, 1) == test_visits);
+  assert(test_calls == 4);
+
+  // Cleanup
+  setThreadCount(0);
+}
+
+void testParallelForVisitsOnlyTheRange() {
+  // Arrange
+  setThreadCount(4);
+  std::vector<int> test_visits(100, 0);
+
+  // Act
+  parallelFor(10, 90, markVisited, &test_visits, 1);
+
+  // Assert
+  for (std::size_t i = 0; i < test_visits.size(); ++i) {
+    assert(test_visits[i] == (i >= 10 && i < 90 ? 1 : 0));
+  }
+
+  // Cleanup
+  setThreadCount(0);
+}
+
+void testParallelForSmallRangeRunsOnce() {
+  // Arrange
+  std::atomic<int> test_calls{0};
+
+  // Act
+  parallelFor(0, PARALLEL_MIN_CHUNK - 1, countCalls, &test_calls);
+
+  // Assert
+  assert(test_calls == 1);
+}
+
+void testParallelForEmptyRange() {
+  // Arrange
+  std::atomic<int> test_calls{0};
+
+  // Act
+  parallelFor(5, 5, countCalls, &test_calls);
+
+  // Assert
+  assert(test_calls == 0);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testThreadCountIsAtLeastOne();
+  testSettingThreadCount();
+  testParallelForVisitsEveryIndexOnce();
+  testParallelForVisitsOnlyTheRange();
+  testParallelForSmallRangeRunsOnce();
+  testParallelForEmptyRange();
+}
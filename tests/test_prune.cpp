@@ -0,0 +1,501 @@
+#include <cassert>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "../src/arena/arena.cpp"
+#include "../src/lib.cpp"
+#include "../src/prune/prune.cpp"
+#include "../src/sqlite/operators.cpp"
+#include "../src/thread/parallel.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+std::ostringstream OUTPUT_MOCK{};
+
+/*
+- Root Path: /home/test
+
+- Groups:
+root/a.txt, root/b.txt
+root/x, root/y (each holding c.txt and d.txt)
+*/
+char const A_NAME[] = "a.txt";
+char const B_NAME[] = "b.txt";
+char const X_C_NAME[] = "c.txt";
+char const X_D_NAME[] = "d.txt";
+char const Y_C_NAME[] = "c.txt";
+char const Y_D_NAME[] = "d.txt";
+
+hash_table_row::rows const TEST_HASH_ROWS{
+    {10, 1, A_NAME, nullptr, 10},  {11, 1, B_NAME, nullptr, 10},
+    {12, 2, X_C_NAME, nullptr, 5}, {13, 2, X_D_NAME, nullptr, 7},
+    {14, 3, Y_C_NAME, nullptr, 5}, {15, 3, Y_D_NAME, nullptr, 7}};
+
+duplicate_node_set createTestSet() {
+  duplicate_node_set test_set{};
+  test_set.tree.parents = {NO_PARENT, 0, 0, 0, 0, 3, 3, 4, 4};
+  test_set.tree.first_children = {1, 0, 0, 5, 7, 0, 0, 0, 0};
+  test_set.tree.child_counts = {4, 0, 0, 2, 2, 0, 0, 0, 0};
+  test_set.tree.path_segments = {"root",   "a.txt",  "b.txt",
+                                 "x",      "y",      X_C_NAME,
+                                 X_D_NAME, Y_C_NAME, Y_D_NAME};
+  test_set.tree.path_segments[1] = A_NAME;
+  test_set.tree.path_segments[2] = B_NAME;
+  test_set.tree.sizes = {44, 10, 10, 12, 12, 5, 7, 5, 7};
+  test_set.tree.directory_ids = {1, -1, -1, 2, 3, -1, -1, -1, -1};
+  test_set.members = {1, 2, 3, 4};
+  test_set.group_offsets = {0, 2, 4};
+  return test_set;
+}
+
+/*
+- Groups:
+root/x, root/y (each holding c.txt and d.txt)
+root/a.txt, root/x/c.txt
+*/
+duplicate_node_set createOverlappingTestSet() {
+  duplicate_node_set test_set = createTestSet();
+  test_set.tree.sizes[1] = 5;
+  test_set.members = {3, 4, 1, 5};
+  return test_set;
+}
+
+// The stamps verify took of every file of the test set.
+std::vector<verified_stamp> createTestStamps() {
+  return {{1, {10, 500}}, {2, {10, 100}}, {5, {5, 300}},
+          {6, {7, 300}},  {7, {5, 200}},  {8, {7, 400}}};
+}
+
+std::vector<verified_stamp> verify_duplicates_return{};
+std::unordered_map<std::string, file_stamp> stamp_file_return{};
+std::unordered_map<std::string, bool> remove_file_return{};
+std::vector<std::string> last_removed_files{};
+std::vector<std::vector<prune_outcome_input>> last_finished_outcomes{};
+std::size_t last_created_journal_count = 0;
+prune_journal_table_row::rows fetch_pending_return{};
+std::list<std::string> journal_strings{};
+bool last_verify_duplicates = false;
+
+void resetMocks() {
+  OUTPUT_MOCK.str("");
+  verify_duplicates_return = createTestStamps();
+  stamp_file_return = {{"/home/test/root/a.txt", {10, 500}},
+                       {"/home/test/root/b.txt", {10, 100}},
+                       {"/home/test/root/x/c.txt", {5, 300}},
+                       {"/home/test/root/x/d.txt", {7, 300}},
+                       {"/home/test/root/y/c.txt", {5, 200}},
+                       {"/home/test/root/y/d.txt", {7, 400}}};
+  remove_file_return = {};
+  last_removed_files = {};
+  last_finished_outcomes = {};
+  last_created_journal_count = 0;
+  fetch_pending_return.clear();
+  journal_strings = {};
+  last_verify_duplicates = false;
+}
+
+std::mutex file_mutex{};
+
+bool stampFile(std::string const &file_path, file_stamp &stamp) {
+  std::lock_guard<std::mutex> lock(file_mutex);
+  auto found = stamp_file_return.find(file_path);
+  if (found == stamp_file_return.end()) {
+    return false;
+  }
+  stamp = found->second;
+  return true;
+}
+
+bool removeFile(std::string const &file_path) {
+  std::lock_guard<std::mutex> lock(file_mutex);
+  last_removed_files.push_back(file_path);
+  auto found = remove_file_return.find(file_path);
+  return found == remove_file_return.end() || found->second;
+}
+
+std::vector<std::size_t> collectFileNodes(inode_tree const &tree,
+                                          std::size_t node) {
+  if (tree.directory_ids[node] == -1) {
+    return {node};
+  }
+
+  std::vector<std::size_t> file_nodes{};
+  for (std::size_t i = 0; i < tree.child_counts[node]; ++i) {
+    file_nodes.push_back(tree.first_children[node] + i);
+  }
+  return file_nodes;
+}
+
+bool findVerifiedStamp(std::vector<verified_stamp> const &file_stamps,
+                       std::size_t node, file_stamp &stamp) {
+  for (verified_stamp const &file_stamp : file_stamps) {
+    if (file_stamp.node == node) {
+      stamp = file_stamp.stamp;
+      return true;
+    }
+  }
+  return false;
+}
+
+void renderPath(inode_tree const &tree, std::size_t node,
+                std::vector<char const *> &segment_stack, std::string &path) {
+  path = tree.path_segments[node];
+  for (std::size_t parent = tree.parents[node]; parent != NO_PARENT;
+       parent = tree.parents[parent]) {
+    path = std::string(tree.path_segments[parent]) + "/" + path;
+  }
+}
+
+std::string joinPath(std::vector<std::string> const &path_segments) {
+  std::string joined_path{};
+  for (int i = 0; i < path_segments.size() - 1; ++i) {
+    joined_path += path_segments[i];
+    joined_path += '/';
+  }
+  joined_path += path_segments[path_segments.size() - 1];
+  return joined_path;
+}
+
+sqlite3 *initDB(char const *const file_name) { return nullptr; }
+void upgradeDB(sqlite3 *db) {}
+void freeDB(sqlite3 *db) {}
+
+directory_table_row::rows fetchAllDirectories(sqlite3 *db, arena *arena) {
+  return {};
+}
+
+hash_table_row::rows fetchAllHashes(sqlite3 *db, arena *arena) {
+  return TEST_HASH_ROWS;
+}
+
+scan_meta_data_table_row fetchScanMetaData(sqlite3 *db) {
+  return {.root_dir = "/home/test"};
+}
+
+prune_journal_table_row::rows fetchPendingPruneJournal(sqlite3 *db,
+                                                       arena *arena) {
+  return fetch_pending_return;
+}
+
+void createPruneJournal(
+    sqlite3 *db, std::vector<prune_journal_input> const &journal_inputs) {
+  last_created_journal_count = journal_inputs.size();
+  for (prune_journal_input const &journal_input : journal_inputs) {
+    journal_strings.push_back(journal_input.path);
+    char const *path = journal_strings.back().c_str();
+    journal_strings.push_back(journal_input.keeper_path);
+    char const *keeper_path = journal_strings.back().c_str();
+    fetch_pending_return.push_back(
+        {.id = static_cast<row_id>(fetch_pending_return.size() + 1),
+         .hash_id = journal_input.hash_id,
+         .path = path,
+         .keeper_path = keeper_path,
+         .size = journal_input.size,
+         .modified_ns = journal_input.modified_ns,
+         .keeper_modified_ns = journal_input.keeper_modified_ns,
+         .keeper_inode = journal_input.keeper_inode});
+  }
+}
+
+void finishPruneJournal(
+    sqlite3 *db, std::vector<prune_outcome_input> const &outcome_inputs) {
+  last_finished_outcomes.push_back(outcome_inputs);
+}
+
+duplicate_node_set transform(file_hash_rows const &rows,
+                             digest_options const &options) {
+  return createTestSet();
+}
+
+digest_options fetchDigestOptions(sqlite3 *db) {
+  return {.include_names = false};
+}
+
+std::vector<verified_stamp>
+verifyDuplicates(sqlite3 *db, arena *dupes_arena,
+                 duplicate_node_set &duplicate_nodes_set,
+                 std::ostream &console) {
+  last_verify_duplicates = true;
+  return verify_duplicates_return;
+}
+
+void sortDuplicateNodeSet(duplicate_node_set &duplicate_nodes_set,
+                          load_options const &options) {}
+
+bool sameEntry(prune_entry const &entry, row_id hash_id,
+               std::string const &path, std::string const &keeper_path) {
+  return entry.hash_id == hash_id && entry.path == path &&
+         entry.keeper_path == keeper_path;
+}
+
+prune_journal_table_row::rows createTestJournal() {
+  return {{1, 11, "/home/test/root/b.txt", "/home/test/root/a.txt", 10, 100,
+           500, 0},
+          {2, 14, "/home/test/root/y/c.txt", "/home/test/root/x/c.txt", 5,
+           200, 300, 0},
+          {3, 15, "/home/test/root/y/d.txt", "/home/test/root/x/d.txt", 7,
+           400, 300, 0}};
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------- planPrune ------------------------------- */
+void testPlanningKeepsTheShortestPath() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  std::vector<prune_entry> actual_entries =
+      planPrune(createTestSet(), TEST_HASH_ROWS, "/home/test",
+                PRUNE_KEEP_SHORTEST_PATH, verify_duplicates_return);
+
+  // Assert
+  assert(actual_entries.size() == 3);
+  assert(sameEntry(actual_entries[0], 11, "/home/test/root/b.txt",
+                   "/home/test/root/a.txt"));
+  assert(sameEntry(actual_entries[1], 14, "/home/test/root/y/c.txt",
+                   "/home/test/root/x/c.txt"));
+  assert(sameEntry(actual_entries[2], 15, "/home/test/root/y/d.txt",
+                   "/home/test/root/x/d.txt"));
+  assert(actual_entries[2].stamp.size == 7);
+  assert(actual_entries[2].stamp.modified_ns == 400);
+}
+
+void testPlanningKeepsTheOldestFiles() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  std::vector<prune_entry> actual_entries =
+      planPrune(createTestSet(), TEST_HASH_ROWS, "/home/test",
+                PRUNE_KEEP_OLDEST, verify_duplicates_return);
+
+  // Assert
+  assert(actual_entries.size() == 3);
+  assert(sameEntry(actual_entries[0], 10, "/home/test/root/a.txt",
+                   "/home/test/root/b.txt"));
+  assert(sameEntry(actual_entries[1], 12, "/home/test/root/x/c.txt",
+                   "/home/test/root/y/c.txt"));
+  assert(sameEntry(actual_entries[2], 13, "/home/test/root/x/d.txt",
+                   "/home/test/root/y/d.txt"));
+}
+
+void testPlanningSkipsFilesWithoutAVerifiedStamp() {
+  // Arrange
+  resetMocks();
+  verify_duplicates_return.erase(verify_duplicates_return.begin() + 3);
+  verify_duplicates_return.erase(verify_duplicates_return.begin() + 1);
+
+  // Act
+  std::vector<prune_entry> actual_entries =
+      planPrune(createTestSet(), TEST_HASH_ROWS, "/home/test",
+                PRUNE_KEEP_SHORTEST_PATH, verify_duplicates_return);
+
+  // Assert
+  assert(actual_entries.size() == 1);
+  assert(sameEntry(actual_entries[0], 12, "/home/test/root/x/c.txt",
+                   "/home/test/root/y/c.txt"));
+}
+
+void testPlanningJournalsTheVerifiedStamps() {
+  // Arrange
+  resetMocks();
+  stamp_file_return["/home/test/root/y/d.txt"] = {7, 900};
+  stamp_file_return["/home/test/root/x/d.txt"] = {7, 800};
+
+  // Act
+  std::vector<prune_entry> actual_entries =
+      planPrune(createTestSet(), TEST_HASH_ROWS, "/home/test",
+                PRUNE_KEEP_SHORTEST_PATH, verify_duplicates_return);
+
+  // Assert
+  assert(actual_entries.size() == 3);
+  assert(actual_entries[2].stamp.modified_ns == 400);
+  assert(actual_entries[2].keeper_stamp.modified_ns == 300);
+}
+
+void testPlanningNeverDeletesTheKeeperOfAnotherGroup() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  std::vector<prune_entry> actual_entries =
+      planPrune(createOverlappingTestSet(), TEST_HASH_ROWS, "/home/test",
+                PRUNE_KEEP_OLDEST, verify_duplicates_return);
+
+  // Assert
+  assert(actual_entries.size() == 2);
+  assert(sameEntry(actual_entries[0], 13, "/home/test/root/x/d.txt",
+                   "/home/test/root/y/d.txt"));
+  assert(sameEntry(actual_entries[1], 10, "/home/test/root/a.txt",
+                   "/home/test/root/x/c.txt"));
+  assert(actual_entries[1].keeper_stamp.modified_ns == 300);
+}
+
+void testPlanningKeepsTheMemberAnotherGroupKeeps() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  std::vector<prune_entry> actual_entries =
+      planPrune(createOverlappingTestSet(), TEST_HASH_ROWS, "/home/test",
+                PRUNE_KEEP_SHORTEST_PATH, verify_duplicates_return);
+
+  // Assert
+  assert(actual_entries.size() == 3);
+  assert(sameEntry(actual_entries[0], 14, "/home/test/root/y/c.txt",
+                   "/home/test/root/x/c.txt"));
+  assert(sameEntry(actual_entries[1], 15, "/home/test/root/y/d.txt",
+                   "/home/test/root/x/d.txt"));
+  assert(sameEntry(actual_entries[2], 10, "/home/test/root/a.txt",
+                   "/home/test/root/x/c.txt"));
+}
+
+/* ------------------------------ pruneJournal ------------------------------ */
+void testPruningDeletesTheJournaledFiles() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  prune_stats actual_stats =
+      pruneJournal(nullptr, createTestJournal(), PRUNE_BATCH_SIZE);
+
+  // Assert
+  assert(actual_stats == (prune_stats{3, 0, 0, 0, 22}));
+  assert(last_removed_files.size() == 3);
+  std::vector<std::vector<prune_outcome_input>> expected_outcomes{
+      {{1, PRUNE_OUTCOME_DELETED},
+       {2, PRUNE_OUTCOME_DELETED},
+       {3, PRUNE_OUTCOME_DELETED}}};
+  assert(last_finished_outcomes == expected_outcomes);
+}
+
+void testPruningKeepsFilesWhichChanged() {
+  // Arrange
+  resetMocks();
+  stamp_file_return["/home/test/root/b.txt"] = {10, 101};
+  stamp_file_return["/home/test/root/x/c.txt"] = {6, 300};
+  stamp_file_return.erase("/home/test/root/y/d.txt");
+
+  // Act
+  prune_stats actual_stats =
+      pruneJournal(nullptr, createTestJournal(), PRUNE_BATCH_SIZE);
+
+  // Assert
+  assert(actual_stats == (prune_stats{0, 1, 2, 0, 0}));
+  assert(last_removed_files.size() == 0);
+  std::vector<std::vector<prune_outcome_input>> expected_outcomes{
+      {{1, PRUNE_OUTCOME_KEPT},
+       {2, PRUNE_OUTCOME_KEPT},
+       {3, PRUNE_OUTCOME_DELETED}}};
+  assert(last_finished_outcomes == expected_outcomes);
+}
+
+void testPruningKeepsFilesWhoseKeeperWasReplaced() {
+  // Arrange
+  resetMocks();
+  stamp_file_return["/home/test/root/a.txt"] = {10, 500, 0, 9};
+  stamp_file_return["/home/test/root/x/c.txt"] = {5, 301};
+
+  // Act
+  prune_stats actual_stats =
+      pruneJournal(nullptr, createTestJournal(), PRUNE_BATCH_SIZE);
+
+  // Assert
+  assert(actual_stats == (prune_stats{1, 0, 2, 0, 7}));
+  assert(last_removed_files ==
+         std::vector<std::string>({"/home/test/root/y/d.txt"}));
+}
+
+void testPruningKeepsFilesWhichCouldNotBeDeleted() {
+  // Arrange
+  resetMocks();
+  remove_file_return = {{"/home/test/root/b.txt", false}};
+
+  // Act
+  prune_stats actual_stats =
+      pruneJournal(nullptr, createTestJournal(), PRUNE_BATCH_SIZE);
+
+  // Assert
+  assert(actual_stats == (prune_stats{2, 0, 0, 1, 12}));
+  assert(last_finished_outcomes[0][0] ==
+         (prune_outcome_input{1, PRUNE_OUTCOME_KEPT}));
+}
+
+void testPruningFinishesEveryBatch() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  pruneJournal(nullptr, createTestJournal(), 2);
+
+  // Assert
+  std::vector<std::vector<prune_outcome_input>> expected_outcomes{
+      {{1, PRUNE_OUTCOME_DELETED}, {2, PRUNE_OUTCOME_DELETED}},
+      {{3, PRUNE_OUTCOME_DELETED}}};
+  assert(last_finished_outcomes == expected_outcomes);
+}
+
+/* ---------------------------------- prune --------------------------------- */
+void testPruneJournalsThePlanBeforeDeleting() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  prune("/home/test/.cache/ddupes/testing.db",
+        {.keep = PRUNE_KEEP_SHORTEST_PATH}, OUTPUT_MOCK);
+
+  // Assert
+  assert(last_verify_duplicates);
+  assert(last_created_journal_count == 3);
+  assert(fetch_pending_return[0] ==
+         (prune_journal_table_row{1, 11, "/home/test/root/b.txt",
+                                  "/home/test/root/a.txt", 10, 100, 500,
+                                  0}));
+  assert(last_removed_files.size() == 3);
+}
+
+void testPruneResumesALeftJournal() {
+  // Arrange
+  resetMocks();
+  fetch_pending_return.push_back(createTestJournal()[2]);
+
+  // Act
+  prune("/home/test/.cache/ddupes/testing.db", {.keep = PRUNE_KEEP_OLDEST},
+        OUTPUT_MOCK);
+
+  // Assert
+  assert(!last_verify_duplicates);
+  assert(last_created_journal_count == 0);
+  assert(last_removed_files ==
+         std::vector<std::string>({"/home/test/root/y/d.txt"}));
+  assert(OUTPUT_MOCK.str() ==
+         "Resuming the prune left in the journal, 1 files are left to "
+         "delete.\n\n"
+         "Deleted 1 files (7 bytes freed), 0 files were already gone, 0 files "
+         "were kept because they or their keeper changed and 0 files could "
+         "not be deleted.\n\n");
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testPlanningKeepsTheShortestPath();
+  testPlanningKeepsTheOldestFiles();
+  testPlanningSkipsFilesWithoutAVerifiedStamp();
+  testPlanningJournalsTheVerifiedStamps();
+  testPlanningNeverDeletesTheKeeperOfAnotherGroup();
+  testPlanningKeepsTheMemberAnotherGroupKeeps();
+  testPruningDeletesTheJournaledFiles();
+  testPruningKeepsFilesWhichChanged();
+  testPruningKeepsFilesWhoseKeeperWasReplaced();
+  testPruningKeepsFilesWhichCouldNotBeDeleted();
+  testPruningFinishesEveryBatch();
+  testPruneJournalsThePlanBeforeDeleting();
+  testPruneResumesALeftJournal();
+}
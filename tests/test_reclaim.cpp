@@ -0,0 +1,480 @@
+#include <cassert>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "../src/arena/arena.cpp"
+#include "../src/lib.cpp"
+#include "../src/reclaim/reclaim.cpp"
+#include "../src/thread/parallel.cpp"
+#include "./data.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+std::ostringstream OUTPUT_MOCK{};
+
+/*
+- Root Path: /home/test
+
+- Groups:
+root/a.txt, root/b.txt
+root/x, root/y (each holding c.txt and d.txt)
+*/
+duplicate_node_set createTestSet() {
+  duplicate_node_set test_set{};
+  test_set.tree.parents = {NO_PARENT, 0, 0, 0, 0, 3, 3, 4, 4};
+  test_set.tree.first_children = {1, 0, 0, 5, 7, 0, 0, 0, 0};
+  test_set.tree.child_counts = {4, 0, 0, 2, 2, 0, 0, 0, 0};
+  test_set.tree.path_segments = {"root",  "a.txt", "b.txt", "x",    "y",
+                                 "c.txt", "d.txt", "c.txt", "d.txt"};
+  test_set.tree.sizes = {44, 10, 10, 12, 12, 5, 7, 5, 7};
+  test_set.tree.directory_ids = {1, -1, -1, 2, 3, -1, -1, -1, -1};
+  test_set.members = {1, 2, 3, 4};
+  test_set.group_offsets = {0, 2, 4};
+  return test_set;
+}
+
+// Every file of the test set, each with the node as its inode.
+std::vector<verified_stamp> createTestStamps() {
+  std::vector<verified_stamp> test_stamps{};
+  for (std::size_t node : {1, 2, 5, 6, 7, 8}) {
+    test_stamps.push_back({.node = node,
+                           .stamp = {.size = 10,
+                                     .modified_ns = 20,
+                                     .device = 1,
+                                     .inode = static_cast<int64_t>(node)}});
+  }
+  return test_stamps;
+}
+
+std::vector<std::pair<std::string, std::string>> last_link_calls{};
+std::vector<std::pair<int64_t, int64_t>> last_link_inodes{};
+reclaim_mode last_link_mode = RECLAIM_MODE_REFLINK;
+std::unordered_map<std::string, link_result> link_file_return{};
+std::vector<std::size_t> last_verified_key_groups{};
+std::size_t last_verified_inputs_count = 0;
+bool last_verify_duplicates = false;
+group_sort last_sort = GROUP_SORT_BYTES;
+std::vector<hash_update_input> last_update_hashes{};
+std::vector<std::string> unstampable_files{};
+std::vector<std::string> unmapped_files{};
+
+void resetMocks() {
+  OUTPUT_MOCK.str("");
+  last_link_calls = {};
+  last_link_inodes = {};
+  last_link_mode = RECLAIM_MODE_REFLINK;
+  link_file_return = {};
+  last_verified_key_groups = {};
+  last_verified_inputs_count = 0;
+  last_verify_duplicates = false;
+  last_sort = GROUP_SORT_BYTES;
+  last_update_hashes.clear();
+  unstampable_files = {};
+  unmapped_files = {};
+}
+
+std::vector<std::size_t> collectFileNodes(inode_tree const &tree,
+                                          std::size_t node) {
+  if (tree.directory_ids[node] == -1) {
+    return {node};
+  }
+
+  std::vector<std::size_t> file_nodes{};
+  for (std::size_t i = 0; i < tree.child_counts[node]; ++i) {
+    file_nodes.push_back(tree.first_children[node] + i);
+  }
+  return file_nodes;
+}
+
+bool findVerifiedStamp(std::vector<verified_stamp> const &file_stamps,
+                       std::size_t node, file_stamp &stamp) {
+  for (verified_stamp const &file_stamp : file_stamps) {
+    if (file_stamp.node == node) {
+      stamp = file_stamp.stamp;
+      return true;
+    }
+  }
+  return false;
+}
+
+void renderPath(inode_tree const &tree, std::size_t node,
+                std::vector<char const *> &segment_stack, std::string &path) {
+  path = tree.path_segments[node];
+  for (std::size_t parent = tree.parents[node]; parent != NO_PARENT;
+       parent = tree.parents[parent]) {
+    path = std::string(tree.path_segments[parent]) + "/" + path;
+  }
+}
+
+std::string joinPath(std::vector<std::string> const &path_segments) {
+  std::string joined_path{};
+  for (int i = 0; i < path_segments.size() - 1; ++i) {
+    joined_path += path_segments[i];
+    joined_path += '/';
+  }
+  joined_path += path_segments[path_segments.size() - 1];
+  return joined_path;
+}
+
+std::mutex link_mutex{};
+
+link_result recordLink(std::string const &source_path,
+                       std::string const &target_path,
+                       file_stamp const &source_stamp,
+                       file_stamp const &target_stamp) {
+  std::lock_guard<std::mutex> lock(link_mutex);
+  last_link_calls.push_back({source_path, target_path});
+  last_link_inodes.push_back({source_stamp.inode, target_stamp.inode});
+  auto found = link_file_return.find(target_path);
+  return found == link_file_return.end() ? LINK_RESULT_LINKED : found->second;
+}
+
+link_result hardlinkFile(std::string const &source_path,
+                         std::string const &target_path,
+                         file_stamp const &source_stamp,
+                         file_stamp const &target_stamp) {
+  last_link_mode = RECLAIM_MODE_HARDLINK;
+  return recordLink(source_path, target_path, source_stamp, target_stamp);
+}
+
+link_result reflinkFile(std::string const &source_path,
+                        std::string const &target_path,
+                        file_stamp const &source_stamp,
+                        file_stamp const &target_stamp) {
+  last_link_mode = RECLAIM_MODE_REFLINK;
+  return recordLink(source_path, target_path, source_stamp, target_stamp);
+}
+
+bool stampFile(std::string const &file_path, file_stamp &stamp) {
+  if (std::find(unstampable_files.begin(), unstampable_files.end(),
+                file_path) != unstampable_files.end()) {
+    return false;
+  }
+  stamp = {.size = 10, .modified_ns = 30, .device = 1, .inode = 1};
+  return true;
+}
+
+bool fingerprintExtents(std::string const &path, uint8_t *fingerprint) {
+  if (std::find(unmapped_files.begin(), unmapped_files.end(), path) !=
+      unmapped_files.end()) {
+    return false;
+  }
+  std::fill(fingerprint, fingerprint + MD5_DIGEST_LENGTH, 3);
+  return true;
+}
+
+void updateHashes(sqlite3 *db, std::vector<hash_update_input> const &inputs) {
+  for (hash_update_input const &input : inputs) {
+    last_update_hashes.push_back(input);
+  }
+}
+
+bool buildVerifiedKey(duplicate_node_set const &duplicate_nodes_set,
+                      std::size_t group, std::string const &root_dir,
+                      digest &key) {
+  last_verified_key_groups.push_back(group);
+  return true;
+}
+
+sqlite3 *initDB(char const *const file_name) { return nullptr; }
+void upgradeDB(sqlite3 *db) {}
+void freeDB(sqlite3 *db) {}
+
+directory_table_row::rows fetchAllDirectories(sqlite3 *db, arena *arena) {
+  return {};
+}
+
+hash_table_row::rows fetchAllHashes(sqlite3 *db, arena *arena) { return {}; }
+
+scan_meta_data_table_row fetchScanMetaData(sqlite3 *db) {
+  return {.root_dir = "/home/test"};
+}
+
+void createVerifiedGroups(
+    sqlite3 *db, std::vector<verified_group_input> const &verified_inputs) {
+  last_verified_inputs_count = verified_inputs.size();
+}
+
+duplicate_node_set transform(file_hash_rows const &rows,
+                             digest_options const &options) {
+  return createTestSet();
+}
+
+digest_options fetchDigestOptions(sqlite3 *db) {
+  return {.include_names = false};
+}
+
+std::vector<verified_stamp>
+verifyDuplicates(sqlite3 *db, arena *dupes_arena,
+                 duplicate_node_set &duplicate_nodes_set,
+                 std::ostream &console) {
+  last_verify_duplicates = true;
+  return createTestStamps();
+}
+
+void sortDuplicateNodeSet(duplicate_node_set &duplicate_nodes_set,
+                          load_options const &options) {
+  last_sort = options.sort;
+}
+
+bool sameTask(reclaim_task const &task, std::string const &keeper_path,
+              std::string const &target_path, int64_t size,
+              std::size_t group) {
+  return task.keeper_path == keeper_path && task.target_path == target_path &&
+         task.size == size && task.group == group;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* --------------------------- collectReclaimTasks -------------------------- */
+void testCollectingTasksPairsFilesWithTheKeeper() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet();
+
+  // Act
+  std::vector<reclaim_task> actual_tasks =
+      collectReclaimTasks(test_set, "/home/test", createTestStamps());
+
+  // Assert
+  assert(actual_tasks.size() == 3);
+  assert(sameTask(actual_tasks[0], "/home/test/root/a.txt",
+                  "/home/test/root/b.txt", 10, 0));
+  assert(sameTask(actual_tasks[1], "/home/test/root/x/c.txt",
+                  "/home/test/root/y/c.txt", 5, 1));
+  assert(sameTask(actual_tasks[2], "/home/test/root/x/d.txt",
+                  "/home/test/root/y/d.txt", 7, 1));
+}
+
+void testCollectingTasksSkipsMembersWithOtherFileCounts() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet();
+  test_set.members = {3, 1};
+  test_set.group_offsets = {0, 2};
+
+  // Act
+  std::vector<reclaim_task> actual_tasks =
+      collectReclaimTasks(test_set, "/home/test", createTestStamps());
+
+  // Assert
+  assert(actual_tasks.size() == 0);
+}
+
+void testCollectingTasksCarriesTheVerifiedStamps() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet();
+
+  // Act
+  std::vector<reclaim_task> actual_tasks =
+      collectReclaimTasks(test_set, "/home/test", createTestStamps());
+
+  // Assert
+  assert(actual_tasks[0].target_node == 2);
+  assert(actual_tasks[0].keeper_stamp.inode == 1);
+  assert(actual_tasks[0].target_stamp.inode == 2);
+  assert(actual_tasks[2].keeper_stamp.inode == 6);
+  assert(actual_tasks[2].target_stamp.inode == 8);
+}
+
+void testCollectingTasksSkipsFilesWithoutAVerifiedStamp() {
+  // Arrange
+  duplicate_node_set test_set = createTestSet();
+  std::vector<verified_stamp> test_stamps = createTestStamps();
+  test_stamps.erase(test_stamps.begin() + 4);
+
+  // Act
+  std::vector<reclaim_task> actual_tasks =
+      collectReclaimTasks(test_set, "/home/test", test_stamps);
+
+  // Assert
+  assert(actual_tasks.size() == 2);
+  assert(actual_tasks[1].target_path == "/home/test/root/y/d.txt");
+}
+
+/* ------------------------------ reclaimFiles ------------------------------ */
+void testReclaimingFilesLinksEveryTask() {
+  // Arrange
+  resetMocks();
+  std::vector<reclaim_task> test_tasks = collectReclaimTasks(
+      createTestSet(), "/home/test", createTestStamps());
+  std::vector<bool> linked_tasks(3, false);
+
+  // Act
+  reclaim_stats actual_stats = reclaimFiles(
+      test_tasks, RECLAIM_MODE_HARDLINK, RECLAIM_BATCH_SIZE, linked_tasks);
+
+  // Assert
+  assert(actual_stats == (reclaim_stats{3, 0, 0, 0, 22}));
+  assert(last_link_calls.size() == 3);
+  assert(last_link_mode == RECLAIM_MODE_HARDLINK);
+  assert(linked_tasks == std::vector<bool>({true, true, true}));
+  std::sort(last_link_inodes.begin(), last_link_inodes.end());
+  assert(last_link_inodes ==
+         (std::vector<std::pair<int64_t, int64_t>>{{1, 2}, {5, 7}, {6, 8}}));
+}
+
+void testReclaimingFilesCountsFilesWhichWereNotLinked() {
+  // Arrange
+  resetMocks();
+  link_file_return = {{"/home/test/root/b.txt", LINK_RESULT_SAME_FILE},
+                      {"/home/test/root/y/c.txt", LINK_RESULT_UNSUPPORTED},
+                      {"/home/test/root/y/d.txt", LINK_RESULT_CHANGED}};
+  std::vector<reclaim_task> test_tasks = collectReclaimTasks(
+      createTestSet(), "/home/test", createTestStamps());
+  std::vector<bool> linked_tasks(3, false);
+
+  // Act
+  reclaim_stats actual_stats = reclaimFiles(
+      test_tasks, RECLAIM_MODE_REFLINK, RECLAIM_BATCH_SIZE, linked_tasks);
+
+  // Assert
+  assert(actual_stats == (reclaim_stats{0, 2, 1, 0, 0}));
+  assert(last_link_mode == RECLAIM_MODE_REFLINK);
+  assert(linked_tasks == std::vector<bool>({false, false, false}));
+}
+
+void testReclaimingFilesStopsAfterABatchWithAFailure() {
+  // Arrange
+  resetMocks();
+  link_file_return = {{"/home/test/root/b.txt", LINK_RESULT_FAILED}};
+  std::vector<reclaim_task> test_tasks = collectReclaimTasks(
+      createTestSet(), "/home/test", createTestStamps());
+  std::vector<bool> linked_tasks(3, false);
+
+  // Act
+  reclaim_stats actual_stats =
+      reclaimFiles(test_tasks, RECLAIM_MODE_REFLINK, 2, linked_tasks);
+
+  // Assert
+  assert(actual_stats == (reclaim_stats{1, 0, 0, 1, 5}));
+  assert(last_link_calls.size() == 2);
+  assert(linked_tasks == std::vector<bool>({false, true, false}));
+}
+
+/* -------------------------- storeReclaimedGroups -------------------------- */
+void testStoringReclaimedGroupsRefreshesTheLinkedRows() {
+  // Arrange
+  resetMocks();
+  duplicate_node_set test_set = createTestSet();
+  hash_table_row::rows test_rows{
+      {11, 1, test_set.tree.path_segments[2], uniqueTestHash(1), 10, 20},
+      {12, 3, test_set.tree.path_segments[7], uniqueTestHash(2), 5, 20},
+      {13, 3, test_set.tree.path_segments[8], uniqueTestHash(3), 7, 20}};
+  std::vector<reclaim_task> test_tasks = collectReclaimTasks(
+      test_set, "/home/test", createTestStamps());
+  unstampable_files = {"/home/test/root/y/d.txt"};
+  unmapped_files = {"/home/test/root/y/c.txt"};
+
+  // Act
+  storeReclaimedGroups(nullptr, test_set, test_rows, "/home/test", test_tasks,
+                       {true, true, true});
+
+  // Assert
+  assert(last_update_hashes.size() == 2);
+  assert(last_update_hashes[0].id == 11);
+  assert(last_update_hashes[0].hash == test_rows[0].hash);
+  assert(last_update_hashes[0].modified_ns == 30);
+  assert(last_update_hashes[0].extents != nullptr);
+  assert(last_update_hashes[1].id == 12);
+  assert(last_update_hashes[1].extents == nullptr);
+  assert(last_verified_inputs_count == 2);
+}
+
+void testStoringReclaimedGroupsSkipsTasksWhichWereNotLinked() {
+  // Arrange
+  resetMocks();
+  duplicate_node_set test_set = createTestSet();
+  hash_table_row::rows test_rows{
+      {11, 1, test_set.tree.path_segments[2], uniqueTestHash(1), 10, 20}};
+  std::vector<reclaim_task> test_tasks = collectReclaimTasks(
+      test_set, "/home/test", createTestStamps());
+
+  // Act
+  storeReclaimedGroups(nullptr, test_set, test_rows, "/home/test", test_tasks,
+                       {false, true, false});
+
+  // Assert
+  assert(last_update_hashes.size() == 0);
+  assert(last_verified_key_groups == std::vector<std::size_t>({1}));
+}
+
+/* --------------------------------- reclaim -------------------------------- */
+void testReclaimVerifiesAndKeepsTheShortestPath() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  reclaim("/home/test/.cache/ddupes/testing.db",
+          {.mode = RECLAIM_MODE_REFLINK}, OUTPUT_MOCK);
+
+  // Assert
+  assert(last_verify_duplicates);
+  assert(last_sort == GROUP_SORT_PATH);
+}
+
+void testReclaimStoresTheLinkedGroupsAsVerified() {
+  // Arrange
+  resetMocks();
+  link_file_return = {{"/home/test/root/b.txt", LINK_RESULT_SAME_FILE}};
+
+  // Act
+  reclaim("/home/test/.cache/ddupes/testing.db",
+          {.mode = RECLAIM_MODE_HARDLINK}, OUTPUT_MOCK);
+
+  // Assert
+  assert(last_verified_key_groups == std::vector<std::size_t>({1}));
+  assert(last_verified_inputs_count == 1);
+}
+
+void testReclaimPrintsWhatWasLinked() {
+  // Arrange
+  resetMocks();
+  link_file_return = {{"/home/test/root/y/c.txt", LINK_RESULT_UNSUPPORTED}};
+
+  // Act
+  reclaim("/home/test/.cache/ddupes/testing.db",
+          {.mode = RECLAIM_MODE_REFLINK}, OUTPUT_MOCK);
+
+  // Assert
+  assert(OUTPUT_MOCK.str() ==
+         "Linked 2 files (17 bytes reclaimed), 0 files were already linked or "
+         "had changed, 1 files could not be linked on their file system and 0 "
+         "files failed.\n\n");
+}
+
+void testReclaimThrowsWhenAFileFailed() {
+  // Arrange
+  resetMocks();
+  link_file_return = {{"/home/test/root/b.txt", LINK_RESULT_FAILED}};
+
+  try {
+    // Act
+    reclaim("/home/test/.cache/ddupes/testing.db",
+            {.mode = RECLAIM_MODE_REFLINK}, OUTPUT_MOCK);
+    assert(false);
+  } catch (reclaim_error &error) {
+    // Assert
+    assert(last_verified_key_groups == std::vector<std::size_t>({1}));
+  }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testCollectingTasksPairsFilesWithTheKeeper();
+  testCollectingTasksSkipsMembersWithOtherFileCounts();
+  testCollectingTasksCarriesTheVerifiedStamps();
+  testCollectingTasksSkipsFilesWithoutAVerifiedStamp();
+  testReclaimingFilesLinksEveryTask();
+  testReclaimingFilesCountsFilesWhichWereNotLinked();
+  testReclaimingFilesStopsAfterABatchWithAFailure();
+  testStoringReclaimedGroupsRefreshesTheLinkedRows();
+  testStoringReclaimedGroupsSkipsTasksWhichWereNotLinked();
+  testReclaimVerifiesAndKeepsTheShortestPath();
+  testReclaimStoresTheLinkedGroupsAsVerified();
+  testReclaimPrintsWhatWasLinked();
+  testReclaimThrowsWhenAFileFailed();
+}
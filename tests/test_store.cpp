@@ -0,0 +1,378 @@
+#include <cassert>
+#include <unordered_map>
+
+#include "../src/lib.cpp"
+#include "../src/sqlite/operators.cpp"
+#include "../src/store/store.cpp"
+#include "./data.cpp"
+
+/* -------------------------------------------------------------------------- */
+/*                                    Mocks                                   */
+/* -------------------------------------------------------------------------- */
+uint8_t const EXTRACTED_HASH_BYTE = 7;
+uint8_t const STORED_HASH_BYTE = 9;
+
+std::vector<stored_digest_key> stored_digest_keys{};
+int64_t fetch_store_clock_return = 0;
+std::vector<std::string> last_extract_hash_paths{};
+std::vector<stored_digest_key> last_created_keys{};
+std::vector<digest> last_created_digests{};
+std::vector<int64_t> last_created_used{};
+std::vector<stored_digest_key> last_touched_keys{};
+int64_t last_touched_used = 0;
+std::size_t last_evict_max_entries = 0;
+bool last_free_db = false;
+std::unordered_map<std::string, std::string> attributes{};
+std::vector<std::string> unwritable_files{};
+bool last_init_db = false;
+
+void resetMocks() {
+  stored_digest_keys = {};
+  fetch_store_clock_return = 0;
+  last_extract_hash_paths = {};
+  last_created_keys = {};
+  last_created_digests = {};
+  last_created_used = {};
+  last_touched_keys = {};
+  last_touched_used = 0;
+  last_evict_max_entries = 0;
+  last_free_db = false;
+  attributes = {};
+  unwritable_files = {};
+  last_init_db = false;
+}
+
+void extractHash(uint8_t *hash, std::string path) {
+  last_extract_hash_paths.push_back(path);
+  std::fill(hash, hash + MD5_DIGEST_LENGTH, EXTRACTED_HASH_BYTE);
+}
+
+bool readAttribute(std::string const &path, char const *name,
+                   std::string &value) {
+  auto attribute = attributes.find(path + "#" + name);
+  if (attribute == attributes.end()) {
+    return false;
+  }
+  value = attribute->second;
+  return true;
+}
+
+bool writeAttribute(std::string const &path, char const *name,
+                    std::string const &value) {
+  if (std::find(unwritable_files.begin(), unwritable_files.end(), path) !=
+      unwritable_files.end()) {
+    return false;
+  }
+  attributes[path + "#" + name] = value;
+  return true;
+}
+
+// Only compared against nullptr, never dereferenced.
+char MOCK_DB_HANDLE = 0;
+
+sqlite3 *initDB(char const *const file_name) {
+  last_init_db = true;
+  return reinterpret_cast<sqlite3 *>(&MOCK_DB_HANDLE);
+}
+void initStoreDB(sqlite3 *db) {}
+void freeDB(sqlite3 *db) { last_free_db = true; }
+
+int64_t fetchStoreClock(sqlite3 *db) { return fetch_store_clock_return; }
+
+bool fetchStoredDigest(sqlite3 *db, stored_digest_key const &key,
+                       uint8_t *hash) {
+  if (std::find(stored_digest_keys.begin(), stored_digest_keys.end(), key) ==
+      stored_digest_keys.end()) {
+    return false;
+  }
+  std::fill(hash, hash + MD5_DIGEST_LENGTH, STORED_HASH_BYTE);
+  return true;
+}
+
+void createStoredDigests(sqlite3 *db,
+                         std::vector<stored_digest_input> const &inputs) {
+  for (stored_digest_input const &input : inputs) {
+    last_created_keys.push_back(input.key);
+    last_created_digests.push_back(toDigest(input.hash));
+    last_created_used.push_back(input.used);
+  }
+}
+
+void touchStoredDigests(sqlite3 *db, std::vector<stored_digest_key> const &keys,
+                        int64_t used) {
+  last_touched_keys.insert(last_touched_keys.end(), keys.begin(), keys.end());
+  last_touched_used = used;
+}
+
+void evictStoredDigests(sqlite3 *db, std::size_t max_entries) {
+  last_evict_max_entries = max_entries;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Tests                                   */
+/* -------------------------------------------------------------------------- */
+/* ------------------------- formatDigestAttribute -------------------------- */
+void testFormattingADigestAttribute() {
+  // Act
+  std::string actual_value =
+      formatDigestAttribute(uniqueTestHash(1), {12, 345, 1, 2});
+
+  // Assert
+  assert(actual_value == "md5:12:345:01ffffffffffffffffffffffffffffff");
+}
+
+/* -------------------------- parseDigestAttribute -------------------------- */
+void testParsingADigestAttributeOfAnUnchangedFile() {
+  // Arrange
+  digest actual_digest{};
+
+  // Act
+  bool parsed =
+      parseDigestAttribute("md5:12:345:01ffffffffffffffffffffffffffffff",
+                           {12, 345, 3, 4}, actual_digest.bytes);
+
+  // Assert
+  assert(parsed);
+  assert(actual_digest == toDigest(uniqueTestHash(1)));
+}
+
+void testParsingADigestAttributeOfAChangedFileFails() {
+  // Arrange
+  digest actual_digest{};
+  std::string test_value = "md5:12:345:01ffffffffffffffffffffffffffffff";
+
+  // Act & Assert
+  assert(!parseDigestAttribute(test_value, {13, 345}, actual_digest.bytes));
+  assert(!parseDigestAttribute(test_value, {12, 346}, actual_digest.bytes));
+  assert(!parseDigestAttribute("sha1:12:345:01ffffffffffffffffffffffffffffff",
+                               {12, 345}, actual_digest.bytes));
+  assert(!parseDigestAttribute("md5:12:345:01ff", {12, 345},
+                               actual_digest.bytes));
+  assert(!parseDigestAttribute("md5:12:345:01fffffffffffffffffffffffffffffz",
+                               {12, 345}, actual_digest.bytes));
+}
+
+/* ---------------------------- extractStoredHash --------------------------- */
+void testExtractingAStoredHashReadsTheStore() {
+  // Arrange
+  resetMocks();
+  stored_digest_keys = {{1, 2, 3, 4}};
+  digest_store *store = initDigestStore("shared.store", false, 0);
+  digest actual_digest{};
+
+  // Act
+  bool read_file =
+      extractStoredHash(store, actual_digest.bytes, "/r/a", {3, 4, 1, 2});
+
+  // Assert
+  assert(!read_file);
+  assert(actual_digest.bytes[0] == STORED_HASH_BYTE);
+  assert(last_extract_hash_paths.size() == 0);
+  assert(store->digests_read == 1);
+  assert(store->read_keys == (std::vector<stored_digest_key>{{1, 2, 3, 4}}));
+
+  // Cleanup
+  freeDigestStore(store);
+}
+
+void testExtractingAChangedFileHashesAndStoresIt() {
+  // Arrange
+  resetMocks();
+  stored_digest_keys = {{1, 2, 3, 4}};
+  digest_store *store = initDigestStore("shared.store", false, 0);
+  digest actual_digest{};
+
+  // Act
+  bool read_file =
+      extractStoredHash(store, actual_digest.bytes, "/r/a", {3, 5, 1, 2});
+
+  // Assert
+  assert(read_file);
+  assert(actual_digest.bytes[0] == EXTRACTED_HASH_BYTE);
+  assert(last_extract_hash_paths == (std::vector<std::string>{"/r/a"}));
+  assert(store->digests_written == 1);
+  assert(store->pending_digests.size() == 1);
+  assert(store->pending_digests[0].key == (stored_digest_key{1, 2, 3, 5}));
+  assert(store->pending_digests[0].hash == actual_digest);
+
+  // Cleanup
+  freeDigestStore(store);
+}
+
+void testExtractingWithoutAStoreHashesTheFile() {
+  // Arrange
+  resetMocks();
+  digest actual_digest{};
+
+  // Act
+  bool read_file =
+      extractStoredHash(nullptr, actual_digest.bytes, "/r/a", {3, 4, 1, 2});
+
+  // Assert
+  assert(read_file);
+  assert(actual_digest.bytes[0] == EXTRACTED_HASH_BYTE);
+  assert(last_extract_hash_paths == (std::vector<std::string>{"/r/a"}));
+}
+
+void testExtractingReadsTheAttributeFirst() {
+  // Arrange
+  resetMocks();
+  attributes["/r/a#user.ddupes.digest"] =
+      "md5:3:4:01ffffffffffffffffffffffffffffff";
+  digest_store *store = initDigestStore("", true, 0);
+  digest actual_digest{};
+
+  // Act
+  bool read_file =
+      extractStoredHash(store, actual_digest.bytes, "/r/a", {3, 4, 1, 2});
+
+  // Assert
+  assert(!read_file);
+  assert(!last_init_db);
+  assert(actual_digest == toDigest(uniqueTestHash(1)));
+  assert(last_extract_hash_paths.size() == 0);
+  assert(store->attributes_read == 1);
+  assert(store->attributes_written == 0);
+
+  // Cleanup
+  freeDigestStore(store);
+}
+
+void testExtractingAFileWithAStaleAttributeWritesItAgain() {
+  // Arrange
+  resetMocks();
+  attributes["/r/a#user.ddupes.digest"] =
+      "md5:3:3:01ffffffffffffffffffffffffffffff";
+  digest_store *store = initDigestStore("", true, 0);
+  digest actual_digest{};
+
+  // Act
+  extractStoredHash(store, actual_digest.bytes, "/r/a", {3, 4, 1, 2});
+
+  // Assert
+  assert(actual_digest.bytes[0] == EXTRACTED_HASH_BYTE);
+  assert(attributes["/r/a#user.ddupes.digest"] ==
+         formatDigestAttribute(actual_digest.bytes, {3, 4}));
+  assert(store->attributes_written == 1);
+  assert(store->digests_written == 0);
+
+  // Cleanup
+  freeDigestStore(store);
+}
+
+void testExtractingCopiesStoredDigestsToAttributes() {
+  // Arrange
+  resetMocks();
+  stored_digest_keys = {{1, 2, 3, 4}};
+  unwritable_files = {"/r/b"};
+  digest_store *store = initDigestStore("shared.store", true, 0);
+  digest actual_digest{};
+
+  // Act
+  extractStoredHash(store, actual_digest.bytes, "/r/a", {3, 4, 1, 2});
+  extractStoredHash(store, actual_digest.bytes, "/r/b", {3, 4, 1, 2});
+
+  // Assert
+  assert(last_extract_hash_paths.size() == 0);
+  assert(store->digests_read == 2);
+  assert(store->attributes_written == 1);
+  assert(attributes.count("/r/a#user.ddupes.digest") == 1);
+
+  // Cleanup
+  freeDigestStore(store);
+}
+
+void testInitializingWithoutAStoreOrAttributesGivesNothing() {
+  // Act
+  digest_store *store = initDigestStore("", false, 0);
+
+  // Assert
+  assert(store == nullptr);
+}
+
+void testExtractingFlushesFullBatches() {
+  // Arrange
+  resetMocks();
+  digest_store *store = initDigestStore("shared.store", false, 0);
+  digest actual_digest{};
+
+  // Act
+  for (std::size_t i = 0; i < STORE_BATCH_SIZE; ++i) {
+    extractStoredHash(store, actual_digest.bytes, "/r/a",
+                      {3, 4, 1, static_cast<int64_t>(i)});
+  }
+
+  // Assert
+  assert(last_created_keys.size() == STORE_BATCH_SIZE);
+  assert(store->pending_digests.size() == 0);
+
+  // Cleanup
+  freeDigestStore(store);
+}
+
+/* ----------------------------- freeDigestStore ---------------------------- */
+void testFreeingTheStoreWritesAndMarksWithTheNextClock() {
+  // Arrange
+  resetMocks();
+  fetch_store_clock_return = 41;
+  stored_digest_keys = {{1, 2, 3, 4}};
+  digest_store *store = initDigestStore("shared.store", false, 0);
+  digest actual_digest{};
+  extractStoredHash(store, actual_digest.bytes, "/r/a", {3, 4, 1, 2});
+  extractStoredHash(store, actual_digest.bytes, "/r/b", {6, 7, 1, 5});
+
+  // Act
+  freeDigestStore(store);
+
+  // Assert
+  assert(last_created_keys == (std::vector<stored_digest_key>{{1, 5, 6, 7}}));
+  assert(last_created_digests[0].bytes[0] == EXTRACTED_HASH_BYTE);
+  assert(last_created_used == (std::vector<int64_t>{42}));
+  assert(last_touched_keys == (std::vector<stored_digest_key>{{1, 2, 3, 4}}));
+  assert(last_touched_used == 42);
+  assert(last_evict_max_entries == STORE_DEFAULT_MAX_ENTRIES);
+  assert(last_free_db);
+}
+
+void testFreeingTheStoreEvictsDownToItsMaxEntries() {
+  // Arrange
+  resetMocks();
+  digest_store *store = initDigestStore("shared.store", false, 1000);
+
+  // Act
+  freeDigestStore(store);
+
+  // Assert
+  assert(last_evict_max_entries == 1000);
+}
+
+void testFreeingNoStoreDoesNothing() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  freeDigestStore(nullptr);
+
+  // Assert
+  assert(!last_free_db);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                    Main                                    */
+/* -------------------------------------------------------------------------- */
+int main() {
+  testFormattingADigestAttribute();
+  testParsingADigestAttributeOfAnUnchangedFile();
+  testParsingADigestAttributeOfAChangedFileFails();
+  testExtractingAStoredHashReadsTheStore();
+  testExtractingAChangedFileHashesAndStoresIt();
+  testExtractingWithoutAStoreHashesTheFile();
+  testExtractingReadsTheAttributeFirst();
+  testExtractingAFileWithAStaleAttributeWritesItAgain();
+  testExtractingCopiesStoredDigestsToAttributes();
+  testInitializingWithoutAStoreOrAttributesGivesNothing();
+  testExtractingFlushesFullBatches();
+  testFreeingTheStoreWritesAndMarksWithTheNextClock();
+  testFreeingTheStoreEvictsDownToItsMaxEntries();
+  testFreeingNoStoreDoesNothing();
+}
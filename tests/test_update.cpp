@@ -4,8 +4,10 @@
 #include <sstream>
 #include <unordered_map>
 
+#include "../src/arena/arena.cpp"
 #include "../src/lib.cpp"
 #include "../src/sqlite/operators.cpp"
+#include "../src/thread/parallel.cpp"
 #include "../src/update/update.cpp"
 #include "./data.cpp"
 
@@ -14,11 +16,9 @@ std::ostringstream OUTPUT_MOCK{};
 std::ostringstream OUTPUT_ERROR_MOCK{};
 
 /* ---------------------------------- Mocks --------------------------------- */
-const std::unordered_map<std::string, bool> file_exists_return{
-    {"/user/test/home/dir1/testing.txt", true},
-    {"/user/test/home/dir1/oranges/testing_two.txt", false},
-    {"/user/test/home/dir2/oranges/testing_three.txt", false},
-    {"/user/test/home/dir1/apples/testing_four.txt", true}};
+std::unordered_map<std::string, std::vector<std::string>>
+    list_directory_return{};
+std::vector<std::string> unreadable_directories{};
 const directory_table_row::rows fetch_all_directories_return{
     {1, "dir1", -1},   {2, "dir2", -1},  {3, "oranges", 1},
     {4, "oranges", 2}, {5, "apples", 1},
@@ -32,10 +32,38 @@ const hash_table_row::rows fetch_all_hashes_return{
 const scan_meta_data_table_row fetch_scan_meta_data_return{
     .root_dir = "/user/test/home"};
 
-std::vector<int> last_delete_hash_id{};
+std::vector<row_id> last_delete_hash_id{};
+std::vector<row_id> last_clear_directory_digests{};
+bool last_upgrade_db = false;
 
-bool fileExists(std::string const &file_path) {
-  return file_exists_return.at(file_path);
+std::unordered_map<std::string, file_stamp> stamp_file_return{};
+std::vector<std::string> unopenable_files{};
+uint8_t const EXTRACTED_HASH_BYTE = 7;
+std::vector<std::string> last_create_hash_names{};
+std::vector<hash_input> last_create_hash_inputs{};
+std::vector<std::string> last_create_directory_names{};
+std::vector<directory_input> last_create_directory_inputs{};
+std::vector<hash_update_input> last_update_hashes{};
+// The inputs point at digests which only live as long as the rescan.
+std::vector<digest> last_update_hash_digests{};
+std::vector<directory_stamp_input> last_update_directory_stamps{};
+row_id const CREATED_DIRECTORY_ID = 100;
+bool in_transaction = false;
+std::size_t inserts_outside_transaction = 0;
+
+directory_listing listDirectory(std::string const &directory_path,
+                                std::vector<std::string> &names) {
+  if (std::find(unreadable_directories.begin(), unreadable_directories.end(),
+                directory_path) != unreadable_directories.end()) {
+    return DIRECTORY_LISTING_UNREADABLE;
+  }
+
+  auto listing = list_directory_return.find(directory_path);
+  if (listing == list_directory_return.end()) {
+    return DIRECTORY_LISTING_MISSING;
+  }
+  names.insert(names.end(), listing->second.begin(), listing->second.end());
+  return DIRECTORY_LISTING_READ;
 }
 
 std::string joinPath(std::vector<std::string> const &path_segments) {
@@ -48,14 +76,94 @@ std::string joinPath(std::vector<std::string> const &path_segments) {
   return joined_path;
 }
 
+bool stampFile(std::string const &file_path, file_stamp &stamp) {
+  auto file_stamp = stamp_file_return.find(file_path);
+  if (file_stamp == stamp_file_return.end()) {
+    return false;
+  }
+  stamp = file_stamp->second;
+  return true;
+}
+
+bool stampEntry(std::string const &path, file_stamp &stamp, file_type &type) {
+  type = list_directory_return.count(path) != 0 ? FILE_TYPE_DIRECTORY
+                                                : FILE_TYPE_FILE;
+  return stampFile(path, stamp);
+}
+
+digest_store *initDigestStore(std::string const &store_path, bool attributes,
+                              std::size_t max_entries) {
+  return nullptr;
+}
+void printDigestStoreStats(digest_store const *store, std::ostream &console) {}
+void freeDigestStore(digest_store *store) {}
+
+std::vector<std::string> stored_files{};
+
+bool extractStoredHash(digest_store *store, uint8_t *hash,
+                       std::string const &path, file_stamp const &stamp) {
+  if (std::find(unopenable_files.begin(), unopenable_files.end(), path) !=
+      unopenable_files.end()) {
+    throw file_open_error("Could not open " + path);
+  }
+  std::fill(hash, hash + MD5_DIGEST_LENGTH, EXTRACTED_HASH_BYTE);
+  return std::find(stored_files.begin(), stored_files.end(), path) ==
+         stored_files.end();
+}
+
+std::vector<std::string> unmapped_files{};
+std::vector<std::string> last_fingerprint_extents_paths{};
+
+bool fingerprintExtents(std::string const &path, uint8_t *fingerprint) {
+  last_fingerprint_extents_paths.push_back(path);
+  if (std::find(unmapped_files.begin(), unmapped_files.end(), path) !=
+      unmapped_files.end()) {
+    return false;
+  }
+  std::fill(fingerprint, fingerprint + MD5_DIGEST_LENGTH, 3);
+  return true;
+}
+
+void beginTransaction(sqlite3 *db) { in_transaction = true; }
+void commitTransaction(sqlite3 *db) { in_transaction = false; }
+
+row_id createHash(sqlite3 *db, hash_input const &input) {
+  inserts_outside_transaction += !in_transaction;
+  last_create_hash_names.push_back(input.name);
+  last_create_hash_inputs.push_back(input);
+  return last_create_hash_inputs.size();
+}
+
+row_id createDirectory(sqlite3 *db, directory_input const &input) {
+  inserts_outside_transaction += !in_transaction;
+  last_create_directory_names.push_back(input.name);
+  last_create_directory_inputs.push_back(input);
+  return CREATED_DIRECTORY_ID + last_create_directory_inputs.size() - 1;
+}
+
+void updateHashes(sqlite3 *db, std::vector<hash_update_input> const &inputs) {
+  for (hash_update_input const &input : inputs) {
+    last_update_hashes.push_back(input);
+    last_update_hash_digests.push_back(toDigest(input.hash));
+  }
+}
+
+void updateDirectoryStamps(sqlite3 *db,
+                           std::vector<directory_stamp_input> const &inputs) {
+  for (directory_stamp_input const &input : inputs) {
+    last_update_directory_stamps.push_back(input);
+  }
+}
+
 sqlite3 *initDB(char const *const file_name) { return nullptr; };
+void upgradeDB(sqlite3 *db) { last_upgrade_db = true; }
 void freeDB(sqlite3 *db) { return; }
 
-directory_table_row::rows fetchAllDirectories(sqlite3 *db) {
+directory_table_row::rows fetchAllDirectories(sqlite3 *db, arena *arena) {
   return fetch_all_directories_return;
 }
 
-hash_table_row::rows fetchAllHashes(sqlite3 *db) {
+hash_table_row::rows fetchAllHashes(sqlite3 *db, arena *arena) {
   return fetch_all_hashes_return;
 }
 
@@ -63,9 +171,55 @@ scan_meta_data_table_row fetchScanMetaData(sqlite3 *db) {
   return fetch_scan_meta_data_return;
 }
 
-void deleteHash(sqlite3 *db, int id) { last_delete_hash_id.push_back(id); }
+void deleteHash(sqlite3 *db, row_id id) { last_delete_hash_id.push_back(id); }
+
+char const *fetch_placeholders_option_return = nullptr;
+std::vector<cache_option_input> last_create_cache_option{};
+
+cache_option_table_row fetchCacheOption(sqlite3 *db, str_const name) {
+  if (fetch_placeholders_option_return == nullptr ||
+      !compareStrings(name, LOCKSTEP_PLACEHOLDERS_OPTION)) {
+    throw not_found_error("No option found.");
+  }
+  return {.name = name, .value = fetch_placeholders_option_return};
+}
 
-void resetMocks() { last_delete_hash_id = {}; }
+void createCacheOption(sqlite3 *db, cache_option_input const &input) {
+  last_create_cache_option.push_back(input);
+}
+
+void clearDirectoryDigests(sqlite3 *db, std::vector<row_id> const &ids) {
+  last_clear_directory_digests.insert(last_clear_directory_digests.end(),
+                                      ids.begin(), ids.end());
+}
+
+void resetMocks() {
+  list_directory_return = {
+      {"/user/test/home", {"dir1", "dir2"}},
+      {"/user/test/home/dir1", {"oranges", "testing.txt", "apples"}},
+      {"/user/test/home/dir1/oranges", {}},
+      {"/user/test/home/dir1/apples", {"testing_four.txt", "other.txt"}}};
+  unreadable_directories = {};
+  last_delete_hash_id = {};
+  last_clear_directory_digests = {};
+  last_upgrade_db = false;
+  stamp_file_return = {};
+  unopenable_files = {};
+  unmapped_files = {};
+  stored_files = {};
+  last_fingerprint_extents_paths = {};
+  last_create_hash_names = {};
+  last_create_hash_inputs.clear();
+  last_create_directory_names = {};
+  last_create_directory_inputs.clear();
+  last_update_hashes.clear();
+  last_update_hash_digests.clear();
+  last_update_directory_stamps.clear();
+  in_transaction = false;
+  inserts_outside_transaction = 0;
+  fetch_placeholders_option_return = nullptr;
+  last_create_cache_option.clear();
+}
 
 /* ---------------------------------- Tests --------------------------------- */
 void testUpdateDeletesMissingFiles() {
@@ -73,22 +227,540 @@ void testUpdateDeletesMissingFiles() {
   resetMocks();
 
   // Act
-  update("testing", OUTPUT_MOCK);
+  update("testing", {.rescan = false}, OUTPUT_MOCK);
+
+  // Assert
+  std::vector<row_id> expected_deleted_hash_ids = {2, 3};
+  assert(last_delete_hash_id == expected_deleted_hash_ids);
+}
+
+void testUpdateClearsDigestsAboveMissingFiles() {
+  // Arrange
+  resetMocks();
+
+  // Act
+  update("testing", {.rescan = false}, OUTPUT_MOCK);
+
+  // Assert
+  std::vector<row_id> expected_cleared_directory_ids = {3, 1, 4, 2};
+  assert(last_upgrade_db);
+  assert(last_clear_directory_digests == expected_cleared_directory_ids);
+}
+
+void testUpdateKeepsFilesOfUnreadableDirectories() {
+  // Arrange
+  resetMocks();
+  unreadable_directories = {"/user/test/home/dir1/oranges"};
+
+  // Act
+  update("testing", {.rescan = false}, OUTPUT_MOCK);
 
   // Assert
-  std::vector<int> expected_deleted_hash_ids = {2, 3};
+  std::vector<row_id> expected_deleted_hash_ids = {3};
   assert(last_delete_hash_id == expected_deleted_hash_ids);
 }
 
+/* --------------------------- buildDirectoryPaths -------------------------- */
+void testBuildingDirectoryPathsFromTheirParents() {
+  // Arrange
+  directory_table_row::rows test_directories{
+      {1, "c", 3}, {2, "root", -1}, {3, "b", 2}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+
+  // Act
+  std::vector<std::string> directory_paths =
+      buildDirectoryPaths(test_directories, test_directory_map, "/home");
+
+  // Assert
+  std::vector<std::string> expected_directory_paths = {
+      "/home", "/home/root/b/c", "/home/root", "/home/root/b"};
+  assert(directory_paths == expected_directory_paths);
+}
+
+/* -------------------------- groupFilesByDirectory ------------------------- */
+void testGroupingFilesByDirectoryKeepsTheirOrder() {
+  // Arrange
+  hash_table_row::rows test_hashes{{1, 2, "one.txt", uniqueTestHash()},
+                                   {2, 1, "two.txt", uniqueTestHash()},
+                                   {3, 2, "three.txt", uniqueTestHash()},
+                                   {4, -1, "four.txt", uniqueTestHash()}};
+
+  // Act
+  directory_buckets files = groupFilesByDirectory(test_hashes, 2);
+
+  // Assert
+  std::vector<std::size_t> expected_offsets = {0, 1, 2, 4};
+  std::vector<std::size_t> expected_hash_indices = {3, 1, 0, 2};
+  assert(files.offsets == expected_offsets);
+  assert(files.indices == expected_hash_indices);
+}
+
+/* ----------------------- determineDirectoriesToClear ---------------------- */
+void testClearingSharedAncestorsOnlyOnce() {
+  // Arrange
+  directory_table_row::rows test_directories{
+      {1, "root", -1}, {2, "a", 1}, {3, "b", 2}, {4, "c", 2}};
+  hash_table_row::rows test_hashes{{1, 3, "one.txt", uniqueTestHash()},
+                                   {2, 4, "two.txt", uniqueTestHash()},
+                                   {3, 1, "three.txt", uniqueTestHash()}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+
+  // Act
+  std::vector<row_id> directory_ids = determineDirectoriesToClear(
+      test_hashes, {1, 2}, test_directory_map, test_directories.size());
+
+  // Assert
+  std::vector<row_id> expected_directory_ids = {3, 2, 1, 4};
+  assert(directory_ids == expected_directory_ids);
+}
+
+void testClearingNothingWhenNoFilesAreMissing() {
+  // Arrange
+  directory_table_row::rows test_directories{{1, "root", -1}};
+  hash_table_row::rows test_hashes{{1, 1, "one.txt", uniqueTestHash()}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+
+  // Act
+  std::vector<row_id> directory_ids = determineDirectoriesToClear(
+      test_hashes, {}, test_directory_map, test_directories.size());
+
+  // Assert
+  assert(directory_ids.size() == 0);
+}
+
+void testClearingAboveChangedDirectories() {
+  // Arrange
+  directory_table_row::rows test_directories{
+      {1, "root", -1}, {2, "a", 1}, {3, "b", 1}};
+  hash_table_row::rows test_hashes{{1, 3, "one.txt", uniqueTestHash()}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+
+  // Act
+  std::vector<row_id> directory_ids =
+      determineDirectoriesToClear(test_hashes, {}, test_directory_map,
+                                  test_directories.size(), {2, -1});
+
+  // Assert
+  std::vector<row_id> expected_directory_ids = {2, 1};
+  assert(directory_ids == expected_directory_ids);
+}
+
+/* ------------------------------- rescanCache ------------------------------ */
+/*
+- Root Path: /r
+
+- Directories:
+a (changed, gained new.txt and newdir/inner.txt, lost gone.txt)
+a/b (unchanged)
+c (unchanged)
+*/
+void testRescanningOnlyListsChangedDirectories() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{
+      {1, "a", -1, nullptr, 0, 100},
+      {2, "b", 1, nullptr, 0, 200},
+      {3, "c", -1, nullptr, 0, 300}};
+  hash_table_row::rows test_hashes{
+      {1, 1, "keep.txt", uniqueTestHash(), 5, 10},
+      {2, 1, "gone.txt", uniqueTestHash(), 5, 10},
+      {3, 1, "edit.txt", uniqueTestHash(), 5, 10},
+      {4, 1, "locked.txt", uniqueTestHash(), 5, 10},
+      {5, 2, "same.txt", uniqueTestHash(), 5, 10},
+      {6, 3, "old.txt", uniqueTestHash(), 5, 10}};
+  list_directory_return = {
+      {"/r", {"a", "c"}},
+      {"/r/a",
+       {"keep.txt", "edit.txt", "locked.txt", "b", "new.txt", "newdir"}},
+      {"/r/a/newdir", {"inner.txt"}}};
+  stamp_file_return = {{"/r/a", {0, 101}},
+                       {"/r/a/b", {0, 200}},
+                       {"/r/c", {0, 300}},
+                       {"/r/a/keep.txt", {5, 10}},
+                       {"/r/a/edit.txt", {6, 11}},
+                       {"/r/a/locked.txt", {5, 99}},
+                       {"/r/a/new.txt", {3, 12}},
+                       {"/r/a/newdir", {0, 13}},
+                       {"/r/a/newdir/inner.txt", {4, 14}},
+                       {"/r/a/b/same.txt", {5, 10}},
+                       {"/r/c/old.txt", {5, 10}}};
+  unopenable_files = {"/r/a/locked.txt"};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescan_stats actual_stats = rescanCache(
+      nullptr, nullptr, false, test_hashes, test_directories,
+      test_directory_map, "/r", hash_ids_to_delete, changed_directory_ids);
+
+  // Assert
+  assert(actual_stats == (rescan_stats{1, 1, 2, 1}));
+  assert(hash_ids_to_delete == (std::vector<row_id>{2, 4}));
+  assert(changed_directory_ids == (std::vector<row_id>{1, 1}));
+  assert(last_update_hashes.size() == 1);
+  assert(last_update_hashes[0].id == 3);
+  assert(last_update_hashes[0].hash[0] == EXTRACTED_HASH_BYTE);
+  assert(last_update_hashes[0].size == 6);
+  assert(last_update_hashes[0].modified_ns == 11);
+  assert(last_update_directory_stamps ==
+         (std::vector<directory_stamp_input>{{1, 101}}));
+  assert(last_create_directory_names == (std::vector<std::string>{"newdir"}));
+  assert(last_create_directory_inputs[0].parent_id == 1);
+  assert(last_create_directory_inputs[0].modified_ns == 13);
+  assert(last_create_hash_names ==
+         (std::vector<std::string>{"new.txt", "inner.txt"}));
+  assert(last_create_hash_inputs[0].directory_id == 1);
+  assert(last_create_hash_inputs[0].size == 3);
+  assert(last_create_hash_inputs[1].directory_id == CREATED_DIRECTORY_ID);
+  assert(last_create_hash_inputs[1].modified_ns == 14);
+  assert(inserts_outside_transaction == 0);
+  assert(!in_transaction);
+}
+
+void testRescanningAnOlderCacheOnlyRecordsTimes() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{{1, "a", -1}};
+  hash_table_row::rows test_hashes{{1, 1, "same.txt", uniqueTestHash(), 5},
+                                   {2, 1, "grown.txt", uniqueTestHash(), 5}};
+  list_directory_return = {{"/r", {"a"}},
+                           {"/r/a", {"same.txt", "grown.txt", "new.txt"}}};
+  stamp_file_return = {{"/r/a", {0, 50}},
+                       {"/r/a/same.txt", {5, 20}},
+                       {"/r/a/grown.txt", {7, 21}},
+                       {"/r/a/new.txt", {1, 22}}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescan_stats actual_stats = rescanCache(
+      nullptr, nullptr, false, test_hashes, test_directories,
+      test_directory_map, "/r", hash_ids_to_delete, changed_directory_ids);
+
+  // Assert
+  assert(actual_stats == (rescan_stats{1, 0, 0, 1}));
+  assert(hash_ids_to_delete.size() == 0);
+  assert(last_create_hash_inputs.size() == 0);
+  assert(last_update_hashes.size() == 2);
+  assert(last_update_hashes[0].id == 1);
+  assert(last_update_hashes[0].hash == test_hashes[0].hash);
+  assert(last_update_hashes[0].modified_ns == 20);
+  assert(last_update_hashes[1].id == 2);
+  assert(last_update_hashes[1].hash[0] == EXTRACTED_HASH_BYTE);
+  assert(last_update_directory_stamps ==
+         (std::vector<directory_stamp_input>{{1, 50}}));
+}
+
+void testRescanningOnlyFingerprintsFilesItReads() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{{1, "a", -1, nullptr, 0, 40}};
+  hash_table_row::rows test_hashes{
+      {1, 1, "same.txt", uniqueTestHash(), 5, 10},
+      {2, 1, "edit.txt", uniqueTestHash(), 5, 10},
+      {3, 1, "tmpfs.txt", uniqueTestHash(), 5, 10},
+      {4, 1, "stored.txt", uniqueTestHash(), 5, 10}};
+  list_directory_return = {
+      {"/r", {"a"}},
+      {"/r/a",
+       {"same.txt", "edit.txt", "tmpfs.txt", "stored.txt", "new.txt"}}};
+  stamp_file_return = {{"/r/a", {0, 41}},
+                       {"/r/a/same.txt", {5, 10}},
+                       {"/r/a/edit.txt", {6, 11}},
+                       {"/r/a/tmpfs.txt", {6, 12}},
+                       {"/r/a/stored.txt", {6, 12}},
+                       {"/r/a/new.txt", {1, 13}}};
+  unmapped_files = {"/r/a/tmpfs.txt"};
+  stored_files = {"/r/a/stored.txt"};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescanCache(nullptr, nullptr, false, test_hashes, test_directories,
+              test_directory_map, "/r", hash_ids_to_delete,
+              changed_directory_ids);
+
+  // Assert
+  assert(last_fingerprint_extents_paths ==
+         (std::vector<std::string>{"/r/a/edit.txt", "/r/a/tmpfs.txt",
+                                   "/r/a/new.txt"}));
+  assert(last_update_hashes.size() == 3);
+  assert(last_update_hashes[0].extents != nullptr);
+  assert(last_update_hashes[1].extents == nullptr);
+  assert(last_update_hashes[2].extents == nullptr);
+  assert(last_create_hash_inputs[0].extents != nullptr);
+}
+
+void testRescanningSkipsDirectoriesAboveTheScannedPaths() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{
+      {1, "home", -1, nullptr, 0, NOT_SCANNED_MODIFIED_NS},
+      {2, "a", 1, nullptr, 0, 40}};
+  hash_table_row::rows test_hashes{{1, 2, "one.txt", uniqueTestHash(), 5, 10}};
+  list_directory_return = {{"/r", {"home"}}, {"/r/home", {"a", "other"}}};
+  stamp_file_return = {{"/r/home", {0, 1}},
+                       {"/r/home/a", {0, 40}},
+                       {"/r/home/a/one.txt", {5, 10}}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescan_stats actual_stats = rescanCache(
+      nullptr, nullptr, false, test_hashes, test_directories,
+      test_directory_map, "/r", hash_ids_to_delete, changed_directory_ids);
+
+  // Assert
+  assert(actual_stats == (rescan_stats{0, 0, 0, 0}));
+  assert(hash_ids_to_delete.size() == 0);
+  assert(changed_directory_ids.size() == 0);
+  assert(last_update_directory_stamps.size() == 0);
+}
+
+void testRescanningHashesFilesEditedInUnchangedDirectories() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{{1, "a", -1, nullptr, 0, 40}};
+  hash_table_row::rows test_hashes{
+      {1, 1, "same.txt", uniqueTestHash(), 5, 10},
+      {2, 1, "grown.txt", uniqueTestHash(), 5, 10}};
+  stamp_file_return = {{"/r/a", {0, 40}},
+                       {"/r/a/same.txt", {5, 10}},
+                       {"/r/a/grown.txt", {9, 10}}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescan_stats actual_stats = rescanCache(
+      nullptr, nullptr, false, test_hashes, test_directories,
+      test_directory_map, "/r", hash_ids_to_delete, changed_directory_ids);
+
+  // Assert
+  assert(actual_stats == (rescan_stats{0, 0, 0, 1}));
+  assert(hash_ids_to_delete.size() == 0);
+  assert(changed_directory_ids == (std::vector<row_id>{1}));
+  assert(last_update_hashes.size() == 1);
+  assert(last_update_hashes[0].id == 2);
+  assert(last_update_hashes[0].size == 9);
+  assert(last_update_hash_digests[0].bytes[0] == EXTRACTED_HASH_BYTE);
+  assert(last_update_directory_stamps.size() == 0);
+}
+
+void testRescanningRemovesTheFilesOfMissingDirectories() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{{1, "a", -1, nullptr, 0, 40}};
+  hash_table_row::rows test_hashes{{1, 1, "one.txt", uniqueTestHash(), 5, 10},
+                                   {2, -1, "top.txt", uniqueTestHash(), 5, 10}};
+  list_directory_return = {{"/r", {"top.txt"}}};
+  stamp_file_return = {{"/r/top.txt", {5, 10}}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescanCache(nullptr, nullptr, false, test_hashes, test_directories,
+              test_directory_map, "/r", hash_ids_to_delete,
+              changed_directory_ids);
+
+  // Assert
+  assert(hash_ids_to_delete == (std::vector<row_id>{1}));
+  assert(last_update_directory_stamps.size() == 0);
+}
+
+/*
+- Root Path: /r (holds top.txt, gained new.txt and newdir/inner.txt)
+
+- Directories:
+a (unchanged)
+*/
+void testRescanningAddsNewEntriesUnderTheRoot() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{{1, "a", -1, nullptr, 0, 40}};
+  hash_table_row::rows test_hashes{{1, 1, "one.txt", uniqueTestHash(), 5, 10},
+                                   {2, -1, "top.txt", uniqueTestHash(), 5, 10}};
+  list_directory_return = {{"/r", {"top.txt", "a", "new.txt", "newdir"}},
+                           {"/r/a", {"one.txt"}},
+                           {"/r/newdir", {"inner.txt"}}};
+  stamp_file_return = {{"/r/a", {0, 40}},
+                       {"/r/a/one.txt", {5, 10}},
+                       {"/r/top.txt", {5, 10}},
+                       {"/r/new.txt", {3, 12}},
+                       {"/r/newdir", {0, 13}},
+                       {"/r/newdir/inner.txt", {4, 14}}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescan_stats actual_stats = rescanCache(
+      nullptr, nullptr, false, test_hashes, test_directories,
+      test_directory_map, "/r", hash_ids_to_delete, changed_directory_ids);
+
+  // Assert
+  assert(actual_stats == (rescan_stats{1, 1, 2, 0}));
+  assert(hash_ids_to_delete.size() == 0);
+  assert(changed_directory_ids == (std::vector<row_id>{-1}));
+  assert(last_update_directory_stamps.size() == 0);
+  assert(last_create_directory_names == (std::vector<std::string>{"newdir"}));
+  assert(last_create_directory_inputs[0].parent_id == -1);
+  assert(last_create_hash_names ==
+         (std::vector<std::string>{"new.txt", "inner.txt"}));
+  assert(last_create_hash_inputs[0].directory_id == -1);
+  assert(last_create_hash_inputs[1].directory_id == CREATED_DIRECTORY_ID);
+  assert(inserts_outside_transaction == 0);
+}
+
+void testRescanningLeavesUnreadableNewDirectoriesOut() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{{1, "a", -1, nullptr, 0, 40}};
+  hash_table_row::rows test_hashes{{1, 1, "one.txt", uniqueTestHash(), 5, 10}};
+  list_directory_return = {{"/r/a", {"one.txt", "locked"}},
+                           {"/r/a/locked", {}}};
+  unreadable_directories = {"/r/a/locked"};
+  stamp_file_return = {{"/r/a", {0, 41}},
+                       {"/r/a/one.txt", {5, 10}},
+                       {"/r/a/locked", {0, 15}}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescan_stats actual_stats = rescanCache(
+      nullptr, nullptr, false, test_hashes, test_directories,
+      test_directory_map, "/r", hash_ids_to_delete, changed_directory_ids);
+
+  // Assert
+  assert(actual_stats == (rescan_stats{1, 0, 0, 0}));
+  assert(last_create_directory_inputs.size() == 0);
+  assert(changed_directory_ids.size() == 0);
+  assert(last_update_directory_stamps ==
+         (std::vector<directory_stamp_input>{{1, 41}}));
+}
+
+hash placeholderTestHash() {
+  hash placeholder = uniqueTestHash();
+  std::memcpy(placeholder + MD5_DIGEST_LENGTH - PLACEHOLDER_MARKER_LENGTH,
+              PLACEHOLDER_MARKER, PLACEHOLDER_MARKER_LENGTH);
+  return placeholder;
+}
+
+void testRescanningHashesLockstepPlaceholders() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{{1, "a", -1, nullptr, 0, 40}};
+  hash_table_row::rows test_hashes{
+      {1, 1, "unique.txt", placeholderTestHash(), 5, 10},
+      {2, 1, "gone.txt", placeholderTestHash(), 5, 10},
+      {3, 1, "real.txt", uniqueTestHash(), 5, 10}};
+  stamp_file_return = {{"/r/a", {0, 40}},
+                       {"/r/a/unique.txt", {5, 10}},
+                       {"/r/a/real.txt", {5, 10}}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescan_stats actual_stats = rescanCache(
+      nullptr, nullptr, true, test_hashes, test_directories,
+      test_directory_map, "/r", hash_ids_to_delete, changed_directory_ids);
+
+  // Assert
+  assert(actual_stats == (rescan_stats{0, 0, 0, 1}));
+  assert(hash_ids_to_delete == (std::vector<row_id>{2}));
+  assert(changed_directory_ids == (std::vector<row_id>{1}));
+  assert(last_update_hashes.size() == 1);
+  assert(last_update_hashes[0].id == 1);
+  assert(last_update_hash_digests[0].bytes[0] == EXTRACTED_HASH_BYTE);
+  assert(last_update_hashes[0].modified_ns == 10);
+}
+
+void testRescanningKeepsPlaceholderLookalikesOfOtherCaches() {
+  // Arrange
+  resetMocks();
+  directory_table_row::rows test_directories{{1, "a", -1, nullptr, 0, 40}};
+  hash_table_row::rows test_hashes{
+      {1, 1, "unique.txt", placeholderTestHash(), 5, 10}};
+  stamp_file_return = {{"/r/a", {0, 40}}, {"/r/a/unique.txt", {5, 10}}};
+  parent_directory_map_const test_directory_map =
+      buildDirectoryRowMap(test_directories);
+  std::vector<row_id> hash_ids_to_delete{};
+  std::vector<row_id> changed_directory_ids{};
+
+  // Act
+  rescan_stats actual_stats = rescanCache(
+      nullptr, nullptr, false, test_hashes, test_directories,
+      test_directory_map, "/r", hash_ids_to_delete, changed_directory_ids);
+
+  // Assert
+  assert(actual_stats == (rescan_stats{0, 0, 0, 0}));
+  assert(last_update_hashes.size() == 0);
+  assert(last_fingerprint_extents_paths.size() == 0);
+}
+
+void testUpdateClearsThePlaceholdersOptionAfterRescanning() {
+  // Arrange
+  resetMocks();
+  fetch_placeholders_option_return = "1";
+
+  // Act
+  update("testing", {.rescan = true}, OUTPUT_MOCK);
+
+  // Assert
+  std::vector<cache_option_input> expected_cache_options{
+      {LOCKSTEP_PLACEHOLDERS_OPTION, "0"}};
+  assert(last_create_cache_option == expected_cache_options);
+}
+
 void testPrintingTheNumberOfFilesWeDelete() {
   // Arrange
   resetMocks();
 
   // Act
-  update("testing", OUTPUT_MOCK);
+  update("testing", {.rescan = false}, OUTPUT_MOCK);
 
   // Assert
   // Regex and search for the delete file numbers.
 }
 
-int main() { testUpdateDeletesMissingFiles(); }
+int main() {
+  testUpdateDeletesMissingFiles();
+  testUpdateClearsDigestsAboveMissingFiles();
+  testUpdateKeepsFilesOfUnreadableDirectories();
+  testBuildingDirectoryPathsFromTheirParents();
+  testGroupingFilesByDirectoryKeepsTheirOrder();
+  testClearingSharedAncestorsOnlyOnce();
+  testClearingNothingWhenNoFilesAreMissing();
+  testClearingAboveChangedDirectories();
+  testRescanningOnlyListsChangedDirectories();
+  testRescanningAnOlderCacheOnlyRecordsTimes();
+  testRescanningOnlyFingerprintsFilesItReads();
+  testRescanningSkipsDirectoriesAboveTheScannedPaths();
+  testRescanningHashesFilesEditedInUnchangedDirectories();
+  testRescanningRemovesTheFilesOfMissingDirectories();
+  testRescanningAddsNewEntriesUnderTheRoot();
+  testRescanningLeavesUnreadableNewDirectoriesOut();
+  testRescanningHashesLockstepPlaceholders();
+  testRescanningKeepsPlaceholderLookalikesOfOtherCaches();
+  testUpdateClearsThePlaceholdersOptionAfterRescanning();
+}